@@ -127,6 +127,7 @@ namespace Mapper
             UseInstances        = 0x2600,
             Version             = 0x2700,
             Extra               = 0x2800,
+            Jit                 = 0x2900,
         }
     }
 
@@ -192,7 +193,55 @@ namespace Mapper
         public Graph()
             { _graph = mpr_graph_new(0); }
 
-        IntPtr _graph;
+        internal IntPtr _graph;
+    }
+
+    public class Query
+    {
+        [DllImport("mapper", CharSet = CharSet.Ansi, CallingConvention = CallingConvention.StdCall)]
+        private static extern IntPtr mpr_graph_new_qry(IntPtr graph, int type, IntPtr dev, int dir,
+                                                       IntPtr handler, IntPtr data);
+        public Query(Graph graph, Type type, Direction dir = Direction.Any)
+            { _qry = mpr_graph_new_qry(graph._graph, (int) type, IntPtr.Zero, (int) dir,
+                                       IntPtr.Zero, IntPtr.Zero); }
+
+        [DllImport("mapper", CharSet = CharSet.Ansi, CallingConvention = CallingConvention.StdCall)]
+        private static extern void mpr_qry_free(IntPtr qry);
+        ~Query()
+            { mpr_qry_free(_qry); }
+
+        [DllImport("mapper", CharSet = CharSet.Ansi, CallingConvention = CallingConvention.StdCall)]
+        unsafe private static extern void mpr_qry_add_filter(IntPtr qry, int prop,
+                                                             [MarshalAs(UnmanagedType.LPStr)] string key,
+                                                             int len, int type, void* value, int op);
+        unsafe public Query filter(Property.Id prop, int value, Operator op = Operator.IsEqual)
+        {
+            mpr_qry_add_filter(_qry, (int) prop, null, 1, (int) Type.Int32, (void*)&value, (int) op);
+            return this;
+        }
+        unsafe public Query filter(Property.Id prop, float value, Operator op = Operator.IsEqual)
+        {
+            mpr_qry_add_filter(_qry, (int) prop, null, 1, (int) Type.Float, (void*)&value, (int) op);
+            return this;
+        }
+        unsafe public Query filter(Property.Id prop, [MarshalAs(UnmanagedType.LPStr)] string value,
+                                   Operator op = Operator.IsEqual)
+        {
+            // the query keeps its own copy of the value
+            IntPtr str = Marshal.StringToHGlobalAnsi(value);
+            mpr_qry_add_filter(_qry, (int) prop, null, 1, (int) Type.String, (void*)str, (int) op);
+            Marshal.FreeHGlobal(str);
+            return this;
+        }
+
+        [DllImport("mapper", CharSet = CharSet.Ansi, CallingConvention = CallingConvention.StdCall)]
+        private static extern int mpr_qry_get_size(IntPtr qry);
+        public int getSize()
+            { return mpr_qry_get_size(_qry); }
+
+        // public Object getObject(int idx);
+
+        internal IntPtr _qry;
     }
 
     public class Signal : Object
@@ -212,6 +261,8 @@ namespace Mapper
             None,           //!< No stealing will take place.
             StealOldest,    //!< Steal the oldest instance.
             StealNewest,    //!< Steal the newest instance.
+            StealStalest,   //!< Steal the least recently updated instance.
+            StealQuietest,  //!< Steal the instance with the smallest magnitude.
         }
 
         [DllImport("mapper", CharSet = CharSet.Ansi, CallingConvention = CallingConvention.StdCall)]
@@ -312,6 +363,10 @@ namespace Mapper
             Undefined,        //!< Not yet defined
             UDP,              //!< Map updates are sent using UDP.
             TCP,              //!< Map updates are sent using TCP.
+            UDPPacked,        //!< UDP with instance updates packed per signal.
+            TCPPacked,        //!< TCP with instance updates packed per signal.
+            UDPCompact,       //!< UDP with unlabelled instance and slot ids.
+            TCPCompact,       //!< TCP with unlabelled instance and slot ids.
         }
 
         [DllImport("mapper", CharSet = CharSet.Ansi, CallingConvention = CallingConvention.StdCall)]
@@ -351,6 +351,24 @@ void mpr_sig_free(mpr_sig sig);
  *                      length property. */
 void mpr_sig_set_value(mpr_sig sig, mpr_id inst, int length, mpr_type type, const void *value);
 
+/*! Update the values of several signal instances at once.  This is equivalent
+ *  to calling mpr_sig_set_value() for each instance, but the update time is
+ *  shared by the whole batch and each outgoing map is evaluated once for a
+ *  group of instances rather than once per instance.
+ *  \param sig          The signal to operate on.
+ *  \param num_inst     The number of instances to update.
+ *  \param insts        An array of num_inst instance identifiers.
+ *  \param length       Length of each instance value; must be equal to the
+ *                      signal length.
+ *  \param type         Data type of the values argument.
+ *  \param values       A buffer holding the value of each instance in the same
+ *                      order as insts, or 0 to release all of the instances.
+ *                      Values containing NaN are skipped.
+ *  \param stride       Distance in elements between the starts of consecutive
+ *                      instance values, or 0 if they are tightly packed. */
+void mpr_sig_set_values(mpr_sig sig, int num_inst, const mpr_id *insts, int length,
+                        mpr_type type, const void *values, int stride);
+
 /*! Get the value of a signal instance.
  *  \param sig          The signal to operate on.
  *  \param inst         A pointer to the identifier of the instance to query,
@@ -739,6 +757,59 @@ int mpr_graph_remove_cb(mpr_graph g, mpr_graph_handler *h, const void *data);
  *  \return             A list of results.  Use mpr_list_get_next() to iterate. */
 mpr_list mpr_graph_get_objs(mpr_graph g, int types);
 
+/*! Create a live query. Unlike a list, whose filters are rerun each time it is
+ *  iterated, a live query keeps its results up to date as objects are added,
+ *  modified or removed, using the same events that are passed to graph
+ *  callbacks. The initial results can be read as soon as it is created.
+ *  \param g            The graph to query.
+ *  \param type         The type of object to match: MPR_DEV, MPR_SIG or MPR_MAP.
+ *  \param dev          If not NULL, only match signals or maps of this device.
+ *  \param dir          The direction of signals or maps to match if a device
+ *                      is given, as with mpr_dev_get_sigs() and
+ *                      mpr_dev_get_maps().
+ *  \param h            Optional callback for changes to the results. It is
+ *                      called with MPR_OBJ_NEW for objects that start matching,
+ *                      MPR_OBJ_REM for objects that stop matching or are
+ *                      removed, and with the graph event for matching objects
+ *                      that are modified or expire.
+ *  \param data         A user-defined pointer to be passed to the callback
+ *                      for context.
+ *  \return             The new query, or NULL if it could not be created.
+ *                      Free it with mpr_qry_free(); any queries left are
+ *                      freed along with the graph. */
+mpr_qry mpr_graph_new_qry(mpr_graph g, mpr_type type, mpr_dev dev, mpr_dir dir,
+                          mpr_graph_handler *h, const void *data);
+
+/*! Add a property condition to a live query. Conditions are combined with AND
+ *  and behave as in mpr_list_filter(); the value is copied. Results that no
+ *  longer match are removed immediately.
+ *  \param q            The live query to update.
+ *  \param prop         Symbolic identifier of the property to look for.
+ *  \param key          The name of the property to look for if prop is
+ *                      MPR_PROP_EXTRA.
+ *  \param len          The value length.
+ *  \param type         The value type.
+ *  \param value        The value.
+ *  \param op           The comparison operator. */
+void mpr_qry_add_filter(mpr_qry q, mpr_prop prop, const char *key, int len,
+                        mpr_type type, const void *value, mpr_op op);
+
+/*! Get the number of objects matching a live query.
+ *  \param q            The live query.
+ *  \return             The number of results. */
+int mpr_qry_get_size(mpr_qry q);
+
+/*! Get an object matching a live query by index. The order of the results is
+ *  not defined and may change when the results change.
+ *  \param q            The live query.
+ *  \param idx          The index of the result, less than mpr_qry_get_size().
+ *  \return             The object, or NULL if the index is out of range. */
+mpr_obj mpr_qry_get_idx(mpr_qry q, unsigned int idx);
+
+/*! Free a live query.
+ *  \param q            The live query to free. */
+void mpr_qry_free(mpr_qry q);
+
 /** @} */ // end of group Graphs
 
 /***** Time *****/
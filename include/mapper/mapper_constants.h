@@ -78,6 +78,7 @@ typedef enum {
     MPR_PROP_USE_INST       = 0x2600,
     MPR_PROP_VERSION        = 0x2700,
     MPR_PROP_EXTRA          = 0x2800,
+    MPR_PROP_JIT            = 0x2900,   //!< Local only, never sent to peers.
 } mpr_prop;
 
 /*! A 64-bit data structure containing an NTP-compatible time tag, as
@@ -119,6 +120,14 @@ typedef enum {
     MPR_PROTO_UNDEFINED,        //!< Not yet defined
     MPR_PROTO_UDP,              //!< Map updates are sent using UDP.
     MPR_PROTO_TCP,              //!< Map updates are sent using TCP.
+    MPR_PROTO_UDP_PACKED,       /*!< As MPR_PROTO_UDP, with instance updates
+                                 *   packed into one message per signal. */
+    MPR_PROTO_TCP_PACKED,       /*!< As MPR_PROTO_TCP, with instance updates
+                                 *   packed into one message per signal. */
+    MPR_PROTO_UDP_COMPACT,      /*!< As MPR_PROTO_UDP, with instance and slot
+                                 *   ids sent without string labels. */
+    MPR_PROTO_TCP_COMPACT,      /*!< As MPR_PROTO_TCP, with instance and slot
+                                 *   ids sent without string labels. */
     MPR_NUM_PROTO
 } mpr_proto;
 
@@ -152,6 +161,8 @@ typedef enum {
     MPR_STEAL_NONE,     //!< No stealing will take place.
     MPR_STEAL_OLDEST,   //!< Steal the oldest instance.
     MPR_STEAL_NEWEST,   //!< Steal the newest instance.
+    MPR_STEAL_STALEST,  //!< Steal the least recently updated instance.
+    MPR_STEAL_QUIETEST, //!< Steal the instance with the smallest magnitude.
 } mpr_steal_type;
 
 /*! The set of possible graph events, used to inform callbacks.
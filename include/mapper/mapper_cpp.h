@@ -297,6 +297,66 @@ namespace mapper {
         mpr_list _list;
     };
 
+    /*! Query objects provide a live set of results from a mapper::Graph that
+     *  is kept up to date as Objects are added, modified, or removed. */
+    template <class T>
+    class Query
+    {
+    public:
+        Query(mpr_qry qry)
+        {
+            _qry = qry;
+            _refcount_ptr = (int*)malloc(sizeof(int));
+            *_refcount_ptr = 1;
+        }
+        Query(const Query& orig)
+        {
+            _qry = orig._qry;
+            _refcount_ptr = orig._refcount_ptr;
+            ++(*_refcount_ptr);
+        }
+        ~Query()
+        {
+            if (--(*_refcount_ptr) <= 0) {
+                if (_qry)
+                    mpr_qry_free(_qry);
+                free(_refcount_ptr);
+            }
+        }
+        operator mpr_qry() const
+            { return _qry; }
+
+        int size() const
+            { return mpr_qry_get_size(_qry); }
+
+        /*! Add a Property condition to this Query.
+         *  \param p            Property to match.
+         *  \param op           The comparison operator.
+         *  \return             Self. */
+        Query& filter(const Property& p, mpr_op op);
+
+        /*! Retrieve an indexed result of the Query.
+         *  \param idx           The index of the result to retrieve.
+         *  \return              The retrieved Object. */
+        T operator [] (int idx) const
+            { return T(mpr_qry_get_idx(_qry, idx)); }
+
+        /*! Convert the current Query results to a std::vector of CLASS_NAME.
+         *  \return              The converted Query results. */
+        operator std::vector<T>() const
+        {
+            std::vector<T> vec;
+            int size = mpr_qry_get_size(_qry);
+            for (int i = 0; i < size; i++)
+                vec.push_back(T(mpr_qry_get_idx(_qry, i)));
+            return vec;
+        }
+
+    private:
+        mpr_qry _qry;
+        int* _refcount_ptr;
+    };
+
     /*! Objects provide a generic representation of Devices, Signals, and Maps. */
     class Object
     {
@@ -619,6 +679,27 @@ namespace mapper {
         template <typename T>
         Signal& set_value(std::vector<T> val)
             { return set_value(&val[0], (int)val.size()); }
+
+        /* Bulk instance update functions */
+        Signal& set_values(int num_inst, const mpr_id *ids, const int *val, int len,
+                           int stride=0)
+            { RETURN_SELF(mpr_sig_set_values(_obj, num_inst, ids, len, MPR_INT32,
+                                             val, stride)); }
+        Signal& set_values(int num_inst, const mpr_id *ids, const float *val, int len,
+                           int stride=0)
+            { RETURN_SELF(mpr_sig_set_values(_obj, num_inst, ids, len, MPR_FLT,
+                                             val, stride)); }
+        Signal& set_values(int num_inst, const mpr_id *ids, const double *val, int len,
+                           int stride=0)
+            { RETURN_SELF(mpr_sig_set_values(_obj, num_inst, ids, len, MPR_DBL,
+                                             val, stride)); }
+        template <typename T>
+        Signal& set_values(const std::vector<mpr_id>& ids, const std::vector<T>& val)
+        {
+            int num_inst = (int)ids.size();
+            return set_values(num_inst, ids.data(), val.data(),
+                              num_inst ? (int)val.size() / num_inst : 0);
+        }
         const void *value() const
             { return mpr_sig_get_value(_obj, 0, 0); }
         const void *value(Time time) const
@@ -957,6 +1038,46 @@ namespace mapper {
         List<Map> maps() const
             { return List<Map>(mpr_graph_get_objs(_graph, MPR_MAP)); }
 
+        // live queries
+        /*! Create a live Query of the Devices in this Graph.
+         *  \param h        Optional callback for changes to the results.
+         *  \param data     A user-defined pointer to be passed to the
+         *                  callback for context.
+         *  \return         The new Query. */
+        Query<Device> device_query(mpr_graph_handler *h=0, void *data=0) const
+        {
+            return Query<Device>(mpr_graph_new_qry(_graph, MPR_DEV, 0,
+                                                   MPR_DIR_ANY, h, data));
+        }
+
+        /*! Create a live Query of the Signals in this Graph.
+         *  \param dev      Only match Signals of this Device if not NULL.
+         *  \param dir      The direction of Signals to match.
+         *  \param h        Optional callback for changes to the results.
+         *  \param data     A user-defined pointer to be passed to the
+         *                  callback for context.
+         *  \return         The new Query. */
+        Query<Signal> signal_query(mpr_dev dev=0, mpr_dir dir=MPR_DIR_ANY,
+                                   mpr_graph_handler *h=0, void *data=0) const
+        {
+            return Query<Signal>(mpr_graph_new_qry(_graph, MPR_SIG, dev, dir,
+                                                   h, data));
+        }
+
+        /*! Create a live Query of the Maps in this Graph.
+         *  \param dev      Only match Maps of this Device if not NULL.
+         *  \param dir      The direction of Maps to match.
+         *  \param h        Optional callback for changes to the results.
+         *  \param data     A user-defined pointer to be passed to the
+         *                  callback for context.
+         *  \return         The new Query. */
+        Query<Map> map_query(mpr_dev dev=0, mpr_dir dir=MPR_DIR_ANY,
+                             mpr_graph_handler *h=0, void *data=0) const
+        {
+            return Query<Map>(mpr_graph_new_qry(_graph, MPR_MAP, dev, dir,
+                                                h, data));
+        }
+
     private:
         mpr_graph _graph;
         int* _refcount_ptr;
@@ -1356,6 +1477,13 @@ namespace mapper {
         return (*this);
     }
 
+    template <class T>
+    Query<T>& Query<T>::filter(const Property& p, mpr_op op)
+    {
+        mpr_qry_add_filter(_qry, p.prop, p.key, p.len, p.type, p.val, op);
+        return (*this);
+    }
+
     template <class T>
     template <typename... Values>
     List<T>& List<T>::set_property(const Values... vals)
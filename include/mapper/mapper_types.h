@@ -26,6 +26,10 @@ typedef void **mpr_list;
 //! This can be retrieved by calling mpr_obj_graph().
 typedef void *mpr_graph;
 
+/*! An internal structure holding the results of a live graph query, created
+ *  with mpr_graph_new_qry(). */
+typedef void *mpr_qry;
+
 //! An internal structure defining a grouping of signals.
 typedef int mpr_sig_group;
 
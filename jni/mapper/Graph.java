@@ -111,6 +111,19 @@ public class Graph
     public mapper.List<mapper.Map> maps()
         { return new mapper.List<mapper.Map>(maps(_graph)); }
 
+    // live queries
+    private native long deviceQuery(long graph);
+    public mapper.Query<mapper.Device> deviceQuery()
+        { return new mapper.Query<mapper.Device>(deviceQuery(_graph)); }
+
+    private native long signalQuery(long graph);
+    public mapper.Query<mapper.Signal> signalQuery()
+        { return new mapper.Query<mapper.Signal>(signalQuery(_graph)); }
+
+    private native long mapQuery(long graph);
+    public mapper.Query<mapper.Map> mapQuery()
+        { return new mapper.Query<mapper.Map>(mapQuery(_graph)); }
+
     /* Note: this is _not_ guaranteed to run, the user should still call free()
      * explicitly when the graph is no longer needed. */
     protected void finalize() throws Throwable {
@@ -3,14 +3,14 @@ package mapper;
 
 /*! Possible operations for composing graph queries. */
 public enum Operator {
-    NEX (0),
-    EQ  (1),
-    EX  (2),
-    GT  (3),
-    GTE (4),
-    LT  (5),
-    LTE (6),
-    NEQ (7);
+    NEX (1),
+    EQ  (2),
+    EX  (3),
+    GT  (4),
+    GTE (5),
+    LT  (6),
+    LTE (7),
+    NEQ (8);
 
     Operator(int value) {
         this._value = value;
@@ -44,7 +44,8 @@ public enum Property
     UNIT                (0x2500),
     USE_INST            (0x2600),
     VERSION             (0x2700),
-    EXTRA               (0x2800);
+    EXTRA               (0x2800),
+    JIT                 (0x2900);
 
     Property(int value) {
         this._value = value;
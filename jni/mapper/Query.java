@@ -0,0 +1,74 @@
+package mapper;
+
+import java.util.Iterator;
+
+public class Query<T extends AbstractObject> implements Iterable<T> {
+
+    private native T _newObject(long ptr);
+    private native long _get(long query, int index);
+    private native int _size(long query);
+    private native void _free(long query);
+
+    private native void _filter(long query, int id, String key,
+                                java.lang.Object value, int op);
+
+    /* constructor */
+    public Query(long queryptr) {
+        _query = queryptr;
+    }
+
+    /* free */
+    public void free() {
+        if (_query != 0)
+            _free(_query);
+        _query = 0;
+    }
+
+    public T get(int index) {
+        return _newObject(_get(_query, index));
+    }
+
+    public int size() {
+        return _size(_query);
+    }
+
+    public boolean isEmpty() {
+        return _size(_query) == 0;
+    }
+
+    public Iterator<T> iterator() {
+        Iterator<T> it = new Iterator<T>() {
+            private int _index = 0;
+
+            @Override
+            public boolean hasNext() { return _index < _size(_query); }
+
+            @Override
+            public T next() {
+                if (_index >= _size(_query))
+                    return null;
+                return _newObject(_get(_query, _index++));
+            }
+
+            @Override
+            public void remove() {
+                throw new UnsupportedOperationException();
+            }
+        };
+        return it;
+    }
+
+    public Query filter(String key, java.lang.Object value, Operator operator) {
+        _filter(_query, 0, key, value, operator.value());
+        return this;
+    }
+    public Query filter(Property id, java.lang.Object value, Operator operator) {
+        _filter(_query, id.value(), null, value, operator.value());
+        return this;
+    }
+
+    /* Note: queries are freed along with their graph, so they are not freed
+     * on finalize; call free() explicitly to release one earlier. */
+
+    private long _query;
+}
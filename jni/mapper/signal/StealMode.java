@@ -5,7 +5,9 @@ package mapper.signal;
 public enum StealMode {
     NONE    (0),
     OLDEST  (1),
-    NEWEST  (2);
+    NEWEST  (2),
+    STALEST (3),
+    QUIETEST(4);
 
     StealMode(int value) {
         this._value = value;
@@ -10,6 +10,7 @@
 #include "mapper_Graph.h"
 #include "mapper_List.h"
 #include "mapper_Map.h"
+#include "mapper_Query.h"
 #include "mapper_Signal_Instance.h"
 #include "mapper_Signal.h"
 #include "mapper_Time.h"
@@ -1243,6 +1244,27 @@ JNIEXPORT jlong JNICALL Java_mapper_Graph_maps
     return g ? jlong_ptr(mpr_graph_get_objs(g, MPR_MAP)) : 0;
 }
 
+JNIEXPORT jlong JNICALL Java_mapper_Graph_deviceQuery
+  (JNIEnv *env, jobject obj, jlong jgraph)
+{
+    mpr_graph g = (mpr_graph) ptr_jlong(jgraph);
+    return g ? jlong_ptr(mpr_graph_new_qry(g, MPR_DEV, 0, MPR_DIR_ANY, 0, 0)) : 0;
+}
+
+JNIEXPORT jlong JNICALL Java_mapper_Graph_signalQuery
+  (JNIEnv *env, jobject obj, jlong jgraph)
+{
+    mpr_graph g = (mpr_graph) ptr_jlong(jgraph);
+    return g ? jlong_ptr(mpr_graph_new_qry(g, MPR_SIG, 0, MPR_DIR_ANY, 0, 0)) : 0;
+}
+
+JNIEXPORT jlong JNICALL Java_mapper_Graph_mapQuery
+  (JNIEnv *env, jobject obj, jlong jgraph)
+{
+    mpr_graph g = (mpr_graph) ptr_jlong(jgraph);
+    return g ? jlong_ptr(mpr_graph_new_qry(g, MPR_MAP, 0, MPR_DIR_ANY, 0, 0)) : 0;
+}
+
 /**** mapper_Device.h ****/
 
 JNIEXPORT jlong JNICALL Java_mapper_Device_mapperDeviceNew
@@ -1631,6 +1653,116 @@ JNIEXPORT jboolean JNICALL Java_mapper_Map_ready
     return map ? (mpr_map_get_is_ready(map)) : 0;
 }
 
+/**** mapper_Query.h ****/
+
+JNIEXPORT jobject JNICALL Java_mapper_Query__1newObject
+  (JNIEnv *env, jobject jobj, jlong ptr)
+{
+    mpr_obj mobj = (mpr_obj)ptr_jlong(ptr);
+    if (!mobj)
+        return NULL;
+    return get_jobject_from_mpr_obj(mobj);
+}
+
+JNIEXPORT jlong JNICALL Java_mapper_Query__1get
+  (JNIEnv *env, jobject obj, jlong query, jint idx)
+{
+    mpr_qry q = (mpr_qry) ptr_jlong(query);
+    return (q && idx >= 0) ? jlong_ptr(mpr_qry_get_idx(q, idx)) : 0;
+}
+
+JNIEXPORT jint JNICALL Java_mapper_Query__1size
+  (JNIEnv *env, jobject obj, jlong query)
+{
+    mpr_qry q = (mpr_qry) ptr_jlong(query);
+    return q ? mpr_qry_get_size(q) : 0;
+}
+
+JNIEXPORT void JNICALL Java_mapper_Query__1free
+  (JNIEnv *env, jobject obj, jlong query)
+{
+    mpr_qry q = (mpr_qry) ptr_jlong(query);
+    if (q)
+        mpr_qry_free(q);
+}
+
+JNIEXPORT void JNICALL Java_mapper_Query__1filter
+  (JNIEnv *env, jobject obj, jlong query, jint id, jstring jkey, jobject jval,
+   jint op)
+{
+    mpr_qry q = (mpr_qry) ptr_jlong(query);
+    const char *ckey = 0;
+    jmethodID mid;
+    if (!q || !jval)
+        return;
+    jclass cls = (*env)->GetObjectClass(env, jval);
+    if (!cls)
+        return;
+    if (jkey) {
+        ckey = (*env)->GetStringUTFChars(env, jkey, 0);
+        id = MPR_PROP_UNKNOWN;
+    }
+
+    // the query copies the value, so it can be released as soon as it is added
+    if ((*env)->IsInstanceOf(env, jval, (*env)->FindClass(env, "java/lang/Boolean"))) {
+        mid = (*env)->GetMethodID(env, cls, "booleanValue", "()Z");
+        int val = (JNI_TRUE == (*env)->CallBooleanMethod(env, jval, mid));
+        mpr_qry_add_filter(q, id, ckey, 1, MPR_BOOL, &val, op);
+    }
+    else if ((*env)->IsInstanceOf(env, jval, (*env)->FindClass(env, "java/lang/Double"))) {
+        mid = (*env)->GetMethodID(env, cls, "doubleValue", "()D");
+        double val = (*env)->CallDoubleMethod(env, jval, mid);
+        mpr_qry_add_filter(q, id, ckey, 1, MPR_DBL, &val, op);
+    }
+    else if ((*env)->IsInstanceOf(env, jval, (*env)->FindClass(env, "java/lang/Float"))) {
+        mid = (*env)->GetMethodID(env, cls, "floatValue", "()F");
+        float val = (*env)->CallFloatMethod(env, jval, mid);
+        mpr_qry_add_filter(q, id, ckey, 1, MPR_FLT, &val, op);
+    }
+    else if ((*env)->IsInstanceOf(env, jval, (*env)->FindClass(env, "java/lang/Integer"))) {
+        mid = (*env)->GetMethodID(env, cls, "intValue", "()I");
+        int val = (*env)->CallIntMethod(env, jval, mid);
+        mpr_qry_add_filter(q, id, ckey, 1, MPR_INT32, &val, op);
+    }
+    else if ((*env)->IsInstanceOf(env, jval, (*env)->FindClass(env, "java/lang/Long"))) {
+        mid = (*env)->GetMethodID(env, cls, "longValue", "()J");
+        int64_t val = (*env)->CallLongMethod(env, jval, mid);
+        mpr_qry_add_filter(q, id, ckey, 1, MPR_INT64, &val, op);
+    }
+    else if ((*env)->IsInstanceOf(env, jval, (*env)->FindClass(env, "java/lang/String"))) {
+        const char *val = (*env)->GetStringUTFChars(env, jval, 0);
+        mpr_qry_add_filter(q, id, ckey, 1, MPR_STR, val, op);
+        (*env)->ReleaseStringUTFChars(env, jval, val);
+    }
+    else if ((*env)->IsInstanceOf(env, jval, (*env)->FindClass(env, "[I"))) {
+        int len = (*env)->GetArrayLength(env, jval);
+        jint* vals = (*env)->GetIntArrayElements(env, jval, NULL);
+        if (vals) {
+            mpr_qry_add_filter(q, id, ckey, len, MPR_INT32, vals, op);
+            (*env)->ReleaseIntArrayElements(env, jval, vals, JNI_ABORT);
+        }
+    }
+    else if ((*env)->IsInstanceOf(env, jval, (*env)->FindClass(env, "[F"))) {
+        int len = (*env)->GetArrayLength(env, jval);
+        jfloat* vals = (*env)->GetFloatArrayElements(env, jval, NULL);
+        if (vals) {
+            mpr_qry_add_filter(q, id, ckey, len, MPR_FLT, vals, op);
+            (*env)->ReleaseFloatArrayElements(env, jval, vals, JNI_ABORT);
+        }
+    }
+    else if ((*env)->IsInstanceOf(env, jval, (*env)->FindClass(env, "[D"))) {
+        int len = (*env)->GetArrayLength(env, jval);
+        jdouble* vals = (*env)->GetDoubleArrayElements(env, jval, NULL);
+        if (vals) {
+            mpr_qry_add_filter(q, id, ckey, len, MPR_DBL, vals, op);
+            (*env)->ReleaseDoubleArrayElements(env, jval, vals, JNI_ABORT);
+        }
+    }
+
+    if (jkey && ckey)
+        (*env)->ReleaseStringUTFChars(env, jkey, ckey);
+}
+
 /**** mapper_Signal_Instances.h ****/
 
 JNIEXPORT jlong JNICALL Java_mapper_Signal_00024Instance_mapperInstance
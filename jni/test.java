@@ -191,6 +191,14 @@ class test {
             System.out.println();
         }
 
+        // live query
+        mapper.Query<Signal> live = g.signalQuery();
+        live.filter("name", "out*", Operator.EQ);
+        for (Signal s : live) {
+            System.out.println("  live: " + s.properties().get("name"));
+        }
+        live.free();
+
         System.out.println();
         System.out.println("Number of maps from "
                            + out1.properties().get("name") + ": " + out1.maps().size());
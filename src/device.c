@@ -19,6 +19,14 @@
 
 extern const char* net_msg_strings[NUM_MSG_STRINGS];
 
+/* Extra device property listing the data protocols a device understands. Peers
+ * that do not send it are assumed to support only the plain protocols. */
+#define DATA_PROTOCOLS_KEY "data_protocols"
+
+/* Released path aliases are not assigned again for this many seconds so that
+ * late datagrams still addressed to them cannot reach a different signal. */
+#define ALIAS_QUARANTINE_SEC TIMEOUT_SEC
+
 #define DEV_SERVER_FUNC(FUNC, ...)                      \
 {                                                       \
     lo_server_ ## FUNC(net->server.udp, __VA_ARGS__);   \
@@ -73,16 +81,27 @@ void init_dev_prop_tbl(mpr_dev dev)
     mpr_tbl_link(tbl, PROP(NUM_SIGS_OUT), 1, MPR_INT32, &dev->num_outputs, mod);
     mpr_tbl_link(tbl, PROP(ORDINAL), 1, MPR_INT32, &dev->ordinal, mod);
     if (!dev->loc) {
-        qry = mpr_list_new_query((const void**)&dev->obj.graph->sigs,
-                                 cmp_qry_dev_sigs, "hi", dev->obj.id, MPR_DIR_ANY);
+        qry = mpr_list_new_arr_query((const void**)&dev->obj.graph->sigs, &dev->sigs,
+                                     cmp_qry_dev_sigs, "hi", dev->obj.id, MPR_DIR_ANY);
         mpr_tbl_link(tbl, PROP(SIG), 1, MPR_LIST, qry, NON_MODIFIABLE | PROP_OWNED);
     }
     mpr_tbl_link(tbl, PROP(STATUS), 1, MPR_INT32, &dev->status, mod | LOCAL_ACCESS_ONLY);
     mpr_tbl_link(tbl, PROP(SYNCED), 1, MPR_TIME, &dev->synced, mod | LOCAL_ACCESS_ONLY);
     mpr_tbl_link(tbl, PROP(VERSION), 1, MPR_INT32, &dev->obj.version, mod);
 
-    if (dev->loc)
+    if (dev->loc) {
         mpr_tbl_set(tbl, PROP(LIBVER), NULL, 1, MPR_STR, PACKAGE_VERSION, NON_MODIFIABLE);
+
+        // advertise the data protocols we understand so peers can use them
+        const char *protocols[MPR_NUM_PROTO];
+        int i;
+        for (i = MPR_PROTO_UNDEFINED + 1; i < MPR_NUM_PROTO; i++) {
+            protocols[i - 1] = mpr_protocol_as_str(i);
+            dev->protocols |= 1 << i;
+        }
+        mpr_tbl_set(tbl, PROP(EXTRA), DATA_PROTOCOLS_KEY, MPR_NUM_PROTO - 1, MPR_STR,
+                    protocols, NON_MODIFIABLE);
+    }
     mpr_tbl_set(tbl, PROP(IS_LOCAL), NULL, 1, MPR_BOOL, &dev->loc,
                 LOCAL_ACCESS_ONLY | NON_MODIFIABLE);
 }
@@ -107,6 +126,7 @@ mpr_dev mpr_dev_new(const char *name_prefix, mpr_graph g)
     dev->loc = (mpr_local_dev)calloc(1, sizeof(mpr_local_dev_t));
 
     init_dev_prop_tbl(dev);
+    mpr_graph_reindex_obj(g, (mpr_obj)dev);
 
     dev->prefix = strdup(name_prefix);
     mpr_dev_start_servers(dev);
@@ -123,6 +143,7 @@ mpr_dev mpr_dev_new(const char *name_prefix, mpr_graph g)
     dev->loc->idmaps.active = (mpr_id_map*) malloc(sizeof(mpr_id_map));
     dev->loc->idmaps.active[0] = 0;
     dev->loc->num_sig_groups = 1;
+    mpr_dev_reindex_idmaps(dev);
 
     mpr_net_add_dev(&g->net, dev);
 
@@ -207,6 +228,9 @@ void mpr_dev_free(mpr_dev dev)
         }
     }
     free(dev->loc->idmaps.active);
+    free(dev->loc->idmaps.LID_idx);
+    free(dev->loc->idmaps.GID_idx);
+    FUNC_IF(free, dev->loc->aliases);
 
     while (dev->loc->idmaps.reserve) {
         map = dev->loc->idmaps.reserve;
@@ -220,6 +244,7 @@ void mpr_dev_free(mpr_dev dev)
             net->rtr->sigs = net->rtr->sigs->next;
             free(rs);
         }
+        mpr_expr_cache_free(net->rtr->expr_cache);
         free(net->rtr);
     }
 
@@ -247,11 +272,14 @@ void mpr_dev_on_registered(mpr_dev dev)
                 if (idmap && !(idmap->GID >> 32))
                     idmap->GID |= dev->obj.id;
             }
+            mpr_sig_reindex_idmaps(sig);
             sig->obj.id |= dev->obj.id;
+            mpr_graph_reindex_obj(dev->obj.graph, (mpr_obj)sig);
         }
     }
-    mpr_list qry = mpr_list_new_query((const void**)&dev->obj.graph->sigs,
-                                      cmp_qry_dev_sigs, "hi", dev->obj.id, MPR_DIR_ANY);
+    mpr_dev_reindex_idmaps(dev);
+    mpr_list qry = mpr_list_new_arr_query((const void**)&dev->obj.graph->sigs, &dev->sigs,
+                                          cmp_qry_dev_sigs, "hi", dev->obj.id, MPR_DIR_ANY);
     mpr_tbl_set(dev->obj.props.synced, PROP(SIG), NULL, 1, MPR_LIST, qry,
                 NON_MODIFIABLE | PROP_OWNED);
     dev->loc->registered = 1;
@@ -291,57 +319,25 @@ int mpr_dev_bundle_start(lo_timetag t, void *data)
  *   instance within the network of libmapper devices
  * - Updates to specific "slots" of a convergent (i.e. multi-source) mapping
  *   are indicated using the label "@slot" followed by a single integer slot #
+ * - Maps using a packed protocol may send several instance updates in a single
+ *   message starting with the label "@pk", see _handle_packed() below
+ * - Maps using a compact protocol send the instance id as an unlabelled int64
+ *   and the slot # as an unlabelled char following the value; slot #s above
+ *   255 fall back to the labelled "@sl" form
  * - Instance creation and release may also be triggered by expression
  *   evaluation. Refer to the document "Using Instanced Signals with Libmapper"
  *   for more information.
  */
-int mpr_dev_handler(const char *path, const char *types, lo_arg **argv, int argc,
-                    lo_message msg, void *data)
+static int _handle_update(mpr_sig sig, const char *types, lo_arg **argv, int val_len,
+                          mpr_id GID, int slot_idx)
 {
-    mpr_sig sig = (mpr_sig)data;
-    mpr_dev dev;
+    mpr_dev dev = sig->dev;
     mpr_rtr rtr = sig->obj.graph->net.rtr;
-    int i, val_len = 0, vals;
-    int idmap_idx, slot_idx = -1, map_manages_inst = 0;
-    mpr_id GID = 0;
+    int i, vals, idmap_idx, map_manages_inst = 0;
     mpr_id_map idmap;
     mpr_map map = 0;
     mpr_slot slot = 0;
 
-    TRACE_RETURN_UNLESS(sig && (dev = sig->dev), 0, "error in mpr_dev_handler, "
-                        "cannot retrieve user data\n");
-    TRACE_DEV_RETURN_UNLESS(sig->num_inst, 0, "signal '%s' has no instances.\n", sig->obj.name);
-    RETURN_UNLESS(argc, 0);
-
-    // We need to consider that there may be properties appended to the msg
-    // check length and find properties if any
-    while (val_len < argc && types[val_len] != MPR_STR)
-        ++val_len;
-    i = val_len;
-    while (i < argc) {
-        // Parse any attached properties (instance ids, slot number)
-        TRACE_DEV_RETURN_UNLESS(types[i] == MPR_STR, 0, "error in "
-                                "mpr_dev_handler: unexpected argument type.\n")
-        if ((strcmp(&argv[i]->s, "@in") == 0) && argc >= i + 2) {
-            TRACE_DEV_RETURN_UNLESS(types[i+1] == MPR_INT64, 0, "error in "
-                                    "mpr_dev_handler: bad arguments for 'instance' prop.\n")
-            GID = argv[i+1]->i64;
-            i += 2;
-        }
-        else if ((strcmp(&argv[i]->s, "@sl") == 0) && argc >= i + 2) {
-            TRACE_DEV_RETURN_UNLESS(types[i+1] == MPR_INT32, 0, "error in "
-                                    "mpr_dev_handler: bad arguments for 'slot' prop.\n")
-            slot_idx = argv[i+1]->i32;
-            i += 2;
-        }
-        else {
-#ifdef DEBUG
-            trace_dev(dev, "error in mpr_dev_handler: unknown property name '%s'.\n", &argv[i]->s);
-#endif
-            return 0;
-        }
-    }
-
     if (slot_idx >= 0) {
         // retrieve mapping associated with this slot
         slot = mpr_rtr_get_slot(rtr, sig, slot_idx);
@@ -430,7 +426,7 @@ int mpr_dev_handler(const char *path, const char *types, lo_arg **argv, int argc
                 // clear signal's reference to idmap
                 mpr_dev_LID_decref(dev, sig->loc->group, idmap);
                 sig->loc->idmaps[idmap_idx].map = 0;
-                sig->loc->idmaps[idmap_idx].inst->active = 0;
+                mpr_sig_deactivate_inst(sig, sig->loc->idmaps[idmap_idx].inst);
                 sig->loc->idmaps[idmap_idx].inst = 0;
                 return 0;
             }
@@ -470,26 +466,45 @@ int mpr_dev_handler(const char *path, const char *types, lo_arg **argv, int argc
     if (all)
         idmap_idx = 0;
 
+    /* Collect the active instances so that the map expression can be
+     * evaluated for all of them in a single pass. */
+    int n_inst = 0, idmap_idxs[sig->loc->idmap_len], inst_idxs[sig->loc->idmap_len];
     for (; idmap_idx < sig->loc->idmap_len; idmap_idx++) {
         // check if map instance is active
+        if (all && !sig->loc->idmaps[idmap_idx].inst)
+            continue;
+        idmap_idxs[n_inst] = idmap_idx;
+        inst_idxs[n_inst++] = sig->loc->idmaps[idmap_idx].inst->idx;
+        if (!all)
+            break;
+    }
+
+    int k, dst_len = map ? map->dst->sig->len : 0;
+    if (map) {
+        mpr_local_slot lslot = slot->loc;
+
+        /* TODO: would be more efficient not to allocate memory for multiple
+         * instances if slot is single-instance. */
+        for (k = 0; k < n_inst; k++)
+            mpr_value_set_sample(&lslot->val, inst_idxs[k], argv[0], ts);
+        RETURN_UNLESS(slot->causes_update && n_inst, 0);
+        mpr_map_perform_batch(map, &ts, inst_idxs, n_inst);
+    }
+
+    for (k = 0; k < n_inst; k++) {
+        idmap_idx = idmap_idxs[k];
+        // check if instance is still active
         if (all && !(si = sig->loc->idmaps[idmap_idx].inst))
             continue;
 
-        inst_idx = sig->loc->idmaps[idmap_idx].inst->idx;
+        inst_idx = inst_idxs[k];
         idmap = sig->loc->idmaps[idmap_idx].map;
 
         int status = MPR_SIG_UPDATE;
         mpr_type *typestring = 0;
         if (map) {
-            mpr_local_slot lslot = slot->loc;
-
-            /* TODO: would be more efficient not to allocate memory for multiple
-             * instances if slot is single-instance. */
-            mpr_value_set_sample(&lslot->val, inst_idx, argv[0], ts);
-            if (!slot->causes_update)
-                continue;
-            typestring = alloca(map->dst->sig->len * sizeof(mpr_type));
-            status = mpr_map_perform(map, typestring, &ts, inst_idx);
+            typestring = map->loc->types + k * dst_len;
+            status = map->loc->status[k];
             if (!map->use_inst || !sig->use_inst)
                 status &= EXPR_UPDATE;
         }
@@ -533,6 +548,7 @@ int mpr_dev_handler(const char *path, const char *types, lo_arg **argv, int argc
                 si->has_val = 1;
             if (si->has_val) {
                 memcpy(&si->time, &ts, sizeof(mpr_time));
+                mpr_sig_touch_inst(sig, si);
                 mpr_sig_call_handler(sig, MPR_SIG_UPDATE, idmap->LID, sig->len, si->val, &ts, diff);
                 // check if instance was released
                 if (si->active) {
@@ -551,14 +567,115 @@ int mpr_dev_handler(const char *path, const char *types, lo_arg **argv, int argc
             int evt = MPR_SIG_REL_UPSTRM & sig->loc->event_flags ? MPR_SIG_REL_UPSTRM : MPR_SIG_UPDATE;
             mpr_sig_call_handler(sig, evt, idmap->LID, 0, 0, &ts, diff);
         }
-
-        if (!all)
-            break;
     }
 
     return 0;
 }
 
+/* Packed messages carry several instance updates for the same signal: "@pk"
+ * followed by one (int64 GID, vector) tuple per instance and an optional
+ * trailing "@sl" slot tag. Each tuple is handled like a single update. */
+static int _handle_packed(mpr_sig sig, const char *types, lo_arg **argv, int argc)
+{
+#ifdef DEBUG
+    mpr_dev dev = sig->dev;
+#endif
+    int i = 1, len, slot_idx = -1;
+
+    if (argc >= 3 && types[argc-2] == MPR_STR && strcmp(&argv[argc-2]->s, "@sl") == 0) {
+        TRACE_DEV_RETURN_UNLESS(types[argc-1] == MPR_INT32, 0, "error in "
+                                "mpr_dev_handler: bad arguments for 'slot' prop.\n")
+        slot_idx = argv[argc-1]->i32;
+        argc -= 2;
+    }
+    while (i < argc) {
+        TRACE_DEV_RETURN_UNLESS(types[i] == MPR_INT64, 0, "error in "
+                                "mpr_dev_handler: bad packed instance update.\n")
+        // vector elements are never of type int64
+        for (len = 1; i + len < argc && types[i + len] != MPR_INT64; len++) ;
+        TRACE_DEV_RETURN_UNLESS(len > 1, 0, "error in mpr_dev_handler: "
+                                "empty packed instance update.\n")
+        _handle_update(sig, types + i + 1, argv + i + 1, len - 1, argv[i]->i64, slot_idx);
+        i += len;
+    }
+    return 0;
+}
+
+int mpr_dev_handler(const char *path, const char *types, lo_arg **argv, int argc,
+                    lo_message msg, void *data)
+{
+    mpr_sig sig = (mpr_sig)data;
+    mpr_dev dev;
+    int i, val_len = 0, slot_idx = -1;
+    mpr_id GID = 0;
+
+    TRACE_RETURN_UNLESS(sig && (dev = sig->dev), 0, "error in mpr_dev_handler, "
+                        "cannot retrieve user data\n");
+    TRACE_DEV_RETURN_UNLESS(sig->num_inst, 0, "signal '%s' has no instances.\n", sig->obj.name);
+    RETURN_UNLESS(argc, 0);
+
+    if (types[0] == MPR_STR && strcmp(&argv[0]->s, "@pk") == 0)
+        return _handle_packed(sig, types, argv, argc);
+
+    // We need to consider that there may be properties appended to the msg
+    // check length and find properties if any
+    while (val_len < argc && types[val_len] != MPR_STR && types[val_len] != MPR_INT64
+           && types[val_len] != LO_CHAR)
+        ++val_len;
+    i = val_len;
+    while (i < argc) {
+        // Parse any attached properties (instance ids, slot number)
+        if (types[i] == MPR_INT64) {
+            // compact encoding: instance id without label
+            GID = argv[i++]->i64;
+            continue;
+        }
+        if (types[i] == LO_CHAR) {
+            // compact encoding: slot id without label
+            slot_idx = (unsigned char)argv[i++]->c;
+            continue;
+        }
+        TRACE_DEV_RETURN_UNLESS(types[i] == MPR_STR, 0, "error in "
+                                "mpr_dev_handler: unexpected argument type.\n")
+        if ((strcmp(&argv[i]->s, "@in") == 0) && argc >= i + 2) {
+            TRACE_DEV_RETURN_UNLESS(types[i+1] == MPR_INT64, 0, "error in "
+                                    "mpr_dev_handler: bad arguments for 'instance' prop.\n")
+            GID = argv[i+1]->i64;
+            i += 2;
+        }
+        else if ((strcmp(&argv[i]->s, "@sl") == 0) && argc >= i + 2) {
+            TRACE_DEV_RETURN_UNLESS(types[i+1] == MPR_INT32, 0, "error in "
+                                    "mpr_dev_handler: bad arguments for 'slot' prop.\n")
+            slot_idx = argv[i+1]->i32;
+            i += 2;
+        }
+        else {
+#ifdef DEBUG
+            trace_dev(dev, "error in mpr_dev_handler: unknown property name '%s'.\n", &argv[i]->s);
+#endif
+            return 0;
+        }
+    }
+    return _handle_update(sig, types, argv, val_len, GID, slot_idx);
+}
+
+int mpr_dev_handle_local(mpr_sig sig, const mpr_type *types, void *val, int len,
+                         mpr_id GID, int slot_idx)
+{
+    int i, size = 0;
+    RETURN_UNLESS(sig->num_inst && types && len, 0);
+
+    // elements are stored contiguously, nulls included
+    for (i = 0; i < len && !size; i++) {
+        if (types[i] != MPR_NULL)
+            size = mpr_type_get_size(types[i]);
+    }
+    lo_arg *argv[len];
+    for (i = 0; i < len; i++)
+        argv[i] = size ? (lo_arg*)((char*)val + i * size) : 0;
+    return _handle_update(sig, types, argv, len, GID, slot_idx);
+}
+
 mpr_id mpr_dev_get_unused_sig_id(mpr_dev dev)
 {
     int done = 0;
@@ -580,6 +697,79 @@ mpr_id mpr_dev_get_unused_sig_id(mpr_dev dev)
     return id;
 }
 
+/* Data messages for a signal may be addressed to the short path "/@<alias>"
+ * once the alias has been announced to the peer of a link through the map slot
+ * properties. These are dispatched by a single method that is registered
+ * before any signal methods. An alias is released when the last map of its
+ * signal over its link is removed, or when the link itself goes away; messages
+ * still addressed to it are then dropped, and it is only assigned again once
+ * ALIAS_QUARANTINE_SEC have passed. */
+static int _alias_handler(const char *path, const char *types, lo_arg **argv, int argc,
+                          lo_message msg, void *data)
+{
+    mpr_dev dev = (mpr_dev)data;
+    RETURN_UNLESS(path && path[0] == '/' && path[1] == '@', 1);
+    int alias = atoi(path + 2);
+    RETURN_UNLESS(alias > 0 && alias <= dev->loc->num_aliases, 0);
+    mpr_sig sig = dev->loc->aliases[alias - 1].sig;
+    RETURN_UNLESS(sig, 0);
+    return mpr_dev_handler(path, types, argv, argc, msg, (void*)sig);
+}
+
+static int _alias_is_quarantined(mpr_local_dev ldev, int idx, mpr_time now)
+{
+    return mpr_time_get_diff(now, ldev->aliases[idx].released) < ALIAS_QUARANTINE_SEC;
+}
+
+int mpr_dev_get_alias(mpr_dev dev, mpr_sig sig, mpr_link link)
+{
+    RETURN_UNLESS(dev->loc && sig->loc && link, 0);
+    // loopback updates are dispatched without a path
+    RETURN_UNLESS(link->local_dev != link->remote_dev, 0);
+    mpr_local_dev ldev = dev->loc;
+    int i, free_idx = -1;
+    mpr_time now;
+    mpr_time_set(&now, MPR_NOW);
+    for (i = 0; i < ldev->num_aliases; i++) {
+        if (!ldev->aliases[i].sig) {
+            if (free_idx < 0 && !_alias_is_quarantined(ldev, i, now))
+                free_idx = i;
+        }
+        else if (ldev->aliases[i].sig == sig && ldev->aliases[i].link == link)
+            return i + 1;
+    }
+    if (free_idx < 0) {
+        free_idx = ldev->num_aliases++;
+        ldev->aliases = realloc(ldev->aliases, ldev->num_aliases * sizeof(*ldev->aliases));
+    }
+    ldev->aliases[free_idx].sig = sig;
+    ldev->aliases[free_idx].link = link;
+    return free_idx + 1;
+}
+
+void mpr_dev_release_aliases(mpr_dev dev, mpr_sig sig, mpr_link link)
+{
+    RETURN_UNLESS(dev->loc);
+    mpr_local_dev ldev = dev->loc;
+    int i;
+    mpr_time now;
+    mpr_time_set(&now, MPR_NOW);
+    for (i = 0; i < ldev->num_aliases; i++) {
+        if (!ldev->aliases[i].sig)
+            continue;
+        if ((!sig || ldev->aliases[i].sig == sig) && (!link || ldev->aliases[i].link == link)) {
+            ldev->aliases[i].sig = 0;
+            ldev->aliases[i].link = 0;
+            ldev->aliases[i].released = now;
+        }
+    }
+    /* Trim released aliases from the end of the table once their quarantine
+     * has expired; trimming earlier would let the next alias reuse them. */
+    while (ldev->num_aliases && !ldev->aliases[ldev->num_aliases - 1].sig
+           && !_alias_is_quarantined(ldev, ldev->num_aliases - 1, now))
+        --ldev->num_aliases;
+}
+
 void mpr_dev_add_sig_methods(mpr_dev dev, mpr_sig sig)
 {
     RETURN_UNLESS(sig && sig->loc);
@@ -600,33 +790,25 @@ void mpr_dev_remove_sig_methods(mpr_dev dev, mpr_sig sig)
     free(path);
     DEV_SERVER_FUNC(del_method, sig->path, NULL);
     --dev->loc->n_output_callbacks;
+    mpr_dev_release_aliases(dev, sig, 0);
 }
 
 mpr_list mpr_dev_get_sigs(mpr_dev dev, mpr_dir dir)
 {
-    RETURN_UNLESS(dev && dev->obj.graph->sigs, 0);
-    mpr_list qry = mpr_list_new_query((const void**)&dev->obj.graph->sigs,
-                                      cmp_qry_dev_sigs, "hi", dev->obj.id, dir);
+    RETURN_UNLESS(dev && dev->sigs.num, 0);
+    mpr_list qry = mpr_list_new_arr_query((const void**)&dev->obj.graph->sigs, &dev->sigs,
+                                          cmp_qry_dev_sigs, "hi", dev->obj.id, dir);
     return mpr_list_start(qry);
 }
 
 mpr_sig mpr_dev_get_sig_by_name(mpr_dev dev, const char *sig_name)
 {
     RETURN_UNLESS(dev, 0);
-    mpr_list sigs = mpr_list_from_data(dev->obj.graph->sigs);
-    while (sigs) {
-        mpr_sig sig = (mpr_sig)*sigs;
-        if ((sig->dev == dev) && strcmp(sig->obj.name, skip_slash(sig_name))==0)
-            return sig;
-        sigs = mpr_list_get_next(sigs);
-    }
-    return 0;
+    return mpr_graph_get_sig_by_name(dev->obj.graph, dev, skip_slash(sig_name));
 }
 
-static int cmp_qry_dev_maps(const void *context_data, mpr_map map)
+static int _map_has_dev(mpr_map map, mpr_id dev_id, mpr_dir dir)
 {
-    mpr_id dev_id = *(mpr_id*)context_data;
-    mpr_dir dir = *(int*)(context_data + sizeof(mpr_id));
     int i;
     if (dir == MPR_DIR_BOTH) {
         RETURN_UNLESS(map->dst->sig->dev->obj.id == dev_id, 0);
@@ -643,11 +825,23 @@ static int cmp_qry_dev_maps(const void *context_data, mpr_map map)
     return 0;
 }
 
+static int cmp_qry_dev_maps(const void *context_data, mpr_map map)
+{
+    mpr_id dev_id = *(mpr_id*)context_data;
+    mpr_dir dir = *(int*)(context_data + sizeof(mpr_id));
+    return _map_has_dev(map, dev_id, dir);
+}
+
+int mpr_dev_has_map(mpr_dev dev, mpr_map map, mpr_dir dir)
+{
+    return _map_has_dev(map, dev->obj.id, dir);
+}
+
 mpr_list mpr_dev_get_maps(mpr_dev dev, mpr_dir dir)
 {
-    RETURN_UNLESS(dev && dev->obj.graph->maps, 0);
-    mpr_list qry = mpr_list_new_query((const void**)&dev->obj.graph->maps,
-                                      cmp_qry_dev_maps, "hi", dev->obj.id, dir);
+    RETURN_UNLESS(dev && dev->maps.num, 0);
+    mpr_list qry = mpr_list_new_arr_query((const void**)&dev->obj.graph->maps, &dev->maps,
+                                          cmp_qry_dev_maps, "hi", dev->obj.id, dir);
     return mpr_list_start(qry);
 }
 
@@ -676,23 +870,22 @@ static int cmp_qry_dev_links(const void *context_data, mpr_link link)
 
 mpr_list mpr_dev_get_links(mpr_dev dev, mpr_dir dir)
 {
-    RETURN_UNLESS(dev && dev->obj.graph->links, 0);
-    mpr_list qry = mpr_list_new_query((const void**)&dev->obj.graph->links,
-                                      cmp_qry_dev_links, "hi", dev->obj.id, dir);
+    RETURN_UNLESS(dev && dev->links.num, 0);
+    mpr_list qry = mpr_list_new_arr_query((const void**)&dev->obj.graph->links, &dev->links,
+                                          cmp_qry_dev_links, "hi", dev->obj.id, dir);
     return mpr_list_start(qry);
 }
 
 mpr_link mpr_dev_get_link_by_remote(mpr_dev dev, mpr_dev remote)
 {
     RETURN_UNLESS(dev, 0);
-    mpr_list links = mpr_list_from_data(dev->obj.graph->links);
-    while (links) {
-        mpr_link link = (mpr_link)*links;
+    int i;
+    for (i = 0; i < dev->links.num; i++) {
+        mpr_link link = (mpr_link)dev->links.objs[i];
         if (link->devs[0] == dev && link->devs[1] == remote)
             return link;
         if (link->devs[1] == dev && link->devs[0] == remote)
             return link;
-        links = mpr_list_get_next(links);
     }
     return 0;
 }
@@ -700,12 +893,9 @@ mpr_link mpr_dev_get_link_by_remote(mpr_dev dev, mpr_dev remote)
 // TODO: handle interrupt-driven updates that omit call to this function
 static inline int mpr_dev_process_outputs_internal(mpr_dev dev, int idx)
 {
-    mpr_list links = mpr_list_from_data(dev->obj.graph->links);
-    int msgs = 0;
-    while (links) {
-        msgs += mpr_link_process_bundles((mpr_link)*links, dev->loc->time, idx);
-        links = mpr_list_get_next(links);
-    }
+    int i, msgs = 0;
+    for (i = 0; i < dev->links.num; i++)
+        msgs += mpr_link_process_bundles((mpr_link)dev->links.objs[i], dev->loc->time, idx);
     return msgs ? 1 : 0;
 }
 
@@ -837,6 +1027,44 @@ void mpr_dev_reserve_idmap(mpr_dev dev)
     dev->loc->idmaps.reserve = map;
 }
 
+/* Active id maps are also chained into hash buckets by LID and by GID. New
+ * maps are added to the head of their buckets, so lookups return the most
+ * recently added match just as a walk of the active list does. */
+static void _idx_add_idmap(mpr_local_dev ldev, mpr_id_map map)
+{
+    unsigned int mask = ldev->idmaps.idx_size - 1;
+    mpr_id_map *bucket = &ldev->idmaps.LID_idx[mpr_id_hash(map->LID, map->group) & mask];
+    map->LID_next = *bucket;
+    *bucket = map;
+    bucket = &ldev->idmaps.GID_idx[mpr_id_hash(map->GID, map->group) & mask];
+    map->GID_next = *bucket;
+    *bucket = map;
+}
+
+void mpr_dev_reindex_idmaps(mpr_dev dev)
+{
+    mpr_local_dev ldev = dev->loc;
+    int i, j, n = 0, size = 16;
+    while (size < ldev->idmaps.num_active * 2)
+        size *= 2;
+    if (size != ldev->idmaps.idx_size) {
+        ldev->idmaps.LID_idx = realloc(ldev->idmaps.LID_idx, size * sizeof(mpr_id_map));
+        ldev->idmaps.GID_idx = realloc(ldev->idmaps.GID_idx, size * sizeof(mpr_id_map));
+        ldev->idmaps.idx_size = size;
+    }
+    memset(ldev->idmaps.LID_idx, 0, size * sizeof(mpr_id_map));
+    memset(ldev->idmaps.GID_idx, 0, size * sizeof(mpr_id_map));
+
+    // add maps oldest first to preserve the order of the active lists
+    mpr_id_map map, maps[ldev->idmaps.num_active ? ldev->idmaps.num_active : 1];
+    for (i = 0; i < ldev->num_sig_groups; i++) {
+        for (j = n, map = ldev->idmaps.active[i]; map; map = map->next)
+            maps[n++] = map;
+        while (n > j)
+            _idx_add_idmap(ldev, maps[--n]);
+    }
+}
+
 mpr_id_map mpr_dev_add_idmap(mpr_dev dev, int group, mpr_id LID, mpr_id GID)
 {
     if (!dev->loc->idmaps.reserve)
@@ -847,24 +1075,45 @@ mpr_id_map mpr_dev_add_idmap(mpr_dev dev, int group, mpr_id LID, mpr_id GID)
     map->GID = GID;
     map->LID_refcount = 1;
     map->GID_refcount = 0;
+    map->group = group;
     dev->loc->idmaps.reserve = map->next;
     map->next = dev->loc->idmaps.active[group];
     dev->loc->idmaps.active[group] = map;
+
+    if (++dev->loc->idmaps.num_active > dev->loc->idmaps.idx_size)
+        mpr_dev_reindex_idmaps(dev);
+    else
+        _idx_add_idmap(dev->loc, map);
     return map;
 }
 
 static void mpr_dev_remove_idmap(mpr_dev dev, int group, mpr_id_map rem)
 {
-    mpr_id_map *map = &dev->loc->idmaps.active[group];
+    mpr_local_dev ldev = dev->loc;
+    unsigned int mask = ldev->idmaps.idx_size - 1;
+    mpr_id_map *map = &ldev->idmaps.active[group];
     while (*map) {
         if ((*map) == rem) {
             *map = (*map)->next;
-            rem->next = dev->loc->idmaps.reserve;
-            dev->loc->idmaps.reserve = rem;
+            rem->next = ldev->idmaps.reserve;
+            ldev->idmaps.reserve = rem;
+            --ldev->idmaps.num_active;
             break;
         }
         map = &(*map)->next;
     }
+
+    // unlink from hash buckets
+    map = &ldev->idmaps.LID_idx[mpr_id_hash(rem->LID, group) & mask];
+    while (*map && *map != rem)
+        map = &(*map)->LID_next;
+    if (*map)
+        *map = rem->LID_next;
+    map = &ldev->idmaps.GID_idx[mpr_id_hash(rem->GID, group) & mask];
+    while (*map && *map != rem)
+        map = &(*map)->GID_next;
+    if (*map)
+        *map = rem->GID_next;
 }
 
 int mpr_dev_LID_decref(mpr_dev dev, int group, mpr_id_map map)
@@ -895,22 +1144,24 @@ int mpr_dev_GID_decref(mpr_dev dev, int group, mpr_id_map map)
 
 mpr_id_map mpr_dev_get_idmap_by_LID(mpr_dev dev, int group, mpr_id LID)
 {
-    mpr_id_map map = dev->loc->idmaps.active[group];
+    unsigned int mask = dev->loc->idmaps.idx_size - 1;
+    mpr_id_map map = dev->loc->idmaps.LID_idx[mpr_id_hash(LID, group) & mask];
     while (map) {
-        if (map->LID == LID)
+        if (map->LID == LID && map->group == group)
             return map;
-        map = map->next;
+        map = map->LID_next;
     }
     return 0;
 }
 
 mpr_id_map mpr_dev_get_idmap_by_GID(mpr_dev dev, int group, mpr_id GID)
 {
-    mpr_id_map map = dev->loc->idmaps.active[group];
+    unsigned int mask = dev->loc->idmaps.idx_size - 1;
+    mpr_id_map map = dev->loc->idmaps.GID_idx[mpr_id_hash(GID, group) & mask];
     while (map) {
-        if (map->GID == GID)
+        if (map->GID == GID && map->group == group)
             return map;
-        map = map->next;
+        map = map->GID_next;
     }
     return 0;
 }
@@ -940,6 +1191,9 @@ void mpr_dev_start_servers(mpr_dev dev)
     // Add bundle handlers
     DEV_SERVER_FUNC(add_bundle_handlers, mpr_dev_bundle_start, NULL, (void*)dev);
 
+    // Add handler for aliased signal paths before any signal methods
+    DEV_SERVER_FUNC(add_method, NULL, NULL, _alias_handler, (void*)dev);
+
     int portnum = lo_server_get_port(net->server.udp);
     mpr_tbl_set(dev->obj.props.synced, PROP(PORT), NULL, 1, MPR_INT32, &portnum,
                 NON_MODIFIABLE);
@@ -974,6 +1228,7 @@ const char *mpr_dev_get_name(mpr_dev dev)
     dev->obj.name = (char*)malloc(len);
     dev->obj.name[0] = 0;
     snprintf(dev->obj.name, len, "%s.%d", dev->prefix, dev->loc->ordinal.val);
+    mpr_graph_reindex_obj(dev->obj.graph, (mpr_obj)dev);
     return dev->obj.name;
 }
 
@@ -1091,6 +1346,7 @@ int mpr_dev_set_from_msg(mpr_dev dev, mpr_msg m)
 {
     RETURN_UNLESS(m, 0);
     int i, updated = 0;
+    mpr_id id = dev->obj.id;
     mpr_msg_atom a;
     for (i = 0; i < m->num_atoms; i++) {
         a = &m->atoms[i];
@@ -1099,11 +1355,24 @@ int mpr_dev_set_from_msg(mpr_dev dev, mpr_msg m)
                 if (mpr_type_get_is_str(a->types[0]))
                     updated += mpr_dev_update_linked(dev, a);
                 break;
+            case PROP(EXTRA):
+                if (0 == strcmp(a->key, DATA_PROTOCOLS_KEY) && mpr_type_get_is_str(a->types[0])) {
+                    int j;
+                    dev->protocols = 0;
+                    for (j = 0; j < a->len; j++)
+                        dev->protocols |= 1 << mpr_protocol_from_str(&a->vals[j]->s);
+                    // the undefined bit stands for unknown protocols
+                    dev->protocols &= ~1;
+                }
+                updated += mpr_tbl_set_from_atom(dev->obj.props.synced, a, REMOTE_MODIFY);
+                break;
             default:
                 updated += mpr_tbl_set_from_atom(dev->obj.props.synced, a, REMOTE_MODIFY);
                 break;
         }
     }
+    if (dev->obj.id != id)
+        mpr_graph_reindex_obj(dev->obj.graph, (mpr_obj)dev);
     return updated;
 }
 
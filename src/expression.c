@@ -1,9 +1,11 @@
 #include <ctype.h>
 #include <math.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include "mapper_internal.h"
+#include "config.h"
 
 #define MAX_HIST_SIZE 100
 #define STACK_SIZE 128
@@ -49,62 +51,35 @@ FLOAT_OR_DOUBLE_UNARY_FUNC(uniform, rand() / (RAND_MAX + 1.0) * x);
 UNARY_FUNC(int, sign, i, x >= 0 ? 1 : -1);
 FLOAT_OR_DOUBLE_UNARY_FUNC(sign, x >= 0 ? 1.0 : -1.0);
 
-#define TEST_VEC(OP, CMP, RET, EL)  \
-    for (int i = 0; i < len; i++) { \
-        if (val[i].EL OP CMP)       \
-            return RET;             \
-    }                               \
-    return 1 - RET;
-#define TEST_VEC_TYPED(NAME, TYPE, OP, CMP, RET, EL)    \
-    static TYPE NAME##EL(mpr_expr_val val, int len) {   \
-        TEST_VEC(OP, CMP, RET, EL)                      \
-    }
-TEST_VEC_TYPED(all, int, ==, 0, 0, i)
-TEST_VEC_TYPED(any, int, !=, 0, 1, i)
-TEST_VEC_TYPED(all, float, ==, 0.f, 0, f)
-TEST_VEC_TYPED(any, float, !=, 0.f, 1, f)
-TEST_VEC_TYPED(all, double, ==, 0., 0, d)
-TEST_VEC_TYPED(any, double, !=, 0., 1, d)
-
-#define SUM_FUNC(TYPE, EL)                          \
-    static TYPE sum##EL(mpr_expr_val val, int len)  \
-    {                                               \
-        TYPE aggregate = 0;                         \
-        for (int i = 0; i < len; i++)               \
-            aggregate += val[i].EL;                 \
-        return aggregate;                           \
-    }
-SUM_FUNC(int, i)
-SUM_FUNC(float, f)
-SUM_FUNC(double, d)
-
-static float meanf(mpr_expr_val val, int len)
+/* Vector reductions use the kernels in vector.c and operate on contiguous
+ * arrays of a single type. */
+#define REDUCE_VFUNC(NAME, KERNEL, TYPE, MTYPE, EL)         \
+static TYPE NAME(TYPE *val, int len)                        \
+{                                                           \
+    TYPE result;                                            \
+    mpr_vec_get_reduce_fn(KERNEL, MTYPE)(val, len, &result);\
+    return result;                                          \
+}
+#define TYPED_REDUCE_VFUNCS(TYPE, MTYPE, EL)                \
+    REDUCE_VFUNC(all##EL, MPR_VEC_ALL, TYPE, MTYPE, EL)     \
+    REDUCE_VFUNC(any##EL, MPR_VEC_ANY, TYPE, MTYPE, EL)     \
+    REDUCE_VFUNC(sum##EL, MPR_VEC_SUM, TYPE, MTYPE, EL)     \
+    REDUCE_VFUNC(vmax##EL, MPR_VEC_VMAX, TYPE, MTYPE, EL)   \
+    REDUCE_VFUNC(vmin##EL, MPR_VEC_VMIN, TYPE, MTYPE, EL)
+TYPED_REDUCE_VFUNCS(int, MPR_INT32, i)
+TYPED_REDUCE_VFUNCS(float, MPR_FLT, f)
+TYPED_REDUCE_VFUNCS(double, MPR_DBL, d)
+
+static float meanf(float *val, int len)
 {
     return sumf(val, len) / (float)len;
 }
 
-static double meand(mpr_expr_val val, int len)
+static double meand(double *val, int len)
 {
     return sumd(val, len) / (double)len;
 }
 
-#define EXTREMA_VFUNC(NAME, OP, TYPE, EL)   \
-static TYPE NAME(mpr_expr_val val, int len) \
-{                                           \
-    TYPE extrema = val[0].EL;               \
-    for (int i = 1; i < len; i++) {         \
-        if (val[i].EL OP extrema)           \
-            extrema = val[i].EL;            \
-    }                                       \
-    return extrema;                         \
-}
-EXTREMA_VFUNC(vmaxi, >, int, i);
-EXTREMA_VFUNC(vmini, <, int, i);
-EXTREMA_VFUNC(vmaxf, >, float, f);
-EXTREMA_VFUNC(vminf, <, float, f);
-EXTREMA_VFUNC(vmaxd, >, double, d);
-EXTREMA_VFUNC(vmind, <, double, d);
-
 #define TYPED_EMA(TYPE, SUFFIX)                             \
 static TYPE ema##SUFFIX(TYPE memory, TYPE val, TYPE weight) \
     { return val * weight + memory * (1 - weight); }
@@ -268,6 +243,7 @@ typedef enum {
     OP_IF,
     OP_IF_ELSE,
     OP_IF_THEN_ELSE,
+    N_OP
 } expr_op_t;
 
 #define NONE        0x0
@@ -302,7 +278,6 @@ static struct {
     { "|",      2, 3,  GET_OPER | GET_OPER <<4 | GET_ONE  <<8 | GET_ONE  <<12 },
     { "&&",     2, 2,  GET_ZERO | GET_ZERO <<4 | NONE     <<8 | NONE     <<12 },
     { "||",     2, 1,  GET_OPER | GET_OPER <<4 | GET_ONE  <<8 | GET_ONE  <<12 },
-    // TODO: handle optimization of ternary operator
     { "IFTHEN",      2, 0, NONE | NONE     <<4 | NONE     <<8 | NONE     <<12 },
     { "IFELSE",      2, 0, NONE | NONE     <<4 | NONE     <<8 | NONE     <<12 },
     { "IFTHENELSE",  3, 0, NONE | NONE     <<4 | NONE     <<8 | NONE     <<12 },
@@ -323,9 +298,9 @@ typedef double fn_dbl_arity1(double);
 typedef double fn_dbl_arity2(double,double);
 typedef double fn_dbl_arity3(double,double,double);
 typedef double fn_dbl_arity4(double,double,double,double);
-typedef int vfn_int_arity1(mpr_expr_val, int);
-typedef float vfn_flt_arity1(mpr_expr_val, int);
-typedef double vfn_dbl_arity1(mpr_expr_val, int);
+typedef int vfn_int_arity1(int*, int);
+typedef float vfn_flt_arity1(float*, int);
+typedef double vfn_dbl_arity1(double*, int);
 
 typedef struct _token {
     union {
@@ -356,6 +331,8 @@ typedef struct _token {
         TOK_COLON           = 0x008000,
         TOK_SEMICOLON       = 0x010000,
         TOK_VECTORIZE       = 0x020000,
+        TOK_STORE_TMP,      /* added by optimizer: copy top of stack to temporary */
+        TOK_LOAD_TMP,       /* added by optimizer: push copy of temporary */
         TOK_ASSIGN          = 0x040000,
         TOK_ASSIGN_USE,
         TOK_ASSIGN_CONST,
@@ -365,12 +342,12 @@ typedef struct _token {
     } toktype;
     union {
         mpr_type casttype;
-        uint8_t offset;
+        uint16_t offset;
     };
     mpr_type datatype;
-    uint8_t vec_len;
+    uint16_t vec_len;
 //    union {
-        uint8_t vec_idx;
+        uint16_t vec_idx;
         uint8_t arity;
 //    };
     int8_t hist;          // TODO switch to bitflags
@@ -382,12 +359,79 @@ typedef struct _var {
     char *name;
     mpr_type datatype;
     mpr_type casttype;
-    uint8_t vec_len;
+    uint16_t vec_len;
     char vec_len_locked;
     char assigned;
     char public;
 } mpr_var_t, *mpr_var;
 
+/* After parsing, the RPN token stack is lowered to a flat instruction stream.
+ * Each instruction has an opcode specialised by its operand type and operates
+ * on registers whose indices are resolved at compile time, so evaluation
+ * needs neither a stack pointer nor per-element type dispatch. */
+typedef enum {
+    /* operator instructions share their values with expr_op_t */
+    INSTR_LOAD_CONST = N_OP,
+    INSTR_LOAD_Y,
+    INSTR_LOAD_X,
+    INSTR_LOAD_VAR,
+    INSTR_LOAD_TT,
+    INSTR_FN0,
+    INSTR_FN1,
+    INSTR_FN2,
+    INSTR_FN3,
+    INSTR_FN4,
+    INSTR_VFN,
+    INSTR_MOVE,
+    INSTR_CAST_I,
+    INSTR_CAST_F,
+    INSTR_CAST_D,
+    INSTR_ASSIGN_Y,
+    INSTR_ASSIGN_VAR,
+    INSTR_ASSIGN_TT,
+    INSTR_MEMO_LOAD,
+    INSTR_MEMO_STORE,
+    N_INSTR
+} expr_instr_t;
+
+#define TYPE_IDX(TYPE) ((TYPE) == MPR_INT32 ? 0 : (TYPE) == MPR_FLT ? 1 : 2)
+#define OPCODE(INSTR, TYPE) ((INSTR) * 3 + TYPE_IDX(TYPE))
+
+typedef struct _instr {
+    union {
+        float f;
+        int i;
+        double d;
+        void *fn;
+    };                      /* constant value or function pointer */
+    mpr_vec_fn *vec;        /* vector kernel for elementwise operation */
+    uint16_t opcode;        /* OPCODE(instruction, operand type) */
+    uint8_t reg;            /* result register, operands are reg, reg+1... */
+    uint16_t src;           /* source register (MOVE) or source length (VFN) */
+    uint16_t offset;        /* element offset into source (ASSIGN) or
+                             * destination (MOVE) register */
+    uint16_t vec_len;
+    uint16_t vec_idx;
+    uint8_t tok_idx;        /* index of the token this was lowered from */
+    int8_t var;             /* variable or input index */
+    int8_t hist;            /* non-zero if indexing history */
+    mpr_type hist_type;     /* type of the history index in register reg */
+    mpr_type datatype;      /* assigned datatype, reported in output types */
+    char can_advance;       /* assignment does not block advancing offset */
+} mpr_instr_t, *mpr_instr;
+
+/* Subexpressions that depend on some but not all of the inputs are memoized.
+ * Their result is kept for each instance along with the stamps of the input
+ * samples it was computed from, and reused until one of those inputs is
+ * updated. MEMO_LOAD precedes the instructions of the subexpression and skips
+ * them if the stored result is current; MEMO_STORE follows them. */
+typedef struct _memo {
+    uint32_t deps;          /* bitmask of the inputs read by the subexpression */
+    uint16_t next;          /* index of the instruction following MEMO_STORE */
+    int offset;             /* offset of input stamps in each instance's record */
+    int val_offset;         /* offset of the stored result */
+} mpr_memo_t, *mpr_memo;
+
 static int strncmp_lc(const char *a, const char *b, int len)
 {
     int i;
@@ -494,6 +538,7 @@ static int tok_arity(mpr_token_t tok)
 static int expr_lex(const char *str, int idx, mpr_token_t *tok)
 {
     tok->datatype = MPR_INT32;
+    tok->offset = 0;
     tok->casttype = 0;
     tok->vec_len = 1;
     tok->vec_idx = 0;
@@ -734,19 +779,83 @@ struct _mpr_expr
     mpr_var vars;
     uint8_t offset;
     uint8_t len;
-    uint8_t vec_size;
+    uint16_t vec_size;
     uint8_t *in_hist_size;
     uint8_t out_hist_size;
     uint8_t n_vars;
     int8_t inst_ctl;
     int8_t mute_ctl;
+    uint8_t n_tmp;          /* number of temporaries used by optimized tokens */
+    uint8_t parsed_len;     /* number of tokens before optimization */
+    mpr_instr code;
+    uint16_t *tok_instr;    /* index of first instruction lowered from token */
+    uint16_t n_instr;
+    uint8_t n_regs;
+    uint8_t out_reg;        /* register holding the result of the last token */
+    mpr_type out_type;
+    uint16_t reg_size;      /* bytes per register for each instance */
+    char *regs;             /* register file, n_regs * reg_size bytes */
+    int regs_n_inst;        /* number of instances the registers can hold */
+    mpr_memo memos;         /* memoized subexpressions */
+    uint8_t n_memos;
+    int memo_size;          /* size of the memo record for each instance */
+    char *memo;             /* memo records, indexed by instance */
+    int memo_n_inst;        /* number of instances the memo records can hold */
+    void *jit;              /* native code, or NULL if not enabled */
+    uint32_t *jit_offsets;  /* offset of each instruction in native code */
+    struct _cache_entry *shared; /* cache entry if this is a handle to a
+                                  * shared expression, otherwise NULL */
 };
 
+/* Expressions with identical strings and signal types and lengths are parsed
+ * and compiled once per cache. Each user receives a handle: a copy of the
+ * shared expression with its own evaluation offset, scratch registers and
+ * memoized results, that refers to the shared tokens, instructions, variable
+ * descriptions and native code. Evaluation must treat the shared parts as
+ * read-only; values of user variables are kept in the caller's v_vars. */
+typedef struct _cache_entry {
+    struct _cache_entry *next;  /* next entry in the same bucket */
+    struct _mpr_expr_cache *cache;
+    mpr_expr expr;              /* the shared expression */
+    int refcount;               /* number of handles */
+    uint32_t hash;
+    int key_len;
+    char key[];
+} cache_entry_t, *cache_entry;
+
+typedef struct _mpr_expr_cache {
+    cache_entry *buckets;
+    int size;                   /* number of buckets, a power of two */
+    int count;
+} mpr_expr_cache_t;
+
+static void cache_remove(cache_entry entry);
+
 void mpr_expr_free(mpr_expr expr)
 {
     int i;
+    if (expr->shared) {
+        cache_entry entry = expr->shared;
+        FUNC_IF(free, expr->regs);
+        FUNC_IF(free, expr->memo);
+        free(expr);
+        if (--entry->refcount > 0)
+            return;
+        cache_remove(entry);
+        expr = entry->expr;
+        free(entry);
+    }
     FUNC_IF(free, expr->in_hist_size);
     FUNC_IF(free, expr->tokens);
+    FUNC_IF(free, expr->code);
+    FUNC_IF(free, expr->tok_instr);
+    FUNC_IF(free, expr->regs);
+    FUNC_IF(free, expr->memos);
+    FUNC_IF(free, expr->memo);
+#ifdef HAVE_JIT
+    FUNC_IF(mpr_jit_free, expr->jit);
+#endif
+    FUNC_IF(free, expr->jit_offsets);
     if (expr->n_vars && expr->vars) {
         for (i = 0; i < expr->n_vars; i++)
             free(expr->vars[i].name);
@@ -797,6 +906,8 @@ static void printtoken(mpr_token_t t, mpr_var_t *vars)
         case TOK_VECTORIZE: snprintf(s, len, "VECT(%d)", t.arity);       break;
         case TOK_NEGATE:    snprintf(s, len, "-");                       break;
         case TOK_VFN:       snprintf(s, len, "%s()", vfn_tbl[t.fn].name); break;
+        case TOK_STORE_TMP: snprintf(s, len, "STORE_TMP(%d)", t.i);      break;
+        case TOK_LOAD_TMP:  snprintf(s, len, "LOAD_TMP(%d)", t.i);       break;
         case TOK_ASSIGN:
         case TOK_ASSIGN_CONST:
         case TOK_ASSIGN_USE:
@@ -1016,7 +1127,7 @@ static int check_type_and_len(mpr_token_t *stk, int top, mpr_var_t *vars)
     // TODO: allow precomputation of const-only vectors
     int i, arity, can_precompute = 1, optimize = NONE;
     mpr_type type = stk[top].datatype;
-    uint8_t vec_len = stk[top].vec_len;
+    uint16_t vec_len = stk[top].vec_len;
     switch (stk[top].toktype) {
         case TOK_OP:
             if (stk[top].op == OP_IF)
@@ -1170,7 +1281,7 @@ static int check_type_and_len(mpr_token_t *stk, int top, mpr_var_t *vars)
                                         stk[i].vec_len, vec_len);
                     }
                     else if (stk[i].toktype == TOK_VAR && stk[i].var < VAR_Y) {
-                        uint8_t *vec_len_ptr = &vars[stk[i].var].vec_len;
+                        uint16_t *vec_len_ptr = &vars[stk[i].var].vec_len;
                         *vec_len_ptr = vec_len;
                         stk[i].vec_len = vec_len;
                         stk[i].vec_len_locked = 1;
@@ -1207,6 +1318,7 @@ static int check_type_and_len(mpr_token_t *stk, int top, mpr_var_t *vars)
                     ++depth;
                     break;
                 case TOK_VAR:
+                case TOK_TT:
                     if (stk[i].hist) {
                         ++skip;
                         ++depth;
@@ -1244,7 +1356,7 @@ static int check_type_and_len(mpr_token_t *stk, int top, mpr_var_t *vars)
 static int check_assign_type_and_len(mpr_token_t *stk, int top, mpr_var_t *vars)
 {
     int i = top;
-    uint8_t vec_len = 0;
+    uint16_t vec_len = 0;
     expr_var_t var = stk[top].var;
 
     while (i >= 0 && (stk[i].toktype & TOK_ASSIGN) && (stk[i].var == var)) {
@@ -1293,6 +1405,802 @@ static int find_var_by_name(mpr_var_t *vars, int n_vars, const char *str, int le
     return -1;
 }
 
+/* Minimum vector length for which elementwise operations are dispatched to
+ * vector kernels instead of being evaluated inline. */
+#define VEC_KERNEL_MIN_LEN 8
+
+static mpr_vec_op tok_vec_op(mpr_token_t *tok)
+{
+    if (TOK_OP == tok->toktype) {
+        switch (tok->op) {
+            case OP_ADD:                        return MPR_VEC_ADD;
+            case OP_SUBTRACT:                   return MPR_VEC_SUB;
+            case OP_MULTIPLY:                   return MPR_VEC_MUL;
+            case OP_DIVIDE:                     return MPR_VEC_DIV;
+            case OP_IS_EQUAL:                   return MPR_VEC_EQ;
+            case OP_IS_NOT_EQUAL:               return MPR_VEC_NE;
+            case OP_IS_LESS_THAN:               return MPR_VEC_LT;
+            case OP_IS_LESS_THAN_OR_EQUAL:      return MPR_VEC_LE;
+            case OP_IS_GREATER_THAN:            return MPR_VEC_GT;
+            case OP_IS_GREATER_THAN_OR_EQUAL:   return MPR_VEC_GE;
+            case OP_LOGICAL_AND:                return MPR_VEC_AND;
+            case OP_LOGICAL_OR:                 return MPR_VEC_OR;
+            case OP_BITWISE_AND:                return MPR_VEC_BAND;
+            case OP_BITWISE_OR:                 return MPR_VEC_BOR;
+            case OP_BITWISE_XOR:                return MPR_VEC_BXOR;
+            default:                            return MPR_VEC_NONE;
+        }
+    }
+    else if (TOK_FN == tok->toktype) {
+        switch (tok->fn) {
+            case FN_ABS:                        return MPR_VEC_ABS;
+            case FN_CEIL:                       return MPR_VEC_CEIL;
+            case FN_FLOOR:                      return MPR_VEC_FLOOR;
+            case FN_MAX:                        return MPR_VEC_MAX;
+            case FN_MIN:                        return MPR_VEC_MIN;
+            case FN_SQRT:                       return MPR_VEC_SQRT;
+            case FN_TRUNC:                      return MPR_VEC_TRUNC;
+            default:                            break;
+        }
+        /* The transcendental kernels approximate libm, so whether they are
+         * used must depend only on the vector length and not on the number
+         * of instances evaluated together. */
+        if (tok->vec_len < VEC_KERNEL_MIN_LEN)
+            return MPR_VEC_NONE;
+        switch (tok->fn) {
+            case FN_COS:                        return MPR_VEC_COS;
+            case FN_EXP:                        return MPR_VEC_EXP;
+            case FN_LOG:                        return MPR_VEC_LOG;
+            case FN_SIN:                        return MPR_VEC_SIN;
+            default:                            return MPR_VEC_NONE;
+        }
+    }
+    return MPR_VEC_NONE;
+}
+
+#define IS_ASSIGN_STMT(TOK) (   TOK_ASSIGN == (TOK).toktype         \
+                             || TOK_ASSIGN_CONST == (TOK).toktype   \
+                             || TOK_ASSIGN_TT == (TOK).toktype)
+
+/* After parsing, the token stack is rewritten by a series of optimization
+ * passes. Within a statement evaluation is a pure stack computation, so any
+ * subexpression may be replaced by a different token sequence that leaves the
+ * same value on the stack. Subexpressions are identified by the index of their
+ * last (root) token. */
+
+static int tok_equal(const mpr_token_t *a, const mpr_token_t *b)
+{
+    if (   a->toktype != b->toktype || a->datatype != b->datatype
+        || a->casttype != b->casttype || a->vec_len != b->vec_len
+        || a->vec_idx != b->vec_idx || a->hist != b->hist || a->muted != b->muted)
+        return 0;
+    switch (a->toktype) {
+        case TOK_CONST:
+            switch (a->datatype) {
+                case MPR_INT32: return a->i == b->i;
+                case MPR_FLT:   return !memcmp(&a->f, &b->f, sizeof(float));
+                case MPR_DBL:   return !memcmp(&a->d, &b->d, sizeof(double));
+                default:        return 0;
+            }
+        case TOK_VAR:
+        case TOK_TT:        return a->var == b->var;
+        case TOK_OP:        return a->op == b->op;
+        case TOK_FN:        return a->fn == b->fn;
+        case TOK_VFN:       return a->vfn == b->vfn;
+        case TOK_VECTORIZE: return a->arity == b->arity;
+        case TOK_LOAD_TMP:  return a->i == b->i;
+        default:            return 0;
+    }
+}
+
+/* Tokens that may be evaluated more than once, or not at all, without
+ * changing the result of the expression. */
+static int tok_is_pure(const mpr_token_t *tok)
+{
+    switch (tok->toktype) {
+        case TOK_CONST:
+        case TOK_VAR:
+        case TOK_TT:
+        case TOK_OP:
+        case TOK_VFN:
+        case TOK_VECTORIZE:
+        case TOK_LOAD_TMP:  return 1;
+        case TOK_FN:        return tok->fn < FN_DELAY;
+        default:            return 0;
+    }
+}
+
+static int range_is_pure(mpr_token_t *stk, int start, int end)
+{
+    for (; start <= end; start++) {
+        if (!tok_is_pure(&stk[start]))
+            return 0;
+    }
+    return 1;
+}
+
+/* Find the index of the first token of the subexpression ending at each token,
+ * or -1 if the subexpression does not lie within a single statement. */
+static void find_subexprs(mpr_token_t *stk, int len, int *start)
+{
+    int i, j, n, s, top = -1, roots[len];
+    for (i = 0; i < len; i++) {
+        switch (stk[i].toktype) {
+            case TOK_VAR:
+            case TOK_TT:        n = stk[i].hist ? 1 : 0;    break;
+            case TOK_STORE_TMP: n = 1;                      break;
+            default:
+                if (stk[i].toktype >= TOK_ASSIGN) {
+                    // nothing left on the stack can be optimized
+                    start[i] = -1;
+                    top = -1;
+                    continue;
+                }
+                n = tok_arity(stk[i]);
+                break;
+        }
+        s = i;
+        if (n > top + 1) {
+            s = -1;
+            top = -1;
+        }
+        for (j = 0; j < n && top >= 0; j++) {
+            int k = roots[top--];
+            if (k < 0 || s < 0)
+                s = -1;
+            else if (k < s)
+                s = k;
+        }
+        start[i] = s;
+        roots[++top] = s;
+    }
+}
+
+/* Get the root token of each operand of a subexpression with a valid start. */
+static void get_operands(int *start, int root, int arity, int *operands)
+{
+    int i = root - 1;
+    while (arity-- > 0) {
+        operands[arity] = i;
+        i = start[i] - 1;
+    }
+}
+
+/* Replace the tokens stk[start..end] with n tokens copied from src. Returns
+ * the new stack length, or -1 if the stack size would be exceeded. */
+static int replace_tokens(mpr_token_t *stk, int len, int start, int end,
+                          const mpr_token_t *src, int n)
+{
+    int tail = len - end - 1;
+    mpr_token_t tmp[n > 0 ? n : 1];
+    if (len - (end - start + 1) + n > STACK_SIZE)
+        return -1;
+    if (n)
+        memcpy(tmp, src, sizeof(mpr_token_t) * n);
+    memmove(stk + start + n, stk + end + 1, sizeof(mpr_token_t) * tail);
+    if (n)
+        memcpy(stk + start, tmp, sizeof(mpr_token_t) * n);
+    return start + n + tail;
+}
+
+/* Replace a constant with its reciprocal if the reciprocal is exact, i.e. the
+ * constant is a power of two, so that multiplying gives the same result. */
+static int const_tok_invert_exact(mpr_token_t *tok)
+{
+    int exp;
+    switch (tok->datatype) {
+        case MPR_FLT: {
+            float r = 1.f / tok->f;
+            if (   !isfinite(r) || 0.5f != fabsf(frexpf(tok->f, &exp))
+                || 0.5f != fabsf(frexpf(r, &exp)))
+                return 0;
+            tok->f = r;
+            return 1;
+        }
+        case MPR_DBL: {
+            double r = 1.0 / tok->d;
+            if (   !isfinite(r) || 0.5 != fabs(frexp(tok->d, &exp))
+                || 0.5 != fabs(frexp(r, &exp)))
+                return 0;
+            tok->d = r;
+            return 1;
+        }
+        default:
+            return 0;
+    }
+}
+
+/* Fold ternary operators with constant conditions, and operators or functions
+ * whose operands have all become constant as a result. Since constants apply
+ * to every element of a vector, a constant condition selects the same branch
+ * for the whole vector. */
+static int fold_consts(mpr_token_t *stk, int len)
+{
+    int i, j, n, b, start[STACK_SIZE], operands[4];
+    mpr_token_t tmp[5];
+  again:
+    find_subexprs(stk, len, start);
+    for (i = 0; i < len; i++) {
+        if (start[i] < 0 || (TOK_OP != stk[i].toktype && TOK_FN != stk[i].toktype))
+            continue;
+        n = tok_arity(stk[i]);
+        if (!n || !tok_is_pure(&stk[i]))
+            continue;
+        get_operands(start, i, n, operands);
+
+        if (TOK_OP == stk[i].toktype
+            && (OP_IF_ELSE == stk[i].op || OP_IF_THEN_ELSE == stk[i].op)) {
+            mpr_token_t *cond = &stk[operands[0]], *res;
+            if (   start[operands[0]] != operands[0] || TOK_CONST != cond->toktype
+                || cond->casttype || cond->datatype != stk[i].datatype)
+                continue;
+            // history indices are read using the datatype of the previous token
+            if (   i + 1 < len && stk[i+1].hist
+                && (TOK_VAR == stk[i+1].toktype || TOK_TT == stk[i+1].toktype))
+                continue;
+            if (OP_IF_ELSE == stk[i].op)
+                b = const_tok_is_zero(*cond) ? 1 : 0;
+            else
+                b = const_tok_is_zero(*cond) ? 2 : 1;
+            res = &stk[operands[b]];
+            if (   res->vec_len != stk[i].vec_len
+                || (res->casttype ? res->casttype : res->datatype) != stk[i].datatype
+                || (res->casttype && stk[i].casttype))
+                continue;
+            if (stk[i].casttype)
+                res->casttype = stk[i].casttype;
+            len = replace_tokens(stk, len, start[i], i, stk + start[operands[b]],
+                                 operands[b] - start[operands[b]] + 1);
+            goto again;
+        }
+
+        for (j = 0; j < n; j++) {
+            if (start[operands[j]] != operands[j] || TOK_CONST != stk[operands[j]].toktype)
+                break;
+        }
+        if (j < n)
+            continue;
+        if (   TOK_OP == stk[i].toktype
+            && (OP_DIVIDE == stk[i].op || OP_MODULO == stk[i].op)
+            && (stk[i-1].casttype || const_tok_is_zero(stk[i-1])))
+            continue;
+        for (j = 0; j <= n; j++) {
+            memcpy(&tmp[j], &stk[i - n + j], sizeof(mpr_token_t));
+            tmp[j].vec_len = 1;
+        }
+        tmp[n].casttype = 0;
+        if (!precompute(tmp, n + 1, 1))
+            continue;
+        tmp[0].casttype = stk[i].casttype;
+        tmp[0].vec_len = stk[i].vec_len;
+        tmp[0].vec_len_locked = stk[i].vec_len_locked;
+        tmp[0].vec_idx = 0;
+        tmp[0].hist = 0;
+        tmp[0].muted = 0;
+        len = replace_tokens(stk, len, i - n, i, tmp, 1);
+        goto again;
+    }
+    return len;
+}
+
+/* Replace pow() with a constant exponent of two by multiplication, and
+ * division by a constant by multiplication with its reciprocal where this
+ * gives an identical result. */
+static int reduce_strength(mpr_token_t *stk, int len)
+{
+    int i, s, n, start[STACK_SIZE];
+    mpr_token_t tmp[STACK_SIZE];
+  again:
+    find_subexprs(stk, len, start);
+    for (i = 2; i < len; i++) {
+        mpr_token_t *c = &stk[i-1];
+        if (   start[i] < 0 || start[i-1] != i-1 || TOK_CONST != c->toktype
+            || c->casttype || c->datatype != stk[i].datatype || MPR_INT32 == c->datatype)
+            continue;
+        if (TOK_OP == stk[i].toktype && OP_DIVIDE == stk[i].op) {
+            if (const_tok_invert_exact(c))
+                stk[i].op = OP_MULTIPLY;
+        }
+        else if (TOK_FN == stk[i].toktype && FN_POW == stk[i].fn) {
+            if (MPR_FLT == c->datatype ? 2.f != c->f : 2.0 != c->d)
+                continue;
+            // duplicate the base, repeated evaluation is removed later if costly
+            s = start[i-2];
+            if (!range_is_pure(stk, s, i-2))
+                continue;
+            memcpy(tmp, stk + s, sizeof(mpr_token_t) * (i - 1 - s));
+            memcpy(&tmp[i-1-s], &stk[i], sizeof(mpr_token_t));
+            tmp[i-1-s].toktype = TOK_OP;
+            tmp[i-1-s].op = OP_MULTIPLY;
+            if ((n = replace_tokens(stk, len, i - 1, i, tmp, i - s)) < 0)
+                continue;
+            len = n;
+            goto again;
+        }
+    }
+    return len;
+}
+
+/* Count the repeats of the subexpression ending at root later in the same
+ * statement, optionally marking their root tokens. */
+static int count_repeats(mpr_token_t *stk, int len, int *start, int root, char *marks)
+{
+    int i, j, size = root - start[root] + 1, count = 0;
+    for (i = root + size; i < len; i++) {
+        if (stk[i].toktype >= TOK_ASSIGN && TOK_TT != stk[i].toktype)
+            break;
+        if (start[i] != i - size + 1)
+            continue;
+        for (j = 0; j < size; j++) {
+            if (!tok_equal(&stk[start[root] + j], &stk[start[i] + j]))
+                break;
+        }
+        if (j < size)
+            continue;
+        if (marks)
+            marks[i] = 1;
+        ++count;
+    }
+    return count;
+}
+
+/* Store the first occurrence of a repeated subexpression in a temporary and
+ * replace the repeats with a copy of the temporary, largest first. */
+static int eliminate_common_subexprs(mpr_token_t *stk, int len, int *n_tmp)
+{
+    int i, n, size, best, best_size, start[STACK_SIZE];
+    char marks[STACK_SIZE];
+    mpr_token_t tmp[STACK_SIZE], t;
+
+    while (*n_tmp < STACK_SIZE) {
+        find_subexprs(stk, len, start);
+        best = -1;
+        best_size = 1;
+        for (i = 0; i < len; i++) {
+            size = i - start[i] + 1;
+            if (start[i] < 0 || size <= best_size || !range_is_pure(stk, start[i], i))
+                continue;
+            // only worthwhile if more tokens are removed than added
+            if ((size - 1) * count_repeats(stk, len, start, i, 0) > 1) {
+                best = i;
+                best_size = size;
+            }
+        }
+        if (best < 0)
+            break;
+
+        memset(marks, 0, sizeof(marks));
+        count_repeats(stk, len, start, best, marks);
+        memset(&t, 0, sizeof(mpr_token_t));
+        t.i = (*n_tmp)++;
+        t.datatype = stk[best].casttype ? stk[best].casttype : stk[best].datatype;
+        t.vec_len = stk[best].vec_len;
+        t.vec_len_locked = 1;
+        for (i = 0, n = 0; i < len; i++) {
+            if (i + best_size - 1 < len && marks[i + best_size - 1]) {
+                memcpy(&tmp[n], &t, sizeof(mpr_token_t));
+                tmp[n++].toktype = TOK_LOAD_TMP;
+                i += best_size - 1;
+                continue;
+            }
+            memcpy(&tmp[n++], &stk[i], sizeof(mpr_token_t));
+            if (i == best) {
+                memcpy(&tmp[n], &t, sizeof(mpr_token_t));
+                tmp[n++].toktype = TOK_STORE_TMP;
+            }
+        }
+        memcpy(stk, tmp, sizeof(mpr_token_t) * n);
+        len = n;
+    }
+    return len;
+}
+
+/* Run the optimization passes on the parsed token stack, returning its new
+ * length. The common subexpression pass removes repeated evaluation introduced
+ * by strength reduction. Assignments to user variables are never removed,
+ * since every variable is published as map metadata. */
+static int optimize(mpr_token_t *stk, int len, int *n_tmp)
+{
+    len = fold_consts(stk, len);
+    len = reduce_strength(stk, len);
+    return eliminate_common_subexprs(stk, len, n_tmp);
+}
+
+#define DEPS_VOLATILE 0x80000000
+#define MEMO_MIN_LEN 4
+
+/* Find the inputs each subexpression depends on, as a bitmask with one bit per
+ * input. Subexpressions that also read values that may change without an
+ * input update (the output, user variables, or their timetags) or that have
+ * side effects are flagged as volatile. */
+static void find_src_deps(mpr_token_t *stk, int len, uint32_t *deps)
+{
+    int i, j, n, top = -1;
+    uint32_t d, stack[len], tmp_deps[len];
+    for (i = 0; i < len; i++) {
+        switch (stk[i].toktype) {
+            case TOK_VAR:
+            case TOK_TT:        n = stk[i].hist ? 1 : 0;    break;
+            case TOK_STORE_TMP: n = 1;                      break;
+            default:
+                if (stk[i].toktype >= TOK_ASSIGN) {
+                    deps[i] = DEPS_VOLATILE;
+                    top = -1;
+                    continue;
+                }
+                n = tok_arity(stk[i]);
+                break;
+        }
+        d = n > top + 1 ? DEPS_VOLATILE : 0;
+        for (j = 0; j < n && top >= 0; j++)
+            d |= stack[top--];
+        switch (stk[i].toktype) {
+            case TOK_VAR:
+            case TOK_TT:
+                if (stk[i].var >= VAR_X && stk[i].var - VAR_X < 31)
+                    d |= 1 << (stk[i].var - VAR_X);
+                else
+                    d |= DEPS_VOLATILE;
+                break;
+            case TOK_FN:
+                if (stk[i].fn >= FN_DELAY)
+                    d |= DEPS_VOLATILE;
+                break;
+            case TOK_STORE_TMP:
+                tmp_deps[stk[i].i] = d;
+                d |= DEPS_VOLATILE;
+                break;
+            case TOK_LOAD_TMP:
+                d |= tmp_deps[stk[i].i];
+                break;
+            default:
+                break;
+        }
+        deps[i] = d;
+        stack[++top] = d;
+    }
+}
+
+/* Choose the subexpressions to memoize: pure subexpressions that depend on a
+ * strict subset of the inputs read by the expression, and that are costly
+ * enough that reusing their result is faster than recomputing it. A
+ * subexpression that depends on the same inputs as the one containing it is
+ * not chosen, since both would always be recomputed together. Memoized
+ * subexpressions may be nested, so that an update to one input recomputes only
+ * the subexpressions on the path from that input to the root. On return deps[i]
+ * holds the inputs read by the subexpression ending at token i, start[i] the
+ * index of its first token, and is_memo[i] is set if it was chosen. Returns the
+ * number of subexpressions chosen. */
+static int find_memos(mpr_token_t *stk, int len, uint32_t *deps, int *start,
+                      char *is_memo)
+{
+    int i, j, n = 0, cost;
+    uint32_t all = 0;
+
+    find_subexprs(stk, len, start);
+    find_src_deps(stk, len, deps);
+    for (i = 0; i < len; i++) {
+        is_memo[i] = 0;
+        if (stk[i].toktype < TOK_ASSIGN)
+            all |= deps[i] & ~DEPS_VOLATILE;
+    }
+    for (i = 0; i < len && n < 0x7F; i++) {
+        if (   start[i] < 0 || start[i] == i || !deps[i] || deps[i] & DEPS_VOLATILE
+            || deps[i] == all || stk[i].toktype >= TOK_ASSIGN)
+            continue;
+        // the parent is the next subexpression that includes this one
+        for (j = i + 1; j < len; j++) {
+            if (start[j] >= 0 && start[j] <= start[i])
+                break;
+        }
+        if (j < len && deps[j] == deps[i])
+            continue;
+        for (j = start[i], cost = 0; j <= i; j++) {
+            if (TOK_FN == stk[j].toktype || TOK_VFN == stk[j].toktype)
+                cost += MEMO_MIN_LEN;
+            else
+                ++cost;
+        }
+        if (cost < MEMO_MIN_LEN)
+            continue;
+        is_memo[i] = 1;
+        ++n;
+    }
+    return n;
+}
+
+/*! Lower the RPN token stack to a typed instruction stream. Register indices
+ *  are the stack positions the interpreter would use, except that registers
+ *  are released at the end of each statement so that evaluation may begin at
+ *  any statement boundary (see expr->offset). Each register stores its
+ *  elements packed at the width of their type, and is 4 bytes per element
+ *  wide unless the expression stores doubles. The register file is allocated
+ *  once here and sized for the maximum stack depth. Returns 0 if the tokens
+ *  cannot be compiled, in which case the expression will be interpreted. */
+static int compile(mpr_expr expr)
+{
+    mpr_token_t *tok = expr->tokens;
+    int i, j, k, n = 0, top = -1, max_instr = 0, n_regs = 0, dims[expr->len];
+    int n_memos, start[expr->len], memo_idx[expr->len], memo_size = 0;
+    uint32_t deps[expr->len];
+    char is_memo[expr->len];
+    mpr_type last_type = 0;
+    mpr_instr code;
+    mpr_memo memos;
+
+    n_memos = find_memos(expr->tokens, expr->len, deps, start, is_memo);
+    for (i = 0; i < expr->len; i++)
+        max_instr += 2 + (TOK_VECTORIZE == tok[i].toktype ? tok[i].arity : 0);
+    max_instr += n_memos * 2;
+    code = calloc(1, sizeof(mpr_instr_t) * max_instr);
+    expr->tok_instr = malloc(sizeof(uint16_t) * (expr->len + 1));
+    memos = n_memos ? calloc(1, sizeof(mpr_memo_t) * n_memos) : 0;
+    n_memos = 0;
+
+    for (i = 0; i < expr->len; i++, tok++) {
+        mpr_instr in;
+        expr->tok_instr[i] = n;
+        /* memoized subexpressions beginning at this token, outermost first;
+         * each result is placed where the subexpression would leave it */
+        for (j = expr->len - 1; j >= i; j--) {
+            mpr_token_t *root = &expr->tokens[j];
+            mpr_memo memo = &memos[n_memos];
+            if (!is_memo[j] || start[j] != i)
+                continue;
+            memo->deps = deps[j];
+            memo->offset = memo_size;
+            for (k = 0; k < 32; k++)
+                memo_size += ((memo->deps >> k) & 1) * sizeof(uint32_t);
+            memo_size = (memo_size + 7) & ~7;
+            memo->val_offset = memo_size;
+            memo_size += root->vec_len * sizeof(double);
+            in = &code[n++];
+            in->tok_idx = i;
+            in->opcode = OPCODE(INSTR_MEMO_LOAD, root->casttype ? root->casttype
+                                                                : root->datatype);
+            in->reg = top + 1;
+            in->vec_len = root->vec_len;
+            in->var = memo_idx[j] = n_memos++;
+        }
+        in = &code[n];
+        in->tok_idx = i;
+        in->vec_len = tok->vec_len;
+        in->vec_idx = tok->vec_idx;
+        switch (tok->toktype) {
+            case TOK_CONST:
+                in->reg = ++top;
+                in->opcode = OPCODE(INSTR_LOAD_CONST, tok->datatype);
+                switch (tok->datatype) {
+                    case MPR_INT32: in->i = tok->i; break;
+                    case MPR_FLT:   in->f = tok->f; break;
+                    case MPR_DBL:   in->d = tok->d; break;
+                    default:        goto error;
+                }
+                ++n;
+                break;
+            case TOK_VAR:
+            case TOK_TT:
+                if (tok->hist) {
+                    if (   MPR_INT32 != last_type && MPR_FLT != last_type
+                        && MPR_DBL != last_type)
+                        goto error;
+                    in->hist = 1;
+                    in->hist_type = last_type;
+                }
+                else
+                    ++top;
+                in->reg = top;
+                if (TOK_TT == tok->toktype) {
+                    in->opcode = OPCODE(INSTR_LOAD_TT, MPR_DBL);
+                    in->var = tok->var;
+                }
+                else if (VAR_Y == tok->var)
+                    in->opcode = OPCODE(INSTR_LOAD_Y, tok->datatype);
+                else if (tok->var >= VAR_X) {
+                    in->opcode = OPCODE(INSTR_LOAD_X, tok->datatype);
+                    in->var = tok->var - VAR_X;
+                }
+                else {
+                    in->opcode = OPCODE(INSTR_LOAD_VAR, MPR_DBL);
+                    in->var = tok->var;
+                }
+                ++n;
+                break;
+            case TOK_OP:
+                top -= op_tbl[tok->op].arity - 1;
+                in->reg = top;
+                if (MPR_INT32 != tok->datatype) {
+                    switch (tok->op) {
+                        case OP_LEFT_BIT_SHIFT:
+                        case OP_RIGHT_BIT_SHIFT:
+                        case OP_BITWISE_AND:
+                        case OP_BITWISE_OR:
+                        case OP_BITWISE_XOR:
+                        case OP_IF:
+                            goto error;
+                        default:
+                            break;
+                    }
+                }
+                else if (OP_IF == tok->op)
+                    goto error;
+                if (   MPR_INT32 != tok->datatype && MPR_FLT != tok->datatype
+                    && MPR_DBL != tok->datatype)
+                    goto error;
+                in->opcode = OPCODE(tok->op, tok->datatype);
+                in->vec = mpr_vec_get_fn(tok_vec_op(tok), tok->datatype);
+                ++n;
+                break;
+            case TOK_FN:
+                top -= fn_tbl[tok->fn].arity - 1;
+                in->reg = top;
+                switch (tok->datatype) {
+                    case MPR_INT32: in->fn = fn_tbl[tok->fn].fn_int;    break;
+                    case MPR_FLT:   in->fn = fn_tbl[tok->fn].fn_flt;    break;
+                    case MPR_DBL:   in->fn = fn_tbl[tok->fn].fn_dbl;    break;
+                    default:        goto error;
+                }
+                if (!in->fn || FN_DELAY == tok->fn)
+                    goto error;
+                in->opcode = OPCODE(INSTR_FN0 + fn_tbl[tok->fn].arity, tok->datatype);
+                in->vec = mpr_vec_get_fn(tok_vec_op(tok), tok->datatype);
+                ++n;
+                break;
+            case TOK_VFN:
+                top -= vfn_tbl[tok->vfn].arity - 1;
+                in->reg = top;
+                in->src = dims[top];
+                switch (tok->datatype) {
+                    case MPR_INT32: in->fn = vfn_tbl[tok->vfn].fn_int;  break;
+                    case MPR_FLT:   in->fn = vfn_tbl[tok->vfn].fn_flt;  break;
+                    case MPR_DBL:   in->fn = vfn_tbl[tok->vfn].fn_dbl;  break;
+                    default:        goto error;
+                }
+                if (!in->fn || vfn_tbl[tok->vfn].arity != 1)
+                    goto error;
+                in->opcode = OPCODE(INSTR_VFN, tok->datatype);
+                ++n;
+                break;
+            case TOK_VECTORIZE:
+                /* copy each element into place, the first is already there */
+                top -= tok->arity - 1;
+                k = dims[top];
+                for (j = 1; j < tok->arity; j++) {
+                    in = &code[n++];
+                    in->tok_idx = i;
+                    in->opcode = OPCODE(INSTR_MOVE, tok->datatype);
+                    in->reg = top;
+                    in->src = top + j;
+                    in->offset = k;
+                    in->vec_len = dims[top + j];
+                    /* elements beyond the vector size are never read; clamp
+                     * the copy so it stays within this instance's register */
+                    if (k + in->vec_len > expr->vec_size)
+                        in->vec_len = k < expr->vec_size ? expr->vec_size - k : 0;
+                    k += dims[top + j];
+                }
+                break;
+            case TOK_STORE_TMP:
+                /* temporaries are placed after the stack registers, see below */
+                in->opcode = OPCODE(INSTR_MOVE, tok->datatype);
+                in->reg = tok->i;
+                in->src = top;
+                ++n;
+                break;
+            case TOK_LOAD_TMP:
+                in->opcode = OPCODE(INSTR_MOVE, tok->datatype);
+                in->reg = ++top;
+                in->src = tok->i;
+                ++n;
+                break;
+            case TOK_ASSIGN:
+            case TOK_ASSIGN_USE:
+            case TOK_ASSIGN_CONST:
+                in->reg = top;
+                in->hist = tok->hist;
+                in->offset = tok->offset;
+                in->datatype = tok->datatype;
+                in->can_advance = TOK_ASSIGN_CONST == tok->toktype;
+                if (VAR_Y == tok->var)
+                    in->opcode = OPCODE(INSTR_ASSIGN_Y, expr->out_type);
+                else if (tok->var >= 0 && tok->var < N_USER_VARS) {
+                    in->opcode = OPCODE(INSTR_ASSIGN_VAR, MPR_DBL);
+                    in->var = tok->var;
+                }
+                else
+                    goto error;
+                ++n;
+                break;
+            case TOK_ASSIGN_TT:
+                if (tok->var != VAR_Y || tok->hist == 0)
+                    goto error;
+                in->reg = top;
+                in->hist = tok->hist;
+                in->opcode = OPCODE(INSTR_ASSIGN_TT, MPR_DBL);
+                ++n;
+                break;
+            default:
+                goto error;
+        }
+        if (top < 0 || top >= expr->len)
+            goto error;
+        if (top + 1 > n_regs)
+            n_regs = top + 1;
+        if (tok->toktype < TOK_ASSIGN || TOK_TT == tok->toktype)
+            dims[top] = tok->vec_len;
+        if (tok->toktype < TOK_ASSIGN) {
+            if (tok->casttype) {
+                if (   tok->casttype == tok->datatype
+                    || (   MPR_INT32 != tok->datatype && MPR_FLT != tok->datatype
+                        && MPR_DBL != tok->datatype))
+                    goto error;
+                in = &code[n++];
+                in->tok_idx = i;
+                in->reg = top;
+                in->vec_len = tok->vec_len;
+                if (   MPR_INT32 != tok->casttype && MPR_FLT != tok->casttype
+                    && MPR_DBL != tok->casttype)
+                    goto error;
+                in->opcode = OPCODE(INSTR_CAST_I + TYPE_IDX(tok->casttype), tok->datatype);
+            }
+        }
+        else if (IS_ASSIGN_STMT(*tok) && i + 1 < expr->len && !IS_ASSIGN_STMT(tok[1])) {
+            /* end of statement: nothing left on the stack will be read again */
+            top = -1;
+        }
+        if (is_memo[i]) {
+            in = &code[n++];
+            in->tok_idx = i;
+            in->opcode = OPCODE(INSTR_MEMO_STORE, tok->casttype ? tok->casttype
+                                                                : tok->datatype);
+            in->reg = top;
+            in->vec_len = tok->vec_len;
+            in->var = memo_idx[i];
+            memos[memo_idx[i]].next = n;
+        }
+        last_type = tok->datatype;
+    }
+    if (n_regs + expr->n_tmp > 0xFF)
+        goto error;
+    for (i = 0; i < n; i++) {
+        if (INSTR_MOVE != code[i].opcode / 3)
+            continue;
+        if (TOK_STORE_TMP == expr->tokens[code[i].tok_idx].toktype)
+            code[i].reg += n_regs;
+        else if (TOK_LOAD_TMP == expr->tokens[code[i].tok_idx].toktype)
+            code[i].src += n_regs;
+    }
+    n_regs += expr->n_tmp;
+    expr->tok_instr[expr->len] = n;
+    expr->code = code;
+    expr->n_instr = n;
+    expr->n_regs = n_regs;
+    expr->memos = memos;
+    expr->n_memos = n_memos;
+    expr->memo_size = memo_size;
+    expr->out_reg = top;
+
+    k = sizeof(float);
+    for (i = 0; i < n; i++) {
+        if (2 == code[i].opcode % 3 || INSTR_CAST_D == code[i].opcode / 3)
+            k = sizeof(double);
+    }
+    expr->reg_size = k * expr->vec_size;
+    expr->regs = malloc(n_regs * expr->reg_size);
+    expr->regs_n_inst = 1;
+    return 1;
+
+  error:
+#if TRACING
+    printf("expression could not be compiled, falling back to interpreter\n");
+#endif
+    free(code);
+    free(memos);
+    free(expr->tok_instr);
+    expr->tok_instr = 0;
+    return 0;
+}
+
 /* Macros to help express stack operations in parser. */
 #define FAIL(msg) {                                                 \
     while (--n_vars >= 0)                                           \
@@ -1355,6 +2263,7 @@ mpr_expr mpr_expr_new_from_str(const char *str, int n_ins,
     int n_vars = 0;
     int inst_ctl = -1;
     int mute_ctl = -1;
+    int n_tmp = 0, parsed_len;
     int assign_mask = (TOK_VAR | TOK_OPEN_SQUARE | TOK_COMMA | TOK_CLOSE_SQUARE | TOK_CLOSE_CURLY
                        | TOK_OPEN_CURLY | TOK_PUBLIC | TOK_NEGATE | TOK_CONST);
     int OBJECT_TOKENS = (TOK_VAR | TOK_CONST | TOK_FN | TOK_VFN | TOK_MUTED
@@ -1507,6 +2416,7 @@ mpr_expr mpr_expr_new_from_str(const char *str, int n_ins,
                     vars[n_vars].datatype = MPR_DBL;
                     vars[n_vars].vec_len = 1;
                     vars[n_vars].assigned = 1;
+                    vars[n_vars].public = 0;
 
                     newtok.toktype = TOK_ASSIGN_USE;
                     newtok.var = n_vars;
@@ -1946,6 +2856,12 @@ mpr_expr mpr_expr_new_from_str(const char *str, int n_ins,
     printstack("--->OPERATOR STACK:", op, op_idx, vars, 0);
 #endif
 
+    parsed_len = out_idx + 1;
+    out_idx = optimize(out, out_idx + 1, &n_tmp) - 1;
+#if (TRACING && DEBUG)
+    printstack("--->OPTIMIZED:     ", out, out_idx, vars, 0);
+#endif
+
     // Check for maximum vector length used in stack
     for (i = 0; i < out_idx; i++) {
         if (out[i].vec_len > max_vector)
@@ -1957,6 +2873,8 @@ mpr_expr mpr_expr_new_from_str(const char *str, int n_ins,
     expr->offset = 0;
     expr->inst_ctl = inst_ctl;
     expr->mute_ctl = mute_ctl;
+    expr->n_tmp = n_tmp;
+    expr->parsed_len = parsed_len;
 
     // copy tokens
     expr->tokens = malloc(sizeof(struct _token) * expr->len);
@@ -1976,6 +2894,17 @@ mpr_expr mpr_expr_new_from_str(const char *str, int n_ins,
         expr->vars = NULL;
 
     expr->n_vars = n_vars;
+    expr->out_type = out_type;
+    expr->code = 0;
+    expr->tok_instr = 0;
+    expr->jit = 0;
+    expr->jit_offsets = 0;
+    expr->shared = 0;
+    expr->memos = 0;
+    expr->n_memos = 0;
+    expr->memo = 0;
+    expr->memo_n_inst = 0;
+    compile(expr);
 #if TRACING
     printf("expression allocated and initialized\n");
 #endif
@@ -2042,6 +2971,142 @@ int mpr_expr_get_manages_inst(mpr_expr expr)
     return expr ? expr->inst_ctl >= 0 : 0;
 }
 
+void mpr_expr_get_token_counts(mpr_expr expr, int *parsed, int *optimized)
+{
+    if (parsed)
+        *parsed = expr->parsed_len;
+    if (optimized)
+        *optimized = expr->len;
+}
+
+mpr_expr_cache mpr_expr_cache_new(void)
+{
+    mpr_expr_cache cache = calloc(1, sizeof(mpr_expr_cache_t));
+    cache->size = 16;
+    cache->buckets = calloc(cache->size, sizeof(cache_entry));
+    return cache;
+}
+
+void mpr_expr_cache_free(mpr_expr_cache cache)
+{
+    int i;
+    RETURN_UNLESS(cache);
+    // entries still in use are freed along with their last handle
+    for (i = 0; i < cache->size; i++) {
+        cache_entry entry = cache->buckets[i];
+        while (entry) {
+            entry->cache = 0;
+            entry = entry->next;
+        }
+    }
+    free(cache->buckets);
+    free(cache);
+}
+
+int mpr_expr_cache_get_size(mpr_expr_cache cache)
+{
+    return cache ? cache->count : 0;
+}
+
+static void cache_remove(cache_entry entry)
+{
+    cache_entry *e;
+    RETURN_UNLESS(entry->cache);
+    e = &entry->cache->buckets[entry->hash & (entry->cache->size - 1)];
+    while (*e && *e != entry)
+        e = &(*e)->next;
+    if (*e) {
+        *e = entry->next;
+        --entry->cache->count;
+    }
+}
+
+static void cache_grow(mpr_expr_cache cache)
+{
+    int i, size = cache->size * 2;
+    cache_entry *buckets = calloc(size, sizeof(cache_entry));
+    RETURN_UNLESS(buckets);
+    for (i = 0; i < cache->size; i++) {
+        while (cache->buckets[i]) {
+            cache_entry entry = cache->buckets[i];
+            cache->buckets[i] = entry->next;
+            entry->next = buckets[entry->hash & (size - 1)];
+            buckets[entry->hash & (size - 1)] = entry;
+        }
+    }
+    free(cache->buckets);
+    cache->buckets = buckets;
+    cache->size = size;
+}
+
+static mpr_expr cache_new_handle(cache_entry entry)
+{
+    mpr_expr expr = malloc(sizeof(struct _mpr_expr));
+    memcpy(expr, entry->expr, sizeof(struct _mpr_expr));
+    expr->start = expr->tokens;
+    expr->offset = 0;
+    expr->shared = entry;
+    if (expr->code) {
+        expr->regs = malloc(expr->n_regs * expr->reg_size);
+        expr->regs_n_inst = 1;
+    }
+    // native code is shared, but enabled separately for each handle
+    expr->jit = 0;
+    expr->jit_offsets = 0;
+    expr->memo = 0;
+    expr->memo_n_inst = 0;
+    ++entry->refcount;
+    return expr;
+}
+
+mpr_expr mpr_expr_cache_get(mpr_expr_cache cache, const char *str, int num_in,
+                            const mpr_type *in_types, const int *in_vec_lens,
+                            mpr_type out_type, int out_vec_len)
+{
+    int i, str_len, key_len;
+    uint32_t hash = 2166136261u;
+    cache_entry entry;
+    mpr_expr expr;
+    RETURN_UNLESS(cache && str && num_in && in_types && in_vec_lens, 0);
+
+    str_len = strlen(str);
+    key_len = num_in * (sizeof(mpr_type) + sizeof(int)) + sizeof(mpr_type) + sizeof(int) + str_len;
+    char key[key_len], *k = key;
+
+    // key is the signal types and lengths followed by the expression string
+    memcpy(k, in_types, num_in);
+    k += num_in;
+    memcpy(k, in_vec_lens, num_in * sizeof(int));
+    k += num_in * sizeof(int);
+    *k++ = out_type;
+    memcpy(k, &out_vec_len, sizeof(int));
+    k += sizeof(int);
+    memcpy(k, str, str_len);
+    for (i = 0; i < key_len; i++)
+        hash = (hash ^ (unsigned char)key[i]) * 16777619u;
+
+    for (entry = cache->buckets[hash & (cache->size - 1)]; entry; entry = entry->next) {
+        if (entry->hash == hash && entry->key_len == key_len && !memcmp(entry->key, key, key_len))
+            return cache_new_handle(entry);
+    }
+
+    expr = mpr_expr_new_from_str(str, num_in, in_types, in_vec_lens, out_type, out_vec_len);
+    RETURN_UNLESS(expr, 0);
+    entry = malloc(sizeof(cache_entry_t) + key_len);
+    entry->cache = cache;
+    entry->expr = expr;
+    entry->refcount = 0;
+    entry->hash = hash;
+    entry->key_len = key_len;
+    memcpy(entry->key, key, key_len);
+    if (cache->count >= cache->size)
+        cache_grow(cache);
+    entry->next = cache->buckets[hash & (cache->size - 1)];
+    cache->buckets[hash & (cache->size - 1)] = entry;
+    ++cache->count;
+    return cache_new_handle(entry);
+}
+
 #if TRACING
 static void print_stack_vec(mpr_expr_val stk, mpr_type type, int vec_len)
 {
@@ -2179,8 +3244,8 @@ static const char *type_name(const mpr_type type)
         }                                                                   \
     }                                                                       \
 
-int mpr_expr_eval(mpr_expr expr, mpr_value *v_in, mpr_value *v_vars,
-                  mpr_value v_out, mpr_time *t, mpr_type *types, int inst_idx)
+int mpr_expr_eval_interp(mpr_expr expr, mpr_value *v_in, mpr_value *v_vars,
+                         mpr_value v_out, mpr_time *t, mpr_type *types, int inst_idx)
 {
     if (!expr) {
 #if TRACING
@@ -2214,10 +3279,13 @@ int mpr_expr_eval(mpr_expr expr, mpr_value *v_in, mpr_value *v_vars,
     }
 
     mpr_expr_val_t stk[len][expr->vec_size];
+    mpr_expr_val_t tmp[expr->n_tmp ? expr->n_tmp : 1][expr->vec_size];
     int dims[len];
 
     int i, j, k, top = -1, count = 0, can_advance = 1;
     mpr_type last_type = 0;
+    mpr_vec_op vec_op;
+    mpr_vec_fn *vec;
 
     if (v_out) {
         // init types
@@ -2227,9 +3295,6 @@ int mpr_expr_eval(mpr_expr expr, mpr_value *v_in, mpr_value *v_vars,
         b_out->pos = (b_out->pos + 1) % v_out->mlen;
     }
 
-    for (i = 0; i < expr->n_vars; i++)
-        expr->vars[i].assigned = 0;
-
     while (count < len && tok->toktype != TOK_END) {
         switch (tok->toktype) {
         case TOK_CONST:
@@ -2265,7 +3330,7 @@ int mpr_expr_eval(mpr_expr expr, mpr_value *v_in, mpr_value *v_vars,
             }
             else if (tok->var >= VAR_X) {
                 printf("loading variable x%d", tok->var-VAR_X);
-                mlen = v_in ? v_in[tok->var-VAR_X]->mlen : 0;
+                mlen = v_in && v_in[tok->var-VAR_X] ? v_in[tok->var-VAR_X]->mlen : 0;
             }
 
             if (tok->hist) {
@@ -2291,7 +3356,7 @@ int mpr_expr_eval(mpr_expr expr, mpr_value *v_in, mpr_value *v_vars,
                 COPY_TO_STACK(v_out);
             }
             else if (tok->var >= VAR_X) {
-                if (!v_in)
+                if (!v_in || !v_in[tok->var-VAR_X])
                     return status;
                 mpr_value v = v_in[tok->var-VAR_X];
                 COPY_TO_STACK(v);
@@ -2373,7 +3438,7 @@ int mpr_expr_eval(mpr_expr expr, mpr_value *v_in, mpr_value *v_vars,
                     t_d = t_d * weight + ((b->pos + v_out->mlen + hidx - 1) % v_out->mlen) * (1 - weight);
             }
             else if (tok->var >= VAR_X) {
-                if (!v_in)
+                if (!v_in || !v_in[tok->var-VAR_X])
                     return status;
                 mpr_value v = v_in[tok->var-VAR_X];
                 b = &v->inst[inst_idx % v->num_inst];
@@ -2477,8 +3542,12 @@ int mpr_expr_eval(mpr_expr expr, mpr_value *v_in, mpr_value *v_vars,
             }
             printf("%s)", fn_tbl[tok->fn].arity ? "\b\b" : "");
 #endif
+            /* functions approximated by vector kernels must give the same
+             * results as compiled code, so they are evaluated the same way */
+            vec_op = tok_vec_op(tok);
+            vec = vec_op >= MPR_VEC_SIN ? mpr_vec_get_fn(vec_op, tok->datatype) : 0;
             switch (tok->datatype) {
-#define TYPED_CASE(MTYPE, FN, EL)                                               \
+#define TYPED_CASE(MTYPE, TYPE, FN, EL)                                         \
             case MTYPE:                                                         \
                 switch (fn_tbl[tok->fn].arity) {                                \
                 case 0:                                                         \
@@ -2486,6 +3555,15 @@ int mpr_expr_eval(mpr_expr expr, mpr_value *v_in, mpr_value *v_vars,
                         stk[top][i].EL = ((FN##_arity0*)fn_tbl[tok->fn].FN)();  \
                     break;                                                      \
                 case 1:                                                         \
+                    if (vec) {                                                  \
+                        TYPE buf[MPR_MAX_VECTOR_LEN];                           \
+                        for (i = 0; i < tok->vec_len; i++)                      \
+                            buf[i] = stk[top][i].EL;                            \
+                        vec(buf, buf, tok->vec_len);                            \
+                        for (i = 0; i < tok->vec_len; i++)                      \
+                            stk[top][i].EL = buf[i];                            \
+                        break;                                                  \
+                    }                                                           \
                     for (i = 0; i < tok->vec_len; i++)                          \
                         stk[top][i].EL = (((FN##_arity1*)fn_tbl[tok->fn].FN)    \
                                           (stk[top][i].EL));                    \
@@ -2510,9 +3588,9 @@ int mpr_expr_eval(mpr_expr expr, mpr_value *v_in, mpr_value *v_vars,
                 default: goto error;                                            \
                 }                                                               \
                 break;
-            TYPED_CASE(MPR_INT32, fn_int, i)
-            TYPED_CASE(MPR_FLT, fn_flt, f)
-            TYPED_CASE(MPR_DBL, fn_dbl, d)
+            TYPED_CASE(MPR_INT32, int, fn_int, i)
+            TYPED_CASE(MPR_FLT, float, fn_flt, f)
+            TYPED_CASE(MPR_DBL, double, fn_dbl, d)
 #undef TYPED_CASE
             default:
                 goto error;
@@ -2534,22 +3612,26 @@ int mpr_expr_eval(mpr_expr expr, mpr_value *v_in, mpr_value *v_vars,
             printf("\b\b)");
 #endif
             switch (tok->datatype) {
-#define TYPED_CASE(MTYPE, FN, EL)                                       \
+#define TYPED_CASE(MTYPE, TYPE, FN, EL)                                 \
             case MTYPE:                                                 \
                 switch (vfn_tbl[tok->fn].arity) {                       \
-                    case 1:                                             \
+                    case 1: {                                           \
+                        TYPE a[dims[top]];                              \
+                        for (i = 0; i < dims[top]; i++)                 \
+                            a[i] = stk[top][i].EL;                      \
                         stk[top][0].EL                                  \
                             = (((v##FN##_arity1*)vfn_tbl[tok->fn].FN)   \
-                               (stk[top], dims[top]));                  \
+                               (a, dims[top]));                         \
                         for (i = 1; i < tok->vec_len; i++)              \
                             stk[top][i].EL = stk[top][0].EL;            \
                         break;                                          \
+                    }                                                   \
                     default: goto error;                                \
                 }                                                       \
                 break;
-            TYPED_CASE(MPR_INT32, fn_int, i)
-            TYPED_CASE(MPR_FLT, fn_flt, f)
-            TYPED_CASE(MPR_DBL, fn_dbl, d)
+            TYPED_CASE(MPR_INT32, int, fn_int, i)
+            TYPED_CASE(MPR_FLT, float, fn_flt, f)
+            TYPED_CASE(MPR_DBL, double, fn_dbl, d)
 #undef TYPED_CASE
             default:
                 break;
@@ -2569,7 +3651,7 @@ int mpr_expr_eval(mpr_expr expr, mpr_value *v_in, mpr_value *v_vars,
 #define TYPED_CASE(MTYPE, EL)                                       \
                 case MTYPE:                                         \
                     for (i = 1; i < tok->arity; i++) {              \
-                        for (j = 0; j < dims[top+1]; j++)           \
+                        for (j = 0; j < dims[top+i]; j++)           \
                             stk[top][k++].EL = stk[top+i][j].EL;    \
                     }                                               \
                     break;
@@ -2585,6 +3667,22 @@ int mpr_expr_eval(mpr_expr expr, mpr_value *v_in, mpr_value *v_vars,
             printf("built %u-element vector: ", tok->vec_len);
             print_stack_vec(stk[top], tok->datatype, tok->vec_len);
             printf(" \n");
+#endif
+            break;
+        case TOK_STORE_TMP:
+#if TRACING
+            printf("storing temporary %d\n", tok->i);
+#endif
+            memcpy(tmp[tok->i], stk[top], sizeof(mpr_expr_val_t) * tok->vec_len);
+            break;
+        case TOK_LOAD_TMP:
+            ++top;
+            dims[top] = tok->vec_len;
+            memcpy(stk[top], tmp[tok->i], sizeof(mpr_expr_val_t) * tok->vec_len);
+#if TRACING
+            printf("loading temporary %d ", tok->i);
+            print_stack_vec(stk[top], tok->datatype, tok->vec_len);
+            printf("\n");
 #endif
             break;
         case TOK_ASSIGN:
@@ -2654,8 +3752,6 @@ int mpr_expr_eval(mpr_expr expr, mpr_value *v_in, mpr_value *v_vars,
                 if (t)
                     memcpy(b->times, t, sizeof(mpr_time));
 
-                expr->vars[tok->var].assigned = 1;
-
                 if (tok->var == expr->inst_ctl) {
                     if (alive && stk[top][0].d == 0) {
                         if (status & EXPR_UPDATE)
@@ -2782,3 +3878,911 @@ int mpr_expr_eval(mpr_expr expr, mpr_value *v_in, mpr_value *v_vars,
     trace("Unexpected token in expression.");
     return 0;
 }
+
+/* Registers are addressed relative to the destination of the instruction, as
+ * packed arrays of the element type EL. When several instances are evaluated
+ * together each register holds one vector per instance, so the register of
+ * instance k is found at byte offset k * reg_size. */
+#define REG(IDX) (expr->regs + (IDX) * reg_size * n_inst)
+#define R(N, EL) ((REG_TYPE_##EL*)(REG(in->reg + (N)) + k * reg_size))
+
+#define REG_TYPE_i int
+#define REG_TYPE_f float
+#define REG_TYPE_d double
+
+#define EACH_INST for (k = 0; k < n_inst; k++)
+
+/* Elementwise instructions are applied to each instance in turn, or to the
+ * registers of all instances as a single span if they fill the full vector
+ * and elements of type EL fill the full register. */
+#define IS_SPAN(EL) \
+    (in->vec_len == vec_size && sizeof(REG_TYPE_##EL) * vec_size == reg_size)
+#define EACH_SPAN(EL)                                                           \
+    for (k = 0, len = IS_SPAN(EL) ? vec_size * n_inst : in->vec_len,            \
+         n_spans = IS_SPAN(EL) ? 1 : n_inst; k < n_spans; k++)
+
+#define BINARY_INSTR(OP, SYM, MTYPE, EL)                    \
+    case OPCODE(OP, MTYPE):                                 \
+        EACH_SPAN(EL) {                                     \
+            if (in->vec && len >= VEC_KERNEL_MIN_LEN) {     \
+                in->vec(R(0, EL), R(1, EL), len);           \
+                continue;                                   \
+            }                                               \
+            for (i = 0; i < len; i++)                       \
+                R(0, EL)[i] = R(0, EL)[i] SYM R(1, EL)[i];  \
+        }                                                   \
+        break;
+
+#define TYPED_INSTR_CASES(MTYPE, TYPE, EL, FN)                                  \
+    BINARY_INSTR(OP_ADD, +, MTYPE, EL)                                          \
+    BINARY_INSTR(OP_SUBTRACT, -, MTYPE, EL)                                     \
+    BINARY_INSTR(OP_MULTIPLY, *, MTYPE, EL)                                     \
+    BINARY_INSTR(OP_DIVIDE, /, MTYPE, EL)                                       \
+    BINARY_INSTR(OP_IS_EQUAL, ==, MTYPE, EL)                                    \
+    BINARY_INSTR(OP_IS_NOT_EQUAL, !=, MTYPE, EL)                                \
+    BINARY_INSTR(OP_IS_LESS_THAN, <, MTYPE, EL)                                 \
+    BINARY_INSTR(OP_IS_LESS_THAN_OR_EQUAL, <=, MTYPE, EL)                       \
+    BINARY_INSTR(OP_IS_GREATER_THAN, >, MTYPE, EL)                              \
+    BINARY_INSTR(OP_IS_GREATER_THAN_OR_EQUAL, >=, MTYPE, EL)                    \
+    BINARY_INSTR(OP_LOGICAL_AND, &&, MTYPE, EL)                                 \
+    BINARY_INSTR(OP_LOGICAL_OR, ||, MTYPE, EL)                                  \
+    case OPCODE(OP_LOGICAL_NOT, MTYPE):                                         \
+        EACH_SPAN(EL) {                                                         \
+            for (i = 0; i < len; i++)                                           \
+                R(0, EL)[i] = !R(0, EL)[i];                                     \
+        }                                                                       \
+        break;                                                                  \
+    case OPCODE(OP_IF_ELSE, MTYPE):                                             \
+        EACH_SPAN(EL) {                                                         \
+            for (i = 0; i < len; i++) {                                         \
+                if (!R(0, EL)[i])                                               \
+                    R(0, EL)[i] = R(1, EL)[i];                                  \
+            }                                                                   \
+        }                                                                       \
+        break;                                                                  \
+    case OPCODE(OP_IF_THEN_ELSE, MTYPE):                                        \
+        EACH_SPAN(EL) {                                                         \
+            for (i = 0; i < len; i++)                                           \
+                R(0, EL)[i] = R(0, EL)[i] ? R(1, EL)[i] : R(2, EL)[i];          \
+        }                                                                       \
+        break;                                                                  \
+    case OPCODE(INSTR_LOAD_CONST, MTYPE):                                       \
+        EACH_SPAN(EL) {                                                         \
+            for (i = 0; i < len; i++)                                           \
+                R(0, EL)[i] = in->EL;                                           \
+        }                                                                       \
+        break;                                                                  \
+    case OPCODE(INSTR_LOAD_Y, MTYPE):                                           \
+        if (!v_out)                                                             \
+            goto out;                                                           \
+        EACH_INST                                                               \
+            LOAD_INSTR(v_out, TYPE, EL);                                        \
+        break;                                                                  \
+    case OPCODE(INSTR_LOAD_X, MTYPE): {                                         \
+        if (!v_in || !v_in[in->var])                                            \
+            goto out;                                                           \
+        mpr_value v = v_in[in->var];                                            \
+        EACH_INST                                                               \
+            LOAD_INSTR(v, TYPE, EL);                                            \
+        break;                                                                  \
+    }                                                                           \
+    case OPCODE(INSTR_FN0, MTYPE):                                              \
+        EACH_SPAN(EL) {                                                         \
+            for (i = 0; i < len; i++)                                           \
+                R(0, EL)[i] = ((FN##_arity0*)in->fn)();                         \
+        }                                                                       \
+        break;                                                                  \
+    case OPCODE(INSTR_FN1, MTYPE):                                              \
+        EACH_SPAN(EL) {                                                         \
+            if (in->vec && len >= VEC_KERNEL_MIN_LEN) {                         \
+                in->vec(R(0, EL), R(0, EL), len);                               \
+                continue;                                                       \
+            }                                                                   \
+            for (i = 0; i < len; i++)                                           \
+                R(0, EL)[i] = ((FN##_arity1*)in->fn)(R(0, EL)[i]);              \
+        }                                                                       \
+        break;                                                                  \
+    case OPCODE(INSTR_FN2, MTYPE):                                              \
+        EACH_SPAN(EL) {                                                         \
+            if (in->vec && len >= VEC_KERNEL_MIN_LEN) {                         \
+                in->vec(R(0, EL), R(1, EL), len);                               \
+                continue;                                                       \
+            }                                                                   \
+            for (i = 0; i < len; i++)                                           \
+                R(0, EL)[i] = ((FN##_arity2*)in->fn)(R(0, EL)[i], R(1, EL)[i]); \
+        }                                                                       \
+        break;                                                                  \
+    case OPCODE(INSTR_FN3, MTYPE):                                              \
+        EACH_SPAN(EL) {                                                         \
+            for (i = 0; i < len; i++)                                           \
+                R(0, EL)[i] = ((FN##_arity3*)in->fn)(R(0, EL)[i], R(1, EL)[i],  \
+                                                     R(2, EL)[i]);              \
+        }                                                                       \
+        break;                                                                  \
+    case OPCODE(INSTR_FN4, MTYPE):                                              \
+        EACH_SPAN(EL) {                                                         \
+            for (i = 0; i < len; i++)                                           \
+                R(0, EL)[i] = ((FN##_arity4*)in->fn)(R(0, EL)[i], R(1, EL)[i],  \
+                                                     R(2, EL)[i], R(3, EL)[i]); \
+        }                                                                       \
+        break;                                                                  \
+    case OPCODE(INSTR_VFN, MTYPE):                                              \
+        EACH_INST {                                                             \
+            R(0, EL)[0] = ((v##FN##_arity1*)in->fn)(R(0, EL), in->src);         \
+            for (i = 1; i < in->vec_len; i++)                                   \
+                R(0, EL)[i] = R(0, EL)[0];                                      \
+        }                                                                       \
+        break;                                                                  \
+    case OPCODE(INSTR_MOVE, MTYPE):                                             \
+        EACH_INST {                                                             \
+            TYPE *src = (TYPE*)(REG(in->src) + k * reg_size);                   \
+            for (i = 0; i < in->vec_len; i++)                                   \
+                R(0, EL)[i + in->offset] = src[i];                              \
+        }                                                                       \
+        break;                                                                  \
+    case OPCODE(INSTR_MEMO_LOAD, MTYPE): {                                      \
+        mpr_memo memo = expr->memos + in->var;                                  \
+        if (!memo_is_current(expr, memo, v_in, inst_idx, n_inst))               \
+            break;                                                              \
+        EACH_INST {                                                             \
+            TYPE *v = (TYPE*)(MEMO_RECORD(expr, inst_idx[k]) + memo->val_offset);\
+            for (i = 0; i < in->vec_len; i++)                                   \
+                R(0, EL)[i] = v[i];                                             \
+        }                                                                       \
+        ctx->next = memo->next;                                                 \
+        return EVAL_JUMP;                                                       \
+    }                                                                           \
+    case OPCODE(INSTR_MEMO_STORE, MTYPE): {                                     \
+        mpr_memo memo = expr->memos + in->var;                                  \
+        EACH_INST {                                                             \
+            if (!memo_set_stamps(expr, memo, v_in, inst_idx[k]))                \
+                continue;                                                       \
+            TYPE *v = (TYPE*)(MEMO_RECORD(expr, inst_idx[k]) + memo->val_offset);\
+            for (i = 0; i < in->vec_len; i++)                                   \
+                v[i] = R(0, EL)[i];                                             \
+        }                                                                       \
+        break;                                                                  \
+    }                                                                           \
+    case OPCODE(INSTR_ASSIGN_Y, MTYPE):                                         \
+        if (!v_out) {                                                           \
+            EACH_INST {                                                         \
+                if (!in->can_advance)                                           \
+                    can_advance[k] = 0;                                         \
+                if (alive[k]) {                                                 \
+                    status[k] |= muted[k] ? EXPR_MUTED_UPDATE : EXPR_UPDATE;    \
+                    goto out;                                                   \
+                }                                                               \
+            }                                                                   \
+            break;                                                              \
+        }                                                                       \
+        EACH_INST {                                                             \
+            if (!in->can_advance)                                               \
+                can_advance[k] = 0;                                             \
+            if (!alive[k])                                                      \
+                continue;                                                       \
+            status[k] |= muted[k] ? EXPR_MUTED_UPDATE : EXPR_UPDATE;            \
+            can_advance[k] = 0;                                                 \
+            mpr_value_buffer b_out = &v_out->inst[inst_idx[k]];                 \
+            int idx = b_out->pos + (in->hist ? R(-1, i)[0] : 0);                \
+            idx = WRAP_IDX(idx, v_out->mlen);                                   \
+            TYPE *v = (TYPE*)b_out->samps + idx * v_out->vlen;                  \
+            for (i = 0; i < in->vec_len; i++)                                   \
+                v[i + in->vec_idx] = R(0, EL)[i + in->offset];                  \
+            if (types) {                                                        \
+                mpr_type *types_k = types + k * v_out->vlen;                    \
+                for (i = in->vec_idx; i < in->vec_idx + in->vec_len; i++)       \
+                    types_k[i] = in->datatype;                                  \
+            }                                                                   \
+            /* Also copy time from input */                                     \
+            if (t)                                                              \
+                memcpy(&b_out->times[idx], t, sizeof(mpr_time));                \
+            ADVANCE_OFFSET();                                                   \
+        }                                                                       \
+        break;
+
+/* Casts convert a register in place. Elements of different widths overlap, so
+ * each instance is converted through a scratch vector and copied back. */
+#define CAST_TO(EL, TYPE1, EL1)                                         \
+    EACH_INST {                                                         \
+        TYPE1 cast[MPR_MAX_VECTOR_LEN];                                 \
+        REG_TYPE_##EL *src = R(0, EL);                                  \
+        for (i = 0; i < in->vec_len; i++)                               \
+            cast[i] = (TYPE1)src[i];                                    \
+        memcpy(R(0, EL1), cast, in->vec_len * sizeof(TYPE1));           \
+    }
+
+#define CAST_INSTR(MTYPE, EL, MTYPE1, TYPE1, EL1, MTYPE2, TYPE2, EL2)   \
+    case OPCODE(INSTR_CAST_I + TYPE_IDX(MTYPE1), MTYPE):                \
+        CAST_TO(EL, TYPE1, EL1)                                         \
+        break;                                                          \
+    case OPCODE(INSTR_CAST_I + TYPE_IDX(MTYPE2), MTYPE):                \
+        CAST_TO(EL, TYPE2, EL2)                                         \
+        break;
+
+#define HIST_IDX(WEIGHT_TYPE)                                           \
+    switch (in->hist_type) {                                            \
+        case MPR_INT32:                                                 \
+            hidx = R(0, i)[0];                                          \
+            break;                                                      \
+        case MPR_FLT:                                                   \
+            hidx = (int)R(0, f)[0];                                     \
+            weight = fabsf(R(0, f)[0] - hidx);                          \
+            break;                                                      \
+        default:                                                        \
+            hidx = (int)R(0, d)[0];                                     \
+            weight = (WEIGHT_TYPE)fabs(R(0, d)[0] - hidx);              \
+            break;                                                      \
+    }
+
+/* Wrap a history position or instance index into [0, n) without dividing in
+ * the common case where it is already in range or one period away. */
+#define WRAP_IDX(IDX, N)                                                        \
+    ((IDX) >= 0 ? ((IDX) < (N) ? (IDX) : (IDX) % (N))                           \
+                : ((IDX) + (N) >= 0 ? (IDX) + (N) : ((IDX) % (N) + (N)) % (N)))
+
+#define LOAD_INSTR(SRC, TYPE, EL)                                               \
+{                                                                               \
+    int hidx = 0;                                                               \
+    float weight = 0.f;                                                         \
+    if (in->hist)                                                               \
+        HIST_IDX(float);                                                        \
+    mpr_value_buffer b = &SRC->inst[WRAP_IDX(inst_idx[k], SRC->num_inst)];      \
+    int idx = b->pos + hidx;                                                    \
+    idx = WRAP_IDX(idx, SRC->mlen);                                             \
+    TYPE *a = (TYPE*)b->samps + idx * SRC->vlen + in->vec_idx;                  \
+    for (i = 0; i < in->vec_len; i++)                                           \
+        R(0, EL)[i] = a[i];                                                     \
+    if (weight) {                                                               \
+        --idx;                                                                  \
+        if (idx < 0)                                                            \
+            idx = SRC->mlen + idx;                                              \
+        a = (TYPE*)b->samps + idx * SRC->vlen + in->vec_idx;                    \
+        for (i = 0; i < in->vec_len; i++)                                       \
+            R(0, EL)[i] = R(0, EL)[i] * weight + a[i] * (1 - weight);           \
+    }                                                                           \
+}
+
+/* If assignment was constant or history initialization, move expr start
+ * offset so we don't evaluate this section again. */
+#define ADVANCE_OFFSET()                                                \
+    if (in->hist || can_advance[k])                                     \
+        expr->offset = in->tok_idx + 1;
+
+/* Per-evaluation state shared by the instructions of a compiled expression. */
+typedef struct {
+    mpr_value *v_in;
+    mpr_value *v_vars;
+    mpr_value v_out;
+    mpr_time *t;
+    mpr_type *types;
+    const int *inst_idx;
+    int n_inst;
+    int *status;
+    int *alive;
+    int *muted;
+    int *can_advance;
+    int next;               /* instruction to continue from after EVAL_JUMP */
+} eval_ctx_t, *eval_ctx;
+
+#ifdef __GNUC__
+#define EVAL_INLINE inline __attribute__((always_inline))
+#else
+#define EVAL_INLINE inline
+#endif
+
+#define EVAL_NEXT    0
+#define EVAL_RETURN  1
+#define EVAL_JUMP    2
+#define EVAL_ERROR  -1
+
+#define MEMO_RECORD(EXPR, IDX) ((EXPR)->memo + (IDX) * (EXPR)->memo_size)
+
+/* Check whether the stored result of a memoized subexpression is current for
+ * all of the instances being evaluated, i.e. whether each of the inputs it
+ * depends on still holds the sample it was computed from. */
+static int memo_is_current(mpr_expr expr, mpr_memo memo, mpr_value *v_in,
+                           const int *inst_idx, int n_inst)
+{
+    int j, k;
+    RETURN_UNLESS(v_in, 0);
+    for (k = 0; k < n_inst; k++) {
+        uint32_t deps = memo->deps, *stamps;
+        RETURN_UNLESS(inst_idx[k] < expr->memo_n_inst, 0);
+        stamps = (uint32_t*)(MEMO_RECORD(expr, inst_idx[k]) + memo->offset);
+        for (j = 0; deps; j++, deps >>= 1) {
+            if (deps & 1) {
+                mpr_value v = v_in[j];
+                uint32_t stamp;
+                // inputs may be missing, e.g. when checking a single slot update
+                RETURN_UNLESS(v, 0);
+                stamp = v->inst[inst_idx[k] % v->num_inst].stamp;
+                RETURN_UNLESS(stamp && stamp == *stamps++, 0);
+            }
+        }
+    }
+    return 1;
+}
+
+/* Record the input samples a memoized result is computed from. Returns 0 if
+ * the result cannot be stored for this instance. */
+static int memo_set_stamps(mpr_expr expr, mpr_memo memo, mpr_value *v_in, int inst_idx)
+{
+    int j;
+    uint32_t deps = memo->deps, *stamps;
+    RETURN_UNLESS(v_in && inst_idx < expr->memo_n_inst, 0);
+    for (j = 0; deps >> j; j++)
+        RETURN_UNLESS(!((deps >> j) & 1) || v_in[j], 0);
+    stamps = (uint32_t*)(MEMO_RECORD(expr, inst_idx) + memo->offset);
+    for (j = 0; deps; j++, deps >>= 1) {
+        if (deps & 1) {
+            mpr_value v = v_in[j];
+            *stamps++ = v->inst[inst_idx % v->num_inst].stamp;
+        }
+    }
+    return 1;
+}
+
+/*! Execute a single compiled instruction. Returns EVAL_NEXT to continue with
+ *  the following instruction, EVAL_JUMP to continue with instruction
+ *  ctx->next, EVAL_RETURN if evaluation should stop early, or EVAL_ERROR if
+ *  the instruction could not be executed. */
+static EVAL_INLINE int eval_instr(mpr_expr expr, eval_ctx ctx, mpr_instr in, int n_inst)
+{
+    mpr_value *v_in = ctx->v_in, *v_vars = ctx->v_vars, v_out = ctx->v_out;
+    mpr_time *t = ctx->t;
+    mpr_type *types = ctx->types;
+    const int *inst_idx = ctx->inst_idx;
+    int *status = ctx->status, *alive = ctx->alive, *muted = ctx->muted;
+    int *can_advance = ctx->can_advance;
+    int i, k, len, n_spans, vec_size = expr->vec_size, reg_size = expr->reg_size;
+
+    switch (in->opcode) {
+        TYPED_INSTR_CASES(MPR_INT32, int, i, fn_int)
+        TYPED_INSTR_CASES(MPR_FLT, float, f, fn_flt)
+        TYPED_INSTR_CASES(MPR_DBL, double, d, fn_dbl)
+        BINARY_INSTR(OP_MODULO, %, MPR_INT32, i)
+        BINARY_INSTR(OP_LEFT_BIT_SHIFT, <<, MPR_INT32, i)
+        BINARY_INSTR(OP_RIGHT_BIT_SHIFT, >>, MPR_INT32, i)
+        BINARY_INSTR(OP_BITWISE_AND, &, MPR_INT32, i)
+        BINARY_INSTR(OP_BITWISE_OR, |, MPR_INT32, i)
+        BINARY_INSTR(OP_BITWISE_XOR, ^, MPR_INT32, i)
+        case OPCODE(OP_MODULO, MPR_FLT):
+            EACH_SPAN(f) {
+                for (i = 0; i < len; i++)
+                    R(0, f)[i] = fmodf(R(0, f)[i], R(1, f)[i]);
+            }
+            break;
+        case OPCODE(OP_MODULO, MPR_DBL):
+            EACH_SPAN(d) {
+                for (i = 0; i < len; i++)
+                    R(0, d)[i] = fmod(R(0, d)[i], R(1, d)[i]);
+            }
+            break;
+        CAST_INSTR(MPR_INT32, i, MPR_FLT, float, f, MPR_DBL, double, d)
+        CAST_INSTR(MPR_FLT, f, MPR_INT32, int, i, MPR_DBL, double, d)
+        CAST_INSTR(MPR_DBL, d, MPR_INT32, int, i, MPR_FLT, float, f)
+        case OPCODE(INSTR_LOAD_VAR, MPR_DBL): {
+            if (!v_vars)
+                goto error;
+            mpr_value v = *v_vars + in->var;
+            EACH_INST {
+                double *d = (double*)v->inst[inst_idx[k]].samps + in->vec_idx;
+                for (i = 0; i < in->vec_len; i++)
+                    R(0, d)[i] = d[i];
+            }
+            break;
+        }
+        case OPCODE(INSTR_LOAD_TT, MPR_DBL):
+            EACH_INST {
+                int hidx = 0;
+                double weight = 0.0, t_d;
+                if (in->hist)
+                    HIST_IDX(double);
+                if (VAR_Y == in->var) {
+                    if (!v_out)
+                        goto out;
+                    mpr_value_buffer b_out = &v_out->inst[inst_idx[k]];
+                    int idx = (b_out->pos + v_out->mlen + hidx) % v_out->mlen;
+                    t_d = mpr_time_as_dbl(b_out->times[idx]);
+                    if (weight)
+                        t_d = t_d * weight + ((b_out->pos + v_out->mlen + hidx - 1)
+                                              % v_out->mlen) * (1 - weight);
+                }
+                else if (in->var >= VAR_X) {
+                    if (!v_in || !v_in[in->var - VAR_X])
+                        goto out;
+                    mpr_value v = v_in[in->var - VAR_X];
+                    mpr_value_buffer b = &v->inst[inst_idx[k] % v->num_inst];
+                    int idx = (b->pos + v->mlen + hidx) % v->mlen;
+                    t_d = mpr_time_as_dbl(b->times[idx]);
+                    if (weight)
+                        t_d = t_d * weight + ((b->pos + v->mlen + hidx - 1)
+                                              % v->mlen) * (1 - weight);
+                }
+                else if (v_vars) {
+                    mpr_value v = *v_vars + in->var;
+                    t_d = mpr_time_as_dbl(v->inst[inst_idx[k]].times[0]);
+                }
+                else
+                    goto error;
+                for (i = 0; i < in->vec_len; i++)
+                    R(0, d)[i] = t_d;
+            }
+            break;
+        case OPCODE(INSTR_ASSIGN_VAR, MPR_DBL):
+            EACH_INST {
+                if (!in->can_advance)
+                    can_advance[k] = 0;
+            }
+            if (!v_vars)
+                goto error;
+            EACH_INST {
+                // passed the address of an array of mpr_value structs
+                mpr_value v = *v_vars + in->var;
+                mpr_value_buffer b = &v->inst[inst_idx[k]];
+                double *d = (double*)b->samps + in->vec_idx;
+                for (i = 0; i < in->vec_len; i++)
+                    d[i] = R(0, d)[i + in->offset];
+
+                // Also copy time from input
+                if (t)
+                    memcpy(b->times, t, sizeof(mpr_time));
+
+                if (in->var == expr->inst_ctl) {
+                    if (alive[k] && R(0, d)[0] == 0) {
+                        if (status[k] & EXPR_UPDATE)
+                            status[k] |= EXPR_RELEASE_AFTER_UPDATE;
+                        else
+                            status[k] |= EXPR_RELEASE_BEFORE_UPDATE;
+                    }
+                    alive[k] = R(0, d)[0] != 0;
+                    continue;
+                }
+                else if (in->var == expr->mute_ctl) {
+                    muted[k] = R(0, d)[0] != 0;
+                    continue;
+                }
+                ADVANCE_OFFSET();
+            }
+            break;
+        case OPCODE(INSTR_ASSIGN_TT, MPR_DBL):
+            if (!v_out)
+                goto out;
+            EACH_INST {
+                mpr_value_buffer b_out = &v_out->inst[inst_idx[k]];
+                int idx = (b_out->pos + v_out->mlen + R(-1, i)[0]) % v_out->mlen;
+                if (idx < 0)
+                    idx = v_out->mlen + idx;
+                mpr_time_set_dbl(&b_out->times[idx], R(0, d)[0]);
+                if (in->hist || can_advance[k])
+                    expr->offset = in->tok_idx + 1;
+                else
+                    can_advance[k] = 0;
+            }
+            break;
+        default:
+            goto error;
+    }
+
+    return EVAL_NEXT;
+
+  out:
+    return EVAL_RETURN;
+
+  error:
+    return EVAL_ERROR;
+}
+
+#ifdef HAVE_JIT
+
+/* Native code produced for an expression is entered with the expression, the
+ * evaluation context and the address of the first instruction to execute.
+ * Registers rbx and r15 hold the expression and context, and r14 holds the
+ * base address of the register file.
+ * Simple arithmetic, constants, moves, casts, and scalar and vector function
+ * calls are emitted inline; every other instruction calls back into
+ * jit_eval_instr(). Native code is only used when evaluating a single
+ * instance. */
+typedef int jit_fn(mpr_expr expr, eval_ctx ctx, void *start);
+
+static int jit_eval_instr(mpr_expr expr, eval_ctx ctx, mpr_instr in)
+{
+    return eval_instr(expr, ctx, in, 1);
+}
+
+static const int jit_sse_prefix[] = { 0, 0xF3, 0xF2 };
+static const int jit_el_size[] = { sizeof(int), sizeof(float), sizeof(double) };
+
+#define JIT_REGS MPR_JIT_R14
+#define JIT_DISP(REG, EL, TI) ((REG) * reg_size + (EL) * jit_el_size[TI])
+
+static void jit_load(mpr_jit_buf buf, int ti, int reg, int32_t disp)
+{
+    if (ti)
+        mpr_jit_op_mem(buf, jit_sse_prefix[ti], 0x0F10, 0, reg, JIT_REGS, disp);
+    else
+        mpr_jit_op_mem(buf, 0, 0x8B, 0, reg, JIT_REGS, disp);
+}
+
+static void jit_store(mpr_jit_buf buf, int ti, int reg, int32_t disp)
+{
+    if (ti)
+        mpr_jit_op_mem(buf, jit_sse_prefix[ti], 0x0F11, 0, reg, JIT_REGS, disp);
+    else
+        mpr_jit_op_mem(buf, 0, 0x89, 0, reg, JIT_REGS, disp);
+}
+
+static int jit_instr(mpr_jit_buf buf, mpr_expr expr, mpr_instr in)
+{
+    int j, ti = in->opcode % 3, op = in->opcode / 3, reg_size = expr->reg_size;
+    int reg = in->reg, arith = 0;
+
+    if (INSTR_MOVE == op) {
+        for (j = 0; j < in->vec_len; j++) {
+            int32_t src = JIT_DISP(in->src, j, ti);
+            int32_t dst = JIT_DISP(reg, j + in->offset, ti);
+            mpr_jit_op_mem(buf, 0, 0x8B, 2 == ti, MPR_JIT_RAX, JIT_REGS, src);
+            mpr_jit_op_mem(buf, 0, 0x89, 2 == ti, MPR_JIT_RAX, JIT_REGS, dst);
+        }
+        return 1;
+    }
+    RETURN_UNLESS(in->vec_len < VEC_KERNEL_MIN_LEN, 0);
+
+    switch (op) {
+        case OP_ADD:        arith = ti ? 0x0F58 : 0x03;     break;
+        case OP_SUBTRACT:   arith = ti ? 0x0F5C : 0x2B;     break;
+        case OP_MULTIPLY:   arith = ti ? 0x0F59 : 0x0FAF;   break;
+        case OP_DIVIDE:     arith = ti ? 0x0F5E : 0;        break;
+        case INSTR_LOAD_CONST:
+            for (j = 0; j < in->vec_len; j++) {
+                if (2 == ti) {
+                    uint64_t u;
+                    memcpy(&u, &in->d, sizeof(double));
+                    mpr_jit_mov_imm64(buf, MPR_JIT_RAX, u);
+                    mpr_jit_op_mem(buf, 0, 0x89, 1, MPR_JIT_RAX, JIT_REGS,
+                                   JIT_DISP(reg, j, ti));
+                }
+                else {
+                    uint32_t u;
+                    memcpy(&u, &in->i, sizeof(int));
+                    mpr_jit_store_imm32(buf, JIT_REGS, JIT_DISP(reg, j, ti), u);
+                }
+            }
+            return 1;
+        case INSTR_CAST_I:
+        case INSTR_CAST_F:
+        case INSTR_CAST_D: {
+            int dst_ti = op - INSTR_CAST_I;
+            /* cvtsi2ss/sd, cvttss2si/sd2si, and cvtss2sd/sd2ss */
+            int opcode = !ti ? 0x0F2A : !dst_ti ? 0x0F2C : 0x0F5A;
+            int prefix = jit_sse_prefix[ti ? ti : dst_ti];
+            /* widening casts convert from the last element down so that no
+             * element is overwritten before it has been read */
+            int widen = jit_el_size[dst_ti] > jit_el_size[ti];
+            RETURN_UNLESS(dst_ti != ti, 0);
+            for (j = 0; j < in->vec_len; j++) {
+                int el = widen ? in->vec_len - 1 - j : j;
+                mpr_jit_op_mem(buf, prefix, opcode, 0, MPR_JIT_RAX, JIT_REGS,
+                               JIT_DISP(reg, el, ti));
+                jit_store(buf, dst_ti, MPR_JIT_RAX, JIT_DISP(reg, el, dst_ti));
+            }
+            return 1;
+        }
+        case INSTR_FN0:
+        case INSTR_FN1:
+        case INSTR_FN2:
+        case INSTR_FN3:
+        case INSTR_FN4: {
+            /* arguments are passed in edi/esi/edx/ecx for int, xmm0-3 otherwise */
+            static const int args[2][4] = {
+                { MPR_JIT_RDI, MPR_JIT_RSI, MPR_JIT_RDX, MPR_JIT_RCX },
+                { 0, 1, 2, 3 }
+            };
+            int k, n_args = op - INSTR_FN0;
+            for (j = 0; j < in->vec_len; j++) {
+                for (k = 0; k < n_args; k++)
+                    jit_load(buf, ti, args[!!ti][k], JIT_DISP(reg + k, j, ti));
+                mpr_jit_mov_imm64(buf, MPR_JIT_RAX, (uintptr_t)in->fn);
+                mpr_jit_call(buf, MPR_JIT_RAX);
+                jit_store(buf, ti, MPR_JIT_RAX, JIT_DISP(reg, j, ti));
+            }
+            return 1;
+        }
+        case INSTR_VFN:
+            /* reduce the register in place and broadcast the result */
+            mpr_jit_op_mem(buf, 0, 0x8D, 1, MPR_JIT_RDI, JIT_REGS, JIT_DISP(reg, 0, ti));
+            mpr_jit_mov_imm64(buf, MPR_JIT_RSI, in->src);
+            mpr_jit_mov_imm64(buf, MPR_JIT_RAX, (uintptr_t)in->fn);
+            mpr_jit_call(buf, MPR_JIT_RAX);
+            for (j = 0; j < in->vec_len; j++)
+                jit_store(buf, ti, MPR_JIT_RAX, JIT_DISP(reg, j, ti));
+            return 1;
+        default:
+            return 0;
+    }
+    RETURN_UNLESS(arith, 0);
+    for (j = 0; j < in->vec_len; j++) {
+        jit_load(buf, ti, MPR_JIT_RAX, JIT_DISP(reg, j, ti));
+        mpr_jit_op_mem(buf, jit_sse_prefix[ti], arith, 0, MPR_JIT_RAX, JIT_REGS,
+                       JIT_DISP(reg + 1, j, ti));
+        jit_store(buf, ti, MPR_JIT_RAX, JIT_DISP(reg, j, ti));
+    }
+    return 1;
+}
+
+/* Instructions that cannot be emitted inline, such as loads and stores,
+ * comparisons, logical operators and long vectors, call back into the
+ * instruction loop. Since all results are kept in the register file, native
+ * code and callbacks can be mixed freely. */
+static int jit_compile(mpr_expr expr)
+{
+    static const int saved[] = { MPR_JIT_RBX, MPR_JIT_R12, MPR_JIT_R13, MPR_JIT_R14,
+                                 MPR_JIT_R15 };
+    mpr_jit_buf_t buf;
+    size_t exit;
+    int i;
+    uint32_t *offsets = malloc(sizeof(uint32_t) * (expr->n_instr + 1));
+    RETURN_UNLESS(offsets, 0);
+    mpr_jit_init(&buf);
+
+    /* prologue: the five pushes also restore 16-byte stack alignment */
+    for (i = 0; i < 5; i++)
+        mpr_jit_push(&buf, saved[i]);
+    mpr_jit_op_reg(&buf, 0x89, 1, MPR_JIT_RDI, MPR_JIT_RBX);
+    mpr_jit_op_reg(&buf, 0x89, 1, MPR_JIT_RSI, MPR_JIT_R15);
+    mpr_jit_op_mem(&buf, 0, 0x8B, 1, JIT_REGS, MPR_JIT_RBX,
+                   offsetof(struct _mpr_expr, regs));
+    mpr_jit_jmp_reg(&buf, MPR_JIT_RDX);
+
+    /* epilogue, returning the value in eax */
+    exit = buf.len;
+    for (i = 4; i >= 0; i--)
+        mpr_jit_pop(&buf, saved[i]);
+    mpr_jit_ret(&buf);
+
+    for (i = 0; i < expr->n_instr; i++) {
+        mpr_instr in = expr->code + i;
+        offsets[i] = buf.len;
+        if (jit_instr(&buf, expr, in))
+            continue;
+        mpr_jit_op_reg(&buf, 0x89, 1, MPR_JIT_RBX, MPR_JIT_RDI);
+        mpr_jit_op_reg(&buf, 0x89, 1, MPR_JIT_R15, MPR_JIT_RSI);
+        mpr_jit_mov_imm64(&buf, MPR_JIT_RDX, (uintptr_t)in);
+        mpr_jit_mov_imm64(&buf, MPR_JIT_RAX, (uintptr_t)jit_eval_instr);
+        mpr_jit_call(&buf, MPR_JIT_RAX);
+        mpr_jit_op_reg(&buf, 0x85, 0, MPR_JIT_RAX, MPR_JIT_RAX);
+        mpr_jit_jmp(&buf, MPR_JIT_NE, exit);
+    }
+    offsets[expr->n_instr] = buf.len;
+    mpr_jit_op_reg(&buf, 0x31, 0, MPR_JIT_RAX, MPR_JIT_RAX);
+    mpr_jit_jmp(&buf, MPR_JIT_ALWAYS, exit);
+
+    if (!(expr->jit = mpr_jit_finalize(&buf))) {
+        free(offsets);
+        return 0;
+    }
+    expr->jit_offsets = offsets;
+    return 1;
+}
+
+#endif /* HAVE_JIT */
+
+int mpr_expr_set_jit(mpr_expr expr, int enable)
+{
+    RETURN_UNLESS(expr, 0);
+#ifdef HAVE_JIT
+    if (expr->shared) {
+        /* native code belongs to the shared expression and is kept until it is
+         * freed, since other handles may be using it */
+        mpr_expr shared = expr->shared->expr;
+        if (enable && !shared->jit && shared->code)
+            jit_compile(shared);
+        expr->jit = enable ? shared->jit : 0;
+        expr->jit_offsets = enable ? shared->jit_offsets : 0;
+    }
+    else if (enable && !expr->jit && expr->code)
+        jit_compile(expr);
+    else if (!enable && expr->jit) {
+        mpr_jit_free(expr->jit);
+        free(expr->jit_offsets);
+        expr->jit = 0;
+        expr->jit_offsets = 0;
+    }
+#endif
+    return expr->jit != 0;
+}
+
+/*! Evaluate the compiled instruction stream for one or more instances. The
+ *  instructions form the outer loop and instances the inner loop, so all of
+ *  the instances must begin evaluation at the same instruction. For each
+ *  instance this must produce exactly the same results and side effects as
+ *  mpr_expr_eval_interp(). */
+static int eval_code(mpr_expr expr, mpr_value *v_in, mpr_value *v_vars,
+                     mpr_value v_out, mpr_time *t, mpr_type *types,
+                     const int *inst_idx, int n_inst, int *status)
+{
+    mpr_instr in = expr->code, end = expr->code + expr->n_instr;
+    int i, k, reg_size = expr->reg_size;
+    int alive[n_inst], muted[n_inst], can_advance[n_inst];
+    eval_ctx_t ctx = { v_in, v_vars, v_out, t, types, inst_idx, n_inst,
+                       status, alive, muted, can_advance };
+    if (v_out && v_out->inst[inst_idx[0]].pos >= 0)
+        in += expr->tok_instr[expr->offset];
+
+    if (n_inst > expr->regs_n_inst) {
+        char *regs = realloc(expr->regs, expr->n_regs * reg_size * n_inst);
+        if (!regs) {
+            EACH_INST
+                status[k] = 0;
+            return 0;
+        }
+        expr->regs = regs;
+        expr->regs_n_inst = n_inst;
+    }
+
+    if (expr->n_memos) {
+        int memo_n_inst = expr->memo_n_inst;
+        EACH_INST {
+            if (inst_idx[k] >= memo_n_inst)
+                memo_n_inst = inst_idx[k] + 1;
+        }
+        if (memo_n_inst > expr->memo_n_inst) {
+            char *memo = realloc(expr->memo, memo_n_inst * expr->memo_size);
+            if (memo) {
+                // zeroed stamps never match an input sample
+                memset(memo + expr->memo_n_inst * expr->memo_size, 0,
+                       (memo_n_inst - expr->memo_n_inst) * expr->memo_size);
+                expr->memo = memo;
+                expr->memo_n_inst = memo_n_inst;
+            }
+        }
+    }
+
+    EACH_INST {
+        status[k] = 1;
+        alive[k] = 1;
+        muted[k] = 0;
+        can_advance[k] = 1;
+        if (v_vars) {
+            if (expr->inst_ctl >= 0) {
+                // recover instance state
+                mpr_value v = *v_vars + expr->inst_ctl;
+                double *d = v->inst[inst_idx[k]].samps;
+                alive[k] = (0 != d[0]);
+            }
+            if (expr->mute_ctl >= 0) {
+                // recover mute state
+                mpr_value v = *v_vars + expr->mute_ctl;
+                double *d = v->inst[inst_idx[k]].samps;
+                muted[k] = (0 != d[0]);
+            }
+        }
+        if (v_out) {
+            mpr_value_buffer b_out = &v_out->inst[inst_idx[k]];
+            // init types
+            if (types)
+                memset(types + k * v_out->vlen, MPR_NULL, v_out->vlen);
+            /* Increment index position of output data structure. */
+            if (++b_out->pos >= v_out->mlen)
+                b_out->pos = 0;
+        }
+    }
+
+#ifdef HAVE_JIT
+    if (expr->jit && 1 == n_inst) {
+        jit_fn *fn = (jit_fn*)expr->jit;
+        int next = in - expr->code;
+        while (next >= 0) {
+            switch (fn(expr, &ctx, (char*)expr->jit + expr->jit_offsets[next])) {
+                case EVAL_RETURN:   goto out;
+                case EVAL_ERROR:    goto error;
+                // native code returns to re-enter at the target of a jump
+                case EVAL_JUMP:     next = ctx.next;    break;
+                default:            next = -1;
+            }
+        }
+        in = end;
+    }
+#endif
+    /* The single-instance loop is specialised so that the per-instance loops
+     * and register strides of each instruction are resolved at compile time. */
+    if (1 == n_inst) {
+        for (; in < end; in++) {
+            switch (eval_instr(expr, &ctx, in, 1)) {
+                case EVAL_RETURN:   goto out;
+                case EVAL_ERROR:    goto error;
+                case EVAL_JUMP:     in = expr->code + ctx.next - 1; break;
+                default:            break;
+            }
+        }
+    }
+    else {
+        for (; in < end; in++) {
+            switch (eval_instr(expr, &ctx, in, n_inst)) {
+                case EVAL_RETURN:   goto out;
+                case EVAL_ERROR:    goto error;
+                case EVAL_JUMP:     in = expr->code + ctx.next - 1; break;
+                default:            break;
+            }
+        }
+    }
+
+    RETURN_UNLESS(v_out, status[0]);
+
+    EACH_INST {
+        mpr_value_buffer b_out = &v_out->inst[inst_idx[k]];
+        if (!types) {
+            /* Internal evaluation during parsing doesn't contain assignment
+             * token, so we need to copy to output here. */
+
+            /* Increment index position of output data structure. */
+            b_out->pos = (b_out->pos + 1) % v_out->mlen;
+            void *v = mpr_value_get_samp(v_out, inst_idx[k]);
+            switch (v_out->type) {
+#define TYPED_CASE(MTYPE, TYPE, EL)                                 \
+                case MTYPE:                                         \
+                    for (i = 0; i < v_out->vlen; i++)               \
+                        ((TYPE*)v)[i] = ((TYPE*)(REG(expr->out_reg) \
+                                                 + k * reg_size))[i];\
+                    break;
+                TYPED_CASE(MPR_INT32, int, i)
+                TYPED_CASE(MPR_FLT, float, f)
+                TYPED_CASE(MPR_DBL, double, d)
+#undef TYPED_CASE
+                default:
+                    goto error;
+            }
+            continue;
+        }
+
+        /* Undo position increment if nothing was updated. */
+        if (!(status[k] & (EXPR_UPDATE | EXPR_MUTED_UPDATE))) {
+            --b_out->pos;
+            if (b_out->pos < 0)
+                b_out->pos = v_out->mlen - 1;
+        }
+    }
+
+  out:
+    return status[0];
+
+  error:
+    trace("Unexpected instruction in expression.");
+    EACH_INST
+        status[k] = 0;
+    return 0;
+}
+
+int mpr_expr_eval(mpr_expr expr, mpr_value *v_in, mpr_value *v_vars,
+                  mpr_value v_out, mpr_time *t, mpr_type *types, int inst_idx)
+{
+    int status;
+    if (!expr || !expr->code || (v_out && v_out->type != expr->out_type))
+        return mpr_expr_eval_interp(expr, v_in, v_vars, v_out, t, types, inst_idx);
+    return eval_code(expr, v_in, v_vars, v_out, t, types, &inst_idx, 1, &status);
+}
+
+void mpr_expr_eval_batch(mpr_expr expr, mpr_value *v_in, mpr_value *v_vars,
+                         mpr_value v_out, mpr_time *t, mpr_type *types,
+                         const int *inst_idx, int n_inst, int *status)
+{
+    int i, j, vlen = v_out ? v_out->vlen : 0;
+    if (!expr || !expr->code || !v_out || v_out->type != expr->out_type) {
+        for (i = 0; i < n_inst; i++)
+            status[i] = mpr_expr_eval_interp(expr, v_in, v_vars, v_out, t,
+                                             types ? types + i * vlen : 0, inst_idx[i]);
+        return;
+    }
+    /* Instances that have not been evaluated before start from the first
+     * instruction rather than expr->offset, so evaluate each run of instances
+     * with the same starting point together. */
+    for (i = 0; i < n_inst; i = j) {
+        int started = v_out->inst[inst_idx[i]].pos >= 0;
+        for (j = i + 1; j < n_inst; j++) {
+            if ((v_out->inst[inst_idx[j]].pos >= 0) != started)
+                break;
+        }
+        eval_code(expr, v_in, v_vars, v_out, t, types ? types + i * vlen : 0,
+                  inst_idx + i, j - i, status + i);
+    }
+}
@@ -2,6 +2,7 @@
 #include <stdio.h>
 #include <assert.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <zlib.h>
 #include <sys/time.h>
 
@@ -177,6 +178,8 @@ void mpr_graph_free(mpr_graph g)
         g->callbacks = g->callbacks->next;
         free(cb);
     }
+    while (g->qrys)
+        mpr_qry_free(g->qrys);
 
     // unsubscribe from and remove any autorenewing subscriptions
     while (g->subscriptions)
@@ -223,18 +226,142 @@ void mpr_graph_free(mpr_graph g)
     }
 
     mpr_net_free(&g->net);
+    FUNC_IF(free, g->idx.id);
+    FUNC_IF(free, g->idx.name);
+    mpr_list_free_prop_idx(g);
     free(g);
 }
 
+/**** Indexes ****/
+
+static unsigned int _str_hash(const char *str, unsigned int hash)
+{
+    while (*str)
+        hash = (hash ^ (unsigned char)*str++) * 16777619u;
+    return hash;
+}
+
+static unsigned int _name_hash(mpr_obj o)
+{
+    switch (o->type) {
+        case MPR_DEV:
+            return o->name ? _str_hash(o->name, 2166136261u) : 0;
+        case MPR_SIG:
+            return _str_hash(o->name, mpr_id_hash((mpr_id)(uintptr_t)((mpr_sig)o)->dev, 0));
+        case MPR_MAP:
+            return mpr_id_hash((mpr_id)(uintptr_t)((mpr_map)o)->dst->sig, 0);
+        default:
+            return 0;
+    }
+}
+
+static int _unlink_obj(mpr_graph g, mpr_obj o)
+{
+    unsigned int mask = g->idx.size - 1;
+    mpr_obj *p;
+    RETURN_UNLESS(g->idx.size, 0);
+    for (p = &g->idx.id[o->id_hash & mask]; *p && *p != o; p = &(*p)->id_next) {}
+    RETURN_UNLESS(*p, 0);
+    *p = o->id_next;
+    for (p = &g->idx.name[o->name_hash & mask]; *p && *p != o; p = &(*p)->name_next) {}
+    if (*p)
+        *p = o->name_next;
+    return 1;
+}
+
+static void _link_id(mpr_graph g, mpr_obj o)
+{
+    mpr_obj *bucket = &g->idx.id[o->id_hash & (g->idx.size - 1)];
+    o->id_next = *bucket;
+    *bucket = o;
+}
+
+static void _link_name(mpr_graph g, mpr_obj o)
+{
+    mpr_obj *bucket = &g->idx.name[o->name_hash & (g->idx.size - 1)];
+    o->name_next = *bucket;
+    *bucket = o;
+}
+
+static void _resize_idx(mpr_graph g, int size)
+{
+    mpr_obj *id = g->idx.id, *name = g->idx.name, o, next, rev;
+    int i, old_size = g->idx.size;
+    g->idx.id = (mpr_obj*)calloc(size, sizeof(mpr_obj));
+    g->idx.name = (mpr_obj*)calloc(size, sizeof(mpr_obj));
+    g->idx.size = size;
+
+    /* Each new bucket takes objects from a single old bucket: relink them
+     * oldest first so that buckets stay ordered by insertion. */
+    for (i = 0; i < old_size; i++) {
+        for (rev = 0, o = id[i]; o; o = next) {
+            next = o->id_next;
+            o->id_next = rev;
+            rev = o;
+        }
+        for (o = rev; o; o = next) {
+            next = o->id_next;
+            _link_id(g, o);
+        }
+        for (rev = 0, o = name[i]; o; o = next) {
+            next = o->name_next;
+            o->name_next = rev;
+            rev = o;
+        }
+        for (o = rev; o; o = next) {
+            next = o->name_next;
+            _link_name(g, o);
+        }
+    }
+    FUNC_IF(free, id);
+    FUNC_IF(free, name);
+}
+
+/* Objects are added to the front of their buckets, so lookups return the most
+ * recently added match as a walk of the prepend-only graph lists did. */
+void mpr_graph_reindex_obj(mpr_graph g, mpr_obj o)
+{
+    mpr_list_update_prop_idx(g, o, MPR_OBJ_MOD);
+    if (_unlink_obj(g, o))
+        --g->idx.count;
+    if (++g->idx.count > g->idx.size)
+        _resize_idx(g, g->idx.size ? g->idx.size * 2 : 64);
+    o->id_hash = mpr_id_hash(o->id, 0);
+    o->name_hash = _name_hash(o);
+    _link_id(g, o);
+    _link_name(g, o);
+}
+
+static void _unindex_obj(mpr_graph g, mpr_obj o)
+{
+    mpr_list_update_prop_idx(g, o, MPR_OBJ_REM);
+    if (_unlink_obj(g, o))
+        --g->idx.count;
+}
+
+mpr_sig mpr_graph_get_sig_by_name(mpr_graph g, mpr_dev dev, const char *name)
+{
+    RETURN_UNLESS(g->idx.size, 0);
+    unsigned int hash = _str_hash(name, mpr_id_hash((mpr_id)(uintptr_t)dev, 0));
+    mpr_obj o = g->idx.name[hash & (g->idx.size - 1)];
+    for (; o; o = o->name_next) {
+        if (o->name_hash == hash && MPR_SIG == o->type && ((mpr_sig)o)->dev == dev
+            && 0 == strcmp(o->name, name))
+            return (mpr_sig)o;
+    }
+    return 0;
+}
+
 /**** Generic records ****/
 
-static mpr_obj _obj_by_id(mpr_graph g, void *obj_list, mpr_id id)
+static mpr_obj _obj_by_id(mpr_graph g, mpr_type type, mpr_id id)
 {
-    mpr_list objs = mpr_list_from_data(obj_list);
-    while (objs) {
-        if (id == (*objs)->id)
-            return *objs;
-        objs = mpr_list_get_next(objs);
+    RETURN_UNLESS(g->idx.size, 0);
+    unsigned int hash = mpr_id_hash(id, 0);
+    mpr_obj o = g->idx.id[hash & (g->idx.size - 1)];
+    for (; o; o = o->id_next) {
+        if (id == o->id && (o->type & type))
+            return o;
     }
     return NULL;
 }
@@ -242,11 +369,11 @@ static mpr_obj _obj_by_id(mpr_graph g, void *obj_list, mpr_id id)
 mpr_obj mpr_graph_get_obj(mpr_graph g, mpr_type type, mpr_id id)
 {
     if (type & MPR_DEV)
-        return _obj_by_id(g, g->devs, id);
+        return _obj_by_id(g, MPR_DEV, id);
     if (type & MPR_SIG)
-        return _obj_by_id(g, g->sigs, id);
+        return _obj_by_id(g, MPR_SIG, id);
     if (type & MPR_MAP)
-        return _obj_by_id(g, g->maps, id);
+        return _obj_by_id(g, MPR_MAP, id);
     return 0;
 }
 
@@ -282,9 +409,13 @@ int mpr_graph_add_cb(mpr_graph g, mpr_graph_handler *h, int types, const void *u
     return 1;
 }
 
+static void _update_qrys(mpr_graph g, mpr_obj o, mpr_graph_evt e);
+
 void mpr_graph_call_cbs(mpr_graph g, mpr_obj o, mpr_type t, mpr_graph_evt e)
 {
     fptr_list cb = g->callbacks, temp;
+    mpr_list_update_prop_idx(g, o, e);
+    _update_qrys(g, o, e);
     while (cb) {
         temp = cb->next;
         if (cb->types & t)
@@ -293,6 +424,235 @@ void mpr_graph_call_cbs(mpr_graph g, mpr_obj o, mpr_type t, mpr_graph_evt e)
     }
 }
 
+/**** Live queries ****/
+
+#define QRY_EMPTY   -1
+#define QRY_DELETED -2
+
+static unsigned int _qry_hash(mpr_obj o)
+{
+    return mpr_id_hash((mpr_id)(uintptr_t)o, 0);
+}
+
+// Return the slot holding the position of an object, or -1 if it is not a result.
+static int _qry_find(mpr_qry q, mpr_obj o)
+{
+    unsigned int mask = q->pos_size - 1, i = _qry_hash(o) & mask;
+    for (; q->pos[i] != QRY_EMPTY; i = (i + 1) & mask) {
+        if (q->pos[i] >= 0 && q->objs.objs[q->pos[i]] == o)
+            return i;
+    }
+    return -1;
+}
+
+static void _qry_resize(mpr_qry q, int size)
+{
+    int i;
+    unsigned int j, mask = size - 1;
+    q->pos = realloc(q->pos, sizeof(int) * size);
+    q->pos_size = size;
+    q->num_deleted = 0;
+    for (i = 0; i < size; i++)
+        q->pos[i] = QRY_EMPTY;
+    for (i = 0; i < q->objs.num; i++) {
+        for (j = _qry_hash(q->objs.objs[i]) & mask; q->pos[j] != QRY_EMPTY; j = (j + 1) & mask) {}
+        q->pos[j] = i;
+    }
+}
+
+static void _qry_add(mpr_qry q, mpr_obj o)
+{
+    int size = q->pos_size;
+    unsigned int i, mask;
+    if ((q->objs.num + q->num_deleted + 1) * 2 > size) {
+        size = size ? size : 16;
+        while ((q->objs.num + 1) * 2 > size)
+            size *= 2;
+        _qry_resize(q, size);
+    }
+    mask = q->pos_size - 1;
+    for (i = _qry_hash(o) & mask; q->pos[i] >= 0; i = (i + 1) & mask) {}
+    if (QRY_DELETED == q->pos[i])
+        --q->num_deleted;
+    q->pos[i] = q->objs.num;
+    mpr_obj_arr_add(&q->objs, o);
+}
+
+// Remove the result at a slot, moving the last result into its place.
+static void _qry_remove(mpr_qry q, int slot)
+{
+    int idx = q->pos[slot], last = q->objs.num - 1;
+    q->pos[slot] = QRY_DELETED;
+    ++q->num_deleted;
+    if (idx != last) {
+        q->pos[_qry_find(q, q->objs.objs[last])] = idx;
+        q->objs.objs[idx] = q->objs.objs[last];
+    }
+    --q->objs.num;
+}
+
+static int _qry_match(mpr_qry q, mpr_obj o)
+{
+    int i;
+    RETURN_UNLESS(o->type == q->type, 0);
+    if (q->dev) {
+        if (MPR_SIG == o->type) {
+            mpr_sig sig = (mpr_sig)o;
+            RETURN_UNLESS(sig->dev == q->dev && (sig->dir & q->dir), 0);
+        }
+        else if (MPR_MAP == o->type)
+            RETURN_UNLESS(mpr_dev_has_map(q->dev, (mpr_map)o, q->dir), 0);
+    }
+    for (i = 0; i < q->num_filters; i++) {
+        mpr_qry_filter_t *f = &q->filters[i];
+        RETURN_UNLESS(mpr_list_match_obj(o, f->prop, f->key, f->len, f->type,
+                                         f->val, f->op), 0);
+    }
+    return 1;
+}
+
+static void _update_qry(mpr_qry q, mpr_obj o, mpr_graph_evt e)
+{
+    int slot = q->objs.num ? _qry_find(q, o) : -1;
+    int match = (MPR_OBJ_REM != e) && _qry_match(q, o);
+    if (match && slot < 0) {
+        _qry_add(q, o);
+        e = MPR_OBJ_NEW;
+    }
+    else if (!match && slot >= 0) {
+        _qry_remove(q, slot);
+        e = MPR_OBJ_REM;
+    }
+    else if (!match || MPR_OBJ_NEW == e)
+        return;
+    if (q->h)
+        ((mpr_graph_handler*)q->h)(q->graph, o, e, q->data);
+}
+
+static void _update_qrys(mpr_graph g, mpr_obj o, mpr_graph_evt e)
+{
+    mpr_qry q = g->qrys, temp;
+    while (q) {
+        temp = q->next;
+        if (q->type == o->type)
+            _update_qry(q, o, e);
+        q = temp;
+    }
+}
+
+static int _is_ptr_type(mpr_type type)
+{
+    return type <= MPR_LIST || MPR_PTR == type;
+}
+
+static void *_copy_filter_val(int len, mpr_type type, const void *val)
+{
+    int i;
+    void *cpy;
+    RETURN_UNLESS(val && len > 0, 0);
+    if (MPR_STR == type) {
+        if (1 == len)
+            return strdup((const char*)val);
+        cpy = malloc(sizeof(char*) * len);
+        for (i = 0; i < len; i++)
+            ((char**)cpy)[i] = strdup(((const char**)val)[i]);
+        return cpy;
+    }
+    if (1 == len && _is_ptr_type(type))
+        return (void*)val;
+    cpy = malloc(mpr_type_get_size(type) * len);
+    memcpy(cpy, val, mpr_type_get_size(type) * len);
+    return cpy;
+}
+
+static void _free_filter_val(mpr_qry_filter_t *f)
+{
+    int i;
+    RETURN_UNLESS(f->val);
+    if (MPR_STR == f->type && f->len > 1) {
+        for (i = 0; i < f->len; i++)
+            free(((char**)f->val)[i]);
+    }
+    else if (1 == f->len && _is_ptr_type(f->type))
+        return;
+    free(f->val);
+}
+
+mpr_qry mpr_graph_new_qry(mpr_graph g, mpr_type type, mpr_dev dev, mpr_dir dir,
+                          mpr_graph_handler *h, const void *data)
+{
+    RETURN_UNLESS(g && (MPR_DEV == type || MPR_SIG == type || MPR_MAP == type), 0);
+    mpr_qry q = (mpr_qry)calloc(1, sizeof(mpr_qry_t));
+    q->graph = g;
+    q->type = type;
+    q->dev = dev;
+    q->dir = dir;
+    q->h = (void*)h;
+    q->data = data;
+
+    mpr_list l = mpr_graph_get_objs(g, type);
+    while (l) {
+        if (_qry_match(q, (mpr_obj)*l))
+            _qry_add(q, (mpr_obj)*l);
+        l = mpr_list_get_next(l);
+    }
+    q->next = g->qrys;
+    g->qrys = q;
+    return q;
+}
+
+void mpr_qry_add_filter(mpr_qry q, mpr_prop p, const char *key, int len,
+                        mpr_type type, const void *val, mpr_op op)
+{
+    int i, mask = MPR_OP_ALL | MPR_OP_ANY;
+    RETURN_UNLESS(q && op > MPR_OP_UNDEFINED && (op | mask) <= (MPR_OP_NEQ | mask));
+    q->filters = realloc(q->filters, sizeof(mpr_qry_filter_t) * (q->num_filters + 1));
+    mpr_qry_filter_t *f = &q->filters[q->num_filters++];
+    f->key = key ? strdup(key) : 0;
+    f->val = _copy_filter_val(len, type, val);
+    f->prop = p;
+    f->type = type;
+    f->op = op;
+    f->len = len;
+
+    // a new condition can only remove results
+    for (i = q->objs.num - 1; i >= 0; i--) {
+        mpr_obj o = q->objs.objs[i];
+        if (!mpr_list_match_obj(o, p, f->key, len, type, f->val, op))
+            _update_qry(q, o, MPR_OBJ_REM);
+    }
+}
+
+int mpr_qry_get_size(mpr_qry q)
+{
+    return q ? q->objs.num : 0;
+}
+
+mpr_obj mpr_qry_get_idx(mpr_qry q, unsigned int idx)
+{
+    RETURN_UNLESS(q && idx < q->objs.num, 0);
+    return q->objs.objs[idx];
+}
+
+void mpr_qry_free(mpr_qry q)
+{
+    int i;
+    RETURN_UNLESS(q);
+    mpr_qry *qp = &q->graph->qrys;
+    while (*qp && *qp != q)
+        qp = &(*qp)->next;
+    if (*qp)
+        *qp = q->next;
+    for (i = 0; i < q->num_filters; i++) {
+        FUNC_IF(free, q->filters[i].key);
+        _free_filter_val(&q->filters[i]);
+    }
+    FUNC_IF(free, q->filters);
+    FUNC_IF(free, q->pos);
+    mpr_obj_arr_free(&q->objs);
+    free(q);
+}
+
 int mpr_graph_remove_cb(mpr_graph g, mpr_graph_handler *h, const void *user)
 {
     fptr_list cb = g->callbacks;
@@ -344,6 +704,7 @@ mpr_dev mpr_graph_add_dev(mpr_graph g, const char *name, mpr_msg msg)
         dev->obj.type = MPR_DEV;
         dev->obj.graph = g;
         init_dev_prop_tbl(dev);
+        mpr_graph_reindex_obj(g, (mpr_obj)dev);
         rc = 1;
     }
 
@@ -376,25 +737,32 @@ void mpr_graph_remove_dev(mpr_graph g, mpr_dev d, mpr_graph_evt e, int quiet)
     _remove_by_qry(g, mpr_dev_get_sigs(d, MPR_DIR_ANY), e);
 
     mpr_list_remove_item((void**)&g->devs, d);
+    _unindex_obj(g, (mpr_obj)d);
 
     if (!quiet)
         mpr_graph_call_cbs(g, (mpr_obj)d, MPR_DEV, e);
+    else
+        _update_qrys(g, (mpr_obj)d, MPR_OBJ_REM);
 
     FUNC_IF(mpr_tbl_free, d->obj.props.synced);
     FUNC_IF(mpr_tbl_free, d->obj.props.staged);
     FUNC_IF(free, d->obj.name);
+    mpr_obj_arr_free(&d->sigs);
+    mpr_obj_arr_free(&d->maps);
+    mpr_obj_arr_free(&d->links);
     mpr_list_free_item(d);
 }
 
 mpr_dev mpr_graph_get_dev_by_name(mpr_graph g, const char *name)
 {
+    RETURN_UNLESS(g->idx.size, 0);
     const char *no_slash = skip_slash(name);
-    mpr_list devs = mpr_list_from_data(g->devs);
-    while (devs) {
-        mpr_dev dev = (mpr_dev)*devs;
-        devs = mpr_list_get_next(devs);
-        if (dev->obj.name && (0 == strcmp(dev->obj.name, no_slash)))
-            return dev;
+    unsigned int hash = _str_hash(no_slash, 2166136261u);
+    mpr_obj o = g->idx.name[hash & (g->idx.size - 1)];
+    for (; o; o = o->name_next) {
+        if (o->name_hash == hash && MPR_DEV == o->type && o->name
+            && 0 == strcmp(o->name, no_slash))
+            return (mpr_dev)o;
     }
     return 0;
 }
@@ -441,6 +809,8 @@ mpr_sig mpr_graph_add_sig(mpr_graph g, const char *name, const char *dev_name, m
         sig->obj.graph = g;
 
         mpr_sig_init(sig, MPR_DIR_UNDEFINED, name, 0, 0, 0, 0, 0, 0);
+        mpr_graph_reindex_obj(g, (mpr_obj)sig);
+        mpr_obj_arr_add(&dev->sigs, (mpr_obj)sig);
         rc = 1;
     }
 
@@ -463,6 +833,8 @@ void mpr_graph_remove_sig(mpr_graph g, mpr_sig s, mpr_graph_evt e)
     _remove_by_qry(g, mpr_sig_get_maps(s, MPR_DIR_ANY), e);
 
     mpr_list_remove_item((void**)&g->sigs, s);
+    _unindex_obj(g, (mpr_obj)s);
+    mpr_obj_arr_remove(&s->dev->sigs, (mpr_obj)s);
     mpr_graph_call_cbs(g, (mpr_obj)s, MPR_SIG, e);
 
     if (s->dir & MPR_DIR_IN)
@@ -495,6 +867,9 @@ mpr_link mpr_graph_add_link(mpr_graph g, mpr_dev dev1, mpr_dev dev2)
     link->obj.type = MPR_LINK;
     link->obj.graph = g;
     mpr_link_init(link);
+    mpr_obj_arr_add(&dev1->links, (mpr_obj)link);
+    if (dev2 != dev1)
+        mpr_obj_arr_add(&dev2->links, (mpr_obj)link);
     return link;
 }
 
@@ -503,6 +878,8 @@ void mpr_graph_remove_link(mpr_graph g, mpr_link l, mpr_graph_evt e)
     RETURN_UNLESS(l);
     _remove_by_qry(g, mpr_link_get_maps(l), e);
     mpr_list_remove_item((void**)&g->links, l);
+    mpr_obj_arr_remove(&l->devs[0]->links, (mpr_obj)l);
+    mpr_obj_arr_remove(&l->devs[1]->links, (mpr_obj)l);
     mpr_link_free(l);
     mpr_list_free_item(l);
 }
@@ -532,28 +909,32 @@ static mpr_sig add_sig_from_whole_name(mpr_graph g, const char* name)
 
 mpr_map mpr_graph_get_map_by_names(mpr_graph g, int num_src, const char **srcs, const char *dst)
 {
-    mpr_map map = 0;
-    mpr_list maps = mpr_list_from_data(g->maps);
-    while (maps) {
-        map = (mpr_map)*maps;
-        int i;
-        if (map->num_src != num_src)
-            map = 0;
-        else if (mpr_slot_match_full_name(map->dst, dst))
-            map = 0;
-        else {
-            for (i = 0; i < num_src; i++) {
-                if (mpr_slot_match_full_name(map->src[i], srcs[i])) {
-                    map = 0;
-                    break;
-                }
-            }
+    // maps are indexed by their destination signal, so look that up first
+    char *devnamep, *signame;
+    int i, devnamelen = mpr_parse_names(dst, &devnamep, &signame);
+    RETURN_UNLESS(devnamelen && signame && g->idx.size, 0);
+    char devname[devnamelen + 1];
+    strncpy(devname, devnamep, devnamelen);
+    devname[devnamelen] = 0;
+    mpr_dev dev = mpr_graph_get_dev_by_name(g, devname);
+    RETURN_UNLESS(dev, 0);
+    mpr_sig sig = mpr_graph_get_sig_by_name(g, dev, signame);
+    RETURN_UNLESS(sig, 0);
+
+    unsigned int hash = mpr_id_hash((mpr_id)(uintptr_t)sig, 0);
+    mpr_obj o = g->idx.name[hash & (g->idx.size - 1)];
+    for (; o; o = o->name_next) {
+        mpr_map map = (mpr_map)o;
+        if (MPR_MAP != o->type || map->dst->sig != sig || map->num_src != num_src)
+            continue;
+        for (i = 0; i < num_src; i++) {
+            if (mpr_slot_match_full_name(map->src[i], srcs[i]))
+                break;
         }
-        if (map)
-            break;
-        maps = mpr_list_get_next(maps);
+        if (i == num_src)
+            return map;
     }
-    return map;
+    return 0;
 }
 
 mpr_map mpr_graph_add_map(mpr_graph g, mpr_id id, int num_src, const char **src_names,
@@ -570,8 +951,8 @@ mpr_map mpr_graph_add_map(mpr_graph g, mpr_id id, int num_src, const char **src_
     /* We could be part of larger "convergent" mapping, so we will retrieve
      * record by mapping id instead of names. */
     if (id) {
-        map = (mpr_map)_obj_by_id(g, (mpr_obj)g->maps, id);
-        if (!map && _obj_by_id(g, (mpr_obj)g->maps, 0)) {
+        map = (mpr_map)_obj_by_id(g, MPR_MAP, id);
+        if (!map && _obj_by_id(g, MPR_MAP, 0)) {
             // may have staged map stored locally
             map = mpr_graph_get_map_by_names(g, num_src, src_names, dst_name);
         }
@@ -614,6 +995,7 @@ mpr_map mpr_graph_add_map(mpr_graph g, mpr_id id, int num_src, const char **src_
         map->dst->causes_update = 1;
         map->dst->map = map;
         mpr_map_init(map);
+        mpr_graph_reindex_obj(g, (mpr_obj)map);
         rc = 1;
     }
     else {
@@ -637,6 +1019,7 @@ mpr_map mpr_graph_add_map(mpr_graph g, mpr_id id, int num_src, const char **src_
                 map->src[j]->causes_update = 1;
                 map->src[j]->map = map;
                 mpr_slot_init(map->src[j]);
+                mpr_map_add_to_devs(map);
                 ++updated;
             }
         }
@@ -704,6 +1087,8 @@ void mpr_graph_remove_map(mpr_graph g, mpr_map m, mpr_graph_evt e)
 {
     RETURN_UNLESS(m);
     mpr_list_remove_item((void**)&g->maps, m);
+    _unindex_obj(g, (mpr_obj)m);
+    mpr_map_remove_from_devs(m);
     mpr_graph_call_cbs(g, (mpr_obj)m, MPR_MAP, e);
     mpr_map_free(m);
     mpr_list_free_item(m);
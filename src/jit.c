@@ -0,0 +1,186 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "mapper_internal.h"
+#include "config.h"
+
+/* A minimal x86-64 machine code emitter used to translate compiled mapping
+ * expressions to native code. Only the handful of encodings needed by the
+ * expression backend are provided: general purpose moves and arithmetic,
+ * scalar SSE2 loads, stores and arithmetic addressed as [base + disp32],
+ * indirect calls and relative jumps. */
+
+#ifdef HAVE_JIT
+
+#include <sys/mman.h>
+
+#define REX_W 0x08
+#define REX_R 0x04
+#define REX_B 0x01
+
+/* Executable pages are prefixed with their total size so they can be
+ * unmapped later. */
+#define HEADER_SIZE 16
+
+static void emit(mpr_jit_buf buf, const unsigned char *bytes, int len)
+{
+    if (buf->failed)
+        return;
+    if (buf->len + len > buf->size) {
+        size_t size = buf->size ? buf->size * 2 : 256;
+        unsigned char *code;
+        while (size < buf->len + len)
+            size *= 2;
+        if (!(code = realloc(buf->code, size))) {
+            buf->failed = 1;
+            return;
+        }
+        buf->code = code;
+        buf->size = size;
+    }
+    memcpy(buf->code + buf->len, bytes, len);
+    buf->len += len;
+}
+
+static inline void emit_byte(mpr_jit_buf buf, unsigned char b)
+{
+    emit(buf, &b, 1);
+}
+
+static inline void emit_u32(mpr_jit_buf buf, uint32_t u)
+{
+    unsigned char b[4] = { u, u >> 8, u >> 16, u >> 24 };
+    emit(buf, b, 4);
+}
+
+static inline void emit_rex(mpr_jit_buf buf, int w, int reg, int base)
+{
+    int rex = (w ? REX_W : 0) | (reg & 8 ? REX_R : 0) | (base & 8 ? REX_B : 0);
+    if (rex)
+        emit_byte(buf, 0x40 | rex);
+}
+
+/* ModRM (and SIB if required) for [base + disp32] */
+static inline void emit_mem(mpr_jit_buf buf, int reg, int base, int32_t disp)
+{
+    emit_byte(buf, 0x80 | ((reg & 7) << 3) | (base & 7));
+    if ((base & 7) == MPR_JIT_RSP)
+        emit_byte(buf, 0x24);
+    emit_u32(buf, (uint32_t)disp);
+}
+
+void mpr_jit_init(mpr_jit_buf buf)
+{
+    memset(buf, 0, sizeof(mpr_jit_buf_t));
+}
+
+void mpr_jit_op_mem(mpr_jit_buf buf, int prefix, int opcode, int w, int reg,
+                    int base, int32_t disp)
+{
+    if (prefix)
+        emit_byte(buf, prefix);
+    emit_rex(buf, w, reg, base);
+    if (opcode > 0xFF)
+        emit_byte(buf, opcode >> 8);
+    emit_byte(buf, opcode & 0xFF);
+    emit_mem(buf, reg, base, disp);
+}
+
+void mpr_jit_op_reg(mpr_jit_buf buf, int opcode, int w, int reg, int rm)
+{
+    emit_rex(buf, w, reg, rm);
+    if (opcode > 0xFF)
+        emit_byte(buf, opcode >> 8);
+    emit_byte(buf, opcode & 0xFF);
+    emit_byte(buf, 0xC0 | ((reg & 7) << 3) | (rm & 7));
+}
+
+void mpr_jit_push(mpr_jit_buf buf, int reg)
+{
+    emit_rex(buf, 0, 0, reg);
+    emit_byte(buf, 0x50 | (reg & 7));
+}
+
+void mpr_jit_pop(mpr_jit_buf buf, int reg)
+{
+    emit_rex(buf, 0, 0, reg);
+    emit_byte(buf, 0x58 | (reg & 7));
+}
+
+void mpr_jit_mov_imm64(mpr_jit_buf buf, int reg, uint64_t imm)
+{
+    emit_rex(buf, 1, 0, reg);
+    emit_byte(buf, 0xB8 | (reg & 7));
+    emit_u32(buf, (uint32_t)imm);
+    emit_u32(buf, (uint32_t)(imm >> 32));
+}
+
+void mpr_jit_store_imm32(mpr_jit_buf buf, int base, int32_t disp, uint32_t imm)
+{
+    mpr_jit_op_mem(buf, 0, 0xC7, 0, 0, base, disp);
+    emit_u32(buf, imm);
+}
+
+void mpr_jit_call(mpr_jit_buf buf, int reg)
+{
+    mpr_jit_op_reg(buf, 0xFF, 0, 2, reg);
+}
+
+void mpr_jit_jmp_reg(mpr_jit_buf buf, int reg)
+{
+    mpr_jit_op_reg(buf, 0xFF, 0, 4, reg);
+}
+
+void mpr_jit_jmp(mpr_jit_buf buf, int cond, size_t target)
+{
+    if (cond < 0)
+        emit_byte(buf, 0xE9);
+    else {
+        emit_byte(buf, 0x0F);
+        emit_byte(buf, 0x80 | cond);
+    }
+    emit_u32(buf, (uint32_t)(int32_t)(target - (buf->len + 4)));
+}
+
+void mpr_jit_ret(mpr_jit_buf buf)
+{
+    emit_byte(buf, 0xC3);
+}
+
+void *mpr_jit_finalize(mpr_jit_buf buf)
+{
+    unsigned char *mem;
+    size_t size = buf->len + HEADER_SIZE;
+    if (buf->failed || !buf->len)
+        goto error;
+    mem = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (MAP_FAILED == mem)
+        goto error;
+    memcpy(mem, &size, sizeof(size_t));
+    memcpy(mem + HEADER_SIZE, buf->code, buf->len);
+    if (mprotect(mem, size, PROT_READ | PROT_EXEC)) {
+        munmap(mem, size);
+        goto error;
+    }
+    FUNC_IF(free, buf->code);
+    mpr_jit_init(buf);
+    return mem + HEADER_SIZE;
+
+  error:
+    trace("failed to allocate executable memory for expression.\n");
+    FUNC_IF(free, buf->code);
+    mpr_jit_init(buf);
+    return 0;
+}
+
+void mpr_jit_free(void *code)
+{
+    unsigned char *mem = (unsigned char*)code - HEADER_SIZE;
+    size_t size;
+    RETURN_UNLESS(code);
+    memcpy(&size, mem, sizeof(size_t));
+    munmap(mem, size);
+}
+
+#endif /* HAVE_JIT */
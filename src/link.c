@@ -9,6 +9,44 @@
 #include "types_internal.h"
 #include <mapper/mapper.h>
 
+#ifdef HAVE_ARPA_INET_H
+ #include <sys/socket.h>
+ #include <netinet/in.h>
+ #include <netinet/tcp.h>
+ #include <netdb.h>
+ #include <unistd.h>
+ #define close_socket close
+#else
+ #ifdef HAVE_WINSOCK2_H
+  #include <ws2tcpip.h>
+  #define close_socket closesocket
+ #endif
+#endif
+
+#ifdef MSG_NOSIGNAL
+ #define SEND_FLAGS MSG_NOSIGNAL
+#else
+ #define SEND_FLAGS 0
+#endif
+
+/* Data bundles of local links are serialised directly by default. This can be
+ * switched per link at runtime through the "direct" property of the link or of
+ * a map using it, which is local to this process and never sent to peers. */
+#define DIRECT_KEY              "direct"
+
+// keep directly serialised UDP bundles within the maximum UDP payload
+#define MAX_DIRECT_UDP_SIZE     65507
+
+/* TCP bundles are framed on the stream and have no payload limit. They are sent
+ * once they reach liblo's default maximum message size, but a larger message is
+ * still sent in a bundle of its own. */
+#define MAX_DIRECT_TCP_SIZE     32768
+#define BUNDLE_HEADER_SIZE      16
+
+/* keep packed messages within liblo's default maximum message size, which is
+ * also well within the UDP payload */
+#define MAX_PACKED_MSG_SIZE     32768
+
 mpr_link mpr_link_new(mpr_dev local_dev, mpr_dev remote_dev)
 {
     return mpr_graph_add_link(local_dev->obj.graph, local_dev, remote_dev);
@@ -31,7 +69,10 @@ void mpr_link_init(mpr_link link)
 
     if (!link->obj.id && link->local_dev->loc)
         link->obj.id = mpr_dev_generate_unique_id(link->local_dev);
+    if (link->local_dev->loc)
+        mpr_link_set_direct(link, 1);
 
+    link->tcp_sock = -1;
     link->clock.new = 1;
     link->clock.sent.msg_id = 0;
     link->clock.rcvd.msg_id = -1;
@@ -49,6 +90,77 @@ void mpr_link_init(mpr_link link)
     mpr_net_send(net);
 }
 
+static void *_resolve_addr(const char *host, const char *port, int family, int socktype,
+                           int *len)
+{
+    struct addrinfo hints, *info = 0;
+    void *addr;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = family;
+    hints.ai_socktype = socktype;
+#ifdef AI_V4MAPPED
+    if (AF_INET6 == family)
+        hints.ai_flags = AI_V4MAPPED;
+#endif
+    RETURN_UNLESS(0 == getaddrinfo(host, port, &hints, &info) && info, 0);
+    addr = malloc(info->ai_addrlen);
+    memcpy(addr, info->ai_addr, info->ai_addrlen);
+    *len = info->ai_addrlen;
+    freeaddrinfo(info);
+    return addr;
+}
+
+/* Resolve the remote data port for sending directly: UDP from the socket of
+ * the local UDP server, in the address family of that socket, and TCP through
+ * a socket of our own that is connected on first use. Once resolved, bundles
+ * serialised by liblo are sent over the same TCP socket so that the stream
+ * keeps its order when the "direct" property is switched. */
+static void _resolve(mpr_link link, const char *host, const char *port)
+{
+    lo_server server = link->obj.graph->net.server.udp;
+    struct sockaddr_storage ss;
+    socklen_t len = sizeof(ss);
+    FUNC_IF(free, link->udp_sockaddr);
+    FUNC_IF(free, link->tcp_sockaddr);
+    link->udp_sockaddr = link->tcp_sockaddr = 0;
+    if (link->tcp_sock >= 0) {
+        close_socket(link->tcp_sock);
+        link->tcp_sock = -1;
+    }
+
+    if (server && 0 == getsockname(lo_server_get_socket_fd(server), (struct sockaddr*)&ss, &len))
+        link->udp_sockaddr = _resolve_addr(host, port, ss.ss_family, SOCK_DGRAM,
+                                           &link->udp_sockaddr_len);
+    link->tcp_sockaddr = _resolve_addr(host, port, AF_UNSPEC, SOCK_STREAM,
+                                       &link->tcp_sockaddr_len);
+    if (!link->udp_sockaddr || !link->tcp_sockaddr)
+        trace_dev(link->local_dev, "couldn't resolve %s:%s, sending through liblo\n", host, port);
+}
+
+int mpr_link_set_direct(mpr_link link, int direct)
+{
+    RETURN_UNLESS(link->local_dev->loc, 0);
+    direct = direct ? 1 : 0;
+    if (direct != link->direct && link->addr.udp && link->local_dev != link->remote_dev) {
+        /* send anything queued in the other format first, so that updates
+         * queued before the switch are not overtaken by later ones */
+        int i;
+        mpr_time t;
+        mpr_time_set(&t, MPR_NOW);
+        for (i = 0; i < NUM_BUNDLES; i++)
+            mpr_link_process_bundles(link, t, i);
+    }
+    link->direct = direct;
+    mpr_tbl_set(link->obj.props.synced, MPR_PROP_EXTRA, DIRECT_KEY, 1, MPR_BOOL, &link->direct,
+                LOCAL_MODIFY | LOCAL_ACCESS_ONLY);
+    return 1;
+}
+
+int mpr_link_get_is_direct_key(const char *key)
+{
+    return key && 0 == strcmp(key, DIRECT_KEY);
+}
+
 void mpr_link_connect(mpr_link link, const char *host, int admin_port,
                       int data_port)
 {
@@ -60,6 +172,7 @@ void mpr_link_connect(mpr_link link, const char *host, int admin_port,
     sprintf(str, "%d", data_port);
     link->addr.udp = lo_address_new(host, str);
     link->addr.tcp = lo_address_new_with_proto(LO_TCP, host, str);
+    _resolve(link, host, str);
     sprintf(str, "%d", admin_port);
     link->addr.admin = lo_address_new(host, str);
     trace_dev(link->local_dev, "activated router to device '%s' at %s:%d\n",
@@ -78,26 +191,370 @@ void mpr_link_free(mpr_link link)
     FUNC_IF(lo_address_free, link->addr.admin);
     FUNC_IF(lo_address_free, link->addr.udp);
     FUNC_IF(lo_address_free, link->addr.tcp);
-    FUNC_IF(lo_bundle_free_recursive, link->bundles[0].udp);
-    FUNC_IF(lo_bundle_free_recursive, link->bundles[0].tcp);
-    FUNC_IF(lo_bundle_free_recursive, link->bundles[1].udp);
-    FUNC_IF(lo_bundle_free_recursive, link->bundles[1].tcp);
+    int i, j;
+    for (i = 0; i < NUM_BUNDLES; i++) {
+        mpr_bundle b = &link->bundles[i];
+        FUNC_IF(lo_bundle_free_recursive, b->udp);
+        FUNC_IF(lo_bundle_free_recursive, b->tcp);
+        FUNC_IF(free, b->loc);
+        FUNC_IF(free, b->loc_buf);
+        for (j = 0; j < b->num_pk; j++)
+            lo_message_free(b->pk[j].msg);
+        FUNC_IF(free, b->pk);
+        for (j = 0; j < b->num_pools; j++) {
+            mpr_msg_pool p = &b->pools[j];
+            while (p->num)
+                lo_message_free(p->msgs[--p->num]);
+            free(p->msgs);
+            free(p->types);
+        }
+        FUNC_IF(free, b->pools);
+        FUNC_IF(free, b->udp_buf.data);
+        FUNC_IF(free, b->tcp_buf.data);
+    }
+    if (link->tcp_sock >= 0)
+        close_socket(link->tcp_sock);
+    FUNC_IF(free, link->udp_sockaddr);
+    FUNC_IF(free, link->tcp_sockaddr);
+    mpr_dev_release_aliases(link->local_dev, 0, link);
     mpr_dev_remove_link(link->local_dev, link->remote_dev);
 }
 
-// note on memory handling of mpr_link_add_msg():
-// message: will be owned, will be freed when done
-void mpr_link_add_msg(mpr_link link, mpr_sig dst, lo_message msg, mpr_time t, mpr_proto proto, int idx)
+/* Loopback updates are not turned into messages: the typestring is copied into
+ * the bundle value buffer followed by the value, padded so that the value stays
+ * aligned, and both are handed to the destination signal when the bundle is
+ * processed. A null value or typestring queues an instance release. */
+#define LOCAL_PAD(N) (((N) + 7) & ~7)
+
+void mpr_link_add_local_msg(mpr_link link, mpr_sig dst, const mpr_type *types, const void *val,
+                            int len, mpr_id GID, int slot, mpr_time t, int idx)
 {
-    RETURN_UNLESS(msg);
-    if (link->local_dev == link->remote_dev)
-        proto = MPR_PROTO_UDP;
+    mpr_bundle b = &link->bundles[idx];
+    int i, size = 0, offset, end;
+
+    if (!dst->loc) {
+        trace_dev(link->local_dev, "loopback update for non-local signal '%s'\n", dst->path);
+        return;
+    }
+    if (val && types) {
+        for (i = 0; i < len && !size; i++) {
+            if (types[i] != MPR_NULL)
+                size = mpr_type_get_size(types[i]);
+        }
+    }
+    offset = LOCAL_PAD(b->loc_buf_len);
+    end = offset + LOCAL_PAD(len) + len * size;
+    if (end > b->loc_buf_size) {
+        b->loc_buf_size = b->loc_buf_size ? b->loc_buf_size : 256;
+        while (b->loc_buf_size < end)
+            b->loc_buf_size *= 2;
+        b->loc_buf = realloc(b->loc_buf, b->loc_buf_size);
+    }
+    if (size) {
+        memcpy(b->loc_buf + offset, types, len);
+        memcpy(b->loc_buf + offset + LOCAL_PAD(len), val, len * size);
+    }
+    else
+        memset(b->loc_buf + offset, MPR_NULL, len);
+    b->loc_buf_len = end;
+
+    if (b->num_loc >= b->size_loc) {
+        b->size_loc = b->size_loc ? b->size_loc * 2 : 8;
+        b->loc = realloc(b->loc, sizeof(mpr_local_msg_t) * b->size_loc);
+    }
+    if (!b->num_loc)
+        b->time = t;
+    mpr_local_msg m = &b->loc[b->num_loc++];
+    m->sig = dst;
+    m->GID = GID;
+    m->offset = offset;
+    m->len = len;
+    m->slot = slot;
+}
+
+/* Connect the socket used for sending TCP bundles directly. Like liblo, the
+ * connection is made on first use and blocks until it is established. */
+static int _connect_tcp(mpr_link link)
+{
+    RETURN_UNLESS(link->tcp_sock < 0, 1);
+    struct sockaddr *addr = (struct sockaddr*)link->tcp_sockaddr;
+    int sock = socket(addr->sa_family, SOCK_STREAM, 0);
+    RETURN_UNLESS(sock >= 0, 0);
+    if (connect(sock, addr, link->tcp_sockaddr_len) < 0) {
+        close_socket(sock);
+        return 0;
+    }
+    int one = 1;
+#ifdef TCP_NODELAY
+    setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, (const void*)&one, sizeof(one));
+#endif
+#ifdef SO_NOSIGPIPE
+    setsockopt(sock, SOL_SOCKET, SO_NOSIGPIPE, (const void*)&one, sizeof(one));
+#endif
+    link->tcp_sock = sock;
+    return 1;
+}
+
+static int _send_tcp(mpr_link link, const char *data, int len)
+{
+    int n;
+    RETURN_UNLESS(_connect_tcp(link), -1);
+    while (len > 0) {
+        if ((n = send(link->tcp_sock, data, len, SEND_FLAGS)) <= 0) {
+            // drop the connection, it is made again for the next bundle
+            close_socket(link->tcp_sock);
+            link->tcp_sock = -1;
+            return -1;
+        }
+        data += n;
+        len -= n;
+    }
+    return 0;
+}
+
+static void _send_direct(mpr_link link, mpr_direct_buf buf, int tcp)
+{
+    int result;
+    if (tcp) {
+        // the size prefix frames the bundle on the stream
+        *(uint32_t*)buf->data = htonl(buf->len - 4);
+        result = _send_tcp(link, buf->data, buf->len);
+    }
+    else {
+        lo_server server = link->obj.graph->net.server.udp;
+        result = sendto(lo_server_get_socket_fd(server), buf->data, buf->len, 0,
+                        (struct sockaddr*)link->udp_sockaddr, link->udp_sockaddr_len);
+    }
+    if (result < 0)
+        trace_dev(link->local_dev, "error sending bundle to device '%s'\n",
+                  link->remote_dev->obj.name);
+    buf->len = buf->count = 0;
+}
+
+/* Serialise the message straight into the bundle buffer in the format of
+ * lo_bundle_serialise(): the "#bundle" header and timetag of the first
+ * message, then the size and contents of each message. TCP bundles are
+ * preceded by their size, as liblo frames them on the stream. */
+static void _add_direct_msg(mpr_link link, const char *path, lo_message msg, mpr_time t,
+                            int tcp, int idx)
+{
+    mpr_direct_buf buf = tcp ? &link->bundles[idx].tcp_buf : &link->bundles[idx].udp_buf;
+    int len = lo_message_length(msg, path), size;
+    int header = BUNDLE_HEADER_SIZE + (tcp ? 4 : 0);
+    int max = tcp ? MAX_DIRECT_TCP_SIZE : MAX_DIRECT_UDP_SIZE;
+    uint32_t *u;
+
+    // hold a reference while serialising, like lo_bundle_add_message()
+    lo_message_incref(msg);
+    if (!tcp && len + 4 + header > max) {
+        trace_dev(link->local_dev, "message for '%s' is too large to send\n", path);
+        lo_message_free(msg);
+        return;
+    }
+    if (buf->len && buf->len + 4 + len > max)
+        _send_direct(link, buf, tcp);
+    if (buf->len + 4 + len + header > buf->size) {
+        size = buf->size ? buf->size : 1024;
+        while (size < buf->len + 4 + len + header)
+            size *= 2;
+        if (!tcp && size > max)
+            size = max;
+        buf->data = realloc(buf->data, size);
+        buf->size = size;
+    }
+    if (!buf->len) {
+        buf->len = header - BUNDLE_HEADER_SIZE;
+        memcpy(buf->data + buf->len, "#bundle", 8);
+        u = (uint32_t*)(buf->data + buf->len + 8);
+        u[0] = htonl(t.sec);
+        u[1] = htonl(t.frac);
+        buf->len += BUNDLE_HEADER_SIZE;
+    }
+    u = (uint32_t*)(buf->data + buf->len);
+    *u = htonl(len);
+    lo_message_serialise(msg, path, buf->data + buf->len + 4, NULL);
+    buf->len += 4 + len;
+    ++buf->count;
+    lo_message_free(msg);
+}
+
+/* Send a TCP bundle serialised by liblo through the socket used for direct
+ * bundles, reusing the buffer of the latter which has already been sent. */
+static void _send_lo_tcp(mpr_link link, lo_bundle lb, int idx)
+{
+    mpr_direct_buf buf = &link->bundles[idx].tcp_buf;
+    int len = (int)lo_bundle_length(lb);
+    if (len + 4 > buf->size) {
+        buf->data = realloc(buf->data, len + 4);
+        buf->size = len + 4;
+    }
+    lo_bundle_serialise(lb, buf->data + 4, NULL);
+    buf->len = len + 4;
+    _send_direct(link, buf, 1);
+}
+
+/* Data messages are addressed to the path alias announced by the peer for the
+ * map if there is one, otherwise to the full signal path. */
+static const char *_get_path(mpr_sig dst, int alias, char *buf)
+{
+    RETURN_UNLESS(alias, dst->path);
+    snprintf(buf, 16, "/@%d", alias);
+    return buf;
+}
+
+static void _add_msg(mpr_link link, mpr_sig dst, int alias, lo_message msg, mpr_time t,
+                     mpr_proto proto, int idx)
+{
+    char buf[16];
+    int udp = mpr_protocol_is_udp(proto);
+    if (link->local_dev == link->remote_dev) {
+        // loopback updates are queued by mpr_link_add_local_msg() instead
+        lo_message_free(msg);
+        return;
+    }
+    if (link->direct && (udp ? link->udp_sockaddr : link->tcp_sockaddr)) {
+        _add_direct_msg(link, _get_path(dst, alias, buf), msg, t, !udp, idx);
+        return;
+    }
 
     // add message to existing bundles
-    lo_bundle *b = (proto == MPR_PROTO_UDP) ? &link->bundles[idx].udp : &link->bundles[idx].tcp;
+    lo_bundle *b = udp ? &link->bundles[idx].udp : &link->bundles[idx].tcp;
     if (!(*b))
         *b = lo_bundle_new(t);
-    lo_bundle_add_message(*b, dst->path, msg);
+    lo_bundle_add_message(*b, _get_path(dst, alias, buf), msg);
+}
+
+static void _add_packed(mpr_link link, mpr_packed_msg p, int idx)
+{
+    if (p->slot >= 0) {
+        lo_message_add_string(p->msg, "@sl");
+        lo_message_add_int32(p->msg, p->slot);
+    }
+    _add_msg(link, p->sig, p->alias, p->msg, p->time, p->proto, idx);
+}
+
+/* Move packed messages into the bundle, either all of them or only those for
+ * signal dst so that they stay ahead of a following message for it. */
+static void _flush_packed(mpr_link link, mpr_sig dst, int idx)
+{
+    mpr_bundle b = &link->bundles[idx];
+    int i, j = 0, num = b->num_pk;
+    for (i = 0; i < num; i++) {
+        mpr_packed_msg_t p = b->pk[i];
+        if (dst && p.sig != dst) {
+            b->pk[j++] = p;
+            continue;
+        }
+        _add_packed(link, &p, idx);
+    }
+    b->num_pk = j;
+}
+
+// note on memory handling of mpr_link_add_msg():
+// message: will be owned, will be freed when done
+void mpr_link_add_msg(mpr_link link, mpr_sig dst, int alias, lo_message msg, mpr_time t,
+                      mpr_proto proto, int idx)
+{
+    RETURN_UNLESS(msg);
+    if (link->bundles[idx].num_pk)
+        _flush_packed(link, dst, idx);
+    _add_msg(link, dst, alias, msg, t, proto, idx);
+}
+
+/* Data messages are pooled per bundle so that steady-state output does not
+ * allocate: the pool holds its own reference to each message, so sending or
+ * dispatching it does not free it. Messages of the same type string are
+ * interchangeable since their arguments are overwritten in place by
+ * mpr_map_build_msg(), so they are kept in one pool per type string in which
+ * the first num_used messages are still queued. Consecutive updates usually
+ * share a type string, so the last pool used is checked first. */
+static mpr_msg_pool _get_pool(mpr_bundle b, const char *types, int add)
+{
+    int i;
+    if (b->last_pool < b->num_pools && 0 == strcmp(b->pools[b->last_pool].types, types))
+        return &b->pools[b->last_pool];
+    for (i = 0; i < b->num_pools; i++) {
+        if (0 == strcmp(b->pools[i].types, types)) {
+            b->last_pool = i;
+            return &b->pools[i];
+        }
+    }
+    RETURN_UNLESS(add, 0);
+    b->pools = realloc(b->pools, sizeof(mpr_msg_pool_t) * (b->num_pools + 1));
+    mpr_msg_pool p = &b->pools[b->num_pools];
+    memset(p, 0, sizeof(mpr_msg_pool_t));
+    p->types = strdup(types);
+    b->last_pool = b->num_pools++;
+    return p;
+}
+
+lo_message mpr_link_get_msg(mpr_link link, const char *types, int idx)
+{
+    mpr_msg_pool p = _get_pool(&link->bundles[idx], types, 0);
+    RETURN_UNLESS(p && p->num_used < p->num, 0);
+    return p->msgs[p->num_used++];
+}
+
+void mpr_link_pool_msg(mpr_link link, lo_message msg, int idx)
+{
+    mpr_msg_pool p = _get_pool(&link->bundles[idx], lo_message_get_types(msg), 1);
+    if (p->num >= p->size) {
+        p->size = p->size ? p->size * 2 : 8;
+        p->msgs = realloc(p->msgs, sizeof(lo_message) * p->size);
+    }
+    lo_message_incref(msg);
+    p->msgs[p->num++] = p->msgs[p->num_used];
+    p->msgs[p->num_used++] = msg;
+}
+
+int mpr_link_get_has_protocol(mpr_link link, mpr_proto pro)
+{
+    if (MPR_PROTO_UDP == pro || MPR_PROTO_TCP == pro)
+        return 1;
+    return (link->remote_dev->protocols >> pro) & 1;
+}
+
+/* Packed messages start with the string "@pk" followed by one (int64 GID,
+ * vector) tuple per instance update; the "@sl" slot tag is appended when the
+ * message is moved into the bundle. The caller appends the next tuple. The
+ * size of each message is tracked from its path, the label and slot tag, and
+ * the size of each tuple including its type tags, with a few bytes to spare
+ * for padding the type string. */
+lo_message mpr_link_get_packed_msg(mpr_link link, mpr_sig dst, int alias, int slot,
+                                   mpr_time t, mpr_proto proto, int size, int idx)
+{
+    mpr_bundle b = &link->bundles[idx];
+    char buf[16];
+    int i, base = ((strlen(_get_path(dst, alias, buf)) + 4) & ~3) + 24;
+    RETURN_UNLESS(base + size <= MAX_PACKED_MSG_SIZE, 0);
+    for (i = 0; i < b->num_pk; i++) {
+        mpr_packed_msg p = &b->pk[i];
+        if (p->sig != dst || p->alias != alias || p->slot != slot || p->proto != proto)
+            continue;
+        if (p->size + size <= MAX_PACKED_MSG_SIZE) {
+            p->size += size;
+            return p->msg;
+        }
+        // full: send it ahead of a new message for the following updates
+        _add_packed(link, p, idx);
+        b->pk[i] = b->pk[--b->num_pk];
+        break;
+    }
+    NEW_LO_MSG(msg, return 0);
+    lo_message_add_string(msg, "@pk");
+    if (b->num_pk >= b->size_pk) {
+        b->size_pk = b->size_pk ? b->size_pk * 2 : 4;
+        b->pk = realloc(b->pk, sizeof(mpr_packed_msg_t) * b->size_pk);
+    }
+    b->pk[b->num_pk].sig = dst;
+    b->pk[b->num_pk].msg = msg;
+    b->pk[b->num_pk].time = t;
+    b->pk[b->num_pk].slot = slot;
+    b->pk[b->num_pk].alias = alias;
+    b->pk[b->num_pk].size = base + size;
+    b->pk[b->num_pk].proto = proto;
+    ++b->num_pk;
+    return msg;
 }
 
 // TODO: pass in bundle index as argument
@@ -111,12 +568,23 @@ int mpr_link_process_bundles(mpr_link link, mpr_time t, int idx)
     mpr_bundle b = &link->bundles[idx];
     lo_bundle lb;
 
+    if (b->num_pk)
+        _flush_packed(link, 0, idx);
+
     if (link->local_dev != link->remote_dev) {
         mpr_net n = &link->obj.graph->net;
+        if (b->udp_buf.len) {
+            num += b->udp_buf.count;
+            _send_direct(link, &b->udp_buf, 0);
+        }
+        if (b->tcp_buf.len) {
+            num += b->tcp_buf.count;
+            _send_direct(link, &b->tcp_buf, 1);
+        }
         if ((lb = b->udp)) {
             b->udp = 0;
             if ((tmp = lo_bundle_count(lb))) {
-                num = tmp;
+                num += tmp;
                 lo_send_bundle_from(link->addr.udp, n->server.udp, lb);
             }
             lo_bundle_free_recursive(lb);
@@ -125,33 +593,48 @@ int mpr_link_process_bundles(mpr_link link, mpr_time t, int idx)
             b->tcp = 0;
             if ((tmp = lo_bundle_count(lb))) {
                 num += tmp;
-                lo_send_bundle_from(link->addr.tcp, n->server.tcp, lb);
+                if (link->tcp_sockaddr)
+                    _send_lo_tcp(link, lb, idx);
+                else
+                    lo_send_bundle_from(link->addr.tcp, n->server.tcp, lb);
             }
             lo_bundle_free_recursive(lb);
         }
+        for (i = 0; i < b->num_pools; i++)
+            b->pools[i].num_used = 0;
     }
-    else if ((lb = b->udp)) {
-        b->udp = 0;
+    else if (b->num_loc) {
+        // detach the queue since handlers may add updates to this bundle
+        mpr_local_msg q = b->loc;
+        char *buf = b->loc_buf;
+        int size = b->size_loc, buf_size = b->loc_buf_size;
+        num = b->num_loc;
+        b->loc = 0;
+        b->loc_buf = 0;
+        b->num_loc = b->size_loc = b->loc_buf_len = b->loc_buf_size = 0;
+
         // set out-of-band timestamp
-        mpr_dev_bundle_start(lo_bundle_get_timestamp(lb), NULL);
-        // call handler directly instead of sending over the network
-        num = lo_bundle_count(lb);
-        const char *path;
-        while (i < num) {
-            lo_message m = lo_bundle_get_message(lb, i, &path);
-            // need to look up signal by path
-            mpr_rtr_sig rs = link->obj.graph->net.rtr->sigs;
-            while (rs) {
-                if (0 == strcmp(path, rs->sig->path)) {
-                    mpr_dev_handler(NULL, lo_message_get_types(m), lo_message_get_argv(m),
-                                    lo_message_get_argc(m), m, (void*)rs->sig);
-                    break;
-                }
-                rs = rs->next;
-            }
-            ++i;
+        mpr_dev_bundle_start(b->time, NULL);
+        // hand the updates to the destination signals instead of sending them
+        for (i = 0; i < num; i++) {
+            mpr_type *types = buf ? buf + q[i].offset : 0;
+            mpr_dev_handle_local(q[i].sig, types, types ? types + LOCAL_PAD(q[i].len) : 0,
+                                 q[i].len, q[i].GID, q[i].slot);
+        }
+
+        // keep the allocations for the next round unless new ones were made
+        if (!b->loc) {
+            b->loc = q;
+            b->size_loc = size;
         }
-        lo_bundle_free_recursive(lb);
+        else
+            free(q);
+        if (!b->loc_buf) {
+            b->loc_buf = buf;
+            b->loc_buf_size = buf_size;
+        }
+        else
+            free(buf);
     }
     return num;
 }
@@ -171,9 +654,10 @@ static int cmp_qry_link_maps(const void *context_data, mpr_map map)
 
 mpr_list mpr_link_get_maps(mpr_link link)
 {
-    RETURN_UNLESS(link && link->devs[0]->obj.graph->maps, 0);
-    mpr_list q = mpr_list_new_query((const void**)&link->devs[0]->obj.graph->maps,
-                                    cmp_qry_link_maps, "h", link->obj.id);
+    RETURN_UNLESS(link && link->devs[0]->maps.num, 0);
+    mpr_list q = mpr_list_new_arr_query((const void**)&link->devs[0]->obj.graph->maps,
+                                        &link->devs[0]->maps, cmp_qry_link_maps, "h",
+                                        link->obj.id);
     return mpr_list_start(q);
 }
 
@@ -56,6 +56,9 @@ typedef struct _query_info {
     unsigned int size;
     query_compare_func_t *query_compare;
     query_free_func_t *query_free;
+    mpr_obj_arr arr;    // optional array walked instead of the list
+    int arr_idx;        // current position in arr
+    int arr_owned;      // arr was allocated for this query
     int data[0]; // stub
 } query_info_t;
 
@@ -156,14 +159,73 @@ void mpr_list_free_item(void *item)
         free(mpr_list_header_by_data(item));
 }
 
+/** Object arrays **/
+
+void mpr_obj_arr_add(mpr_obj_arr arr, mpr_obj o)
+{
+    if (arr->num == arr->size) {
+        arr->size = arr->size ? arr->size * 2 : 4;
+        arr->objs = realloc(arr->objs, sizeof(mpr_obj) * arr->size);
+    }
+    arr->objs[arr->num++] = o;
+}
+
+int mpr_obj_arr_find(mpr_obj_arr arr, mpr_obj o)
+{
+    int i;
+    for (i = arr->num - 1; i >= 0; i--) {
+        if (arr->objs[i] == o)
+            break;
+    }
+    return i;
+}
+
+/* Keep the remaining objects in order so that a query walking the array
+ * downwards can remove the object it has just returned. */
+void mpr_obj_arr_remove(mpr_obj_arr arr, mpr_obj o)
+{
+    int i = mpr_obj_arr_find(arr, o);
+    RETURN_UNLESS(i >= 0);
+    --arr->num;
+    memmove(arr->objs + i, arr->objs + i + 1, sizeof(mpr_obj) * (arr->num - i));
+}
+
+void mpr_obj_arr_free(mpr_obj_arr arr)
+{
+    FUNC_IF(free, arr->objs);
+    arr->objs = 0;
+    arr->num = arr->size = 0;
+}
+
 /** Structures and functions for performing dynamic queries **/
 
 /* Here are some generalized routines for dealing with typical context
  * format and query continuation. Functions specific to particular
  * queries are defined further down with their compare operation. */
 
+static void **arr_query_continuation(mpr_list_header_t *lh, int idx)
+{
+    query_info_t *q = lh->query_ctx;
+    if (idx >= q->arr->num)
+        idx = q->arr->num - 1;
+    for (; idx >= 0; idx--) {
+        if (q->query_compare(&q->data, q->arr->objs[idx])) {
+            q->arr_idx = idx;
+            lh->self = q->arr->objs[idx];
+            return &lh->self;
+        }
+    }
+
+    // Clean up
+    if (q->query_free)
+        q->query_free(lh);
+    return 0;
+}
+
 void **mpr_list_query_continuation(mpr_list_header_t *lh)
 {
+    if (lh->query_ctx->arr)
+        return arr_query_continuation(lh, lh->query_ctx->arr_idx - 1);
     void *item = mpr_list_header_by_data(lh->self)->next;
     while (item) {
         if (lh->query_ctx->query_compare(&lh->query_ctx->data, item))
@@ -184,6 +246,10 @@ void **mpr_list_query_continuation(mpr_list_header_t *lh)
 
 static void free_query_single_ctx(mpr_list_header_t *lh)
 {
+    if (lh->query_ctx->arr_owned) {
+        mpr_obj_arr_free(lh->query_ctx->arr);
+        free(lh->query_ctx->arr);
+    }
     if (cmp_parallel_query == lh->query_ctx->query_compare) {
         // this is a parallel query – we need to free components also
         void *data = &lh->query_ctx->data;
@@ -321,6 +387,9 @@ static void **new_query_internal(const void **list, int size, const void *func,
     lh->query_ctx->size = sizeof(query_info_t)+size;
     lh->query_ctx->query_compare = (query_compare_func_t*)func;
     lh->query_ctx->query_free = (query_free_func_t*)free_query_single_ctx;
+    lh->query_ctx->arr = 0;
+    lh->query_ctx->arr_idx = 0;
+    lh->query_ctx->arr_owned = 0;
     lh->start = (void**)list;
     lh->self = *lh->start;
     return &lh->self;
@@ -340,10 +409,28 @@ mpr_list mpr_list_new_query(const void **list, const void *func,
     return qry;
 }
 
+mpr_list mpr_list_new_arr_query(const void **list, mpr_obj_arr arr,
+                                const void *func, const char *types, ...)
+{
+    va_list aq;
+    va_start(aq, types);
+    int size = get_query_size(types, aq);
+    va_end(aq);
+
+    va_start(aq, types);
+    mpr_list qry = (mpr_list)new_query_internal(list, size, func, types, aq);
+    va_end(aq);
+    if (qry)
+        mpr_list_header_by_self(qry)->query_ctx->arr = arr;
+    return qry;
+}
+
 mpr_list mpr_list_start(mpr_list list)
 {
     RETURN_UNLESS(list, 0);
     mpr_list_header_t *lh = mpr_list_header_by_self(list);
+    if (QUERY_DYNAMIC == lh->query_type && lh->query_ctx->arr)
+        return (mpr_list)arr_query_continuation(lh, lh->query_ctx->arr->num - 1);
     lh->self = *lh->start;
     if (QUERY_DYNAMIC == lh->query_type) {
         if (!*list)
@@ -396,6 +483,20 @@ mpr_obj mpr_list_get_idx(mpr_list list, unsigned int idx)
     RETURN_UNLESS(list, 0);
     mpr_list_header_t *lh = mpr_list_header_by_self(list);
 
+    if (QUERY_DYNAMIC == lh->query_type && lh->query_ctx->arr) {
+        // restart from the newest object
+        query_info_t *q = lh->query_ctx;
+        int i;
+        for (i = q->arr->num - 1; i >= 0; i--) {
+            if (q->query_compare(&q->data, q->arr->objs[i]) && 0 == idx--) {
+                q->arr_idx = i;
+                lh->self = q->arr->objs[i];
+                return lh->self;
+            }
+        }
+        return 0;
+    }
+
     if (0 == idx && *lh->start)
         return *lh->start;
 
@@ -429,6 +530,37 @@ static int cmp_parallel_query(const void *ctx_data, const void *list)
     }
 }
 
+static mpr_obj_arr copy_arr(mpr_obj_arr arr)
+{
+    mpr_obj_arr cpy = (mpr_obj_arr)calloc(1, sizeof(mpr_obj_arr_t));
+    if (arr->num) {
+        cpy->objs = (mpr_obj*)malloc(sizeof(mpr_obj) * arr->num);
+        memcpy(cpy->objs, arr->objs, sizeof(mpr_obj) * arr->num);
+        cpy->num = cpy->size = arr->num;
+    }
+    return cpy;
+}
+
+/*! Make a query walk an array it owns instead of its list. */
+static void set_query_arr(void **qry, mpr_obj_arr arr)
+{
+    RETURN_UNLESS(arr);
+    if (!qry) {
+        mpr_obj_arr_free(arr);
+        free(arr);
+        return;
+    }
+    query_info_t *q = mpr_list_header_by_self(qry)->query_ctx;
+    q->arr = arr;
+    q->arr_owned = 1;
+}
+
+/*! Return the array walked by a query, if any. */
+static mpr_obj_arr query_arr(mpr_list_header_t *lh)
+{
+    return QUERY_DYNAMIC == lh->query_type ? lh->query_ctx->arr : 0;
+}
+
 static mpr_list_header_t *mpr_list_header_cpy(mpr_list_header_t *lh)
 {
     mpr_list_header_t *cpy = (mpr_list_header_t*)malloc(LIST_HEADER_SIZE);
@@ -437,6 +569,8 @@ static mpr_list_header_t *mpr_list_header_cpy(mpr_list_header_t *lh)
 
     cpy->query_ctx = (query_info_t*)malloc(lh->query_ctx->size);
     memcpy(cpy->query_ctx, lh->query_ctx, lh->query_ctx->size);
+    if (cpy->query_ctx->arr_owned)
+        cpy->query_ctx->arr = copy_arr(lh->query_ctx->arr);
 
     if (cmp_parallel_query == cpy->query_ctx->query_compare) {
         // this is a parallel query – we need to copy components
@@ -479,11 +613,19 @@ mpr_list mpr_list_get_isect(mpr_list list1, mpr_list list2)
     mpr_list_header_t *lh2 = mpr_list_header_by_self(list2);
     mpr_list q = mpr_list_new_query((const void **)lh1->start, cmp_parallel_query,
                                     "vvi", &lh1, &lh2, OP_INTERSECTION);
+
+    // the intersection can only contain objects walked by both lists
+    mpr_obj_arr arr1 = query_arr(lh1), arr2 = query_arr(lh2);
+    if (arr1 && (!arr2 || arr1->num <= arr2->num))
+        set_query_arr((void**)q, copy_arr(arr1));
+    else if (arr2)
+        set_query_arr((void**)q, copy_arr(arr2));
     return mpr_list_start(q);
 }
 
-static mpr_list mpr_list_filter_internal(mpr_list list, const void *func,
-                                         const char *types, ...)
+/* If arr is given the result walks it instead of the list. */
+static mpr_list mpr_list_filter_internal(mpr_list list, mpr_obj_arr arr,
+                                         const void *func, const char *types, ...)
 {
     RETURN_UNLESS(list, 0);
     va_list aq;
@@ -498,13 +640,17 @@ static mpr_list mpr_list_filter_internal(mpr_list list, const void *func,
                                        types, aq);
     va_end(aq);
 
-    if (QUERY_STATIC == lh1->query_type)
+    if (QUERY_STATIC == lh1->query_type) {
+        set_query_arr(filter, arr);
         return (mpr_list)filter;
+    }
 
     // return intersection
     mpr_list_header_t *lh2 = mpr_list_header_by_self(filter);
-    return mpr_list_new_query((const void **)lh1->start, cmp_parallel_query,
-                              "vvi", &lh1, &lh2, OP_INTERSECTION);
+    mpr_list q = mpr_list_new_query((const void **)lh1->start, cmp_parallel_query,
+                                    "vvi", &lh1, &lh2, OP_INTERSECTION);
+    set_query_arr((void**)q, arr);
+    return q;
 }
 
 static int match_pattern(const char* s, const char* p)
@@ -512,22 +658,20 @@ static int match_pattern(const char* s, const char* p)
     RETURN_UNLESS(s && p, 1);
     RETURN_UNLESS(strchr(p, '*'), strcmp(s, p));
 
-    // 1) tokenize pattern using strtok() with delimiter character '*'
-    // 2) use strstr() to check if token exists in offset string
-    char *str = (char*)s, *tok;
-    char dup[strlen(p)+1], *pat = dup;
-    strcpy(pat, p);
-    int ends_wild = ('*' == p[strlen(p)-1]);
-    while (str && *str) {
-        tok = strtok(pat, "*");
-        RETURN_UNLESS(tok, !ends_wild);
-        str = strstr(str, tok);
-        if (str && *str)
-            str += strlen(tok);
-        else
-            return 1;
-        // subsequent calls to strtok() need first argument to be NULL
-        pat = NULL;
+    // find each token delimited by '*' in turn, in place in the pattern
+    const char *str = s, *tok = p, *end;
+    int len, ends_wild = ('*' == p[strlen(p)-1]);
+    while (*str) {
+        while ('*' == *tok)
+            ++tok;
+        RETURN_UNLESS(*tok, !ends_wild);
+        end = strchr(tok, '*');
+        len = end ? end - tok : strlen(tok);
+        while (*str && strncmp(str, tok, len))
+            ++str;
+        RETURN_UNLESS(*str, 1);
+        str += len;
+        tok += len;
     }
     return 0;
 }
@@ -596,14 +740,9 @@ static int compare_val(mpr_op op, int len, mpr_type type,
     }
 }
 
-static int filter_by_prop(const void *ctx, mpr_obj o)
+int mpr_list_match_obj(mpr_obj o, mpr_prop p, const char *key, int len,
+                       mpr_type type, const void *val, mpr_op op)
 {
-    mpr_prop p =      *(int*)       (ctx);
-    mpr_op op =       *(int*)       (ctx + sizeof(int));
-    int len =         *(int*)       (ctx + sizeof(int)*2);
-    mpr_type type =   *(mpr_type*)  (ctx + sizeof(int)*3);
-    void *val =       *(void**)     (ctx + sizeof(int)*4);
-    const char *key =  (const char*)(ctx + sizeof(int)*4 + sizeof(void*));
     int _len;
     mpr_type _type;
     const void *_val;
@@ -638,14 +777,470 @@ static int filter_by_prop(const void *ctx, mpr_obj o)
     return compare_val(op, len, type, _val, val);
 }
 
+static int filter_by_prop(const void *ctx, mpr_obj o)
+{
+    mpr_prop p =      *(int*)       (ctx);
+    mpr_op op =       *(int*)       (ctx + sizeof(int));
+    int len =         *(int*)       (ctx + sizeof(int)*2);
+    mpr_type type =   *(mpr_type*)  (ctx + sizeof(int)*3);
+    void *val =       *(void**)     (ctx + sizeof(int)*4);
+    const char *key =  (const char*)(ctx + sizeof(int)*4 + sizeof(void*));
+    return mpr_list_match_obj(o, p, key, len, type, val, op);
+}
+
+/** Property indexes **/
+
+/* Indexes are sorted arrays of the values of one property, built on demand for
+ * properties passed to mpr_list_filter() and rebuilt lazily after the graph
+ * changes. Objects of local devices are left out since their properties are
+ * often written directly, and are always returned as candidates instead. The
+ * filter is still evaluated on every candidate. */
+
+#define MAX_NUM_PROP_IDX 16
+
+typedef struct {
+    mpr_obj obj;
+    union {
+        int64_t i;
+        uint64_t u;
+        double d;
+        const void *p;
+    } val;
+} idx_entry_t;
+
+struct _mpr_prop_idx {
+    struct _mpr_prop_idx *next;
+    mpr_type obj_type;
+    mpr_prop prop;
+    char *key;
+    mpr_type type;
+    int num;
+    int size;
+    idx_entry_t *entries;
+};
+
+typedef int idx_cmp_func_t(const void *l, const void *r);
+
+#define IDX_CMP_FUNC(NAME, FIELD)                                   \
+static int NAME(const void *l, const void *r)                       \
+{                                                                   \
+    const idx_entry_t *a = (const idx_entry_t*)l;                   \
+    const idx_entry_t *b = (const idx_entry_t*)r;                   \
+    return (a->val.FIELD > b->val.FIELD) - (a->val.FIELD < b->val.FIELD); \
+}
+
+IDX_CMP_FUNC(cmp_idx_int, i)
+IDX_CMP_FUNC(cmp_idx_uint, u)
+IDX_CMP_FUNC(cmp_idx_dbl, d)
+IDX_CMP_FUNC(cmp_idx_ptr, p)
+
+static int cmp_idx_str(const void *l, const void *r)
+{
+    return strcmp(((const idx_entry_t*)l)->val.p, ((const idx_entry_t*)r)->val.p);
+}
+
+/*! Return the comparison function for an indexable value type, or zero. */
+static idx_cmp_func_t *idx_cmp_func(mpr_type type)
+{
+    switch (type) {
+        case MPR_INT32:
+        case MPR_TYPE:  return cmp_idx_int;
+        case MPR_INT64:
+        case MPR_TIME:  return cmp_idx_uint;
+        case MPR_FLT:
+        case MPR_DBL:   return cmp_idx_dbl;
+        case MPR_STR:   return cmp_idx_str;
+        case MPR_PTR:
+        case MPR_DEV:
+        case MPR_SIG:
+        case MPR_MAP:
+        case MPR_OBJ:   return cmp_idx_ptr;
+        default:        return 0;
+    }
+}
+
+/* Values are ordered as in compare_val(). */
+static void set_idx_val(idx_entry_t *e, mpr_type type, const void *val)
+{
+    switch (type) {
+        case MPR_INT32: e->val.i = *(int*)val;                      break;
+        case MPR_TYPE:  e->val.i = *(mpr_type*)val;                 break;
+        case MPR_INT64:
+        case MPR_TIME:  memcpy(&e->val.u, val, sizeof(uint64_t));   break;
+        case MPR_FLT:   e->val.d = *(float*)val;                    break;
+        case MPR_DBL:   e->val.d = *(double*)val;                   break;
+        default:        e->val.p = val;                             break;
+    }
+}
+
+static mpr_list *graph_list(mpr_graph g, mpr_type type)
+{
+    switch (type) {
+        case MPR_DEV:   return &g->devs;
+        case MPR_SIG:   return &g->sigs;
+        case MPR_MAP:   return &g->maps;
+        default:        return 0;
+    }
+}
+
+static int obj_is_local(mpr_obj o)
+{
+    int i;
+    switch (o->type) {
+        case MPR_DEV:
+            return ((mpr_dev)o)->loc != 0;
+        case MPR_SIG:
+            return ((mpr_sig)o)->dev->loc != 0;
+        case MPR_MAP: {
+            mpr_map m = (mpr_map)o;
+            RETURN_UNLESS(!m->dst->sig->dev->loc, 1);
+            for (i = 0; i < m->num_src; i++)
+                RETURN_UNLESS(!m->src[i]->sig->dev->loc, 1);
+            return 0;
+        }
+        default:
+            return 0;
+    }
+}
+
+/*! Fill in the index entry of an object, returning zero if it has no value
+ *  of the indexed type. */
+static int get_idx_entry(mpr_prop_idx idx, mpr_obj o, idx_entry_t *e)
+{
+    mpr_prop p;
+    mpr_type type;
+    const void *val;
+    int len;
+    RETURN_UNLESS(!obj_is_local(o), 0);
+    if (idx->key)
+        p = mpr_obj_get_prop_by_key(o, idx->key, &len, &type, &val, 0);
+    else
+        p = mpr_obj_get_prop_by_idx(o, idx->prop, NULL, &len, &type, &val, 0);
+    RETURN_UNLESS(MPR_PROP_UNKNOWN != p && 1 == len && type == idx->type && val, 0);
+    e->obj = o;
+    set_idx_val(e, type, val);
+    return 1;
+}
+
+static void grow_prop_idx(mpr_prop_idx idx)
+{
+    if (idx->num == idx->size) {
+        idx->size = idx->size ? idx->size * 2 : 64;
+        idx->entries = realloc(idx->entries, sizeof(idx_entry_t) * idx->size);
+    }
+}
+
+static void build_prop_idx(mpr_graph g, mpr_prop_idx idx)
+{
+    mpr_list l = mpr_list_from_data(*graph_list(g, idx->obj_type));
+    idx->num = 0;
+    while (l) {
+        grow_prop_idx(idx);
+        idx->num += get_idx_entry(idx, (mpr_obj)*l, &idx->entries[idx->num]);
+        l = mpr_list_get_next(l);
+    }
+    qsort(idx->entries, idx->num, sizeof(idx_entry_t), idx_cmp_func(idx->type));
+}
+
+static int idx_bound(mpr_prop_idx idx, const idx_entry_t *e, int upper);
+
+/* Entries are found by a scan for their object, since a string value may
+ * already have been freed, so that no comparison is made against them. */
+static void remove_idx_entry(mpr_prop_idx idx, mpr_obj o)
+{
+    int i;
+    for (i = 0; i < idx->num && idx->entries[i].obj != o; i++) {}
+    RETURN_UNLESS(i < idx->num);
+    --idx->num;
+    memmove(&idx->entries[i], &idx->entries[i + 1], sizeof(idx_entry_t) * (idx->num - i));
+}
+
+static void insert_idx_entry(mpr_prop_idx idx, mpr_obj o)
+{
+    idx_entry_t e;
+    int i;
+    RETURN_UNLESS(get_idx_entry(idx, o, &e));
+    grow_prop_idx(idx);
+    i = idx_bound(idx, &e, 1);
+    memmove(&idx->entries[i + 1], &idx->entries[i], sizeof(idx_entry_t) * (idx->num - i));
+    idx->entries[i] = e;
+    ++idx->num;
+}
+
+void mpr_list_update_prop_idx(mpr_graph g, mpr_obj o, mpr_graph_evt e)
+{
+    mpr_prop_idx idx;
+    int i;
+    // indexes built later start from the current state of the graph
+    RETURN_UNLESS(g->prop_idx);
+    if (MPR_OBJ_REM == e) {
+        // the object is about to be freed
+        if (o->idx_stale) {
+            mpr_obj_arr_remove(g->idx_stale, o);
+            o->idx_stale = 0;
+        }
+        for (idx = g->prop_idx; idx; idx = idx->next) {
+            if (idx->obj_type == o->type)
+                remove_idx_entry(idx, o);
+        }
+    }
+    else if (!o->idx_stale) {
+        if (!g->idx_stale)
+            g->idx_stale = (mpr_obj_arr)calloc(1, sizeof(mpr_obj_arr_t));
+        mpr_obj_arr_add(g->idx_stale, o);
+        o->idx_stale = 1;
+    }
+    RETURN_UNLESS(MPR_OBJ_MOD != e);
+
+    // the signal and map counts of the objects they belong to change with them
+    if (MPR_SIG == o->type)
+        mpr_list_update_prop_idx(g, (mpr_obj)((mpr_sig)o)->dev, MPR_OBJ_MOD);
+    else if (MPR_MAP == o->type) {
+        mpr_map m = (mpr_map)o;
+        for (i = 0; i <= m->num_src; i++) {
+            mpr_slot slot = i < m->num_src ? m->src[i] : m->dst;
+            mpr_list_update_prop_idx(g, (mpr_obj)slot->sig, MPR_OBJ_MOD);
+            mpr_list_update_prop_idx(g, (mpr_obj)slot->sig->dev, MPR_OBJ_MOD);
+        }
+    }
+}
+
+/* Remove the entries of all queued objects before inserting any of them, so
+ * that the binary searches only compare current values. */
+static void update_prop_idx(mpr_graph g)
+{
+    mpr_prop_idx idx;
+    mpr_obj *objs;
+    int i, num;
+    RETURN_UNLESS(g->idx_stale && g->idx_stale->num);
+    objs = g->idx_stale->objs;
+    num = g->idx_stale->num;
+    for (idx = g->prop_idx; idx; idx = idx->next) {
+        if (num * 16 > idx->num) {
+            // each update scans the index, so rebuild it after many changes
+            build_prop_idx(g, idx);
+            continue;
+        }
+        for (i = 0; i < num; i++) {
+            if (idx->obj_type == objs[i]->type)
+                remove_idx_entry(idx, objs[i]);
+        }
+        for (i = 0; i < num; i++) {
+            if (idx->obj_type == objs[i]->type)
+                insert_idx_entry(idx, objs[i]);
+        }
+    }
+    for (i = 0; i < num; i++)
+        objs[i]->idx_stale = 0;
+    g->idx_stale->num = 0;
+}
+
+static mpr_prop_idx get_prop_idx(mpr_graph g, mpr_type obj_type, mpr_prop p,
+                                 const char *key, mpr_type type)
+{
+    mpr_prop_idx idx = g->prop_idx;
+    int count = 0;
+    update_prop_idx(g);
+    for (; idx; idx = idx->next, ++count) {
+        if (idx->obj_type != obj_type || idx->type != type)
+            continue;
+        if (key ? (idx->key && !strcmp(idx->key, key)) : (!idx->key && idx->prop == p))
+            break;
+    }
+    if (!idx) {
+        RETURN_UNLESS(count < MAX_NUM_PROP_IDX, 0);
+        idx = (mpr_prop_idx)calloc(1, sizeof(struct _mpr_prop_idx));
+        idx->obj_type = obj_type;
+        idx->prop = p;
+        idx->key = key ? strdup(key) : 0;
+        idx->type = type;
+        idx->next = g->prop_idx;
+        g->prop_idx = idx;
+        build_prop_idx(g, idx);
+    }
+    return idx;
+}
+
+/*! Find the first entry not less than (or, if upper, greater than) a value. */
+static int idx_bound(mpr_prop_idx idx, const idx_entry_t *e, int upper)
+{
+    idx_cmp_func_t *cmp = idx_cmp_func(idx->type);
+    int lo = 0, hi = idx->num, mid, c;
+    while (lo < hi) {
+        mid = (lo + hi) / 2;
+        c = cmp(&idx->entries[mid], e);
+        if (c < 0 || (upper && 0 == c))
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+static void add_local_objs(mpr_graph g, mpr_type obj_type, mpr_obj_arr arr)
+{
+    mpr_list devs = mpr_list_from_data(g->devs);
+    mpr_dev dev;
+    int i, j;
+    while (devs) {
+        dev = (mpr_dev)*devs;
+        devs = mpr_list_get_next(devs);
+        if (!dev->loc)
+            continue;
+        if (MPR_DEV == obj_type)
+            mpr_obj_arr_add(arr, (mpr_obj)dev);
+        else if (MPR_SIG == obj_type) {
+            for (i = 0; i < dev->sigs.num; i++)
+                mpr_obj_arr_add(arr, dev->sigs.objs[i]);
+        }
+        else {
+            // maps between local devices are listed by each of them
+            int num = arr->num;
+            for (i = 0; i < dev->maps.num; i++) {
+                for (j = 0; j < num && arr->objs[j] != dev->maps.objs[i]; j++) {}
+                if (j == num)
+                    mpr_obj_arr_add(arr, dev->maps.objs[i]);
+            }
+        }
+    }
+}
+
+/*! Return the candidates for a filter on one of a graph's object lists from
+ *  its property index, or zero if the filter cannot use an index. */
+static mpr_obj_arr prop_idx_candidates(mpr_graph g, mpr_type obj_type, mpr_prop p,
+                                       const char *key, int len, mpr_type type,
+                                       const void *val, mpr_op op)
+{
+    RETURN_UNLESS(1 == len && val && idx_cmp_func(type), 0);
+    if (MPR_STR == type || cmp_idx_ptr == idx_cmp_func(type)) {
+        RETURN_UNLESS(MPR_OP_EQ == op, 0);
+    }
+    else {
+        RETURN_UNLESS(MPR_OP_EQ == op || MPR_OP_GT == op || MPR_OP_GTE == op
+                      || MPR_OP_LT == op || MPR_OP_LTE == op, 0);
+    }
+    if (key && !key[0])
+        key = 0;
+    else if (key)
+        p = MPR_PROP_UNKNOWN;
+    mpr_prop_idx idx = get_prop_idx(g, obj_type, p, key, type);
+    RETURN_UNLESS(idx, 0);
+
+    mpr_obj_arr arr = (mpr_obj_arr)calloc(1, sizeof(mpr_obj_arr_t));
+    add_local_objs(g, obj_type, arr);
+
+    int i, j, lo = 0, hi = idx->num;
+    if (MPR_STR == type && strchr((const char*)val, '*')) {
+        // match the pattern once for each distinct value
+        for (i = 0; i < idx->num; i = j) {
+            const char *s = (const char*)idx->entries[i].val.p;
+            for (j = i + 1; j < idx->num && !strcmp(idx->entries[j].val.p, s); j++) {}
+            if (0 == match_pattern(s, (const char*)val)) {
+                for (; i < j; i++)
+                    mpr_obj_arr_add(arr, idx->entries[i].obj);
+            }
+        }
+        return arr;
+    }
+
+    idx_entry_t e;
+    set_idx_val(&e, type, val);
+    switch (op) {
+        case MPR_OP_EQ:
+            lo = idx_bound(idx, &e, 0);
+            hi = idx_bound(idx, &e, 1);
+            break;
+        case MPR_OP_GT:     lo = idx_bound(idx, &e, 1);     break;
+        case MPR_OP_GTE:    lo = idx_bound(idx, &e, 0);     break;
+        case MPR_OP_LT:     hi = idx_bound(idx, &e, 0);     break;
+        case MPR_OP_LTE:    hi = idx_bound(idx, &e, 1);     break;
+        default:                                            break;
+    }
+    for (i = lo; i < hi; i++)
+        mpr_obj_arr_add(arr, idx->entries[i].obj);
+    return arr;
+}
+
+/*! Put index candidates in the order of the graph list, so that indexed
+ *  filters return objects in the same order as unindexed ones. Candidates are
+ *  marked and picked up by a walk of the list; since arrays are walked
+ *  downwards, the first object of the list is placed last. */
+static void order_candidates(mpr_list head, mpr_obj_arr arr)
+{
+    mpr_list l;
+    int i, j = arr->num;
+    RETURN_UNLESS(arr->num > 1);
+    l = mpr_list_from_data(head);
+    for (i = 0; i < arr->num; i++)
+        arr->objs[i]->idx_mark = 1;
+    for (; l && j > 0; l = mpr_list_get_next(l)) {
+        mpr_obj o = (mpr_obj)*l;
+        if (o->idx_mark) {
+            o->idx_mark = 0;
+            arr->objs[--j] = o;
+        }
+    }
+    // duplicate candidates leave unused entries at the start
+    if (j) {
+        arr->num -= j;
+        memmove(arr->objs, arr->objs + j, sizeof(mpr_obj) * arr->num);
+    }
+}
+
+/*! Choose the objects a filter on a list should walk: candidates from a
+ *  property index if the list covers one of the graph's object lists, or the
+ *  array the list already walks if that is smaller. */
+static mpr_obj_arr filter_candidates(mpr_list_header_t *lh, mpr_prop p,
+                                     const char *key, int len, mpr_type type,
+                                     const void *val, mpr_op op)
+{
+    mpr_obj_arr arr = 0, cur = query_arr(lh);
+    mpr_obj o = (lh->start && *lh->start) ? (mpr_obj)*lh->start : 0;
+    mpr_list *head = o ? graph_list(o->graph, o->type) : 0;
+    if (head) {
+        // static lists must start at the head of the graph list
+        if (QUERY_STATIC == lh->query_type ? (*head == (mpr_list)o)
+                                           : ((void**)lh->start == (void**)head))
+            arr = prop_idx_candidates(o->graph, o->type, p, key, len, type, val, op);
+    }
+    if (cur && (!arr || cur->num < arr->num)) {
+        if (arr) {
+            mpr_obj_arr_free(arr);
+            free(arr);
+        }
+        arr = copy_arr(cur);
+    }
+    else if (arr)
+        order_candidates(*head, arr);
+    return arr;
+}
+
+void mpr_list_free_prop_idx(mpr_graph g)
+{
+    mpr_prop_idx idx;
+    while ((idx = g->prop_idx)) {
+        g->prop_idx = idx->next;
+        FUNC_IF(free, idx->key);
+        FUNC_IF(free, idx->entries);
+        free(idx);
+    }
+    if (g->idx_stale) {
+        mpr_obj_arr_free(g->idx_stale);
+        free(g->idx_stale);
+        g->idx_stale = 0;
+    }
+}
+
 mpr_list mpr_list_filter(mpr_list list, mpr_prop p, const char *key, int len,
                          mpr_type type, const void *val, mpr_op op)
 {
     int mask = MPR_OP_ALL | MPR_OP_ANY;
     if (!list || op <= MPR_OP_UNDEFINED || (op | mask) > (MPR_OP_NEQ | mask))
         return list;
-    mpr_list q = mpr_list_filter_internal(list, filter_by_prop, "iiicvs", p, op,
-                                          len, type, &val, key);
+    mpr_list_header_t *lh = mpr_list_header_by_self(list);
+    mpr_obj_arr arr = filter_candidates(lh, p, key, len, type, val, op);
+    mpr_list q = mpr_list_filter_internal(list, arr, filter_by_prop, "iiicvs", p,
+                                          op, len, type, &val, key);
     return mpr_list_start(q);
 }
 
@@ -657,6 +1252,8 @@ mpr_list mpr_list_get_diff(mpr_list list1, mpr_list list2)
     mpr_list_header_t *lh2 = mpr_list_header_by_self(list2);
     mpr_list q = mpr_list_new_query((const void **)lh1->start, cmp_parallel_query,
                                     "vvi", &lh1, &lh2, OP_DIFFERENCE);
+    if (query_arr(lh1))
+        set_query_arr((void**)q, copy_arr(query_arr(lh1)));
     return mpr_list_start(q);
 }
 
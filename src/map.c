@@ -65,6 +65,28 @@ static int _cmp_qry_scopes(const void *ctx, mpr_dev d)
     return 0;
 }
 
+static void _add_to_dev(mpr_dev d, mpr_map m)
+{
+    if (mpr_obj_arr_find(&d->maps, (mpr_obj)m) < 0)
+        mpr_obj_arr_add(&d->maps, (mpr_obj)m);
+}
+
+void mpr_map_add_to_devs(mpr_map m)
+{
+    int i;
+    _add_to_dev(m->dst->sig->dev, m);
+    for (i = 0; i < m->num_src; i++)
+        _add_to_dev(m->src[i]->sig->dev, m);
+}
+
+void mpr_map_remove_from_devs(mpr_map m)
+{
+    int i;
+    mpr_obj_arr_remove(&m->dst->sig->dev->maps, (mpr_obj)m);
+    for (i = 0; i < m->num_src; i++)
+        mpr_obj_arr_remove(&m->src[i]->sig->dev->maps, (mpr_obj)m);
+}
+
 void mpr_map_init(mpr_map m)
 {
     m->obj.props.mask = 0;
@@ -77,6 +99,7 @@ void mpr_map_init(mpr_map m)
                  MODIFIABLE | INDIRECT | LOCAL_ACCESS_ONLY);
     mpr_tbl_link(t, PROP(EXPR), 1, MPR_STR, &m->expr_str, MODIFIABLE | INDIRECT);
     mpr_tbl_link(t, PROP(ID), 1, MPR_INT64, &m->obj.id, NON_MODIFIABLE | LOCAL_ACCESS_ONLY);
+    mpr_tbl_link(t, PROP(JIT), 1, MPR_BOOL, &m->jit, NON_MODIFIABLE | LOCAL_ACCESS_ONLY);
     mpr_tbl_link(t, PROP(MUTED), 1, MPR_BOOL, &m->muted, MODIFIABLE);
     mpr_tbl_link(t, PROP(NUM_SIGS_IN), 1, MPR_INT32, &m->num_src, NON_MODIFIABLE);
     mpr_tbl_link(t, PROP(PROCESS_LOC), 1, MPR_INT32, &m->process_loc, MODIFIABLE);
@@ -104,6 +127,7 @@ void mpr_map_init(mpr_map m)
     for (i = 0; i < m->num_src; i++)
         mpr_slot_init(m->src[i]);
     mpr_slot_init(m->dst);
+    mpr_map_add_to_devs(m);
 }
 
 mpr_map mpr_map_new(int num_src, mpr_sig *src, int num_dst, mpr_sig *dst)
@@ -171,13 +195,16 @@ mpr_map mpr_map_new(int num_src, mpr_sig *src, int num_dst, mpr_sig *dst)
             o = (mpr_obj)mpr_graph_add_sig(g, src[order[i]]->obj.name, src[order[i]]->dev->obj.name, 0);
             if (!o->id) {
                 o->id = src[order[i]]->obj.id;
+                mpr_graph_reindex_obj(g, o);
                 ((mpr_sig)o)->dir = src[order[i]]->dir;
                 ((mpr_sig)o)->len = src[order[i]]->len;
                 ((mpr_sig)o)->type = src[order[i]]->type;
             }
             mpr_dev d = ((mpr_sig)o)->dev;
-            if (!d->obj.id)
+            if (!d->obj.id) {
                 d->obj.id = src[order[i]]->dev->obj.id;
+                mpr_graph_reindex_obj(g, (mpr_obj)d);
+            }
         }
         m->src[i]->sig = (mpr_sig)o;
         m->src[i]->obj.id = i;
@@ -190,6 +217,7 @@ mpr_map mpr_map_new(int num_src, mpr_sig *src, int num_dst, mpr_sig *dst)
         m->obj.id = mpr_dev_generate_unique_id((*dst)->dev);
 
     mpr_map_init(m);
+    mpr_graph_reindex_obj(g, (mpr_obj)m);
     m->status = MPR_STATUS_STAGED;
     m->protocol = MPR_PROTO_UDP;
     ++g->staged_maps;
@@ -433,42 +461,209 @@ int mpr_map_perform(mpr_map m, mpr_type *types, mpr_time *time, int inst_idx)
                           time, types, inst_idx));
 }
 
+/* Grow the scratch buffers used by mpr_map_perform_batch(). They are sized for
+ * all local instances when the map values are allocated so this is normally a
+ * no-op. */
+static void _alloc_scratch(mpr_map m, int num_inst)
+{
+    mpr_local_map lm = m->loc;
+    RETURN_UNLESS(num_inst > lm->scratch_size);
+    lm->types = realloc(lm->types, num_inst * m->dst->sig->len * sizeof(mpr_type));
+    lm->status = realloc(lm->status, num_inst * sizeof(int));
+    lm->scratch_size = num_inst;
+}
+
+// only called for outgoing maps
+void mpr_map_perform_batch(mpr_map m, mpr_time *time, const int *inst_idx, int num_inst)
+{
+    int i, *status;
+
+    _alloc_scratch(m, num_inst);
+    status = m->loc->status;
+    memset(status, 0, sizeof(int) * num_inst);
+    RETURN_UNLESS(MPR_STATUS_ACTIVE == m->status && !m->muted);
+
+    if (!m->loc->expr) {
+        trace("error: missing expression.\n");
+        return;
+    }
+
+    mpr_value src[m->num_src];
+    for (i = 0; i < m->num_src; i++)
+        src[i] = &m->src[i]->loc->val;
+    mpr_expr_eval_batch(m->loc->expr, src, &m->loc->vars, &m->dst->loc->val,
+                        time, m->loc->types, inst_idx, num_inst, status);
+}
+
 /*! Build a value update message for a given map. */
+/* Add an argument of each type in the string, with the instance and slot labels
+ * in front of their ids. The values are overwritten by mpr_map_build_msg(). */
+static lo_message _new_msg(const char *types)
+{
+    NEW_LO_MSG(msg, return 0);
+    for (; *types; types++) {
+        switch (*types) {
+        case MPR_INT32: lo_message_add_int32(msg, 0);   break;
+        case MPR_FLT:   lo_message_add_float(msg, 0);   break;
+        case MPR_DBL:   lo_message_add_double(msg, 0);  break;
+        case MPR_NULL:  lo_message_add_nil(msg);        break;
+        case 'h':       lo_message_add_int64(msg, 0);   break;
+        case LO_CHAR:   lo_message_add_char(msg, 0);    break;
+        case 's':
+            // the instance label precedes the int64 id, the slot label the slot
+            lo_message_add_string(msg, 'h' == types[1] ? "@in" : "@sl");
+            break;
+        default:                                        break;
+        }
+    }
+    return msg;
+}
+
 lo_message mpr_map_build_msg(mpr_map m, mpr_slot slot, const void *val,
-                             mpr_type *types, mpr_id_map idmap)
+                             mpr_type *types, mpr_id_map idmap, mpr_link link,
+                             int bundle_idx)
 {
-    int i;
+    int i, j = 0, compact = mpr_protocol_is_compact(m->protocol);
     int len = ((MPR_LOC_SRC == m->process_loc) ? m->dst->sig->len : slot->sig->len);
-    NEW_LO_MSG(msg, return 0);
+    int has_id = m->use_inst && idmap;
+    int has_slot = MPR_LOC_DST == m->process_loc && MPR_DIR_OUT == m->dst->dir;
+    mpr_link l = link ? link : m->dst->link;
+    char msg_types[len + 5];
+
+    // only use the compact encoding with peers that have advertised it
+    if (compact && !(l && mpr_link_get_has_protocol(l, m->protocol)))
+        compact = 0;
 
     if (val && types) {
         // value of vector elements can be <type> or NULL
         for (i = 0; i < len; i++) {
             switch (types[i]) {
-            case MPR_INT32: lo_message_add_int32(msg, ((int*)val)[i]);     break;
-            case MPR_FLT:   lo_message_add_float(msg, ((float*)val)[i]);   break;
-            case MPR_DBL:   lo_message_add_double(msg, ((double*)val)[i]); break;
-            case MPR_NULL:  lo_message_add_nil(msg);                       break;
-            default:                                                       break;
+            case MPR_INT32:
+            case MPR_FLT:
+            case MPR_DBL:
+            case MPR_NULL:  msg_types[j++] = types[i];  break;
+            default:                                    break;
             }
         }
     }
     else if (m->use_inst) {
         for (i = 0; i < len; i++)
-            lo_message_add_nil(msg);
+            msg_types[j++] = MPR_NULL;
     }
-    if (m->use_inst && idmap) {
-        lo_message_add_string(msg, "@in");
-        lo_message_add_int64(msg, idmap->GID);
+    /* With a compact protocol the ids are identified by their type alone:
+     * vector elements are never int64 or char. Slot ids are assigned from a
+     * counter on the destination signal that grows with every map made to it,
+     * so only ids that fit in a char are sent unlabelled; larger ones use the
+     * labelled int32 form. */
+    int compact_slot = compact && has_slot && slot->obj.id <= 255;
+    if (has_id) {
+        if (!compact)
+            msg_types[j++] = 's';
+        msg_types[j++] = 'h';
+    }
+    if (has_slot) {
+        if (compact_slot)
+            msg_types[j++] = LO_CHAR;
+        else {
+            msg_types[j++] = 's';
+            msg_types[j++] = MPR_INT32;
+        }
     }
-    if (MPR_LOC_DST == m->process_loc && MPR_DIR_OUT == m->dst->dir) {
-        // add slot
-        lo_message_add_string(msg, "@sl");
-        lo_message_add_int32(msg, slot->obj.id);
+    msg_types[j] = 0;
+
+    /* Reuse a queued-and-sent message of the same shape if possible, and only
+     * overwrite its arguments. */
+    lo_message msg = link ? mpr_link_get_msg(link, msg_types, bundle_idx) : 0;
+    if (!msg) {
+        msg = _new_msg(msg_types);
+        RETURN_UNLESS(msg, 0);
+        if (link)
+            mpr_link_pool_msg(link, msg, bundle_idx);
+    }
+    RETURN_UNLESS(j, msg);
+
+    lo_arg **argv = lo_message_get_argv(msg);
+    j = 0;
+    if (val && types) {
+        for (i = 0; i < len; i++) {
+            switch (types[i]) {
+            case MPR_INT32: argv[j++]->i = ((int*)val)[i];      break;
+            case MPR_FLT:   argv[j++]->f = ((float*)val)[i];    break;
+            case MPR_DBL:   argv[j++]->d = ((double*)val)[i];   break;
+            case MPR_NULL:  ++j;                                break;
+            default:                                            break;
+            }
+        }
+    }
+    else if (m->use_inst)
+        j = len;
+    if (has_id) {
+        j += !compact;
+        argv[j++]->h = idmap->GID;
+    }
+    if (has_slot) {
+        if (compact_slot)
+            argv[j]->c = slot->obj.id;
+        else
+            argv[j + 1]->i = slot->obj.id;
     }
     return msg;
 }
 
+int mpr_map_pack_msg(mpr_map m, mpr_slot slot, const void *val, mpr_type *types,
+                     mpr_id_map idmap, mpr_time t, int bundle_idx)
+{
+    RETURN_UNLESS(mpr_protocol_is_packed(m->protocol), 0);
+    RETURN_UNLESS(m->use_inst && idmap && val && types, 0);
+    // fall back to single updates for peers that have not advertised the protocol
+    RETURN_UNLESS(mpr_link_get_has_protocol(m->dst->link, m->protocol), 0);
+    int i, slot_id = -1;
+    int len = ((MPR_LOC_SRC == m->process_loc) ? m->dst->sig->len : slot->sig->len);
+
+    // tuples cannot carry partial vectors
+    for (i = 0; i < len; i++)
+        RETURN_UNLESS(types[i] != MPR_NULL, 0);
+
+    if (MPR_LOC_DST == m->process_loc && MPR_DIR_OUT == m->dst->dir)
+        slot_id = slot->obj.id;
+    // int64 id and vector, plus one type tag for each
+    int size = 8 + len * mpr_type_get_size(types[0]) + 1 + len;
+    lo_message msg = mpr_link_get_packed_msg(m->dst->link, m->dst->sig, m->dst->alias, slot_id,
+                                             t, m->protocol, size, bundle_idx);
+    RETURN_UNLESS(msg, 0);
+
+    lo_message_add_int64(msg, idmap->GID);
+    for (i = 0; i < len; i++) {
+        switch (types[i]) {
+        case MPR_INT32: lo_message_add_int32(msg, ((int*)val)[i]);     break;
+        case MPR_FLT:   lo_message_add_float(msg, ((float*)val)[i]);   break;
+        case MPR_DBL:   lo_message_add_double(msg, ((double*)val)[i]); break;
+        default:                                                       break;
+        }
+    }
+    return 1;
+}
+
+void mpr_map_send(mpr_map m, mpr_slot slot, const void *val, mpr_type *types,
+                  mpr_id_map idmap, mpr_slot to, mpr_time t, int bundle_idx)
+{
+    mpr_link link = to->link;
+    if (link->local_dev == link->remote_dev) {
+        // releases only apply to instanced maps
+        RETURN_UNLESS(val || m->use_inst);
+        int len = ((MPR_LOC_SRC == m->process_loc) ? m->dst->sig->len : slot->sig->len);
+        int has_slot = MPR_LOC_DST == m->process_loc && MPR_DIR_OUT == m->dst->dir;
+        mpr_link_add_local_msg(link, to->sig, val ? types : 0, val, len,
+                               m->use_inst && idmap ? idmap->GID : 0,
+                               has_slot ? slot->obj.id : -1, t, bundle_idx);
+        return;
+    }
+    if (to == m->dst && mpr_map_pack_msg(m, slot, val, types, idmap, t, bundle_idx))
+        return;
+    lo_message msg = mpr_map_build_msg(m, slot, val, types, idmap, link, bundle_idx);
+    mpr_link_add_msg(link, to->sig, to->alias, msg, t, m->protocol, bundle_idx);
+}
+
 void mpr_map_alloc_values(mpr_map m)
 {
     // If there is no expression or the processing is remote, then no memory needs to be (re)allocated.
@@ -550,6 +745,7 @@ void mpr_map_alloc_values(mpr_map m)
     lm->var_names = var_names;
     lm->num_vars = num_vars;
     lm->num_inst = num_inst;
+    _alloc_scratch(m, num_inst);
 }
 
 /* Helper to replace a map's expression only if the given string
@@ -565,8 +761,18 @@ static int _replace_expr_str(mpr_map m, const char *expr_str)
         src_types[i] = m->src[i]->sig->type;
         src_lens[i] = m->src[i]->sig->len;
     }
-    mpr_expr expr = mpr_expr_new_from_str(expr_str, m->num_src, src_types, src_lens,
-                                          m->dst->sig->type, m->dst->sig->len);
+    mpr_expr expr;
+    mpr_rtr rtr = m->loc->rtr;
+    if (rtr) {
+        // maps with identical expressions and signal types share compiled code
+        if (!rtr->expr_cache)
+            rtr->expr_cache = mpr_expr_cache_new();
+        expr = mpr_expr_cache_get(rtr->expr_cache, expr_str, m->num_src, src_types,
+                                  src_lens, m->dst->sig->type, m->dst->sig->len);
+    }
+    else
+        expr = mpr_expr_new_from_str(expr_str, m->num_src, src_types, src_lens,
+                                     m->dst->sig->type, m->dst->sig->len);
     RETURN_UNLESS(expr, 1);
 
     // expression update may force processing location to change
@@ -584,6 +790,8 @@ static int _replace_expr_str(mpr_map m, const char *expr_str)
     }
     FUNC_IF(mpr_expr_free, m->loc->expr);
     m->loc->expr = expr;
+    if (m->jit)
+        mpr_expr_set_jit(expr, 1);
 
     if (m->expr_str == expr_str)
         return 0;
@@ -1031,10 +1239,31 @@ static void _check_status(mpr_map m)
     return;
 }
 
+void mpr_map_set_jit(mpr_map m, int enable)
+{
+    m->jit = enable ? 1 : 0;
+    if (m->loc && m->loc->expr)
+        mpr_expr_set_jit(m->loc->expr, m->jit);
+}
+
+int mpr_map_set_direct(mpr_map m, int direct)
+{
+    int i, num = 0;
+    RETURN_UNLESS(m->loc, 0);
+    if (m->dst->link)
+        num += mpr_link_set_direct(m->dst->link, direct);
+    for (i = 0; i < m->num_src; i++) {
+        if (m->src[i]->link)
+            num += mpr_link_set_direct(m->src[i]->link, direct);
+    }
+    return num;
+}
+
 // if 'override' flag is not set, only remote properties can be set
 int mpr_map_set_from_msg(mpr_map m, mpr_msg msg, int override)
 {
     int i, j, updated = 0, should_compile = 0;
+    mpr_id id = m->obj.id;
     mpr_tbl tbl;
     mpr_msg_atom a;
     if (!msg)
@@ -1190,9 +1419,12 @@ int mpr_map_set_from_msg(mpr_map m, mpr_msg msg, int override)
                     updated += _remove_scope(m, &(a->vals[j])->s);
                 break;
             case PROP(PROTOCOL): {
+                /* Ignore protocols we do not know so that peers keep using a
+                 * format that both sides understand. */
                 mpr_proto pro = mpr_protocol_from_str(&(a->vals[0])->s);
-                updated += mpr_tbl_set(tbl, PROP(PROTOCOL), NULL, 1, MPR_INT32,
-                                       &pro, REMOTE_MODIFY);
+                if (MPR_PROTO_UNDEFINED != pro)
+                    updated += mpr_tbl_set(tbl, PROP(PROTOCOL), NULL, 1, MPR_INT32,
+                                           &pro, REMOTE_MODIFY);
                 break;
             }
             case PROP(USE_INST): {
@@ -1270,6 +1502,8 @@ int mpr_map_set_from_msg(mpr_map m, mpr_msg msg, int override)
         }
     }
 done:
+    if (m->obj.id != id)
+        mpr_graph_reindex_obj(m->obj.graph, (mpr_obj)m);
     if (m->loc && m->status < MPR_STATUS_READY) {
         // check if mapping is now "ready"
         _check_status(m);
@@ -1346,16 +1580,20 @@ int mpr_map_send_state(mpr_map m, int slot, net_msg_t cmd)
     /* source properties */
     i = (slot >= 0) ? slot : 0;
     link = m->src[i]->loc ? m->src[i]->link : 0;
+    mpr_link peer = link;
     for (; i < m->num_src; i++) {
         if ((slot >= 0) && link && (link != m->src[i]->link))
             break;
+        if (peer != m->src[i]->link)
+            peer = 0;
         if (MSG_MAPPED == cmd || (MPR_DIR_OUT == m->dst->dir))
-            mpr_slot_add_props_to_msg(msg, m->src[i], 0, staged);
+            mpr_slot_add_props_to_msg(msg, m->src[i], 0, staged, m->dst->link);
     }
 
-    /* destination properties */
+    /* destination properties; path aliases are only announced for the
+     * destination when all of the sources in this message share a link */
     if (MSG_MAPPED == cmd || (MPR_DIR_IN == m->dst->dir))
-        mpr_slot_add_props_to_msg(msg, m->dst, 1, staged);
+        mpr_slot_add_props_to_msg(msg, m->dst, 1, staged, peer);
 
     // add public expression variables
     int j, k, l;
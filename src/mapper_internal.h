@@ -136,6 +136,13 @@ void mpr_dev_remove_link(mpr_dev dev, mpr_dev rem);
 int mpr_dev_handler(const char *path, const char *types, lo_arg **argv, int argc,
                     lo_message msg, void *data);
 
+/*! Handle an update queued on a loopback link, without parsing a message.
+ *  \param val          The vector value, or 0 for an instance release.
+ *  \param GID          Instance id, or 0 for none.
+ *  \param slot_idx     Destination slot id, or -1 for none. */
+int mpr_dev_handle_local(mpr_sig sig, const mpr_type *types, void *val, int len,
+                         mpr_id GID, int slot_idx);
+
 int mpr_dev_bundle_start(lo_timetag t, void *data);
 
 inline static void mpr_dev_LID_incref(mpr_dev dev, mpr_id_map map)
@@ -160,6 +167,16 @@ void mpr_dev_add_sig_methods(mpr_dev dev, mpr_sig sig);
 
 void mpr_dev_remove_sig_methods(mpr_dev dev, mpr_sig sig);
 
+/*! Get the path alias announced to the peer of a link for data messages to a
+ *  local signal, assigning a free one if necessary. Released aliases are not
+ *  assigned again until a quarantine period has passed.
+ *  \return             The alias number, or 0 if none can be used. */
+int mpr_dev_get_alias(mpr_dev dev, mpr_sig sig, mpr_link link);
+
+/*! Release the path aliases of a local device matching a signal and a link.
+ *  A null signal or link matches any. */
+void mpr_dev_release_aliases(mpr_dev dev, mpr_sig sig, mpr_link link);
+
 void mpr_dev_release_scope(mpr_dev dev, const char *scope);
 
 mpr_id_map mpr_dev_add_idmap(mpr_dev dev, int group, mpr_id LID, mpr_id GID);
@@ -168,6 +185,9 @@ mpr_id_map mpr_dev_get_idmap_by_LID(mpr_dev dev, int group, mpr_id LID);
 
 mpr_id_map mpr_dev_get_idmap_by_GID(mpr_dev dev, int group, mpr_id GID);
 
+/*! Rebuild the device's id map indexes, e.g. after changing id map GIDs. */
+void mpr_dev_reindex_idmaps(mpr_dev dev);
+
 const char *mpr_dev_get_name(mpr_dev dev);
 
 void mpr_dev_send_state(mpr_dev dev, net_msg_t cmd);
@@ -178,6 +198,15 @@ void mpr_dev_send_state(mpr_dev dev, net_msg_t cmd);
  *  \return             Information about the link, or zero if not found. */
 mpr_link mpr_dev_get_link_by_remote(mpr_dev dev, mpr_dev remote);
 
+/*! Check whether a map has a source or destination on a device.
+ *  \param dev          Device record to query.
+ *  \param map          The map to check.
+ *  \param dir          MPR_DIR_IN for maps into the device, MPR_DIR_OUT for maps
+ *                      out of it, MPR_DIR_ANY for either or MPR_DIR_BOTH for
+ *                      maps with all of their ends on the device.
+ *  \return             1 if the map matches, 0 otherwise. */
+int mpr_dev_has_map(mpr_dev dev, mpr_map map, mpr_dir dir);
+
 /*! Look up information for a registered object using its unique id.
  *  \param g            The graph to query.
  *  \param type         The type of object to return.
@@ -191,8 +220,19 @@ mpr_obj mpr_graph_get_obj(mpr_graph g, mpr_type type, mpr_id id);
  *  \return             Information about the device, or zero if not found. */
 mpr_dev mpr_graph_get_dev_by_name(mpr_graph g, const char *name);
 
+/*! Find a signal of a device by name.
+ *  \param g            The graph to query.
+ *  \param dev          The device owning the signal.
+ *  \param name         Name of the signal, without a leading slash.
+ *  \return             Information about the signal, or zero if not found. */
+mpr_sig mpr_graph_get_sig_by_name(mpr_graph g, mpr_dev dev, const char *name);
+
 mpr_map mpr_graph_get_map_by_names(mpr_graph g, int num_src, const char **srcs, const char *dst);
 
+/*! Add a device, signal or map to the graph's id and name indexes, or move it
+ *  after its id or name has changed. */
+void mpr_graph_reindex_obj(mpr_graph g, mpr_obj o);
+
 /*! Call registered graph callbacks for a given object type.
  *  \param g            The graph to query.
  *  \param o            The object to pass to the callbacks.
@@ -214,6 +254,12 @@ void mpr_rtr_remove_inst(mpr_rtr rtr, mpr_sig sig, int idx);
  *  destinations. */
 void mpr_rtr_process_sig(mpr_rtr r, mpr_sig s, int inst_idx, const void *val, mpr_time t);
 
+/*! As mpr_rtr_process_sig() for several updated instances of a signal, using
+ *  their current values. Each map is looked up and evaluated once for all of
+ *  the instances. */
+void mpr_rtr_process_sig_batch(mpr_rtr r, mpr_sig s, const int *idmap_idxs, int num_inst,
+                               mpr_time t);
+
 void mpr_rtr_add_map(mpr_rtr r, mpr_map m);
 
 void mpr_rtr_remove_link(mpr_rtr r, mpr_link l);
@@ -226,7 +272,7 @@ int mpr_rtr_loop_check(mpr_rtr r, mpr_sig s, int n_remote, const char **remote);
 
 /**** Signals ****/
 
-#define MPR_MAX_VECTOR_LEN 128
+#define MPR_MAX_VECTOR_LEN 512
 
 /*! Initialize an already-allocated mpr_sig structure. */
 void mpr_sig_init(mpr_sig s, mpr_dir dir, const char *name, int len,
@@ -289,6 +335,15 @@ int mpr_sig_get_idmap_with_GID(mpr_sig s, mpr_id GID, int flags, mpr_time t, int
 /*! Release a specific signal instance. */
 void mpr_sig_release_inst_internal(mpr_sig s, int inst_idx);
 
+/*! Mark a signal instance as inactive and return it to the reserve. */
+void mpr_sig_deactivate_inst(mpr_sig s, mpr_sig_inst si);
+
+/*! Record that an active signal instance was updated, for instance stealing. */
+void mpr_sig_touch_inst(mpr_sig s, mpr_sig_inst si);
+
+/*! Rebuild the signal's LID and GID indexes, e.g. after changing id map GIDs. */
+void mpr_sig_reindex_idmaps(mpr_sig s);
+
 /**** Links ****/
 
 mpr_link mpr_link_new(mpr_dev local_dev, mpr_dev remote_dev);
@@ -303,9 +358,45 @@ void mpr_link_remove_map(mpr_link link, mpr_map rem);
 void mpr_link_init(mpr_link link);
 void mpr_link_connect(mpr_link link, const char *host, int admin_port,
                       int data_port);
+
+/*! Choose whether data bundles for this link are serialised directly into a
+ *  buffer as messages are added and sent with a single system call, or built
+ *  and sent using liblo. UDP bundles are sent from the socket of the local UDP
+ *  server and TCP bundles over a connection of the link's own. Direct
+ *  serialisation requires a resolved address and is enabled by default. The
+ *  choice is also exposed as the local-only link property "direct".
+ *  \return             1 if the link is local, 0 otherwise. */
+int mpr_link_set_direct(mpr_link link, int direct);
+
+/*! Check whether a property key names the "direct" link property. */
+int mpr_link_get_is_direct_key(const char *key);
 void mpr_link_free(mpr_link link);
 int mpr_link_process_bundles(mpr_link link, mpr_time t, int idx);
-void mpr_link_add_msg(mpr_link link, mpr_sig dst, lo_message msg, mpr_time t, mpr_proto proto, int idx);
+void mpr_link_add_msg(mpr_link link, mpr_sig dst, int alias, lo_message msg, mpr_time t,
+                      mpr_proto proto, int idx);
+void mpr_link_add_local_msg(mpr_link link, mpr_sig dst, const mpr_type *types, const void *val,
+                            int len, mpr_id GID, int slot, mpr_time t, int idx);
+
+/*! Check whether the remote device of a link can receive data sent using
+ *  protocol pro. Only the plain protocols are assumed for devices that have
+ *  not advertised their protocols. */
+int mpr_link_get_has_protocol(mpr_link link, mpr_proto pro);
+
+/*! Get the pending packed message for signal dst and slot, with room for size
+ *  more bytes. A message that would grow past the maximum size is moved into
+ *  the bundle and a new one is started. Messages are addressed to the path
+ *  alias of the destination if it is not 0.
+ *  \return             The message, or 0 if the update cannot be packed. */
+lo_message mpr_link_get_packed_msg(mpr_link link, mpr_sig dst, int alias, int slot,
+                                   mpr_time t, mpr_proto proto, int size, int idx);
+
+/*! Find an unused pooled message with the given type string and mark it used
+ *  until the bundle at index idx has been processed.
+ *  \return             The message, or 0 if none is available. */
+lo_message mpr_link_get_msg(mpr_link link, const char *types, int idx);
+
+/*! Add a new message to the pool for the bundle at index idx, marked used. */
+void mpr_link_pool_msg(mpr_link link, lo_message msg, int idx);
 
 mpr_link mpr_graph_add_link(mpr_graph g, mpr_dev dev1, mpr_dev dev2);
 
@@ -324,24 +415,86 @@ void mpr_map_alloc_values(mpr_map map);
  *  \return             Zero if the operation was muted, one if performed. */
 int mpr_map_perform(mpr_map map, mpr_type *typestring, mpr_time *time, int inst);
 
+/*! Process several signal instances in a single pass. The typestring and
+ *  status of each instance, as returned by mpr_map_perform(), are left in the
+ *  scratch buffers map->loc->types and map->loc->status.
+ *  \param map          The mapping process to perform.
+ *  \param time         Timestamp for this update.
+ *  \param inst         Array of indices of the signal instances to process.
+ *  \param num_inst     Number of signal instances to process. */
+void mpr_map_perform_batch(mpr_map map, mpr_time *time, const int *inst, int num_inst);
+
+/*! Build a signal data message for a map.
+ *  \param link         The link the message will be sent on, used to reuse a
+ *                      pooled message, or 0 to allocate a new one.
+ *  \param bundle_idx   Index of the bundle the message will be added to.
+ *  \return             The message. */
 lo_message mpr_map_build_msg(mpr_map map, mpr_slot slot, const void *val,
-                             mpr_type *types, mpr_id_map idmap);
+                             mpr_type *types, mpr_id_map idmap, mpr_link link,
+                             int bundle_idx);
+
+/*! Add an instance update to the packed message for the map destination if the
+ *  map uses a packed protocol.
+ *  \return            1 if the update was packed, 0 if the caller should send
+ *                      it using mpr_map_build_msg() instead. */
+int mpr_map_pack_msg(mpr_map map, mpr_slot slot, const void *val, mpr_type *types,
+                     mpr_id_map idmap, mpr_time t, int bundle_idx);
+
+/*! Queue a signal update, or an instance release if val is 0, for a map on
+ *  the link of slot to. Loopback updates are handed to the destination signal
+ *  directly, others are packed or sent as a message built for the map.
+ *  \param to           The slot whose signal and link receive the update. */
+void mpr_map_send(mpr_map map, mpr_slot slot, const void *val, mpr_type *types,
+                  mpr_id_map idmap, mpr_slot to, mpr_time t, int bundle_idx);
 
 /*! Set a mapping's properties based on message parameters. */
 int mpr_map_set_from_msg(mpr_map map, mpr_msg msg, int override);
 
+/*! Enable or disable native code for a map's expression. This is a local
+ *  choice made by the process evaluating the map and is not sent to peers. */
+void mpr_map_set_jit(mpr_map map, int enable);
+
+/*! Choose direct serialisation for the links used by a local map, see
+ *  mpr_link_set_direct(). The links are shared by all maps between the same
+ *  devices. This is a local choice and is not sent to peers.
+ *  \return             The number of links updated. */
+int mpr_map_set_direct(mpr_map map, int direct);
+
 const char *mpr_loc_as_str(mpr_loc loc);
 mpr_loc mpr_loc_from_str(const char *string);
 
 const char *mpr_protocol_as_str(mpr_proto pro);
 mpr_proto mpr_protocol_from_str(const char *string);
 
+/*! Helpers for the transport and data encoding of a map protocol. */
+inline static int mpr_protocol_is_udp(mpr_proto pro)
+{
+    return (MPR_PROTO_UDP == pro || MPR_PROTO_UDP_PACKED == pro
+            || MPR_PROTO_UDP_COMPACT == pro);
+}
+
+inline static int mpr_protocol_is_packed(mpr_proto pro)
+{
+    return MPR_PROTO_UDP_PACKED == pro || MPR_PROTO_TCP_PACKED == pro;
+}
+
+inline static int mpr_protocol_is_compact(mpr_proto pro)
+{
+    return MPR_PROTO_UDP_COMPACT == pro || MPR_PROTO_TCP_COMPACT == pro;
+}
+
 const char *mpr_steal_as_str(mpr_steal_type stl);
 
 int mpr_map_send_state(mpr_map map, int slot, net_msg_t cmd);
 
 void mpr_map_init(mpr_map map);
 
+/*! Add a map to the map arrays of the devices owning its signals, once per
+ *  device. Called again when sources are added to an existing map. */
+void mpr_map_add_to_devs(mpr_map map);
+
+void mpr_map_remove_from_devs(mpr_map map);
+
 void mpr_map_free(mpr_map map);
 
 /**** Slot ****/
@@ -359,7 +512,7 @@ void mpr_slot_free_value(mpr_slot slot);
 int mpr_slot_set_from_msg(mpr_slot slot, mpr_msg msg);
 
 void mpr_slot_add_props_to_msg(lo_message msg, mpr_slot slot, int is_dest,
-                               int staged);
+                               int staged, mpr_link link);
 
 int mpr_slot_match_full_name(mpr_slot slot, const char *full_name);
 
@@ -462,6 +615,10 @@ int mpr_expr_get_var_is_public(mpr_expr expr, int idx);
 
 int mpr_expr_get_manages_inst(mpr_expr expr);
 
+/*! Get the number of tokens in an expression before and after optimization,
+ *  for debugging and testing the optimizer. Either pointer may be 0. */
+void mpr_expr_get_token_counts(mpr_expr expr, int *parsed, int *optimized);
+
 #ifdef DEBUG
 void printexpr(const char*, mpr_expr);
 #endif
@@ -485,10 +642,195 @@ void printexpr(const char*, mpr_expr);
 int mpr_expr_eval(mpr_expr expr, mpr_value *srcs, mpr_value *expr_vars,
                   mpr_value result, mpr_time *t, mpr_type *types, int inst_idx);
 
+/*! Evaluate an expression by interpreting its token stack directly instead of
+ *  running the compiled instruction stream. Arguments and results are the same
+ *  as for mpr_expr_eval(); this is kept as a reference implementation. */
+int mpr_expr_eval_interp(mpr_expr expr, mpr_value *srcs, mpr_value *expr_vars,
+                         mpr_value result, mpr_time *t, mpr_type *types,
+                         int inst_idx);
+
+/*! Evaluate an expression for several instances in a single pass.
+ *  \param inst_idx     Array of indices of the instances being updated.
+ *  \param n_inst       Number of instances to evaluate.
+ *  \param types        An array of mpr_type with room for n_inst * vector
+ *                      length entries, or 0.
+ *  \param status       An array for storing the result of evaluating each
+ *                      instance, as returned by mpr_expr_eval().
+ *  Other arguments are the same as for mpr_expr_eval(). */
+void mpr_expr_eval_batch(mpr_expr expr, mpr_value *srcs, mpr_value *expr_vars,
+                         mpr_value result, mpr_time *t, mpr_type *types,
+                         const int *inst_idx, int n_inst, int *status);
+
+/*! Enable or disable evaluation using native code. This is only available
+ *  if libmapper was configured with --enable-jit on an x86-64 host.
+ *  \param expr         The expression to use.
+ *  \param enable       1 to generate native code, 0 to release it.
+ *  \return             1 if the expression will be evaluated using native
+ *                      code, 0 otherwise. */
+int mpr_expr_set_jit(mpr_expr expr, int enable);
+
 int mpr_expr_get_num_input_slots(mpr_expr expr);
 
 void mpr_expr_free(mpr_expr expr);
 
+/*! Create a cache of compiled expressions. */
+mpr_expr_cache mpr_expr_cache_new(void);
+
+/*! Free a cache. Expressions retrieved from it remain valid until freed. */
+void mpr_expr_cache_free(mpr_expr_cache cache);
+
+/*! Get the number of distinct expressions held in a cache. */
+int mpr_expr_cache_get_size(mpr_expr_cache cache);
+
+/*! Retrieve an expression from the cache, parsing and compiling it only if no
+ *  expression with the same string, input and output types and vector lengths
+ *  has been cached. The returned expression shares its immutable parts with
+ *  other users and must be released with mpr_expr_free(). */
+mpr_expr mpr_expr_cache_get(mpr_expr_cache cache, const char *str, int num_in,
+                            const mpr_type *in_types, const int *in_vec_lens,
+                            mpr_type out_type, int out_vec_len);
+
+/**** Vector kernels ****/
+
+/*! Elementwise operations available as vector kernels. */
+typedef enum {
+    MPR_VEC_NONE = 0,
+    MPR_VEC_ADD,
+    MPR_VEC_SUB,
+    MPR_VEC_MUL,
+    MPR_VEC_DIV,
+    MPR_VEC_EQ,
+    MPR_VEC_NE,
+    MPR_VEC_LT,
+    MPR_VEC_LE,
+    MPR_VEC_GT,
+    MPR_VEC_GE,
+    MPR_VEC_AND,
+    MPR_VEC_OR,
+    MPR_VEC_BAND,
+    MPR_VEC_BOR,
+    MPR_VEC_BXOR,
+    MPR_VEC_MIN,
+    MPR_VEC_MAX,
+    MPR_VEC_ABS,
+    MPR_VEC_SQRT,
+    MPR_VEC_FLOOR,
+    MPR_VEC_CEIL,
+    MPR_VEC_TRUNC,
+    /* approximations of the libm functions, keep these last */
+    MPR_VEC_SIN,
+    MPR_VEC_COS,
+    MPR_VEC_EXP,
+    MPR_VEC_LOG,
+    MPR_VEC_N_FN
+} mpr_vec_op;
+
+/*! Reductions available as vector kernels. */
+typedef enum {
+    MPR_VEC_SUM,
+    MPR_VEC_VMAX,
+    MPR_VEC_VMIN,
+    MPR_VEC_ALL,
+    MPR_VEC_ANY,
+    MPR_VEC_N_REDUCE
+} mpr_vec_reduce_op;
+
+/*! Binary kernels compute dst[i] = dst[i] OP src[i], unary kernels compute
+ *  dst[i] = OP(src[i]). In both cases dst and src may be the same array. */
+typedef void mpr_vec_fn(void *dst, const void *src, int len);
+
+/*! Reduction kernels store a single value of the array type in result. */
+typedef void mpr_vec_reduce_fn(const void *src, int len, void *result);
+
+/*! Get the fastest kernel supported by the host CPU for an elementwise
+ *  operation on contiguous arrays of the given type.
+ *  \param op           The operation.
+ *  \param type         The array type: MPR_INT32, MPR_FLT, or MPR_DBL.
+ *  \return             The kernel, or NULL if the operation is not
+ *                      available for this type. */
+mpr_vec_fn *mpr_vec_get_fn(mpr_vec_op op, mpr_type type);
+
+/*! Get the fastest kernel supported by the host CPU for a reduction over a
+ *  contiguous array of the given type.
+ *  \param op           The reduction.
+ *  \param type         The array type: MPR_INT32, MPR_FLT, or MPR_DBL.
+ *  \return             The kernel, or NULL if the type is not supported. */
+mpr_vec_reduce_fn *mpr_vec_get_reduce_fn(mpr_vec_reduce_op op, mpr_type type);
+
+/**** JIT ****/
+
+/* The native code emitter is only available when libmapper is configured
+ * with --enable-jit on an x86-64 host. */
+
+/*! x86-64 general purpose registers, also used to number xmm registers. */
+typedef enum {
+    MPR_JIT_RAX = 0,
+    MPR_JIT_RCX,
+    MPR_JIT_RDX,
+    MPR_JIT_RBX,
+    MPR_JIT_RSP,
+    MPR_JIT_RBP,
+    MPR_JIT_RSI,
+    MPR_JIT_RDI,
+    MPR_JIT_R8,
+    MPR_JIT_R9,
+    MPR_JIT_R10,
+    MPR_JIT_R11,
+    MPR_JIT_R12,
+    MPR_JIT_R13,
+    MPR_JIT_R14,
+    MPR_JIT_R15
+} mpr_jit_reg;
+
+/*! Condition codes for mpr_jit_jmp(). */
+#define MPR_JIT_ALWAYS  -1
+#define MPR_JIT_EQ      0x4
+#define MPR_JIT_NE      0x5
+
+/*! A growable buffer of machine code. */
+typedef struct {
+    unsigned char *code;
+    size_t len;
+    size_t size;
+    int failed;
+} mpr_jit_buf_t, *mpr_jit_buf;
+
+void mpr_jit_init(mpr_jit_buf buf);
+
+/*! Emit an instruction with a [base + disp32] memory operand.
+ *  \param prefix       Mandatory prefix byte (e.g. 0xF2 for scalar double
+ *                      SSE instructions), or 0 for none.
+ *  \param opcode       One or two opcode bytes, e.g. 0x8B or 0x0F58.
+ *  \param w            Non-zero for a 64-bit operand size.
+ *  \param reg          The register operand or opcode extension.
+ *  \param base         The base register of the memory operand.
+ *  \param disp         The displacement of the memory operand. */
+void mpr_jit_op_mem(mpr_jit_buf buf, int prefix, int opcode, int w, int reg,
+                    int base, int32_t disp);
+
+/*! Emit an instruction with two register operands. */
+void mpr_jit_op_reg(mpr_jit_buf buf, int opcode, int w, int reg, int rm);
+
+void mpr_jit_push(mpr_jit_buf buf, int reg);
+void mpr_jit_pop(mpr_jit_buf buf, int reg);
+void mpr_jit_mov_imm64(mpr_jit_buf buf, int reg, uint64_t imm);
+void mpr_jit_store_imm32(mpr_jit_buf buf, int base, int32_t disp, uint32_t imm);
+void mpr_jit_call(mpr_jit_buf buf, int reg);
+void mpr_jit_jmp_reg(mpr_jit_buf buf, int reg);
+
+/*! Emit a relative jump to an offset in the buffer.
+ *  \param cond         A condition code, or MPR_JIT_ALWAYS. */
+void mpr_jit_jmp(mpr_jit_buf buf, int cond, size_t target);
+
+void mpr_jit_ret(mpr_jit_buf buf);
+
+/*! Copy the contents of a buffer to executable memory and reset the buffer.
+ *  \return             The executable code, or NULL on failure. */
+void *mpr_jit_finalize(mpr_jit_buf buf);
+
+/*! Release code returned by mpr_jit_finalize(). */
+void mpr_jit_free(void *code);
+
 /**** String tables ****/
 
 /*! Create a new string table. */
@@ -573,6 +915,34 @@ mpr_list mpr_list_new_query(const void **list, const void *func,
 
 mpr_list mpr_list_start(mpr_list list);
 
+/*! Create a query over an object array instead of a graph list. The array is
+ *  walked from the newest object; list is the graph list holding the same
+ *  objects, which is used when the query is combined with other queries. */
+mpr_list mpr_list_new_arr_query(const void **list, mpr_obj_arr arr,
+                                const void *func, const mpr_type *types, ...);
+
+void mpr_obj_arr_add(mpr_obj_arr arr, mpr_obj o);
+
+/*! Return the index of an object in an array, or -1 if it is not present. */
+int mpr_obj_arr_find(mpr_obj_arr arr, mpr_obj o);
+
+void mpr_obj_arr_remove(mpr_obj_arr arr, mpr_obj o);
+
+void mpr_obj_arr_free(mpr_obj_arr arr);
+
+/*! Free the property indexes built for filtering a graph's lists. */
+void mpr_list_free_prop_idx(mpr_graph g);
+
+/*! Update the property index entries of an object after event e. Removed
+ *  objects are dropped from the indexes immediately, others are queued and
+ *  updated before the next index lookup. */
+void mpr_list_update_prop_idx(mpr_graph g, mpr_obj o, mpr_graph_evt e);
+
+/*! Check a single object against a property filter, with the same semantics
+ *  as mpr_list_filter(). */
+int mpr_list_match_obj(mpr_obj o, mpr_prop p, const char *key, int len,
+                       mpr_type type, const void *val, mpr_op op);
+
 /**** Time ****/
 
 /*! Get the current time. */
@@ -663,6 +1033,13 @@ inline static int check_sig_length(int length)
     return (length < 1 || length > MPR_MAX_VECTOR_LEN);
 }
 
+/*! Helper to hash an instance id for the LID and GID indexes. */
+inline static unsigned int mpr_id_hash(mpr_id id, int group)
+{
+    id = (id ^ (mpr_id)group) * 0x9E3779B97F4A7C15ULL;
+    return (unsigned int)(id >> 32);
+}
+
 /*! Helper to check if bitfields match completely. */
 inline static int bitmatch(unsigned int a, unsigned int b)
 {
@@ -548,6 +548,7 @@ static void mpr_net_probe_dev_name(mpr_net net, mpr_dev dev)
 
     /* Calculate an id from the name and store it in id.val */
     dev->obj.id = (mpr_id) crc32(0L, (const Bytef *)name, strlen(name)) << 32;
+    mpr_graph_reindex_obj(dev->obj.graph, (mpr_obj)dev);
 
     /* For the same reason, we can't use mpr_net_send() here. */
     lo_send(net->addr.bus, net_msg_strings[MSG_NAME_PROBE], "si", name, net->random_id);
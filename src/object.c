@@ -126,6 +126,27 @@ mpr_prop mpr_obj_set_prop(mpr_obj o, mpr_prop p, const char *s, int len,
         p = mpr_prop_from_str(s);
     }
 
+    if (MPR_PROP_JIT == MASK_PROP_BITFLAGS(p)) {
+        // native code generation is local to this process and never staged
+        RETURN_UNLESS((o->type & MPR_MAP) && 1 == len && val, 0);
+        RETURN_UNLESS(MPR_BOOL == type || MPR_INT32 == type, 0);
+        mpr_map_set_jit((mpr_map)o, *(int*)val);
+        return MPR_PROP_JIT;
+    }
+
+    if (MPR_PROP_EXTRA == MASK_PROP_BITFLAGS(p) && mpr_link_get_is_direct_key(s)
+        && (o->type & (MPR_MAP | MPR_LINK))) {
+        // direct serialisation is local to this process and never staged
+        RETURN_UNLESS(1 == len && val, 0);
+        RETURN_UNLESS(MPR_BOOL == type || MPR_INT32 == type, 0);
+        int num = (  MPR_LINK == o->type ? mpr_link_set_direct((mpr_link)o, *(int*)val)
+                   : mpr_map_set_direct((mpr_map)o, *(int*)val));
+        return num ? MPR_PROP_EXTRA : 0;
+    }
+
+    if (o->graph)
+        mpr_list_update_prop_idx(o->graph, o, MPR_OBJ_MOD);
+
     // check if object represents local resource
     int local = o->props.staged ? 0 : 1;
     int flags = local ? LOCAL_MODIFY : REMOTE_MODIFY;
@@ -138,6 +159,8 @@ mpr_prop mpr_obj_set_prop(mpr_obj o, mpr_prop p, const char *s, int len,
 int mpr_obj_remove_prop(mpr_obj o, mpr_prop p, const char *s)
 {
     RETURN_UNLESS(o, 0);
+    if (o->graph)
+        mpr_list_update_prop_idx(o->graph, o, MPR_OBJ_MOD);
     // check if object represents local resource
     int local = o->props.staged ? 0 : 1;
     if (MPR_PROP_UNKNOWN == p)
@@ -66,6 +66,8 @@ const static_prop_t static_props[] = {
     { "@version",       1, MPR_INT32, MPR_INT32 }, /* MPR_PROP_VERSION */
     { "@extra",         0, 'a', 'a' }, /* MPR_PROP_EXTRA (special case, does not
                                            * represent a specific property name) */
+    { "@jit",           1, MPR_BOOL,  MPR_BOOL },  /* MPR_PROP_JIT (local only, not
+                                                    * looked up by name) */
 };
 
 const char* mpr_loc_strings[] =
@@ -81,6 +83,10 @@ const char* mpr_protocol_strings[] =
     NULL,           /* MPR_PROTO_UNDEFINED */
     "osc.udp",      /* MPR_PROTO_UDP */
     "osc.tcp",      /* MPR_PROTO_TCP */
+    "osc.udp.packed",   /* MPR_PROTO_UDP_PACKED */
+    "osc.tcp.packed",   /* MPR_PROTO_TCP_PACKED */
+    "osc.udp.compact",  /* MPR_PROTO_UDP_COMPACT */
+    "osc.tcp.compact",  /* MPR_PROTO_TCP_COMPACT */
 };
 
 const char *mpr_steal_strings[] =
@@ -88,6 +94,8 @@ const char *mpr_steal_strings[] =
     "none",         /* MPR_STEAL_NONE */
     "oldest",       /* MPR_STEAL_OLDEST */
     "newest",       /* MPR_STEAL_NEWEST */
+    "stalest",      /* MPR_STEAL_STALEST */
+    "quietest",     /* MPR_STEAL_QUIETEST */
 };
 
 int mpr_parse_names(const char *string, char **devnameptr, char **signameptr)
@@ -383,34 +391,96 @@ void mpr_msg_add_typed_val(lo_message msg, int len, mpr_type type,
 const char *mpr_prop_as_str(mpr_prop p, int skip_slash)
 {
     p = MASK_PROP_BITFLAGS(p);
-    die_unless(p > MPR_PROP_UNKNOWN && p <= MPR_PROP_EXTRA,
+    die_unless(p > MPR_PROP_UNKNOWN && p <= MPR_PROP_JIT,
                "called mpr_prop_as_str() with bad index %d.\n", p);
     const char *s = static_props[PROP_TO_INDEX(p)].key;
     return skip_slash ? s + 1 : s;
 }
 
+/* Static property keys and their aliases are interned in a constant table
+ * indexed by a seeded FNV-1a hash, so lookups need no initialisation and are
+ * safe from any thread. The seed and table size were chosen so that every key
+ * gets its own slot, making a lookup a single string comparison. Keys looked up
+ * by name must be added here; choose a new seed if the new key's slot is
+ * already taken. MPR_PROP_JIT is local only and is not looked up by name. */
+#define PROP_HASH_SEED 32
+#define PROP_HASH_SIZE 256
+#define PROP_HASH_ALIAS(idx) (PROP_TO_INDEX(MPR_PROP_EXTRA) + idx)
+
+static const struct {
+    const char *key;
+    mpr_prop prop;
+} prop_aliases[] = {
+    { "expression", MPR_PROP_EXPR },
+    { "maximum",    MPR_PROP_MAX },
+    { "minimum",    MPR_PROP_MIN },
+};
+
+static const unsigned char prop_hash_tbl[PROP_HASH_SIZE] = {
+    [  7] = PROP_TO_INDEX(MPR_PROP_EXPR),            /* expr */
+    [ 16] = PROP_TO_INDEX(MPR_PROP_NUM_SIGS_OUT),    /* num_sigs_out */
+    [ 24] = PROP_TO_INDEX(MPR_PROP_IS_LOCAL),        /* is_local */
+    [ 27] = PROP_TO_INDEX(MPR_PROP_PORT),            /* port */
+    [ 29] = PROP_TO_INDEX(MPR_PROP_ID),              /* id */
+    [ 34] = PROP_TO_INDEX(MPR_PROP_RATE),            /* rate */
+    [ 37] = PROP_TO_INDEX(MPR_PROP_NUM_MAPS_OUT),    /* num_maps_out */
+    [ 40] = PROP_TO_INDEX(MPR_PROP_DATA),            /* data */
+    [ 44] = PROP_HASH_ALIAS(2),                      /* minimum */
+    [ 66] = PROP_TO_INDEX(MPR_PROP_STATUS),          /* status */
+    [ 67] = PROP_TO_INDEX(MPR_PROP_NUM_SIGS_IN),     /* num_sigs_in */
+    [ 68] = PROP_TO_INDEX(MPR_PROP_SCOPE),           /* scope */
+    [ 71] = PROP_TO_INDEX(MPR_PROP_CALIB),           /* calib */
+    [ 84] = PROP_TO_INDEX(MPR_PROP_PROTOCOL),        /* protocol */
+    [ 87] = PROP_TO_INDEX(MPR_PROP_MUTED),           /* muted */
+    [ 91] = PROP_TO_INDEX(MPR_PROP_INST),            /* instance */
+    [ 97] = PROP_TO_INDEX(MPR_PROP_PERIOD),          /* period */
+    [108] = PROP_TO_INDEX(MPR_PROP_VERSION),         /* version */
+    [110] = PROP_TO_INDEX(MPR_PROP_UNIT),            /* unit */
+    [118] = PROP_TO_INDEX(MPR_PROP_JITTER),          /* jitter */
+    [124] = PROP_TO_INDEX(MPR_PROP_LIBVER),          /* lib_version */
+    [129] = PROP_TO_INDEX(MPR_PROP_DIR),             /* direction */
+    [136] = PROP_TO_INDEX(MPR_PROP_TYPE),            /* type */
+    [138] = PROP_TO_INDEX(MPR_PROP_DEV),             /* device */
+    [139] = PROP_TO_INDEX(MPR_PROP_STEAL_MODE),      /* steal */
+    [146] = PROP_TO_INDEX(MPR_PROP_HOST),            /* host */
+    [148] = PROP_TO_INDEX(MPR_PROP_USE_INST),        /* use_inst */
+    [154] = PROP_TO_INDEX(MPR_PROP_SYNCED),          /* synced */
+    [158] = PROP_TO_INDEX(MPR_PROP_NUM_MAPS),        /* num_maps */
+    [162] = PROP_HASH_ALIAS(0),                      /* expression */
+    [163] = PROP_TO_INDEX(MPR_PROP_NAME),            /* name */
+    [172] = PROP_TO_INDEX(MPR_PROP_SLOT),            /* slot */
+    [174] = PROP_HASH_ALIAS(1),                      /* maximum */
+    [180] = PROP_TO_INDEX(MPR_PROP_SIG),             /* signal */
+    [187] = PROP_TO_INDEX(MPR_PROP_NUM_INST),        /* num_instances */
+    [188] = PROP_TO_INDEX(MPR_PROP_LEN),             /* length */
+    [192] = PROP_TO_INDEX(MPR_PROP_PROCESS_LOC),     /* process_loc */
+    [209] = PROP_TO_INDEX(MPR_PROP_LINKED),          /* linked */
+    [224] = PROP_TO_INDEX(MPR_PROP_NUM_MAPS_IN),     /* num_maps_in */
+    [229] = PROP_TO_INDEX(MPR_PROP_ORDINAL),         /* ordinal */
+    [238] = PROP_TO_INDEX(MPR_PROP_MAX),             /* max */
+    [252] = PROP_TO_INDEX(MPR_PROP_MIN),             /* min */
+};
+
+static unsigned int prop_hash(const char *str)
+{
+    unsigned int hash = PROP_HASH_SEED;
+    while (*str)
+        hash = (hash ^ (unsigned char)*str++) * 16777619u;
+    return hash & (PROP_HASH_SIZE - 1);
+}
+
+static const char *prop_hash_key(int i)
+{
+    int num_props = PROP_TO_INDEX(MPR_PROP_EXTRA);
+    return i < num_props ? static_props[i].key + 1 : prop_aliases[i - num_props].key;
+}
+
 mpr_prop mpr_prop_from_str(const char *string)
 {
-    // property keys are stored alphabetically so we can use a binary search
-    int beg = PROP_TO_INDEX(MPR_PROP_UNKNOWN) + 1;
-    int end = PROP_TO_INDEX(MPR_PROP_EXTRA) - 1;
-    int mid = (beg + end) * 0.5, cmp;
-    while (beg <= end) {
-        cmp = strcmp(string, static_props[mid].key + 1);
-        if (cmp > 0)
-            beg = mid + 1;
-        else if (cmp == 0)
-            return INDEX_TO_PROP(mid);
-        else
-            end = mid - 1;
-        mid = (beg + end) * 0.5;
-    }
-    if (strcmp(string, "expression")==0)
-        return MPR_PROP_EXPR;
-    if (strcmp(string, "maximum")==0)
-        return MPR_PROP_MAX;
-    if (strcmp(string, "minimum")==0)
-        return MPR_PROP_MIN;
+    int num_props = PROP_TO_INDEX(MPR_PROP_EXTRA);
+    int i = prop_hash_tbl[prop_hash(string)];
+    if (i && 0 == strcmp(string, prop_hash_key(i)))
+        return i < num_props ? INDEX_TO_PROP(i) : prop_aliases[i - num_props].prop;
     return MPR_PROP_EXTRA;
 }
 
@@ -434,7 +504,7 @@ mpr_loc mpr_loc_from_str(const char *str)
 
 const char *mpr_protocol_as_str(mpr_proto p)
 {
-    if (p <= 0 || p > MPR_NUM_PROTO)
+    if (p <= 0 || p >= MPR_NUM_PROTO)
         return "unknown";
     return mpr_protocol_strings[p];
 }
@@ -452,7 +522,7 @@ mpr_proto mpr_protocol_from_str(const char *str)
 
 const char *mpr_steal_as_str(mpr_steal_type stl)
 {
-    if (stl < MPR_STEAL_NONE || stl > MPR_STEAL_NEWEST)
+    if (stl < MPR_STEAL_NONE || stl > MPR_STEAL_QUIETEST)
         return "unknown";
     return mpr_steal_strings[stl];
 }
@@ -19,12 +19,9 @@ static int _is_map_in_scope(mpr_map map, mpr_id id)
     return 0;
 }
 
-static mpr_rtr_sig _find_rtr_sig(mpr_rtr rtr, mpr_sig sig)
+static inline mpr_rtr_sig _find_rtr_sig(mpr_rtr rtr, mpr_sig sig)
 {
-    mpr_rtr_sig rs = rtr->sigs;
-    while (rs && rs->sig != sig)
-        rs = rs->next;
-    return rs;
+    return sig->loc ? sig->loc->rsig : NULL;
 }
 
 void mpr_rtr_remove_inst(mpr_rtr rtr, mpr_sig sig, int inst_idx) {
@@ -79,6 +76,64 @@ static void _update_map_count(mpr_rtr rtr)
     dev->num_maps_out = dev_maps_out;
 }
 
+/* Evaluate a map for several instances of a local source signal and send the
+ * resulting updates and releases to its destination. */
+static void _perform_and_send(mpr_rtr rtr, mpr_map map, mpr_slot slot, mpr_sig sig,
+                              mpr_id_map idmap, int map_manages_inst, const int *idmap_idxs,
+                              const int *inst_idxs, int n_inst, mpr_time t, uint8_t bundle_idx)
+{
+    struct _mpr_sig_idmap *idmaps = sig->loc->idmaps;
+    mpr_slot dst_slot = map->dst;
+    mpr_slot to = (map->process_loc == MPR_LOC_SRC ? dst_slot : slot);
+    int k, *status;
+
+    mpr_map_perform_batch(map, &t, inst_idxs, n_inst);
+    status = map->loc->status;
+
+    for (k = 0; k < n_inst; k++) {
+        if (!status[k]) {
+            // no updates or releases
+            continue;
+        }
+        int idmap_idx = idmap_idxs[k], inst_idx = inst_idxs[k];
+        mpr_type *types = map->loc->types + k * to->sig->len;
+        /* send instance release if dst is instanced and either src or map is also instanced. */
+        if (idmap && status[k] & EXPR_RELEASE_BEFORE_UPDATE && map->use_inst) {
+            mpr_map_send(map, slot, 0, 0, sig->use_inst ? idmaps[idmap_idx].map : idmap,
+                         dst_slot, t, bundle_idx);
+            if (map_manages_inst) {
+                mpr_dev_LID_decref(rtr->dev, 0, idmap);
+                idmap = map->idmap = 0;
+            }
+        }
+        if (status[k] & EXPR_UPDATE) {
+            // send instance update
+            void *result = mpr_value_get_samp(&dst_slot->loc->val, inst_idx);
+            mpr_time *tt = mpr_value_get_time(&dst_slot->loc->val, inst_idx);
+            mpr_id_map upd = idmaps[idmap_idx].map;
+            if (map_manages_inst) {
+                if (!idmap) {
+                    // create an id_map and store it in the map
+                    mpr_id GID = mpr_dev_generate_unique_id(sig->dev);
+                    idmap = map->idmap = mpr_dev_add_idmap(sig->dev, 0, 0, GID);
+                }
+                upd = map->idmap;
+            }
+            mpr_map_send(map, slot, result, types, upd, dst_slot, *tt, bundle_idx);
+        }
+        /* send instance release if dst is instanced and either src or map
+         * is also instanced. */
+        if (idmap && status[k] & EXPR_RELEASE_AFTER_UPDATE && map->use_inst) {
+            mpr_map_send(map, slot, 0, 0, sig->use_inst ? idmaps[idmap_idx].map : idmap,
+                         dst_slot, t, bundle_idx);
+            if (map_manages_inst) {
+                mpr_dev_LID_decref(rtr->dev, 0, idmap);
+                idmap = map->idmap = 0;
+            }
+        }
+    }
+}
+
 void mpr_rtr_process_sig(mpr_rtr rtr, mpr_sig sig, int idmap_idx, const void *val, mpr_time t)
 {
     // abort if signal is already being processed - might be a local loop
@@ -87,7 +142,6 @@ void mpr_rtr_process_sig(mpr_rtr rtr, mpr_sig sig, int idmap_idx, const void *va
         return;
     }
     mpr_id_map idmap = sig->loc->idmaps[idmap_idx].map;
-    lo_message msg;
 
     // find the router signal
     mpr_rtr_sig rs = _find_rtr_sig(rtr, sig);
@@ -122,13 +176,8 @@ void mpr_rtr_process_sig(mpr_rtr rtr, mpr_sig sig, int idmap_idx, const void *va
             mpr_value_reset_inst(&dst_lslot->val, inst_idx);
 
             // send release to downstream
-            if (slot->dir == MPR_DIR_OUT) {
-                msg = 0;
-                if (!map->use_inst || in_scope) {
-                    msg = mpr_map_build_msg(map, slot, 0, 0, idmap);
-                    mpr_link_add_msg(dst_slot->link, dst_slot->sig, msg, t, map->protocol, bundle_idx);
-                }
-            }
+            if (slot->dir == MPR_DIR_OUT && (!map->use_inst || in_scope))
+                mpr_map_send(map, slot, 0, 0, idmap, dst_slot, t, bundle_idx);
 
             // send release to upstream
             for (j = 0; j < map->num_src; j++) {
@@ -146,10 +195,8 @@ void mpr_rtr_process_sig(mpr_rtr rtr, mpr_sig sig, int idmap_idx, const void *va
                 if (sig->loc->idmaps[idmap_idx].status & RELEASED_REMOTELY)
                     continue;
 
-                if (slot->dir == MPR_DIR_IN) {
-                    msg = mpr_map_build_msg(map, slot, 0, 0, idmap);
-                    mpr_link_add_msg(slot->link, slot->sig, msg, t, map->protocol, bundle_idx);
-                }
+                if (slot->dir == MPR_DIR_IN)
+                    mpr_map_send(map, slot, 0, 0, idmap, slot, t, bundle_idx);
             }
         }
         *lock = 0;
@@ -181,8 +228,7 @@ void mpr_rtr_process_sig(mpr_rtr rtr, mpr_sig sig, int idmap_idx, const void *va
             // bypass map processing and bundle value without type coercion
             char types[sig->len];
             memset(types, sig->type, sig->len);
-            msg = mpr_map_build_msg(map, slot, val, types, sig->use_inst ? idmap : 0);
-            mpr_link_add_msg(map->dst->link, map->dst->sig, msg, t, map->protocol, bundle_idx);
+            mpr_map_send(map, slot, val, types, sig->use_inst ? idmap : 0, map->dst, t, bundle_idx);
             continue;
         }
 
@@ -193,12 +239,6 @@ void mpr_rtr_process_sig(mpr_rtr rtr, mpr_sig sig, int idmap_idx, const void *va
         if (map->process_loc == MPR_LOC_SRC && !slot->causes_update)
             continue;
 
-        mpr_slot dst_slot = map->dst;
-        mpr_slot to = (map->process_loc == MPR_LOC_SRC ? dst_slot : slot);
-        char src_types[slot->sig->len], dst_types[to->sig->len];
-        memset(src_types, slot->sig->type, slot->sig->len);
-        memset(dst_types, to->sig->type, to->sig->len);
-
         if (all) {
             // find a source signal with more instances
             for (j = 0; j < map->num_src; j++)
@@ -217,60 +257,95 @@ void mpr_rtr_process_sig(mpr_rtr rtr, mpr_sig sig, int idmap_idx, const void *va
                 idmap = 0;
         }
 
+        /* Collect the active map instances so that the expression can be
+         * evaluated for all of them in a single pass. */
         struct _mpr_sig_idmap *idmaps = sig->loc->idmaps;
+        int n_inst = 0, idmap_idxs[sig->loc->idmap_len], inst_idxs[sig->loc->idmap_len];
         for (; idmap_idx < sig->loc->idmap_len; idmap_idx++) {
             // check if map instance is active
             if ((all || sig->use_inst) && !idmaps[idmap_idx].inst)
                 continue;
-            inst_idx = idmaps[idmap_idx].inst->idx;
-            int status = mpr_map_perform(map, dst_types, &t, inst_idx);
-            if (!status) {
-                // no updates or releases
-                if (!all)
-                    break;
-                else
-                    continue;
-            }
-            /* send instance release if dst is instanced and either src or map is also instanced. */
-            if (idmap && status & EXPR_RELEASE_BEFORE_UPDATE && map->use_inst) {
-                msg = mpr_map_build_msg(map, slot, 0, 0, sig->use_inst ? idmaps[idmap_idx].map : idmap);
-                mpr_link_add_msg(dst_slot->link, dst_slot->sig, msg, t, map->protocol, bundle_idx);
-                if (map_manages_inst) {
-                    mpr_dev_LID_decref(rtr->dev, 0, idmap);
-                    idmap = map->idmap = 0;
-                }
-            }
-            if (status & EXPR_UPDATE) {
-                // send instance update
-                void *result = mpr_value_get_samp(&dst_slot->loc->val, inst_idx);
-                if (map_manages_inst) {
-                    if (!idmap) {
-                        // create an id_map and store it in the map
-                        mpr_id GID = mpr_dev_generate_unique_id(sig->dev);
-                        idmap = map->idmap = mpr_dev_add_idmap(sig->dev, 0, 0, GID);
-                    }
-                    msg = mpr_map_build_msg(map, slot, result, dst_types, map->idmap);
-                }
-                else {
-                    msg = mpr_map_build_msg(map, slot, result, dst_types, idmaps[idmap_idx].map);
-                }
-                mpr_link_add_msg(dst_slot->link, dst_slot->sig, msg,
-                                 *(mpr_time*)mpr_value_get_time(&dst_slot->loc->val, inst_idx),
-                                 map->protocol, bundle_idx);
-            }
-            /* send instance release if dst is instanced and either src or map
-             * is also instanced. */
-            if (idmap && status & EXPR_RELEASE_AFTER_UPDATE && map->use_inst) {
-                msg = mpr_map_build_msg(map, slot, 0, 0, sig->use_inst ? idmaps[idmap_idx].map : idmap);
-                mpr_link_add_msg(dst_slot->link, dst_slot->sig, msg, t, map->protocol, bundle_idx);
-                if (map_manages_inst) {
-                    mpr_dev_LID_decref(rtr->dev, 0, idmap);
-                    idmap = map->idmap = 0;
-                }
-            }
+            idmap_idxs[n_inst] = idmap_idx;
+            inst_idxs[n_inst++] = idmaps[idmap_idx].inst->idx;
             if (!all)
                 break;
         }
+        if (!n_inst)
+            continue;
+
+        _perform_and_send(rtr, map, slot, sig, idmap, map_manages_inst, idmap_idxs,
+                          inst_idxs, n_inst, t, bundle_idx);
+    }
+    *lock = 0;
+}
+
+void mpr_rtr_process_sig_batch(mpr_rtr rtr, mpr_sig sig, const int *idmap_idxs, int num_inst,
+                               mpr_time t)
+{
+    int i, j, k, n_inst;
+
+    if (!sig->use_inst || num_inst < 2) {
+        // nothing to share between updates, or instances managed by the map
+        for (i = 0; i < num_inst; i++) {
+            mpr_sig_inst si = sig->loc->idmaps[idmap_idxs[i]].inst;
+            if (si)
+                mpr_rtr_process_sig(rtr, sig, idmap_idxs[i], si->val, t);
+        }
+        return;
+    }
+    if (sig->loc->locked) {
+        trace_dev(rtr->dev, "Mapping loop detected on signal %s! (2)\n", sig->obj.name);
+        return;
+    }
+    mpr_rtr_sig rs = _find_rtr_sig(rtr, sig);
+    RETURN_UNLESS(rs);
+
+    struct _mpr_sig_idmap *idmaps = sig->loc->idmaps;
+    int map_idxs[num_inst], inst_idxs[num_inst];
+    uint8_t bundle_idx = rtr->dev->loc->bundle_idx % NUM_BUNDLES;
+    rtr->dev->loc->updated = 1; // mark as updated
+    uint8_t *lock = &sig->loc->locked;
+    *lock = 1;
+
+    for (i = 0; i < rs->num_slots; i++) {
+        mpr_slot slot = rs->slots[i];
+        if (!slot || MPR_DIR_IN == slot->dir)
+            continue;
+        mpr_map map = slot->map;
+        if (map->status < MPR_STATUS_ACTIVE)
+            continue;
+
+        /* keep the instances that are in scope of this map and still active,
+         * since a later update in the batch may have stolen an instance */
+        for (j = 0, n_inst = 0; j < num_inst; j++) {
+            k = idmap_idxs[j];
+            if (!idmaps[k].inst)
+                continue;
+            if (map->use_inst && !_is_map_in_scope(map, idmaps[k].map->GID))
+                continue;
+            map_idxs[n_inst] = k;
+            inst_idxs[n_inst++] = idmaps[k].inst->idx;
+        }
+        if (!n_inst)
+            continue;
+
+        if (MPR_LOC_DST == map->process_loc) {
+            // bypass map processing and bundle values without type coercion
+            char types[sig->len];
+            memset(types, sig->type, sig->len);
+            for (j = 0; j < n_inst; j++)
+                mpr_map_send(map, slot, idmaps[map_idxs[j]].inst->val, types,
+                             idmaps[map_idxs[j]].map, map->dst, t, bundle_idx);
+            continue;
+        }
+
+        // copy input values, then evaluate the expression once for all of them
+        for (j = 0; j < n_inst; j++)
+            mpr_value_set_sample(&slot->loc->val, inst_idxs[j], idmaps[map_idxs[j]].inst->val, t);
+        if (map->process_loc == MPR_LOC_SRC && !slot->causes_update)
+            continue;
+        _perform_and_send(rtr, map, slot, sig, idmaps[map_idxs[0]].map, 0, map_idxs,
+                          inst_idxs, n_inst, t, bundle_idx);
     }
     *lock = 0;
 }
@@ -289,6 +364,7 @@ static mpr_rtr_sig _add_rtr_sig(mpr_rtr rtr, mpr_sig sig)
         rs->slots[0] = 0;
         rs->next = rtr->sigs;
         rtr->sigs = rs;
+        sig->loc->rsig = rs;
     }
     return rs;
 }
@@ -386,8 +462,10 @@ void mpr_rtr_add_map(mpr_rtr rtr, mpr_map map)
     map->protocol = use_inst ? MPR_PROTO_TCP : MPR_PROTO_UDP;
 
     // assign a unique id to this map if we are the destination
-    if (local_dst)
+    if (local_dst) {
         map->obj.id = _get_unused_map_id(rtr->dev, rtr);
+        mpr_graph_reindex_obj(map->obj.graph, (mpr_obj)map);
+    }
 
     /* assign indices to source slots */
     if (local_dst) {
@@ -488,6 +566,8 @@ void mpr_rtr_remove_sig(mpr_rtr rtr, mpr_rtr_sig rs)
         while (*rstemp) {
             if (*rstemp == rs) {
                 *rstemp = rs->next;
+                if (rs->sig->loc->rsig == rs)
+                    rs->sig->loc->rsig = NULL;
                 free(rs->slots);
                 free(rs);
                 break;
@@ -497,6 +577,28 @@ void mpr_rtr_remove_sig(mpr_rtr rtr, mpr_rtr_sig rs)
     }
 }
 
+/* Release the path alias announced for a local signal over a link once no
+ * other map of the signal uses that link. */
+static void _release_alias(mpr_rtr rtr, mpr_rtr_sig rs, mpr_map map, mpr_link link)
+{
+    int i, j;
+    RETURN_UNLESS(link);
+    for (i = 0; i < rs->num_slots; i++) {
+        mpr_slot slot = rs->slots[i];
+        if (!slot || slot->map == map)
+            continue;
+        if (slot == slot->map->dst) {
+            for (j = 0; j < slot->map->num_src; j++) {
+                if (slot->map->src[j]->link == link)
+                    return;
+            }
+        }
+        else if (slot->map->dst->link == link)
+            return;
+    }
+    mpr_dev_release_aliases(rtr->dev, rs->sig, link);
+}
+
 int mpr_rtr_remove_map(mpr_rtr rtr, mpr_map map)
 {
     RETURN_UNLESS(map && map->loc, 1);
@@ -508,7 +610,7 @@ int mpr_rtr_remove_map(mpr_rtr rtr, mpr_map map)
     if (map->idmap) {
         // release map-generated instances
         if (map->dst->loc->rsig) {
-            lo_message msg = mpr_map_build_msg(map, 0, 0, 0, map->idmap);
+            lo_message msg = mpr_map_build_msg(map, 0, 0, 0, map->idmap, 0, 0);
             mpr_dev_bundle_start(t, NULL);
             mpr_dev_handler(NULL, lo_message_get_types(msg), lo_message_get_argv(msg),
                             lo_message_get_argc(msg), msg, (void*)map->dst->sig->loc);
@@ -543,7 +645,7 @@ int mpr_rtr_remove_map(mpr_rtr rtr, mpr_map map)
                 else {
                     mpr_dev_LID_decref(rtr->dev, s->loc->group, maps[i].map);
                     maps[i].map = 0;
-                    maps[i].inst->active = 0;
+                    mpr_sig_deactivate_inst(s, maps[i].inst);
                     maps[i].inst = 0;
                 }
             }
@@ -555,6 +657,8 @@ int mpr_rtr_remove_map(mpr_rtr rtr, mpr_map map)
                 break;
             }
         }
+        for (i = 0; i < map->num_src; i++)
+            _release_alias(rtr, rs, map, map->src[i]->link);
     }
     else if (map->dst->link) {
         mpr_link_remove_map(map->dst->link, map);
@@ -568,6 +672,7 @@ int mpr_rtr_remove_map(mpr_rtr rtr, mpr_map map)
                 if (rs->slots[j] == map->src[i])
                     rs->slots[j] = 0;
             }
+            _release_alias(rtr, rs, map, map->dst->link);
         }
         else if (map->src[i]->link) {
             mpr_link_remove_map(map->src[i]->link, map);
@@ -593,6 +698,8 @@ int mpr_rtr_remove_map(mpr_rtr rtr, mpr_map map)
         free(map->loc->var_names);
     }
     FUNC_IF(mpr_expr_free, map->loc->expr);
+    FUNC_IF(free, map->loc->types);
+    FUNC_IF(free, map->loc->status);
     free(map->loc);
     _update_map_count(rtr);
     return 0;
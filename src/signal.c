@@ -9,6 +9,7 @@
 #include <mapper/mapper.h>
 
 #define MAX_INSTANCES 128
+#define SET_VALUES_CHUNK 32
 
 /* TODO: MPR_DEFAULT_INST is actually a valid id - we should use
  * another method for distinguishing non-instanced updates. */
@@ -16,23 +17,193 @@
 
 /* Function prototypes */
 static int _add_idmap(mpr_sig s, mpr_sig_inst si, mpr_id_map map);
+static int _find_idmap_by_LID(mpr_local_sig loc, mpr_id LID);
+static int _find_idmap_by_GID(mpr_local_sig loc, mpr_id GID);
 
 static int _compare_inst_ids(const void *l, const void *r)
 {
     return memcmp(&(*(mpr_sig_inst*)l)->id, &(*(mpr_sig_inst*)r)->id, sizeof(mpr_id));
 }
 
-static mpr_sig_inst _find_inst_by_id(mpr_sig s, mpr_id id)
+/* Find the position of the first instance whose id does not sort before the
+ * given id. The instance array is kept in the order of _compare_inst_ids(). */
+static int _find_inst_pos(mpr_sig s, mpr_id id)
 {
-    RETURN_UNLESS(s->num_inst, 0);
     mpr_sig_inst_t si;
     mpr_sig_inst sip = &si;
+    int lo = 0, hi = s->num_inst;
     si.id = id;
-    mpr_sig_inst *sipp = bsearch(&sip, s->loc->inst, s->num_inst,
-                                 sizeof(mpr_sig_inst), _compare_inst_ids);
-    return (sipp && *sipp) ? *sipp : 0;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (_compare_inst_ids(&s->loc->inst[mid], &sip) < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+static mpr_sig_inst _find_inst_by_id(mpr_sig s, mpr_id id)
+{
+    RETURN_UNLESS(s->num_inst, 0);
+    int pos = _find_inst_pos(s, id);
+    return (pos < s->num_inst && s->loc->inst[pos]->id == id) ? s->loc->inst[pos] : 0;
+}
+
+/* Insert an instance into the id-ordered array, which must have room for it. */
+static void _insert_inst(mpr_sig s, mpr_sig_inst si)
+{
+    int pos = _find_inst_pos(s, si->id);
+    memmove(&s->loc->inst[pos + 1], &s->loc->inst[pos],
+            (s->num_inst - pos) * sizeof(mpr_sig_inst));
+    s->loc->inst[pos] = si;
+}
+
+/* Remove an instance from the id-ordered array. */
+static void _remove_inst(mpr_sig s, mpr_sig_inst si)
+{
+    int pos = _find_inst_pos(s, si->id);
+    memmove(&s->loc->inst[pos], &s->loc->inst[pos + 1],
+            (s->num_inst - pos - 1) * sizeof(mpr_sig_inst));
+}
+
+/* Instances are linked into lists through their prev/next fields: inactive
+ * instances into the signal's free queue and active instances into its list
+ * ordered by activation. Active instances are also linked through their
+ * prev_upd/next_upd fields into a list ordered by last update. */
+static void _list_append(mpr_sig_inst *head, mpr_sig_inst *tail, mpr_sig_inst si)
+{
+    si->next = 0;
+    if ((si->prev = *tail))
+        (*tail)->next = si;
+    else
+        *head = si;
+    *tail = si;
+}
+
+static void _list_unlink(mpr_sig_inst *head, mpr_sig_inst *tail, mpr_sig_inst si)
+{
+    if (si->prev)
+        si->prev->next = si->next;
+    else if (*head == si)
+        *head = si->next;
+    else
+        return;
+    if (si->next)
+        si->next->prev = si->prev;
+    else
+        *tail = si->prev;
+    si->prev = si->next = 0;
+}
+
+static void _upd_list_append(mpr_local_sig loc, mpr_sig_inst si)
+{
+    si->next_upd = 0;
+    if ((si->prev_upd = loc->freshest))
+        loc->freshest->next_upd = si;
+    else
+        loc->stalest = si;
+    loc->freshest = si;
+}
+
+static void _upd_list_unlink(mpr_local_sig loc, mpr_sig_inst si)
+{
+    if (si->prev_upd)
+        si->prev_upd->next_upd = si->next_upd;
+    else if (loc->stalest == si)
+        loc->stalest = si->next_upd;
+    else
+        return;
+    if (si->next_upd)
+        si->next_upd->prev_upd = si->prev_upd;
+    else
+        loc->freshest = si->prev_upd;
+    si->prev_upd = si->next_upd = 0;
+}
+
+/* The magnitude heap orders active instances by the squared magnitude of their
+ * value. It is only maintained while the signal uses MPR_STEAL_QUIETEST, and is
+ * built the first time it is needed. */
+static double _inst_mag(mpr_sig s, mpr_sig_inst si)
+{
+    int i;
+    double d, mag = 0;
+    RETURN_UNLESS(si->has_val, 0);
+    for (i = 0; i < s->len; i++) {
+        switch (s->type) {
+            case MPR_INT32: d = ((int*)si->val)[i];     break;
+            case MPR_FLT:   d = ((float*)si->val)[i];   break;
+            default:        d = ((double*)si->val)[i];  break;
+        }
+        mag += d * d;
+    }
+    return mag;
+}
+
+static void _heap_set(mpr_local_sig loc, int pos, mpr_sig_inst si)
+{
+    loc->heap[pos] = si;
+    si->heap_pos = pos;
+}
+
+static void _heap_fix(mpr_local_sig loc, int pos)
+{
+    mpr_sig_inst si = loc->heap[pos];
+    while (pos > 0 && loc->heap[(pos - 1) / 2]->mag > si->mag) {
+        _heap_set(loc, pos, loc->heap[(pos - 1) / 2]);
+        pos = (pos - 1) / 2;
+    }
+    while (1) {
+        int child = pos * 2 + 1;
+        if (child >= loc->heap_len)
+            break;
+        if (child + 1 < loc->heap_len && loc->heap[child + 1]->mag < loc->heap[child]->mag)
+            ++child;
+        if (loc->heap[child]->mag >= si->mag)
+            break;
+        _heap_set(loc, pos, loc->heap[child]);
+        pos = child;
+    }
+    _heap_set(loc, pos, si);
+}
+
+static void _heap_build(mpr_sig s)
+{
+    mpr_local_sig loc = s->loc;
+    mpr_sig_inst si;
+    int i;
+    loc->heap = malloc(sizeof(mpr_sig_inst) * s->num_inst);
+    loc->heap_len = 0;
+    for (si = loc->oldest; si; si = si->next) {
+        si->mag = _inst_mag(s, si);
+        _heap_set(loc, loc->heap_len++, si);
+    }
+    for (i = loc->heap_len / 2 - 1; i >= 0; i--)
+        _heap_fix(loc, i);
 }
 
+/* Return 1 if the magnitude heap should be updated, dropping it if the signal
+ * no longer steals by magnitude. */
+static int _heap_in_use(mpr_sig s)
+{
+    RETURN_UNLESS(s->loc->heap, 0);
+    if (s->steal_mode == MPR_STEAL_QUIETEST)
+        return 1;
+    free(s->loc->heap);
+    s->loc->heap = 0;
+    s->loc->heap_len = 0;
+    return 0;
+}
+
+static void _heap_remove(mpr_local_sig loc, mpr_sig_inst si)
+{
+    int pos = si->heap_pos;
+    mpr_sig_inst last = loc->heap[--loc->heap_len];
+    if (last == si)
+        return;
+    _heap_set(loc, pos, last);
+    _heap_fix(loc, pos);
+}
 // Add a signal to a parent object.
 mpr_sig mpr_sig_new(mpr_dev dev, mpr_dir dir, const char *name, int len,
                     mpr_type type, const char *unit, const void *min,
@@ -60,6 +231,8 @@ mpr_sig mpr_sig_new(mpr_dev dev, mpr_dir dir, const char *name, int len,
     s->loc->handler = h;
     s->loc->event_flags = events;
     mpr_sig_init(s, dir, name, len, type, unit, min, max, num_inst);
+    mpr_graph_reindex_obj(g, (mpr_obj)s);
+    mpr_obj_arr_add(&dev->sigs, (mpr_obj)s);
 
     if (dir == MPR_DIR_IN)
         ++dev->num_inputs;
@@ -187,9 +360,7 @@ void mpr_sig_free(mpr_sig sig)
     mpr_dev_remove_sig_methods(dev, sig);
     mpr_net net = &sig->obj.graph->net;
     mpr_rtr rtr = net->rtr;
-    mpr_rtr_sig rs = rtr->sigs;
-    while (rs && rs->sig != sig)
-        rs = rs->next;
+    mpr_rtr_sig rs = sig->loc->rsig;
     if (rs) {
         // need to unmap
         for (i = 0; i < rs->num_slots; i++) {
@@ -223,12 +394,14 @@ void mpr_sig_free_internal(mpr_sig s)
                 mpr_sig_release_inst_internal(s, i);
         }
         free(s->loc->idmaps);
-        for (i = 0; i < s->num_inst; i++) {
-            FUNC_IF(free, s->loc->inst[i]->val);
-            FUNC_IF(free, s->loc->inst[i]->has_val_flags);
+        FUNC_IF(free, s->loc->LID_idx);
+        FUNC_IF(free, s->loc->GID_idx);
+        FUNC_IF(free, s->loc->heap);
+        for (i = 0; i < s->num_inst; i++)
             free(s->loc->inst[i]);
-        }
         free(s->loc->inst);
+        FUNC_IF(free, s->loc->vals);
+        FUNC_IF(free, s->loc->val_flags);
         FUNC_IF(free, s->loc->vec_known);
         free(s->loc);
     }
@@ -267,80 +440,102 @@ static void _init_inst(mpr_sig_inst si)
     mpr_time_set(&si->time, si->created);
 }
 
-static mpr_sig_inst _reserved_inst(mpr_sig s, mpr_id *id)
+static void _activate_inst(mpr_sig s, mpr_sig_inst si)
 {
-    int i;
-    for (i = 0; i < s->num_inst; i++) {
-        if (!s->loc->inst[i]->active) {
-            if (id)
-                s->loc->inst[i]->id = *id;
-            qsort(s->loc->inst, s->num_inst, sizeof(mpr_sig_inst), _compare_inst_ids);
-            return s->loc->inst[i];
-        }
+    mpr_local_sig loc = s->loc;
+    int heap = _heap_in_use(s);
+    if (si->active) {
+        // reactivating, move to the end of the lists
+        _list_unlink(&loc->oldest, &loc->newest, si);
+        _upd_list_unlink(loc, si);
+        if (heap)
+            _heap_remove(loc, si);
+    }
+    else
+        _list_unlink(&loc->free_head, &loc->free_tail, si);
+    si->active = 1;
+    _init_inst(si);
+    _list_append(&loc->oldest, &loc->newest, si);
+    _upd_list_append(loc, si);
+    if (heap) {
+        si->mag = 0;
+        _heap_set(loc, loc->heap_len++, si);
+        _heap_fix(loc, si->heap_pos);
     }
-    return 0;
 }
 
-int _oldest_inst(mpr_sig sig)
+void mpr_sig_deactivate_inst(mpr_sig s, mpr_sig_inst si)
 {
-    int i;
-    mpr_sig_inst si;
-    for (i = 0; i < sig->loc->idmap_len; i++) {
-        if (sig->loc->idmaps[i].inst)
-            break;
-    }
-    if (i == sig->loc->idmap_len) {
-        // no active instances to steal!
-        return -1;
+    mpr_local_sig loc = s->loc;
+    RETURN_UNLESS(si->active);
+    si->active = 0;
+    _list_unlink(&loc->oldest, &loc->newest, si);
+    _upd_list_unlink(loc, si);
+    if (_heap_in_use(s))
+        _heap_remove(loc, si);
+    _list_append(&loc->free_head, &loc->free_tail, si);
+}
+
+void mpr_sig_touch_inst(mpr_sig s, mpr_sig_inst si)
+{
+    mpr_local_sig loc = s->loc;
+    RETURN_UNLESS(si->active);
+    if (loc->freshest != si) {
+        _upd_list_unlink(loc, si);
+        _upd_list_append(loc, si);
     }
-    int oldest = i;
-    for (i = oldest+1; i < sig->loc->idmap_len; i++) {
-        if (!(si = sig->loc->idmaps[i].inst))
-            continue;
-        if ((si->created.sec < sig->loc->idmaps[oldest].inst->created.sec) ||
-            (si->created.sec == sig->loc->idmaps[oldest].inst->created.sec &&
-             si->created.frac < sig->loc->idmaps[oldest].inst->created.frac))
-            oldest = i;
+    if (_heap_in_use(s)) {
+        si->mag = _inst_mag(s, si);
+        _heap_fix(loc, si->heap_pos);
     }
-    return oldest;
 }
 
-mpr_id mpr_sig_get_oldest_inst_id(mpr_sig sig)
+/* Return the instance that has been inactive longest, optionally giving it a
+ * new id. The caller is responsible for activating it. */
+static mpr_sig_inst _reserved_inst(mpr_sig s, mpr_id *id)
 {
-    RETURN_UNLESS(sig && sig->loc && sig->use_inst, 0);
-    int idx = _oldest_inst(sig);
-    return (idx >= 0) ? sig->loc->idmaps[idx].map->LID : 0;
+    mpr_sig_inst si = s->loc->free_head;
+    RETURN_UNLESS(si, 0);
+    if (id && si->id != *id) {
+        _remove_inst(s, si);
+        si->id = *id;
+        --s->num_inst;
+        _insert_inst(s, si);
+        ++s->num_inst;
+    }
+    return si;
 }
 
-int _newest_inst(mpr_sig sig)
+/* Return the active instance to release according to the steal mode. */
+static mpr_sig_inst _steal_inst(mpr_sig s)
 {
-    int i;
-    mpr_sig_inst si;
-    for (i = 0; i < sig->loc->idmap_len; i++) {
-        if (sig->loc->idmaps[i].inst)
-            break;
-    }
-    if (i == sig->loc->idmap_len) {
-        // no active instances to steal!
-        return -1;
+    mpr_local_sig loc = s->loc;
+    switch (s->steal_mode) {
+        case MPR_STEAL_OLDEST:
+            return loc->oldest;
+        case MPR_STEAL_NEWEST:
+            return loc->newest;
+        case MPR_STEAL_STALEST:
+            return loc->stalest;
+        case MPR_STEAL_QUIETEST:
+            if (!loc->heap)
+                _heap_build(s);
+            return loc->heap_len ? loc->heap[0] : 0;
+        default:
+            return 0;
     }
-    int newest = i;
-    for (i = newest+1; i < sig->loc->idmap_len; i++) {
-        if (!(si = sig->loc->idmaps[i].inst))
-            continue;
-        if ((si->created.sec > sig->loc->idmaps[newest].inst->created.sec) ||
-            (si->created.sec == sig->loc->idmaps[newest].inst->created.sec &&
-             si->created.frac > sig->loc->idmaps[newest].inst->created.frac))
-            newest = i;
-    }
-    return newest;
+}
+
+mpr_id mpr_sig_get_oldest_inst_id(mpr_sig sig)
+{
+    RETURN_UNLESS(sig && sig->loc && sig->use_inst, 0);
+    return sig->loc->oldest ? sig->loc->oldest->id : 0;
 }
 
 mpr_id mpr_sig_get_newest_inst_id(mpr_sig sig)
 {
     RETURN_UNLESS(sig && sig->loc && sig->use_inst, 0);
-    int idx = _newest_inst(sig);
-    return (idx >= 0) ? sig->loc->idmaps[idx].map->LID : 0;
+    return sig->loc->newest ? sig->loc->newest->id : 0;
 }
 
 int mpr_sig_get_idmap_with_LID(mpr_sig s, mpr_id LID, int flags, mpr_time t, int activate)
@@ -348,14 +543,11 @@ int mpr_sig_get_idmap_with_LID(mpr_sig s, mpr_id LID, int flags, mpr_time t, int
     RETURN_UNLESS(s && s->loc, -1);
     if (!s->use_inst)
         LID = MPR_DEFAULT_INST;
-    mpr_sig_idmap_t *maps = s->loc->idmaps;
     mpr_sig_handler *h = s->loc->handler;
     mpr_sig_inst si;
-    int i;
-    for (i = 0; i < s->loc->idmap_len; i++) {
-        if (maps[i].inst && maps[i].map->LID == LID)
-            return (maps[i].status & ~flags) ? -1 : i;
-    }
+    int i = _find_idmap_by_LID(s->loc, LID);
+    if (i >= 0)
+        return (s->loc->idmaps[i].status & ~flags) ? -1 : i;
     RETURN_UNLESS(activate, -1);
 
     // check if device has record of id map
@@ -373,8 +565,7 @@ int mpr_sig_get_idmap_with_LID(mpr_sig s, mpr_id LID, int flags, mpr_time t, int
             mpr_dev_LID_incref(s->dev, map);
 
         // store pointer to device map in a new signal map
-        si->active = 1;
-        _init_inst(si);
+        _activate_inst(s, si);
         i = _add_idmap(s, si, map);
         if (h && (s->loc->event_flags & MPR_SIG_INST_NEW))
             h(s, MPR_SIG_INST_NEW, LID, 0, s->type, NULL, t);
@@ -386,19 +577,11 @@ int mpr_sig_get_idmap_with_LID(mpr_sig s, mpr_id LID, int flags, mpr_time t, int
         // call instance event handler
         h(s, MPR_SIG_INST_OFLW, 0, 0, s->type, NULL, t);
     }
-    else if (s->steal_mode == MPR_STEAL_OLDEST) {
-        i = _oldest_inst(s);
-        if (i < 0)
-            return -1;
-        int evt = (MPR_SIG_REL_UPSTRM & s->loc->event_flags ? MPR_SIG_REL_UPSTRM : MPR_SIG_UPDATE);
-        h(s, evt, s->loc->idmaps[i].map->LID, 0, s->type, 0, t);
-    }
-    else if (s->steal_mode == MPR_STEAL_NEWEST) {
-        i = _newest_inst(s);
-        if (i < 0)
+    else if (s->steal_mode != MPR_STEAL_NONE) {
+        if (!(si = _steal_inst(s)))
             return -1;
         int evt = (MPR_SIG_REL_UPSTRM & s->loc->event_flags ? MPR_SIG_REL_UPSTRM : MPR_SIG_UPDATE);
-        h(s, evt, s->loc->idmaps[i].map->LID, 0, s->type, 0, t);
+        h(s, evt, si->id, 0, s->type, 0, t);
     }
     else
         return -1;
@@ -412,8 +595,7 @@ int mpr_sig_get_idmap_with_LID(mpr_sig s, mpr_id LID, int flags, mpr_time t, int
         }
         else
             mpr_dev_LID_incref(s->dev, map);
-        si->active = 1;
-        _init_inst(si);
+        _activate_inst(s, si);
         i = _add_idmap(s, si, map);
         if (h && (s->loc->event_flags & MPR_SIG_INST_NEW))
             h(s, MPR_SIG_INST_NEW, LID, 0, s->type, NULL, t);
@@ -425,14 +607,11 @@ int mpr_sig_get_idmap_with_LID(mpr_sig s, mpr_id LID, int flags, mpr_time t, int
 int mpr_sig_get_idmap_with_GID(mpr_sig s, mpr_id GID, int flags, mpr_time t, int activate)
 {
     RETURN_UNLESS(s && s->loc, -1);
-    mpr_sig_idmap_t *maps = s->loc->idmaps;
     mpr_sig_handler *h = s->loc->handler;
     mpr_sig_inst si;
-    int i;
-    for (i = 0; i < s->loc->idmap_len; i++) {
-        if (maps[i].map && maps[i].map->GID == GID)
-            return (maps[i].status & ~flags) ? -1 : i;
-    }
+    int i = _find_idmap_by_GID(s->loc, GID);
+    if (i >= 0)
+        return (s->loc->idmaps[i].status & ~flags) ? -1 : i;
     RETURN_UNLESS(activate, -1);
 
     // check if the device already has a map for this global id
@@ -447,8 +626,7 @@ int mpr_sig_get_idmap_with_GID(mpr_sig s, mpr_id GID, int flags, mpr_time t, int
         if ((si = _reserved_inst(s, NULL))) {
             map = mpr_dev_add_idmap(s->dev, s->loc->group, si->id, GID);
             map->GID_refcount = 1;
-            si->active = 1;
-            _init_inst(si);
+            _activate_inst(s, si);
             i = _add_idmap(s, si, map);
             if (h && (s->loc->event_flags & MPR_SIG_INST_NEW))
                 h(s, MPR_SIG_INST_NEW, si->id, 0, s->type, NULL, t);
@@ -457,8 +635,7 @@ int mpr_sig_get_idmap_with_GID(mpr_sig s, mpr_id GID, int flags, mpr_time t, int
     }
     else if ((si = _find_inst_by_id(s, map->LID)) || (si = _reserved_inst(s, &map->LID))) {
         if (!si->active) {
-            si->active = 1;
-            _init_inst(si);
+            _activate_inst(s, si);
             i = _add_idmap(s, si, map);
             mpr_dev_LID_incref(s->dev, map);
             mpr_dev_GID_incref(s->dev, map);
@@ -481,19 +658,11 @@ int mpr_sig_get_idmap_with_GID(mpr_sig s, mpr_id GID, int flags, mpr_time t, int
         // call instance event handler
         h(s, MPR_SIG_INST_OFLW, 0, 0, s->type, NULL, t);
     }
-    else if (s->steal_mode == MPR_STEAL_OLDEST) {
-        i = _oldest_inst(s);
-        if (i < 0)
+    else if (s->steal_mode != MPR_STEAL_NONE) {
+        if (!(si = _steal_inst(s)))
             return -1;
         int evt = (MPR_SIG_REL_UPSTRM & s->loc->event_flags ? MPR_SIG_REL_UPSTRM : MPR_SIG_UPDATE);
-        h(s, evt, s->loc->idmaps[i].map->LID, 0, s->type, 0, t);
-    }
-    else if (s->steal_mode == MPR_STEAL_NEWEST) {
-        i = _newest_inst(s);
-        if (i < 0)
-            return -1;
-        int evt = (MPR_SIG_REL_UPSTRM & s->loc->event_flags ? MPR_SIG_REL_UPSTRM : MPR_SIG_UPDATE);
-        h(s, evt, s->loc->idmaps[i].map->LID, 0, s->type, 0, t);
+        h(s, evt, si->id, 0, s->type, 0, t);
     }
     else
         return -1;
@@ -503,8 +672,7 @@ int mpr_sig_get_idmap_with_GID(mpr_sig s, mpr_id GID, int flags, mpr_time t, int
         if ((si = _reserved_inst(s, NULL))) {
             map = mpr_dev_add_idmap(s->dev, s->loc->group, si->id, GID);
             map->GID_refcount = 1;
-            si->active = 1;
-            _init_inst(si);
+            _activate_inst(s, si);
             i = _add_idmap(s, si, map);
             if (h && (s->loc->event_flags & MPR_SIG_INST_NEW))
                 h(s, MPR_SIG_INST_NEW, si->id, 0, s->type, NULL, t);
@@ -515,8 +683,7 @@ int mpr_sig_get_idmap_with_GID(mpr_sig s, mpr_id GID, int flags, mpr_time t, int
         si = _find_inst_by_id(s, map->LID);
         TRACE_RETURN_UNLESS(si && !si->active, -1, "Signal %s has no instance %"
                             PR_MPR_ID" available.", s->obj.name, map->LID);
-        si->active = 1;
-        _init_inst(si);
+        _activate_inst(s, si);
         i = _add_idmap(s, si, map);
         mpr_dev_LID_incref(s->dev, map);
         mpr_dev_GID_incref(s->dev, map);
@@ -527,22 +694,45 @@ int mpr_sig_get_idmap_with_GID(mpr_sig s, mpr_id GID, int flags, mpr_time t, int
     return -1;
 }
 
+/* Instance values and has-value flags are stored in two arenas indexed by
+ * instance idx, so loops over all instances of a signal walk contiguous memory.
+ * Instances must be re-pointed whenever the arenas grow or are compacted. */
+static void _point_inst_vals(mpr_sig sig)
+{
+    int i, vlen = mpr_sig_get_vector_bytes(sig), flen = sig->len / 8 + 1;
+    for (i = 0; i < sig->num_inst; i++) {
+        mpr_sig_inst si = sig->loc->inst[i];
+        si->val = sig->loc->vals + si->idx * vlen;
+        si->has_val_flags = sig->loc->val_flags + si->idx * flen;
+    }
+}
+
 static int _reserve_inst(mpr_sig sig, mpr_id *id, void *data)
 {
     RETURN_UNLESS(sig->num_inst < MAX_INSTANCES, -1);
-    int i, cont;
+    mpr_local_sig loc = sig->loc;
     mpr_sig_inst si;
+    int vlen = mpr_sig_get_vector_bytes(sig), flen = sig->len / 8 + 1;
 
     // check if instance with this id already exists! If so, stop here.
     if (id && _find_inst_by_id(sig, *id))
         return -1;
 
-    // reallocate array of instances
-    sig->loc->inst = realloc(sig->loc->inst, sizeof(mpr_sig_inst) * (sig->num_inst+1));
-    sig->loc->inst[sig->num_inst] = (mpr_sig_inst) calloc(1, sizeof(struct _mpr_sig_inst));
-    si = sig->loc->inst[sig->num_inst];
-    si->val = calloc(1, mpr_sig_get_vector_bytes(sig));
-    si->has_val_flags = calloc(1, sig->len / 8 + 1);
+    if (sig->num_inst == loc->size_inst) {
+        // grow the array of instances and the value arenas geometrically
+        loc->size_inst = loc->size_inst ? loc->size_inst * 2 : 1;
+        loc->inst = realloc(loc->inst, sizeof(mpr_sig_inst) * loc->size_inst);
+        loc->vals = realloc(loc->vals, vlen * loc->size_inst);
+        loc->val_flags = realloc(loc->val_flags, flen * loc->size_inst);
+        _point_inst_vals(sig);
+    }
+    if (loc->heap)
+        loc->heap = realloc(loc->heap, sizeof(mpr_sig_inst) * (sig->num_inst+1));
+    si = (mpr_sig_inst) calloc(1, sizeof(struct _mpr_sig_inst));
+    si->val = loc->vals + sig->num_inst * vlen;
+    si->has_val_flags = loc->val_flags + sig->num_inst * flen;
+    memset(si->val, 0, vlen);
+    memset(si->has_val_flags, 0, flen);
     si->has_val = 0;
 
     if (id)
@@ -550,22 +740,15 @@ static int _reserve_inst(mpr_sig sig, mpr_id *id, void *data)
     else {
         // find lowest unused id
         mpr_id lowest_id = 0;
-        cont = 1;
-        while (cont) {
-            cont = 0;
-            for (i = 0; i < sig->num_inst; i++) {
-                if (sig->loc->inst[i]->id == lowest_id) {
-                    cont = 1;
-                    break;
-                }
-            }
-            lowest_id += cont;
-        }
+        while (_find_inst_by_id(sig, lowest_id))
+            ++lowest_id;
         si->id = lowest_id;
     }
     si->idx = sig->num_inst;
     _init_inst(si);
     si->data = data;
+    _insert_inst(sig, si);
+    _list_append(&sig->loc->free_head, &sig->loc->free_tail, si);
 
     if (++sig->num_inst > 1) {
         if (!sig->use_inst) {
@@ -573,8 +756,7 @@ static int _reserve_inst(mpr_sig sig, mpr_id *id, void *data)
         }
         sig->use_inst = 1;
     }
-    qsort(sig->loc->inst, sig->num_inst, sizeof(mpr_sig_inst), _compare_inst_ids);
-    return sig->num_inst-1;;
+    return sig->num_inst-1;
 }
 
 int mpr_sig_reserve_inst(mpr_sig sig, int num, mpr_id *ids, void **data)
@@ -624,40 +806,42 @@ void mpr_sig_update_timing_stats(mpr_sig sig, float diff)
     }
 }
 
-void mpr_sig_set_value(mpr_sig sig, mpr_id id, int len, mpr_type type, const void *val)
+static int _check_update(mpr_sig sig, int len, mpr_type type)
 {
-    RETURN_UNLESS(sig && sig->loc);
-    if (!val) {
-        mpr_sig_release_inst(sig, id);
-        return;
-    }
     if (!mpr_type_get_is_num(type)) {
 #ifdef DEBUG
         trace("called update on signal '%s' with non-number type '%c'\n", sig->obj.name, type);
 #endif
-        return;
+        return 0;
     }
     if (len && (len != sig->len)) {
 #ifdef DEBUG
         trace("called update on signal '%s' with value length %d (should be  %d)\n",
               sig->obj.name, len, sig->len);
 #endif
-        return;
+        return 0;
     }
-    if (type != MPR_INT32) {
-        // check for NaN
-        int i;
-        if (type == MPR_FLT) {
-            for (i = 0; i < len; i++)
-                RETURN_UNLESS(((float*)val)[i] == ((float*)val)[i]);
-        }
-        else if (type == MPR_DBL) {
-            for (i = 0; i < len; i++)
-                RETURN_UNLESS(((double*)val)[i] == ((double*)val)[i]);
-        }
+    return 1;
+}
+
+static int _has_nan(int len, mpr_type type, const void *val)
+{
+    int i;
+    if (type == MPR_FLT) {
+        for (i = 0; i < len; i++)
+            RETURN_UNLESS(((float*)val)[i] == ((float*)val)[i], 1);
+    }
+    else if (type == MPR_DBL) {
+        for (i = 0; i < len; i++)
+            RETURN_UNLESS(((double*)val)[i] == ((double*)val)[i], 1);
     }
+    return 0;
+}
 
-    mpr_time time = mpr_dev_get_time(sig->dev);
+/* Update a single instance with a value that has already been checked and
+ * coerced to the signal type, or with NULL to clear the instance value. */
+static void _set_inst_value(mpr_sig sig, mpr_id id, const void *val, mpr_time time)
+{
     int idmap_idx = mpr_sig_get_idmap_with_LID(sig, id, 0, time, 1);
     RETURN_UNLESS(idmap_idx >= 0);
 
@@ -668,23 +852,95 @@ void mpr_sig_set_value(mpr_sig sig, mpr_id id, int len, mpr_type type, const voi
     memcpy(&si->time, &time, sizeof(mpr_time));
     mpr_sig_update_timing_stats(sig, diff);
 
-    if (!len || !val) {
+    if (!val) {
         si->has_val = 0;
         mpr_rtr_process_sig(sig->obj.graph->net.rtr, sig, idmap_idx, 0, si->time);
         return;
     }
 
-    size_t n = mpr_sig_get_vector_bytes(sig);
+    mpr_rtr_process_sig(sig->obj.graph->net.rtr, sig, idmap_idx, val, si->time);
+    memcpy(si->val, val, mpr_sig_get_vector_bytes(sig));
+    si->has_val = 1;
+    mpr_sig_touch_inst(sig, si);
+}
+
+void mpr_sig_set_value(mpr_sig sig, mpr_id id, int len, mpr_type type, const void *val)
+{
+    RETURN_UNLESS(sig && sig->loc);
+    if (!val) {
+        mpr_sig_release_inst(sig, id);
+        return;
+    }
+    RETURN_UNLESS(_check_update(sig, len, type));
+    RETURN_UNLESS(!_has_nan(len, type, val));
+
+    mpr_time time = mpr_dev_get_time(sig->dev);
+    if (!len) {
+        _set_inst_value(sig, id, 0, time);
+        return;
+    }
 
     void *coerced = (void*)val;
     if (type != sig->type) {
-        coerced = alloca(n);
+        coerced = alloca(mpr_sig_get_vector_bytes(sig));
         set_coerced_val(sig->len, type, val, sig->len, sig->type, coerced);
     }
+    _set_inst_value(sig, id, coerced, time);
+}
 
-    mpr_rtr_process_sig(sig->obj.graph->net.rtr, sig, idmap_idx, coerced, si->time);
-    memcpy(si->val, coerced, n);
-    si->has_val = 1;
+void mpr_sig_set_values(mpr_sig sig, int num_inst, const mpr_id *ids, int len,
+                        mpr_type type, const void *vals, int stride)
+{
+    RETURN_UNLESS(sig && sig->loc && num_inst > 0 && ids);
+    int i;
+    if (!vals) {
+        for (i = 0; i < num_inst; i++)
+            mpr_sig_release_inst(sig, ids[i]);
+        return;
+    }
+    RETURN_UNLESS(_check_update(sig, len, type));
+
+    // all instances in the batch share a single timetag
+    mpr_time time = mpr_dev_get_time(sig->dev);
+    if (!len) {
+        for (i = 0; i < num_inst; i++)
+            _set_inst_value(sig, ids[i], 0, time);
+        return;
+    }
+
+    size_t step = (stride ? stride : len) * mpr_type_get_size(type);
+    int n = 0, idmap_idxs[SET_VALUES_CHUNK];
+    mpr_rtr rtr = sig->obj.graph->net.rtr;
+    for (i = 0; i < num_inst; i++) {
+        const void *val = vals + i * step;
+        if (_has_nan(len, type, val))
+            continue;
+        int idmap_idx = mpr_sig_get_idmap_with_LID(sig, ids[i], 0, time, 1);
+        if (idmap_idx < 0)
+            continue;
+        mpr_sig_inst si = sig->loc->idmaps[idmap_idx].inst;
+
+        // update timing statistics
+        double diff = mpr_time_get_diff(time, si->time);
+        memcpy(&si->time, &time, sizeof(mpr_time));
+        mpr_sig_update_timing_stats(sig, diff);
+
+        if (type != sig->type)
+            set_coerced_val(sig->len, type, val, sig->len, sig->type, si->val);
+        else
+            memcpy(si->val, val, mpr_sig_get_vector_bytes(sig));
+        si->has_val = 1;
+        mpr_sig_touch_inst(sig, si);
+
+        // maps are processed for a chunk of instances at a time
+        idmap_idxs[n++] = idmap_idx;
+        if (SET_VALUES_CHUNK == n) {
+            mpr_rtr_process_sig_batch(rtr, sig, idmap_idxs, n, time);
+            n = 0;
+        }
+    }
+    if (n)
+        mpr_rtr_process_sig_batch(rtr, sig, idmap_idxs, n, time);
 }
 
 void mpr_sig_release_inst(mpr_sig sig, mpr_id id)
@@ -716,7 +972,7 @@ void mpr_sig_release_inst_internal(mpr_sig sig, int idmap_idx)
     }
 
     // Put instance back in reserve list
-    smap->inst->active = 0;
+    mpr_sig_deactivate_inst(sig, smap->inst);
     smap->inst = 0;
 }
 
@@ -724,29 +980,36 @@ void mpr_sig_remove_inst(mpr_sig sig, mpr_id id)
 {
     RETURN_UNLESS(sig && sig->loc && sig->use_inst);
 
-    int i, remove_idx;
-    for (i = 0; i < sig->num_inst; i++) {
-        if (sig->loc->inst[i]->id == id)
-            break;
-    }
-    RETURN_UNLESS(i < sig->num_inst);
-
-    if (sig->loc->inst[i]->active) {
-       // First release instance
-       mpr_sig_release_inst_internal(sig, i);
+    int i, remove_idx, vlen, flen;
+    mpr_sig_inst si;
+    i = _find_inst_pos(sig, id);
+    RETURN_UNLESS(i < sig->num_inst && sig->loc->inst[i]->id == id);
+    si = sig->loc->inst[i];
+
+    if (si->active) {
+        // First release instance
+        int idmap_idx = _find_idmap_by_LID(sig->loc, id);
+        if (idmap_idx >= 0)
+            mpr_sig_release_inst_internal(sig, idmap_idx);
+        mpr_sig_deactivate_inst(sig, si);
     }
 
-    remove_idx = sig->loc->inst[i]->idx;
+    remove_idx = si->idx;
+    _list_unlink(&sig->loc->free_head, &sig->loc->free_tail, si);
+    _remove_inst(sig, si);
+    --sig->num_inst;
 
-    // Free value and timetag memory held by instance
-    FUNC_IF(free, sig->loc->inst[i]->val);
-    FUNC_IF(free, sig->loc->inst[i]->has_val_flags);
-    free(sig->loc->inst[i]);
+    free(si);
 
-    for (++i; i < sig->num_inst; i++)
-        sig->loc->inst[i-1] = sig->loc->inst[i];
-    --sig->num_inst;
-    sig->loc->inst = realloc(sig->loc->inst, sizeof(mpr_sig_inst) * sig->num_inst);
+    // Compact the value arenas over the removed instance
+    vlen = mpr_sig_get_vector_bytes(sig);
+    flen = sig->len / 8 + 1;
+    memmove(sig->loc->vals + remove_idx * vlen,
+            sig->loc->vals + (remove_idx + 1) * vlen,
+            (sig->num_inst - remove_idx) * vlen);
+    memmove(sig->loc->val_flags + remove_idx * flen,
+            sig->loc->val_flags + (remove_idx + 1) * flen,
+            (sig->num_inst - remove_idx) * flen);
 
     // Remove instance memory held by map slots
     mpr_rtr_remove_inst(sig->obj.graph->net.rtr, sig, remove_idx);
@@ -755,6 +1018,7 @@ void mpr_sig_remove_inst(mpr_sig sig, mpr_id id)
         if (sig->loc->inst[i]->idx > remove_idx)
             --sig->loc->inst[i]->idx;
     }
+    _point_inst_vals(sig);
 }
 
 const void *mpr_sig_get_value(mpr_sig sig, mpr_id id, mpr_time *time)
@@ -891,12 +1155,77 @@ static int cmp_qry_sig_maps(const void *context_data, mpr_map map)
 
 mpr_list mpr_sig_get_maps(mpr_sig s, mpr_dir dir)
 {
-    RETURN_UNLESS(s && s->obj.graph->maps, 0);
-    mpr_list q = mpr_list_new_query((const void**)&s->obj.graph->maps,
-                                    cmp_qry_sig_maps, "vi", &s, dir);
+    RETURN_UNLESS(s && s->dev->maps.num, 0);
+    mpr_list q = mpr_list_new_arr_query((const void**)&s->obj.graph->maps, &s->dev->maps,
+                                        cmp_qry_sig_maps, "vi", &s, dir);
     return mpr_list_start(q);
 }
 
+/* The LID and GID indexes are open-addressing tables of positions in the
+ * signal's idmaps array. Entries are not removed when an idmap is cleared or
+ * reused, so lookups verify each candidate against the idmap itself and the
+ * tables are rebuilt once entries fill half of them. Lookups return the lowest
+ * matching position, the same result as scanning the array in order. */
+static void _idx_insert(int *idx, int size, unsigned int hash, int pos)
+{
+    unsigned int mask = size - 1, i = hash & mask;
+    while (idx[i] >= 0)
+        i = (i + 1) & mask;
+    idx[i] = pos;
+}
+
+void mpr_sig_reindex_idmaps(mpr_sig s)
+{
+    mpr_local_sig loc = s->loc;
+    int i, size = 8;
+    while (size < loc->idmap_len * 4)
+        size *= 2;
+    if (size != loc->idx_size) {
+        loc->LID_idx = realloc(loc->LID_idx, size * sizeof(int));
+        loc->GID_idx = realloc(loc->GID_idx, size * sizeof(int));
+        loc->idx_size = size;
+    }
+    memset(loc->LID_idx, 0xFF, size * sizeof(int));
+    memset(loc->GID_idx, 0xFF, size * sizeof(int));
+    loc->idx_count = 0;
+    for (i = 0; i < loc->idmap_len; i++) {
+        mpr_id_map map = loc->idmaps[i].map;
+        if (!map)
+            continue;
+        _idx_insert(loc->LID_idx, size, mpr_id_hash(map->LID, 0), i);
+        _idx_insert(loc->GID_idx, size, mpr_id_hash(map->GID, 0), i);
+        ++loc->idx_count;
+    }
+}
+
+static int _find_idmap_by_LID(mpr_local_sig loc, mpr_id LID)
+{
+    RETURN_UNLESS(loc->idx_size, -1);
+    unsigned int mask = loc->idx_size - 1, i = mpr_id_hash(LID, 0) & mask;
+    int pos, found = -1;
+    while ((pos = loc->LID_idx[i]) >= 0) {
+        mpr_sig_idmap_t *m = &loc->idmaps[pos];
+        if (m->inst && m->map && m->map->LID == LID && (found < 0 || pos < found))
+            found = pos;
+        i = (i + 1) & mask;
+    }
+    return found;
+}
+
+static int _find_idmap_by_GID(mpr_local_sig loc, mpr_id GID)
+{
+    RETURN_UNLESS(loc->idx_size, -1);
+    unsigned int mask = loc->idx_size - 1, i = mpr_id_hash(GID, 0) & mask;
+    int pos, found = -1;
+    while ((pos = loc->GID_idx[i]) >= 0) {
+        mpr_sig_idmap_t *m = &loc->idmaps[pos];
+        if (m->map && m->map->GID == GID && (found < 0 || pos < found))
+            found = pos;
+        i = (i + 1) & mask;
+    }
+    return found;
+}
+
 static int _add_idmap(mpr_sig s, mpr_sig_inst si, mpr_id_map map)
 {
     // find unused signal map
@@ -919,6 +1248,15 @@ static int _add_idmap(mpr_sig s, mpr_sig_inst si, mpr_id_map map)
     s->loc->idmaps[i].map = map;
     s->loc->idmaps[i].inst = si;
     s->loc->idmaps[i].status = 0;
+
+    mpr_local_sig loc = s->loc;
+    if ((loc->idx_count + 1) * 2 > loc->idx_size)
+        mpr_sig_reindex_idmaps(s);
+    else {
+        _idx_insert(loc->LID_idx, loc->idx_size, mpr_id_hash(map->LID, 0), i);
+        _idx_insert(loc->GID_idx, loc->idx_size, mpr_id_hash(map->GID, 0), i);
+        ++loc->idx_count;
+    }
     return i;
 }
 
@@ -986,6 +1324,7 @@ int mpr_sig_set_from_msg(mpr_sig s, mpr_msg msg)
                 if (a->types[0] == 'h') {
                     if (s->obj.id != (a->vals[0])->i64) {
                         s->obj.id = (a->vals[0])->i64;
+                        mpr_graph_reindex_obj(s->obj.graph, (mpr_obj)s);
                         ++updated;
                     }
                 }
@@ -998,6 +1337,10 @@ int mpr_sig_set_from_msg(mpr_sig s, mpr_msg msg)
                     stl = MPR_STEAL_OLDEST;
                 else if (strcmp(&(*a->vals)->s, "newest")==0)
                     stl = MPR_STEAL_NEWEST;
+                else if (strcmp(&(*a->vals)->s, "stalest")==0)
+                    stl = MPR_STEAL_STALEST;
+                else if (strcmp(&(*a->vals)->s, "quietest")==0)
+                    stl = MPR_STEAL_QUIETEST;
                 else
                     break;
                 updated += mpr_tbl_set(tbl, PROP(STEAL_MODE), NULL, 1,
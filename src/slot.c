@@ -89,6 +89,15 @@ int mpr_slot_set_from_msg(mpr_slot slot, mpr_msg msg)
             case MPR_PROP_TYPE:
                 // handled above
                 break;
+            case MPR_PROP_EXTRA:
+                if (strcmp(a->key, "alias") == 0) {
+                    // path alias assigned for this map by the device owning the signal
+                    if (!slot->sig->loc && slot->map->loc && a->types && a->types[0] == MPR_INT32)
+                        slot->alias = a->vals[0]->i32 > 0 ? a->vals[0]->i32 : 0;
+                    break;
+                }
+                updated += mpr_tbl_set_from_atom(slot_props, a, REMOTE_MODIFY);
+                break;
             case MPR_PROP_NUM_INST:
                 // static prop if slot is associated with a local map
                 if (slot->map->loc)
@@ -101,7 +110,8 @@ int mpr_slot_set_from_msg(mpr_slot slot, mpr_msg msg)
     return updated;
 }
 
-void mpr_slot_add_props_to_msg(lo_message msg, mpr_slot slot, int is_dst, int staged)
+void mpr_slot_add_props_to_msg(lo_message msg, mpr_slot slot, int is_dst, int staged,
+                               mpr_link link)
 {
     char temp[16];
     if (is_dst)
@@ -122,6 +132,14 @@ void mpr_slot_add_props_to_msg(lo_message msg, mpr_slot slot, int is_dst, int st
         snprintf(temp+len, 16-len, "%s", mpr_prop_as_str(MPR_PROP_TYPE, 0));
         lo_message_add_string(msg, temp);
         lo_message_add_char(msg, slot->sig->type);
+
+        // include the path alias the peer on link may use for data messages
+        int alias = mpr_dev_get_alias(slot->sig->dev, slot->sig, link);
+        if (alias) {
+            snprintf(temp+len, 16-len, "@alias");
+            lo_message_add_string(msg, temp);
+            lo_message_add_int32(msg, alias);
+        }
     }
 
     mpr_tbl_add_to_msg(0, (staged ? slot->obj.props.staged : slot->obj.props.synced), msg);
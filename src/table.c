@@ -52,6 +52,64 @@ static int compare_rec(const void *l, const void *r)
     return idx_l - idx_r;
 }
 
+static unsigned int rec_hash(mpr_prop prop, const char *key)
+{
+    unsigned int hash = 2166136261u;
+    prop = MASK_PROP_BITFLAGS(prop);
+    if (MPR_PROP_EXTRA != prop)
+        return PROP_TO_INDEX(prop);
+    if ('@' == key[0])
+        ++key;
+    while (*key)
+        hash = (hash ^ (unsigned char)*key++) * 16777619u;
+    return hash;
+}
+
+// the same test as compare_rec() == 0, without wildcards in keys
+static int rec_matches(mpr_tbl_record rec, mpr_prop prop, const char *key)
+{
+    const char *rec_key = rec->key;
+    prop = MASK_PROP_BITFLAGS(prop);
+    RETURN_UNLESS(MASK_PROP_BITFLAGS(rec->prop) == prop, 0);
+    RETURN_UNLESS(MPR_PROP_EXTRA == prop, 1);
+    if ('@' == rec_key[0])
+        ++rec_key;
+    if ('@' == key[0])
+        ++key;
+    return 0 == strcmp(rec_key, key);
+}
+
+static void hash_rec(mpr_tbl t, int pos)
+{
+    mpr_tbl_record rec = &t->rec[pos];
+    unsigned int mask = t->hash_size - 1, i = rec_hash(rec->prop, rec->key) & mask;
+    while (t->hash[i] >= 0)
+        i = (i + 1) & mask;
+    t->hash[i] = pos;
+}
+
+static void rehash(mpr_tbl t, int size)
+{
+    int i;
+    if (size != t->hash_size) {
+        t->hash = realloc(t->hash, size * sizeof(int));
+        t->hash_size = size;
+    }
+    for (i = 0; i < size; i++)
+        t->hash[i] = -1;
+    for (i = 0; i < t->count; i++)
+        hash_rec(t, i);
+}
+
+// restore the order of the records before walking them
+static void sort_tbl(mpr_tbl t)
+{
+    RETURN_UNLESS(t->unsorted);
+    qsort(t->rec, t->count, sizeof(mpr_tbl_record_t), compare_rec);
+    rehash(t, t->hash_size);
+    t->unsorted = 0;
+}
+
 mpr_tbl mpr_tbl_new()
 {
     mpr_tbl t = (mpr_tbl)calloc(1, sizeof(mpr_tbl_t));
@@ -92,6 +150,10 @@ void mpr_tbl_clear(mpr_tbl t)
     t->count = 0;
     t->rec = realloc(t->rec, sizeof(mpr_tbl_record_t));
     t->alloced = 1;
+    t->unsorted = 0;
+    FUNC_IF(free, t->hash);
+    t->hash = 0;
+    t->hash_size = 0;
 }
 
 void mpr_tbl_free(mpr_tbl t)
@@ -119,6 +181,12 @@ static mpr_tbl_record mpr_tbl_add(mpr_tbl t, mpr_prop prop, const char *key,
     rec->type = type;
     rec->val = val;
     rec->flags = flags;
+    if (t->count * 2 > t->hash_size)
+        rehash(t, t->hash_size ? t->hash_size * 2 : 16);
+    else
+        hash_rec(t, t->count - 1);
+    if (t->count > 1 && compare_rec(rec - 1, rec) > 0)
+        t->unsorted = 1;
     return rec;
 }
 
@@ -140,13 +208,15 @@ int mpr_tbl_get_size(mpr_tbl t)
 mpr_tbl_record mpr_tbl_get(mpr_tbl t, mpr_prop prop, const char *key)
 {
     RETURN_UNLESS(key || (MPR_PROP_UNKNOWN != prop && MPR_PROP_EXTRA != prop), 0);
-    mpr_tbl_record_t tmp;
-    tmp.prop = prop;
-    tmp.key = key;
-    mpr_tbl_record rec = 0;
-    rec = bsearch(&tmp, t->rec, t->count, sizeof(mpr_tbl_record_t),
-                  compare_rec);
-    return rec;
+    RETURN_UNLESS(t->hash_size, 0);
+    if (MPR_PROP_EXTRA == MASK_PROP_BITFLAGS(prop) && !key)
+        return 0;
+    unsigned int mask = t->hash_size - 1, i = rec_hash(prop, key) & mask;
+    for (; t->hash[i] >= 0; i = (i + 1) & mask) {
+        if (rec_matches(&t->rec[t->hash[i]], prop, key))
+            return &t->rec[t->hash[i]];
+    }
+    return 0;
 }
 
 int mpr_tbl_get_prop_by_key(mpr_tbl t, const char *key, int *len, mpr_type *type,
@@ -186,6 +256,7 @@ int mpr_tbl_get_prop_by_idx(mpr_tbl t, mpr_prop prop, const char **key, int *len
     }
     else {
         prop &= 0xFF;
+        sort_tbl(t);
         if (prop < t->count && t->count > 0) {
             for (i = 0; i < t->count; i++) {
                 rec = &t->rec[i];
@@ -263,7 +334,7 @@ int mpr_tbl_remove(mpr_tbl t, mpr_prop prop, const char *key, int flags)
 
 void mpr_tbl_clear_empty(mpr_tbl t)
 {
-    int i, j;
+    int i, j, removed = 0;
     mpr_tbl_record rec;
     for (i = 0; i < t->count; i++) {
         rec = &t->rec[i];
@@ -276,7 +347,10 @@ void mpr_tbl_clear_empty(mpr_tbl t)
         for (j = rec - t->rec + 1; j < t->count; j++)
             t->rec[j-1] = t->rec[j];
         --t->count;
+        removed = 1;
     }
+    if (removed)
+        rehash(t, t->hash_size);
 }
 
 /* For unknown reasons, strcpy crashes here with -O2, so we'll use memcpy
@@ -380,7 +454,6 @@ int set_internal(mpr_tbl t, mpr_prop prop, const char *key, int len,
             update_elements(rec, len, type, val);
         else
             rec->prop |= PROP_REMOVE;
-        qsort(t->rec, t->count, sizeof(mpr_tbl_record_t), compare_rec);
         updated = t->dirty = 1;
     }
     return updated;
@@ -479,7 +552,6 @@ int mpr_tbl_set_from_atom(mpr_tbl t, mpr_msg_atom atom, int flags)
                           flags | PROP_OWNED);
         rec->val = 0;
         update_elements_osc(rec, atom->len, atom->types, atom->vals);
-        qsort(t->rec, t->count, sizeof(mpr_tbl_record_t), compare_rec);
         updated = t->dirty = 1;
     }
     return updated;
@@ -594,10 +666,12 @@ void mpr_tbl_add_to_msg(mpr_tbl tbl, mpr_tbl new, lo_message msg)
     int i;
     // add all the updates
     if (new) {
+        sort_tbl(new);
         for (i = 0; i < new->count; i++)
             mpr_record_add_to_msg(&new->rec[i], msg);
     }
     RETURN_UNLESS(tbl);
+    sort_tbl(tbl);
     // add remaining records
     for (i = 0; i < tbl->count; i++) {
         // check if updated version exists
@@ -661,8 +735,10 @@ void mpr_tbl_print_record(mpr_tbl_record rec)
 
 void mpr_tbl_print(mpr_tbl t)
 {
-    mpr_tbl_record rec = t->rec;
+    mpr_tbl_record rec;
     int i;
+    sort_tbl(t);
+    rec = t->rec;
     for (i = 0; i < t->count; i++) {
         mpr_tbl_print_record(rec);
         printf("\n");
@@ -30,6 +30,7 @@
  * be repeated, therefore they are refered to by struct name. */
 
 typedef struct _mpr_expr *mpr_expr;
+typedef struct _mpr_expr_cache *mpr_expr_cache;
 
 /* Forward declarations for this file. */
 
@@ -67,12 +68,17 @@ typedef struct {
     char flags;
 } mpr_tbl_record_t, *mpr_tbl_record;
 
-/*! Used to hold look-up tables. */
+/*! Used to hold look-up tables. New records are appended and found through
+ *  a hash of their property or key; the records are sorted again only before
+ *  they are walked in order. */
 typedef struct _mpr_tbl {
     mpr_tbl_record rec;
+    int *hash;                  //!< Open-addressed positions of records in rec.
     int count;
     int alloced;
+    int hash_size;
     char dirty;
+    char unsorted;              //!< Records were added since the last sort.
 } mpr_tbl_t, *mpr_tbl;
 
 typedef struct _mpr_dict {
@@ -151,6 +157,8 @@ typedef struct _mpr_net {
     uint8_t graph_methods_added;
 } mpr_net_t, *mpr_net;
 
+typedef struct _mpr_prop_idx *mpr_prop_idx;
+
 typedef struct _mpr_graph {
     mpr_net_t net;
     mpr_list devs;                   //!< List of devices.
@@ -158,6 +166,20 @@ typedef struct _mpr_graph {
     mpr_list maps;                   //!< List of maps.
     mpr_list links;                  //!< List of links.
     fptr_list callbacks;             //!< List of object record callbacks.
+    struct _mpr_qry *qrys;           //!< Live queries kept up to date by callbacks.
+
+    /*! Hash indexes of devices, signals and maps, chained through the objects.
+     *  Signals are indexed by name together with their device, and maps by
+     *  their destination signal. */
+    struct {
+        struct _mpr_obj **id;
+        struct _mpr_obj **name;
+        int size;
+        int count;
+    } idx;
+
+    mpr_prop_idx prop_idx;          //!< Property indexes used by mpr_list_filter().
+    struct _mpr_obj_arr *idx_stale; //!< Objects whose prop_idx entries must be updated.
 
     /*! Linked-list of autorenewing device subscriptions. */
     mpr_subscription subscriptions;
@@ -257,8 +279,53 @@ typedef struct _mpr_obj
     struct _mpr_dict props;         //!< Properties associated with this signal.
     int version;                    //!< Version number.
     mpr_type type;                  //!< Object type.
+    uint8_t idx_stale;              //!< Set while queued in the graph's idx_stale.
+    uint8_t idx_mark;               //!< Set while ordering property index candidates.
+    struct _mpr_obj *id_next;       //!< Next object in the graph's id index bucket.
+    struct _mpr_obj *name_next;     //!< Next object in the graph's name index bucket.
+    unsigned int id_hash;           //!< Hashes the object is indexed under.
+    unsigned int name_hash;
 } mpr_obj_t, *mpr_obj;
 
+/*! A growable array of objects, used by devices to keep their own signals,
+ *  maps and links. Objects are appended, so the newest is last. */
+typedef struct _mpr_obj_arr
+{
+    struct _mpr_obj **objs;
+    int num;
+    int size;
+} mpr_obj_arr_t, *mpr_obj_arr;
+
+/*! A property condition of a live query, with its own copy of the value. */
+typedef struct _mpr_qry_filter {
+    char *key;
+    void *val;
+    mpr_prop prop;
+    mpr_type type;
+    mpr_op op;
+    int len;
+} mpr_qry_filter_t;
+
+/*! A live query: the graph objects of one type matching a set of conditions,
+ *  updated from the events passed to graph callbacks. The results are kept in
+ *  an array, with an open-addressed table of their positions so that changes
+ *  do not need to scan the results. */
+typedef struct _mpr_qry {
+    struct _mpr_qry *next;
+    struct _mpr_graph *graph;
+    mpr_dev dev;                    //!< If set, only match signals or maps of this device.
+    mpr_qry_filter_t *filters;
+    mpr_obj_arr_t objs;             //!< The current results.
+    int *pos;                       //!< Positions of results in objs, hashed by address.
+    int pos_size;
+    int num_deleted;
+    int num_filters;
+    mpr_type type;
+    mpr_dir dir;
+    void *h;                        //!< Handler for changes to the results.
+    const void *data;
+} mpr_qry_t, *mpr_qry;
+
 /**** Signal ****/
 
 /*! A structure that stores the current and historical values of a signal. The
@@ -270,6 +337,8 @@ typedef struct _mpr_value_buffer
     void *samps;                //!< Value for each sample of stored history.
     mpr_time *times;            //!< Time for each sample of stored history.
     int8_t pos;                 //!< Current position in the circular buffer.
+    uint32_t stamp;             /*!< Identifies the most recent sample, or 0 if
+                                 *   the buffer was written directly. */
 } mpr_value_buffer_t, *mpr_value_buffer;
 
 typedef struct _mpr_value
@@ -279,6 +348,10 @@ typedef struct _mpr_value
     int num_inst;               //!< Number of instances.
     mpr_type type;              //!< The type of this signal.
     int8_t mlen;                //!< History size of the buffer.
+    uint32_t last_stamp;        //!< Last stamp given to a sample of any instance.
+    void *samps;                //!< Sample arena, strided by instance.
+    mpr_time *times;            //!< Time arena, strided by instance.
+    int size_inst;              //!< Number of instances allocated.
 } mpr_value_t, *mpr_value;
 
 /*! Bit flags for indicating signal instance status. */
@@ -301,6 +374,15 @@ typedef struct _mpr_sig_inst
     void *val;                  //!< The current value of this signal instance.
     mpr_time time;              //!< The time associated with the current value.
 
+    /*! Neighbours in the signal's queue of inactive instances, or in its list
+     *  of active instances ordered by activation. */
+    struct _mpr_sig_inst *prev;
+    struct _mpr_sig_inst *next;
+    struct _mpr_sig_inst *prev_upd;     //!< Neighbours in the list of active
+    struct _mpr_sig_inst *next_upd;     //!< instances ordered by last update.
+    double mag;                 //!< Squared magnitude, for MPR_STEAL_QUIETEST.
+    int heap_pos;               //!< Position in the magnitude heap.
+
     unsigned int idx;           //!< Index for accessing value history.
     uint8_t has_val;            //!< Indicates whether this instance has a value.
     uint8_t active;             //!< Status of this instance.
@@ -318,7 +400,23 @@ typedef struct _mpr_local_sig
 {
     struct _mpr_sig_idmap *idmaps;  //!< ID maps and active instances.
     int idmap_len;
-    struct _mpr_sig_inst **inst;    //!< Array of pointers to the signal insts.
+    int *LID_idx;                   //!< Hash index from LID to idmaps.
+    int *GID_idx;                   //!< Hash index from GID to idmaps.
+    int idx_size;                   //!< Size of the indexes, a power of two.
+    int idx_count;                  //!< Entries used in the indexes.
+    struct _mpr_sig_inst **inst;    //!< Array of pointers to the signal insts,
+                                    //!< ordered by id.
+    void *vals;                     //!< Instance values, strided by inst idx.
+    char *val_flags;                //!< Instance has-value flags, likewise.
+    int size_inst;                  //!< Allocated length of inst and arenas.
+    struct _mpr_sig_inst *free_head;    //!< Queue of inactive instances, in
+    struct _mpr_sig_inst *free_tail;    //!< the order they became inactive.
+    struct _mpr_sig_inst *oldest;       //!< Active instances in order of
+    struct _mpr_sig_inst *newest;       //!< activation.
+    struct _mpr_sig_inst *stalest;      //!< Active instances in order of
+    struct _mpr_sig_inst *freshest;     //!< last update.
+    struct _mpr_sig_inst **heap;        //!< Min-heap of active instances by
+    int heap_len;                       //!< magnitude, NULL unless in use.
     char *vec_known;                //!< Bitflags when entire vector is known.
 
     /*! An optional function to be called when the signal value changes or when
@@ -328,6 +426,7 @@ typedef struct _mpr_local_sig
                                      *  instance event handler. */
 
     mpr_sig_group group;            // TODO: replace with hierarchical instancing
+    struct _mpr_rtr_sig *rsig;      //!< Router entry for this signal, if mapped.
     uint8_t locked;
     uint8_t updated;                // TODO: fold into updated_inst bitflags.
 } mpr_local_sig_t, *mpr_local_sig;
@@ -360,9 +459,64 @@ typedef struct _mpr_sig {
 
 /**** Router ****/
 
+/*! An update queued on a loopback link, stored along with its destination
+ *  signal so it can be dispatched without building a message or looking up a
+ *  path. The typestring and value are kept in the bundle value buffer. */
+typedef struct _mpr_local_msg {
+    struct _mpr_sig *sig;
+    mpr_id GID;                 //!< Instance id, or 0 for none.
+    int offset;                 //!< Offset of the typestring in the value buffer.
+    int len;                    //!< Number of vector elements.
+    int slot;                   //!< Destination slot id, or -1 for none.
+} mpr_local_msg_t, *mpr_local_msg;
+
+/*! Instance updates for one destination signal and slot that are collected
+ *  into a single message for maps using a packed protocol. */
+typedef struct _mpr_packed_msg {
+    struct _mpr_sig *sig;
+    lo_message msg;
+    mpr_time time;              //!< Timestamp of the first update.
+    int slot;                   //!< Destination slot id, or -1 for none.
+    int alias;                  //!< Path alias of the destination, or 0 for none.
+    int size;                   //!< Upper bound on the serialised message size.
+    mpr_proto proto;
+} mpr_packed_msg_t, *mpr_packed_msg;
+
+/*! Reusable data messages sharing a type string. */
+typedef struct _mpr_msg_pool {
+    char *types;                //!< Type string of the pooled messages.
+    lo_message *msgs;           //!< Pooled messages, the first num_used are queued.
+    int num;
+    int size;
+    int num_used;
+} mpr_msg_pool_t, *mpr_msg_pool;
+
+/*! A bundle serialised directly into a buffer. */
+typedef struct _mpr_direct_buf {
+    char *data;
+    int len;
+    int size;
+    int count;                  //!< Number of messages in the buffer.
+} mpr_direct_buf_t, *mpr_direct_buf;
+
 typedef struct _mpr_bundle {
     lo_bundle udp;
     lo_bundle tcp;
+    mpr_local_msg loc;          //!< Queued updates for loopback links.
+    int num_loc;
+    int size_loc;
+    char *loc_buf;              //!< Typestrings and values of the queued updates.
+    int loc_buf_len;
+    int loc_buf_size;
+    mpr_time time;              //!< Timestamp of the queued loopback updates.
+    mpr_packed_msg pk;          //!< Packed messages not yet added to a bundle.
+    int num_pk;
+    int size_pk;
+    mpr_msg_pool pools;         //!< Reusable messages keyed by type string.
+    int num_pools;
+    int last_pool;              //!< Index of the most recently used pool.
+    mpr_direct_buf_t udp_buf;   //!< Directly serialised UDP bundle.
+    mpr_direct_buf_t tcp_buf;   //!< Directly serialised TCP bundle with its size prefix.
 } mpr_bundle_t, *mpr_bundle;
 
 #define NUM_BUNDLES 8
@@ -386,6 +540,13 @@ typedef struct _mpr_link {
 
     mpr_bundle_t bundles[NUM_BUNDLES];  //!< Circular buffer to handle interrupts during poll()
 
+    void *udp_sockaddr;             //!< Resolved UDP address for direct serialisation.
+    int udp_sockaddr_len;
+    void *tcp_sockaddr;             //!< Resolved TCP address for direct serialisation.
+    int tcp_sockaddr_len;
+    int tcp_sock;                   //!< Connected TCP socket for direct sends, or -1.
+    int direct;                     //!< Serialise bundles directly instead of using liblo.
+
     mpr_sync_clock_t clock;
 } mpr_link_t, *mpr_link;
 
@@ -409,6 +570,8 @@ typedef struct _mpr_slot {
     mpr_link link;
 
     int num_inst;
+    int alias;                      /*!< Path alias assigned by the peer owning the
+                                     *   signal for data messages, or 0 for none. */
 
     int dir;                        //!< DI_INCOMING or DI_OUTGOING
     int causes_update;              //!< 1 if causes update, 0 otherwise.
@@ -427,6 +590,10 @@ typedef struct _mpr_local_map {
     int num_vars;                   //!< Number of user variables.
     int num_inst;                   //!< Number of local instances.
 
+    mpr_type *types;                //!< Scratch typestrings for batch evaluation.
+    int *status;                    //!< Scratch statuses for batch evaluation.
+    int scratch_size;               //!< Number of instances held by the scratch buffers.
+
     uint8_t is_local_only;
     uint8_t one_src;
 } mpr_local_map_t, *mpr_local_map;
@@ -445,6 +612,7 @@ typedef struct _mpr_map {
 
     struct _mpr_id_map *idmap;          //!< Associated mpr_id_map.
 
+    int jit;                            //!< 1 to evaluate expression as native code
     int muted;                          //!< 1 to mute mapping, 0 to unmute
     int num_scopes;
     int num_src;
@@ -455,8 +623,8 @@ typedef struct _mpr_map {
 } mpr_map_t, *mpr_map;
 
 /*! The rtr_sig is a linked list containing a signal and a list of mapping
- *  slots.  TODO: This should be replaced with a more efficient approach
- *  such as a hash table or search tree. */
+ *  slots.  Lookups by signal go through the back-pointer stored in the local
+ *  signal, the list is only walked when iterating over all mapped signals. */
 typedef struct _mpr_rtr_sig {
     struct _mpr_rtr_sig *next;          //!< The next rtr_sig in the list.
 
@@ -473,17 +641,21 @@ typedef struct _mpr_rtr_sig {
 typedef struct _mpr_rtr {
     struct _mpr_dev *dev;        //!< The device associated with this link.
     mpr_rtr_sig sigs;            //!< The list of mappings for each signal.
+    mpr_expr_cache expr_cache;   //!< Compiled expressions shared by maps.
 } mpr_rtr_t, *mpr_rtr;
 
 /*! The instance ID map is a linked list of int32 instance ids for coordinating
  *  remote and local instances. */
 typedef struct _mpr_id_map {
     struct _mpr_id_map *next;    //!< The next id map in the list.
+    struct _mpr_id_map *LID_next;   //!< The next id map in the LID bucket.
+    struct _mpr_id_map *GID_next;   //!< The next id map in the GID bucket.
 
     mpr_id GID;                  //!< Hash for originating device.
     mpr_id LID;                  //!< Local instance id to map.
     int LID_refcount;
     int GID_refcount;
+    int group;
 } mpr_id_map_t, *mpr_id_map;
 
 /**** Device ****/
@@ -499,8 +671,19 @@ typedef struct _mpr_local_dev {
     struct {
         struct _mpr_id_map **active;    //!< The list of active instance id maps.
         struct _mpr_id_map *reserve;    //!< The list of reserve instance id maps.
+        struct _mpr_id_map **LID_idx;   //!< Hash buckets of active maps by LID.
+        struct _mpr_id_map **GID_idx;   //!< Hash buckets of active maps by GID.
+        int idx_size;                   //!< Number of buckets, a power of two.
+        int num_active;
     } idmaps;
 
+    struct {
+        struct _mpr_sig *sig;   //!< Local signal addressed by the alias, or NULL if free.
+        struct _mpr_link *link; //!< Link to the peer the alias was announced to.
+        mpr_time released;      //!< Time the alias was last released.
+    } *aliases;                 //!< Path aliases, indexed by alias number - 1.
+    int num_aliases;
+
     mpr_time time;
     int num_sig_groups;
     uint8_t time_is_stale;
@@ -529,6 +712,11 @@ struct _mpr_dev {
     int num_maps_out;           //!< Number of associated outgoing maps.
     int num_linked;             //!< Number of linked devices.
     int status;
+    int protocols;              //!< Bit flags for the data protocols advertised by the device.
+
+    mpr_obj_arr_t sigs;         //!< Signals belonging to this device.
+    mpr_obj_arr_t maps;         //!< Maps with a source or destination on this device.
+    mpr_obj_arr_t links;        //!< Links to or from this device.
 
     uint8_t subscribed;
 };
@@ -12,97 +12,100 @@
 
 static inline int _min(int a, int b) { return a < b ? a : b; }
 
+/* The sample and time histories of all instances are stored in two arenas,
+ * one instance after another, so that updating every instance walks memory
+ * linearly. Each mpr_value_buffer points into the arenas and must be re-pointed
+ * whenever they are reallocated or compacted. */
+static void _point_bufs(mpr_value v, int num_inst)
+{
+    int i, inst_size = v->mlen * v->vlen * mpr_type_get_size(v->type);
+    for (i = 0; i < num_inst; i++) {
+        v->inst[i].samps = v->samps + i * inst_size;
+        v->inst[i].times = v->times + i * v->mlen;
+    }
+}
+
 void mpr_value_realloc(mpr_value v, int vlen, mpr_type type, int mlen, int num_inst, int is_input)
 {
     RETURN_UNLESS(v && mlen && num_inst >= v->num_inst);
-    int i, samp_size = vlen * mpr_type_get_size(type);
+    int i, j, samp_size = vlen * mpr_type_get_size(type), size = v->size_inst;
+    int reset = !v->inst || !is_input || vlen != v->vlen || type != v->type;
 
-    if (!v->inst || num_inst > v->num_inst) {
-        if (v->inst)
-            v->inst = realloc(v->inst, sizeof(mpr_value_buffer_t) * num_inst);
-        else {
-            v->inst = malloc(sizeof(mpr_value_buffer_t) * num_inst);
-            v->num_inst = 0;
-        }
-        // initialize new instances
-        for (i = v->num_inst; i < num_inst; i++) {
-            mpr_value_buffer b = &v->inst[i];
-            b->samps = calloc(1, mlen * samp_size);
-            b->times = calloc(1, mlen * sizeof(mpr_time));
-            b->pos = -1;
-        }
+    // grow geometrically
+    if (num_inst > size) {
+        size = size ? size : 1;
+        while (size < num_inst)
+            size *= 2;
     }
 
-    if (!is_input || vlen != v->vlen || type != v->type) {
-        for (i = 0; i < v->num_inst; i++) {
-            mpr_value_buffer b = &v->inst[i];
-            b->samps = realloc(b->samps, mlen * samp_size);
-            b->times = realloc(b->times, mlen * sizeof(mpr_time));
-            // Initialize entire value to 0
-            memset(b->samps, 0, mlen * samp_size);
-            b->pos = -1;
+    if (!reset && mlen == v->mlen) {
+        // only the number of instances is different; the stride is unchanged
+        if (size > v->size_inst) {
+            v->samps = realloc(v->samps, size * mlen * samp_size);
+            v->times = realloc(v->times, size * mlen * sizeof(mpr_time));
         }
-        goto done;
     }
-
-    if (mlen == v->mlen)
-        goto done;
-
-    // only the memory size is different
-    mpr_value_buffer_t tmp;
-
-    for (i = 0; i < v->num_inst; i++) {
-        mpr_value_buffer b = &v->inst[i];
-        tmp.samps = malloc(samp_size * mlen);
-        tmp.times = malloc(sizeof(mpr_time) * mlen);
-
-        if (mlen > v->mlen) {
-            int npos = v->mlen - b->pos;
-            // copy from [v->pos, v->mlen] to [0, v->mlen - v->pos]
-            memcpy(tmp.samps, b->samps + b->pos * samp_size, npos * samp_size);
-            memcpy(tmp.times, b->times + b->pos * sizeof(mpr_time), npos * sizeof(mpr_time));
-            // copy from [0, v->pos] to [v->mlen - v->pos, v->mlen]
-            memcpy(tmp.samps + npos * samp_size, b->samps, b->pos * samp_size);
-            memcpy(tmp.samps + npos * sizeof(mpr_time), b->samps, b->pos * sizeof(mpr_time));
-            // zero remainder
-            memset(tmp.samps + v->mlen * samp_size, 0, (mlen - v->mlen) * samp_size);
-        }
-        else {
-            int len = _min(v->mlen - b->pos, mlen);
-            memcpy(tmp.samps, b->samps + b->pos * samp_size, len * samp_size);
-            memcpy(tmp.times, b->times + b->pos * sizeof(mpr_time), len * sizeof(mpr_time));
-            if (mlen > len) {
-                memcpy(tmp.samps + len * samp_size, b->samps, (mlen - len) * samp_size);
-                memcpy(tmp.times + len * sizeof(mpr_time), b->times, (mlen - len) * sizeof(mpr_time));
+    else {
+        void *samps = calloc(1, size * mlen * samp_size);
+        mpr_time *times = calloc(1, size * mlen * sizeof(mpr_time));
+        if (!reset) {
+            // only the memory size is different: copy the most recent samples
+            int len = _min(v->mlen, mlen);
+            for (i = 0; i < v->num_inst; i++) {
+                mpr_value_buffer b = &v->inst[i];
+                if (b->pos < 0)
+                    continue;
+                for (j = 0; j < len; j++) {
+                    int from = (b->pos - j + v->mlen) % v->mlen, to = len - 1 - j;
+                    memcpy(samps + (i * mlen + to) * samp_size,
+                           b->samps + from * samp_size, samp_size);
+                    times[i * mlen + to] = b->times[from];
+                }
+                b->pos = len - 1;
+                b->stamp = 0;
             }
         }
-        free(b->samps);
-        free(b->times);
-        b->samps = tmp.samps;
-        b->times = tmp.times;
-        b->pos = 0;
+        FUNC_IF(free, v->samps);
+        FUNC_IF(free, v->times);
+        v->samps = samps;
+        v->times = times;
     }
 
-done:
+    if (size > v->size_inst || !v->inst)
+        v->inst = realloc(v->inst, sizeof(mpr_value_buffer_t) * size);
+    j = reset ? 0 : v->num_inst;
+
     v->vlen = vlen;
     v->type = type;
     v->mlen = mlen;
     v->num_inst = num_inst;
+    v->size_inst = size;
+    _point_bufs(v, num_inst);
+
+    // initialize new instances, which may reuse memory of removed ones
+    for (i = j; i < num_inst; i++) {
+        mpr_value_buffer b = &v->inst[i];
+        memset(b->samps, 0, mlen * samp_size);
+        memset(b->times, 0, mlen * sizeof(mpr_time));
+        b->pos = -1;
+        b->stamp = 0;
+    }
 }
 
 int mpr_value_remove_inst(mpr_value v, int idx)
 {
-    int i;
     RETURN_UNLESS(idx >= 0 && idx < v->num_inst, v->num_inst);
-    free(v->inst[idx].samps);
-    free(v->inst[idx].times);
-    for (i = idx + 1; i < v->num_inst; i++) {
-        // shift values down
-        memcpy(&(v->inst[i-1]), &(v->inst[i]), sizeof(mpr_value_buffer_t));
-    }
+    int inst_size = v->mlen * v->vlen * mpr_type_get_size(v->type);
+    int num_after = v->num_inst - idx - 1;
+    // shift values down
+    memmove(v->samps + idx * inst_size, v->samps + (idx + 1) * inst_size,
+            num_after * inst_size);
+    memmove(v->times + idx * v->mlen, v->times + (idx + 1) * v->mlen,
+            num_after * v->mlen * sizeof(mpr_time));
+    memmove(&v->inst[idx], &v->inst[idx + 1], num_after * sizeof(mpr_value_buffer_t));
     --v->num_inst;
     assert(v->num_inst >= 0);
-    v->inst = realloc(v->inst, sizeof(mpr_value_buffer_t) * v->num_inst);
+    _point_bufs(v, v->num_inst);
     return v->num_inst;
 }
 
@@ -113,6 +116,7 @@ void mpr_value_reset_inst(mpr_value v, int idx)
     memset(b->samps, 0, v->mlen * v->vlen * mpr_type_get_size(v->type));
     memset(b->times, 0, v->mlen * sizeof(mpr_time));
     b->pos = -1;
+    b->stamp = 0;
 }
 
 void mpr_value_set_sample(mpr_value v, int idx, void *s, mpr_time t)
@@ -121,17 +125,22 @@ void mpr_value_set_sample(mpr_value v, int idx, void *s, mpr_time t)
     b->pos = ((b->pos + 1) % v->mlen);
     memcpy(mpr_value_get_samp(v, idx), s, v->vlen * mpr_type_get_size(v->type));
     memcpy(mpr_value_get_time(v, idx), &t, sizeof(mpr_time));
+    /* stamps are unique within this value so that a stamp cannot recur after
+     * an instance is reset or removed; 0 is reserved for unknown samples */
+    if (!++v->last_stamp)
+        ++v->last_stamp;
+    b->stamp = v->last_stamp;
 }
 
 void mpr_value_free(mpr_value v) {
-    int i;
     RETURN_UNLESS(v->inst);
-    for (i = 0; i < v->num_inst; i++) {
-        FUNC_IF(free, v->inst[i].samps);
-        FUNC_IF(free, v->inst[i].times);
-    }
+    FUNC_IF(free, v->samps);
+    FUNC_IF(free, v->times);
     free(v->inst);
     v->inst = 0;
+    v->samps = 0;
+    v->times = 0;
+    v->num_inst = v->size_inst = 0;
 }
 
 #ifdef DEBUG
@@ -0,0 +1,755 @@
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mapper_internal.h"
+
+/* Elementwise and reduction kernels operating on contiguous arrays of int32,
+ * float or double. Scalar versions are always available; on x86 processors
+ * SSE/AVX versions are selected at runtime according to the features
+ * supported by the host CPU. Elementwise kernels produce results identical to
+ * their scalar counterparts, except for the float sin, cos, exp and log
+ * kernels which are polynomial approximations (see below). Summation
+ * accumulates in parallel lanes, so rounding may differ from a strictly
+ * sequential sum. */
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    #define HAVE_X86_KERNELS 1
+    #include <immintrin.h>
+    #define TARGET(ISA) __attribute__((target(ISA)))
+#endif
+
+#define TYPE_IDX(TYPE) ((TYPE) == MPR_INT32 ? 0 : (TYPE) == MPR_FLT ? 1 : 2)
+
+/* Binary kernels compute dst[i] = dst[i] OP src[i], unary kernels compute
+ * dst[i] = OP(src[i]). Within VEXPR and SEXPR the operands are 'a' and 'b'. */
+#define BINARY_KERNEL(NAME, ATTR, T, VT, W, LD, ST, VEXPR, SEXPR)  \
+static ATTR void NAME(void *_dst, const void *_src, int len)       \
+{                                                                   \
+    T *dst = _dst;                                                  \
+    const T *src = _src;                                            \
+    int i = 0;                                                      \
+    for (; i + W <= len; i += W) {                                  \
+        VT a = LD(dst + i), b = LD(src + i);                        \
+        ST(dst + i, VEXPR);                                         \
+    }                                                               \
+    for (; i < len; i++) {                                          \
+        T a = dst[i], b = src[i];                                   \
+        dst[i] = SEXPR;                                             \
+    }                                                               \
+}
+
+#define UNARY_KERNEL(NAME, ATTR, T, VT, W, LD, ST, VEXPR, SEXPR)   \
+static ATTR void NAME(void *_dst, const void *_src, int len)       \
+{                                                                   \
+    T *dst = _dst;                                                  \
+    const T *src = _src;                                            \
+    int i = 0;                                                      \
+    for (; i + W <= len; i += W) {                                  \
+        VT a = LD(src + i);                                         \
+        ST(dst + i, VEXPR);                                         \
+    }                                                               \
+    for (; i < len; i++) {                                          \
+        T a = src[i];                                               \
+        dst[i] = SEXPR;                                             \
+    }                                                               \
+}
+
+/**** Scalar kernels ****/
+
+#define SCALAR_BINARY(NAME, T, EXPR)                                \
+static void NAME(void *_dst, const void *_src, int len)            \
+{                                                                   \
+    T *dst = _dst;                                                  \
+    const T *src = _src;                                            \
+    for (int i = 0; i < len; i++) {                                 \
+        T a = dst[i], b = src[i];                                   \
+        dst[i] = EXPR;                                              \
+    }                                                               \
+}
+
+#define SCALAR_UNARY(NAME, T, EXPR)                                 \
+static void NAME(void *_dst, const void *_src, int len)            \
+{                                                                   \
+    T *dst = _dst;                                                  \
+    const T *src = _src;                                            \
+    for (int i = 0; i < len; i++) {                                 \
+        T a = src[i];                                               \
+        dst[i] = EXPR;                                              \
+    }                                                               \
+}
+
+#define SCALAR_COMMON(T, S)                                         \
+    SCALAR_BINARY(add_##S, T, a + b)                                \
+    SCALAR_BINARY(sub_##S, T, a - b)                                \
+    SCALAR_BINARY(mul_##S, T, a * b)                                \
+    SCALAR_BINARY(div_##S, T, a / b)                                \
+    SCALAR_BINARY(eq_##S, T, a == b)                                \
+    SCALAR_BINARY(ne_##S, T, a != b)                                \
+    SCALAR_BINARY(lt_##S, T, a < b)                                 \
+    SCALAR_BINARY(le_##S, T, a <= b)                                \
+    SCALAR_BINARY(gt_##S, T, a > b)                                 \
+    SCALAR_BINARY(ge_##S, T, a >= b)                                \
+    SCALAR_BINARY(and_##S, T, a && b)                               \
+    SCALAR_BINARY(or_##S, T, a || b)                                \
+    SCALAR_BINARY(min_##S, T, a < b ? a : b)                        \
+    SCALAR_BINARY(max_##S, T, a > b ? a : b)
+
+SCALAR_COMMON(int, i)
+SCALAR_COMMON(float, f)
+SCALAR_COMMON(double, d)
+SCALAR_BINARY(band_i, int, a & b)
+SCALAR_BINARY(bor_i, int, a | b)
+SCALAR_BINARY(bxor_i, int, a ^ b)
+SCALAR_UNARY(abs_i, int, abs(a))
+SCALAR_UNARY(abs_f, float, fabsf(a))
+SCALAR_UNARY(abs_d, double, fabs(a))
+SCALAR_UNARY(sqrt_f, float, sqrtf(a))
+SCALAR_UNARY(sqrt_d, double, sqrt(a))
+SCALAR_UNARY(floor_f, float, floorf(a))
+SCALAR_UNARY(floor_d, double, floor(a))
+SCALAR_UNARY(ceil_f, float, ceilf(a))
+SCALAR_UNARY(ceil_d, double, ceil(a))
+SCALAR_UNARY(trunc_f, float, truncf(a))
+SCALAR_UNARY(trunc_d, double, trunc(a))
+SCALAR_UNARY(sin_f, float, sinf(a))
+SCALAR_UNARY(cos_f, float, cosf(a))
+SCALAR_UNARY(exp_f, float, expf(a))
+SCALAR_UNARY(log_f, float, logf(a))
+
+#define SCALAR_REDUCE(T, S)                                         \
+static void sum_##S(const void *_src, int len, void *result)       \
+{                                                                   \
+    const T *src = _src;                                            \
+    T aggregate = 0;                                                \
+    for (int i = 0; i < len; i++)                                   \
+        aggregate += src[i];                                        \
+    *(T*)result = aggregate;                                        \
+}                                                                   \
+static void vmax_##S(const void *_src, int len, void *result)      \
+{                                                                   \
+    const T *src = _src;                                            \
+    T extrema = src[0];                                             \
+    for (int i = 1; i < len; i++) {                                 \
+        if (src[i] > extrema)                                       \
+            extrema = src[i];                                       \
+    }                                                               \
+    *(T*)result = extrema;                                          \
+}                                                                   \
+static void vmin_##S(const void *_src, int len, void *result)      \
+{                                                                   \
+    const T *src = _src;                                            \
+    T extrema = src[0];                                             \
+    for (int i = 1; i < len; i++) {                                 \
+        if (src[i] < extrema)                                       \
+            extrema = src[i];                                       \
+    }                                                               \
+    *(T*)result = extrema;                                          \
+}                                                                   \
+static void all_##S(const void *_src, int len, void *result)       \
+{                                                                   \
+    const T *src = _src;                                            \
+    for (int i = 0; i < len; i++) {                                 \
+        if (src[i] == 0) {                                          \
+            *(T*)result = 0;                                        \
+            return;                                                 \
+        }                                                           \
+    }                                                               \
+    *(T*)result = 1;                                                \
+}                                                                   \
+static void any_##S(const void *_src, int len, void *result)       \
+{                                                                   \
+    const T *src = _src;                                            \
+    for (int i = 0; i < len; i++) {                                 \
+        if (src[i] != 0) {                                          \
+            *(T*)result = 1;                                        \
+            return;                                                 \
+        }                                                           \
+    }                                                               \
+    *(T*)result = 0;                                                \
+}
+
+SCALAR_REDUCE(int, i)
+SCALAR_REDUCE(float, f)
+SCALAR_REDUCE(double, d)
+
+/* The tables are initialised statically with the scalar kernels so that they
+ * are valid before any thread can call mpr_vec_get_fn(). Faster kernels are
+ * installed by init() when the library is loaded. */
+static mpr_vec_fn *fn_tbl[MPR_VEC_N_FN][3] = {
+    [MPR_VEC_ADD]   = { add_i,      add_f,      add_d   },
+    [MPR_VEC_SUB]   = { sub_i,      sub_f,      sub_d   },
+    [MPR_VEC_MUL]   = { mul_i,      mul_f,      mul_d   },
+    [MPR_VEC_DIV]   = { div_i,      div_f,      div_d   },
+    [MPR_VEC_EQ]    = { eq_i,       eq_f,       eq_d    },
+    [MPR_VEC_NE]    = { ne_i,       ne_f,       ne_d    },
+    [MPR_VEC_LT]    = { lt_i,       lt_f,       lt_d    },
+    [MPR_VEC_LE]    = { le_i,       le_f,       le_d    },
+    [MPR_VEC_GT]    = { gt_i,       gt_f,       gt_d    },
+    [MPR_VEC_GE]    = { ge_i,       ge_f,       ge_d    },
+    [MPR_VEC_AND]   = { and_i,      and_f,      and_d   },
+    [MPR_VEC_OR]    = { or_i,       or_f,       or_d    },
+    [MPR_VEC_BAND]  = { band_i,     0,          0       },
+    [MPR_VEC_BOR]   = { bor_i,      0,          0       },
+    [MPR_VEC_BXOR]  = { bxor_i,     0,          0       },
+    [MPR_VEC_MIN]   = { min_i,      min_f,      min_d   },
+    [MPR_VEC_MAX]   = { max_i,      max_f,      max_d   },
+    [MPR_VEC_ABS]   = { abs_i,      abs_f,      abs_d   },
+    [MPR_VEC_SQRT]  = { 0,          sqrt_f,     sqrt_d  },
+    [MPR_VEC_FLOOR] = { 0,          floor_f,    floor_d },
+    [MPR_VEC_CEIL]  = { 0,          ceil_f,     ceil_d  },
+    [MPR_VEC_TRUNC] = { 0,          trunc_f,    trunc_d },
+    [MPR_VEC_SIN]   = { 0,          sin_f,      0       },
+    [MPR_VEC_COS]   = { 0,          cos_f,      0       },
+    [MPR_VEC_EXP]   = { 0,          exp_f,      0       },
+    [MPR_VEC_LOG]   = { 0,          log_f,      0       },
+};
+
+static mpr_vec_reduce_fn *reduce_tbl[MPR_VEC_N_REDUCE][3] = {
+    [MPR_VEC_SUM]   = { sum_i,      sum_f,      sum_d   },
+    [MPR_VEC_VMAX]  = { vmax_i,     vmax_f,     vmax_d  },
+    [MPR_VEC_VMIN]  = { vmin_i,     vmin_f,     vmin_d  },
+    [MPR_VEC_ALL]   = { all_i,      all_f,      all_d   },
+    [MPR_VEC_ANY]   = { any_i,      any_f,      any_d   },
+};
+
+#ifdef HAVE_X86_KERNELS
+
+/* Reductions keep per-lane partial results which are combined in lane order
+ * before the remaining elements are processed. Extrema lanes are seeded with
+ * the first element and updated using (x > ext ? x : ext), which is exactly
+ * the semantics of the max/min instructions, so NaN handling matches the
+ * scalar versions. */
+#define REDUCE_KERNELS(S, ATTR, T, VT, W, LD, ST, ZERO, SET1, ADD, MAX, MIN, \
+                       EQ_MASK, NE_MASK)                                    \
+static ATTR void sum_##S(const void *_src, int len, void *result)          \
+{                                                                           \
+    const T *src = _src;                                                    \
+    T lanes[W], aggregate = 0;                                              \
+    VT acc = ZERO();                                                        \
+    int i = 0, j;                                                           \
+    for (; i + W <= len; i += W)                                            \
+        acc = ADD(acc, LD(src + i));                                        \
+    ST(lanes, acc);                                                         \
+    for (j = 0; j < W; j++)                                                 \
+        aggregate += lanes[j];                                              \
+    for (; i < len; i++)                                                    \
+        aggregate += src[i];                                                \
+    *(T*)result = aggregate;                                                \
+}                                                                           \
+static ATTR void vmax_##S(const void *_src, int len, void *result)         \
+{                                                                           \
+    const T *src = _src;                                                    \
+    T lanes[W], extrema;                                                    \
+    VT ext = SET1(src[0]);                                                  \
+    int i = 0, j;                                                           \
+    for (; i + W <= len; i += W)                                            \
+        ext = MAX(LD(src + i), ext);                                        \
+    ST(lanes, ext);                                                         \
+    extrema = lanes[0];                                                     \
+    for (j = 1; j < W; j++) {                                               \
+        if (lanes[j] > extrema)                                             \
+            extrema = lanes[j];                                             \
+    }                                                                       \
+    for (; i < len; i++) {                                                  \
+        if (src[i] > extrema)                                               \
+            extrema = src[i];                                               \
+    }                                                                       \
+    *(T*)result = extrema;                                                  \
+}                                                                           \
+static ATTR void vmin_##S(const void *_src, int len, void *result)         \
+{                                                                           \
+    const T *src = _src;                                                    \
+    T lanes[W], extrema;                                                    \
+    VT ext = SET1(src[0]);                                                  \
+    int i = 0, j;                                                           \
+    for (; i + W <= len; i += W)                                            \
+        ext = MIN(LD(src + i), ext);                                        \
+    ST(lanes, ext);                                                         \
+    extrema = lanes[0];                                                     \
+    for (j = 1; j < W; j++) {                                               \
+        if (lanes[j] < extrema)                                             \
+            extrema = lanes[j];                                             \
+    }                                                                       \
+    for (; i < len; i++) {                                                  \
+        if (src[i] < extrema)                                               \
+            extrema = src[i];                                               \
+    }                                                                       \
+    *(T*)result = extrema;                                                  \
+}                                                                           \
+static ATTR void all_##S(const void *_src, int len, void *result)          \
+{                                                                           \
+    const T *src = _src;                                                    \
+    int i = 0;                                                              \
+    for (; i + W <= len; i += W) {                                          \
+        if (EQ_MASK(LD(src + i))) {                                         \
+            *(T*)result = 0;                                                \
+            return;                                                         \
+        }                                                                   \
+    }                                                                       \
+    for (; i < len; i++) {                                                  \
+        if (src[i] == 0) {                                                  \
+            *(T*)result = 0;                                                \
+            return;                                                         \
+        }                                                                   \
+    }                                                                       \
+    *(T*)result = 1;                                                        \
+}                                                                           \
+static ATTR void any_##S(const void *_src, int len, void *result)          \
+{                                                                           \
+    const T *src = _src;                                                    \
+    int i = 0;                                                              \
+    for (; i + W <= len; i += W) {                                          \
+        if (NE_MASK(LD(src + i))) {                                         \
+            *(T*)result = 1;                                                \
+            return;                                                         \
+        }                                                                   \
+    }                                                                       \
+    for (; i < len; i++) {                                                  \
+        if (src[i] != 0) {                                                  \
+            *(T*)result = 1;                                                \
+            return;                                                         \
+        }                                                                   \
+    }                                                                       \
+    *(T*)result = 0;                                                        \
+}
+
+/**** SSE2 float and double kernels ****/
+
+#define SSE2 TARGET("sse2")
+#define ONE_PS _mm_set1_ps(1.f)
+#define ZERO_PS _mm_setzero_ps()
+#define ONE_PD _mm_set1_pd(1.)
+#define ZERO_PD _mm_setzero_pd()
+
+#define SSE_KERNELS(S, T, VT, W, SFX, ONE, ZERO, ABS_MASK, SFN)                         \
+BINARY_KERNEL(add_##S, SSE2, T, VT, W, _mm_loadu_##SFX, _mm_storeu_##SFX,              \
+              _mm_add_##SFX(a, b), a + b)                                               \
+BINARY_KERNEL(sub_##S, SSE2, T, VT, W, _mm_loadu_##SFX, _mm_storeu_##SFX,              \
+              _mm_sub_##SFX(a, b), a - b)                                               \
+BINARY_KERNEL(mul_##S, SSE2, T, VT, W, _mm_loadu_##SFX, _mm_storeu_##SFX,              \
+              _mm_mul_##SFX(a, b), a * b)                                               \
+BINARY_KERNEL(div_##S, SSE2, T, VT, W, _mm_loadu_##SFX, _mm_storeu_##SFX,              \
+              _mm_div_##SFX(a, b), a / b)                                               \
+BINARY_KERNEL(eq_##S, SSE2, T, VT, W, _mm_loadu_##SFX, _mm_storeu_##SFX,               \
+              _mm_and_##SFX(_mm_cmpeq_##SFX(a, b), ONE), a == b)                        \
+BINARY_KERNEL(ne_##S, SSE2, T, VT, W, _mm_loadu_##SFX, _mm_storeu_##SFX,               \
+              _mm_and_##SFX(_mm_cmpneq_##SFX(a, b), ONE), a != b)                       \
+BINARY_KERNEL(lt_##S, SSE2, T, VT, W, _mm_loadu_##SFX, _mm_storeu_##SFX,               \
+              _mm_and_##SFX(_mm_cmplt_##SFX(a, b), ONE), a < b)                         \
+BINARY_KERNEL(le_##S, SSE2, T, VT, W, _mm_loadu_##SFX, _mm_storeu_##SFX,               \
+              _mm_and_##SFX(_mm_cmple_##SFX(a, b), ONE), a <= b)                        \
+BINARY_KERNEL(gt_##S, SSE2, T, VT, W, _mm_loadu_##SFX, _mm_storeu_##SFX,               \
+              _mm_and_##SFX(_mm_cmpgt_##SFX(a, b), ONE), a > b)                         \
+BINARY_KERNEL(ge_##S, SSE2, T, VT, W, _mm_loadu_##SFX, _mm_storeu_##SFX,               \
+              _mm_and_##SFX(_mm_cmpge_##SFX(a, b), ONE), a >= b)                        \
+BINARY_KERNEL(and_##S, SSE2, T, VT, W, _mm_loadu_##SFX, _mm_storeu_##SFX,              \
+              _mm_and_##SFX(_mm_and_##SFX(_mm_cmpneq_##SFX(a, ZERO),                    \
+                                          _mm_cmpneq_##SFX(b, ZERO)), ONE), a && b)     \
+BINARY_KERNEL(or_##S, SSE2, T, VT, W, _mm_loadu_##SFX, _mm_storeu_##SFX,               \
+              _mm_and_##SFX(_mm_or_##SFX(_mm_cmpneq_##SFX(a, ZERO),                     \
+                                         _mm_cmpneq_##SFX(b, ZERO)), ONE), a || b)      \
+BINARY_KERNEL(min_##S, SSE2, T, VT, W, _mm_loadu_##SFX, _mm_storeu_##SFX,              \
+              _mm_min_##SFX(a, b), a < b ? a : b)                                       \
+BINARY_KERNEL(max_##S, SSE2, T, VT, W, _mm_loadu_##SFX, _mm_storeu_##SFX,              \
+              _mm_max_##SFX(a, b), a > b ? a : b)                                       \
+UNARY_KERNEL(abs_##S, SSE2, T, VT, W, _mm_loadu_##SFX, _mm_storeu_##SFX,               \
+             _mm_andnot_##SFX(ABS_MASK, a), fabs##SFN(a))                               \
+UNARY_KERNEL(sqrt_##S, SSE2, T, VT, W, _mm_loadu_##SFX, _mm_storeu_##SFX,              \
+             _mm_sqrt_##SFX(a), sqrt##SFN(a))
+
+SSE_KERNELS(sse_f, float, __m128, 4, ps, ONE_PS, ZERO_PS, _mm_set1_ps(-0.f), f)
+SSE_KERNELS(sse_d, double, __m128d, 2, pd, ONE_PD, ZERO_PD, _mm_set1_pd(-0.), )
+
+#define EQ_MASK_PS(x) _mm_movemask_ps(_mm_cmpeq_ps(x, _mm_setzero_ps()))
+#define NE_MASK_PS(x) _mm_movemask_ps(_mm_cmpneq_ps(x, _mm_setzero_ps()))
+#define EQ_MASK_PD(x) _mm_movemask_pd(_mm_cmpeq_pd(x, _mm_setzero_pd()))
+#define NE_MASK_PD(x) _mm_movemask_pd(_mm_cmpneq_pd(x, _mm_setzero_pd()))
+
+REDUCE_KERNELS(sse_f, SSE2, float, __m128, 4, _mm_loadu_ps, _mm_storeu_ps, _mm_setzero_ps,
+               _mm_set1_ps, _mm_add_ps, _mm_max_ps, _mm_min_ps, EQ_MASK_PS, NE_MASK_PS)
+REDUCE_KERNELS(sse_d, SSE2, double, __m128d, 2, _mm_loadu_pd, _mm_storeu_pd, _mm_setzero_pd,
+               _mm_set1_pd, _mm_add_pd, _mm_max_pd, _mm_min_pd, EQ_MASK_PD, NE_MASK_PD)
+
+/**** SSE4.1 rounding and int32 kernels ****/
+
+#define SSE41 TARGET("sse4.1")
+#define LOAD_SI128(p) _mm_loadu_si128((const __m128i*)(p))
+#define STORE_SI128(p, v) _mm_storeu_si128((__m128i*)(p), v)
+#define ONE_EPI32 _mm_set1_epi32(1)
+#define ZERO_EPI32 _mm_setzero_si128()
+
+UNARY_KERNEL(floor_sse_f, SSE41, float, __m128, 4, _mm_loadu_ps, _mm_storeu_ps,
+             _mm_round_ps(a, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC), floorf(a))
+UNARY_KERNEL(ceil_sse_f, SSE41, float, __m128, 4, _mm_loadu_ps, _mm_storeu_ps,
+             _mm_round_ps(a, _MM_FROUND_TO_POS_INF | _MM_FROUND_NO_EXC), ceilf(a))
+UNARY_KERNEL(trunc_sse_f, SSE41, float, __m128, 4, _mm_loadu_ps, _mm_storeu_ps,
+             _mm_round_ps(a, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC), truncf(a))
+UNARY_KERNEL(floor_sse_d, SSE41, double, __m128d, 2, _mm_loadu_pd, _mm_storeu_pd,
+             _mm_round_pd(a, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC), floor(a))
+UNARY_KERNEL(ceil_sse_d, SSE41, double, __m128d, 2, _mm_loadu_pd, _mm_storeu_pd,
+             _mm_round_pd(a, _MM_FROUND_TO_POS_INF | _MM_FROUND_NO_EXC), ceil(a))
+UNARY_KERNEL(trunc_sse_d, SSE41, double, __m128d, 2, _mm_loadu_pd, _mm_storeu_pd,
+             _mm_round_pd(a, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC), trunc(a))
+
+#define INT_BINARY(NAME, VEXPR, SEXPR) \
+    BINARY_KERNEL(NAME, SSE41, int, __m128i, 4, LOAD_SI128, STORE_SI128, VEXPR, SEXPR)
+
+INT_BINARY(add_sse_i, _mm_add_epi32(a, b), a + b)
+INT_BINARY(sub_sse_i, _mm_sub_epi32(a, b), a - b)
+INT_BINARY(mul_sse_i, _mm_mullo_epi32(a, b), a * b)
+INT_BINARY(eq_sse_i, _mm_and_si128(_mm_cmpeq_epi32(a, b), ONE_EPI32), a == b)
+INT_BINARY(ne_sse_i, _mm_andnot_si128(_mm_cmpeq_epi32(a, b), ONE_EPI32), a != b)
+INT_BINARY(lt_sse_i, _mm_and_si128(_mm_cmplt_epi32(a, b), ONE_EPI32), a < b)
+INT_BINARY(le_sse_i, _mm_andnot_si128(_mm_cmpgt_epi32(a, b), ONE_EPI32), a <= b)
+INT_BINARY(gt_sse_i, _mm_and_si128(_mm_cmpgt_epi32(a, b), ONE_EPI32), a > b)
+INT_BINARY(ge_sse_i, _mm_andnot_si128(_mm_cmplt_epi32(a, b), ONE_EPI32), a >= b)
+INT_BINARY(and_sse_i, _mm_andnot_si128(_mm_or_si128(_mm_cmpeq_epi32(a, ZERO_EPI32),
+                                                    _mm_cmpeq_epi32(b, ZERO_EPI32)),
+                                       ONE_EPI32), a && b)
+INT_BINARY(or_sse_i, _mm_andnot_si128(_mm_and_si128(_mm_cmpeq_epi32(a, ZERO_EPI32),
+                                                    _mm_cmpeq_epi32(b, ZERO_EPI32)),
+                                      ONE_EPI32), a || b)
+INT_BINARY(min_sse_i, _mm_min_epi32(a, b), a < b ? a : b)
+INT_BINARY(max_sse_i, _mm_max_epi32(a, b), a > b ? a : b)
+INT_BINARY(band_sse_i, _mm_and_si128(a, b), a & b)
+INT_BINARY(bor_sse_i, _mm_or_si128(a, b), a | b)
+INT_BINARY(bxor_sse_i, _mm_xor_si128(a, b), a ^ b)
+UNARY_KERNEL(abs_sse_i, SSE41, int, __m128i, 4, LOAD_SI128, STORE_SI128,
+             _mm_abs_epi32(a), abs(a))
+
+#define EQ_MASK_EPI32(x) _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(x, ZERO_EPI32)))
+#define NE_MASK_EPI32(x) (0xF != EQ_MASK_EPI32(x))
+
+REDUCE_KERNELS(sse_i, SSE41, int, __m128i, 4, LOAD_SI128, STORE_SI128, _mm_setzero_si128,
+               _mm_set1_epi32, _mm_add_epi32, _mm_max_epi32, _mm_min_epi32, EQ_MASK_EPI32,
+               NE_MASK_EPI32)
+
+/**** AVX float and double kernels ****/
+
+#define AVX TARGET("avx")
+
+#define AVX_KERNELS(S, T, VT, W, SFX, ONE, ZERO, ABS_MASK, SFN)                             \
+BINARY_KERNEL(add_##S, AVX, T, VT, W, _mm256_loadu_##SFX, _mm256_storeu_##SFX,             \
+              _mm256_add_##SFX(a, b), a + b)                                                \
+BINARY_KERNEL(sub_##S, AVX, T, VT, W, _mm256_loadu_##SFX, _mm256_storeu_##SFX,             \
+              _mm256_sub_##SFX(a, b), a - b)                                                \
+BINARY_KERNEL(mul_##S, AVX, T, VT, W, _mm256_loadu_##SFX, _mm256_storeu_##SFX,             \
+              _mm256_mul_##SFX(a, b), a * b)                                                \
+BINARY_KERNEL(div_##S, AVX, T, VT, W, _mm256_loadu_##SFX, _mm256_storeu_##SFX,             \
+              _mm256_div_##SFX(a, b), a / b)                                                \
+BINARY_KERNEL(eq_##S, AVX, T, VT, W, _mm256_loadu_##SFX, _mm256_storeu_##SFX,              \
+              _mm256_and_##SFX(_mm256_cmp_##SFX(a, b, _CMP_EQ_OQ), ONE), a == b)            \
+BINARY_KERNEL(ne_##S, AVX, T, VT, W, _mm256_loadu_##SFX, _mm256_storeu_##SFX,              \
+              _mm256_and_##SFX(_mm256_cmp_##SFX(a, b, _CMP_NEQ_UQ), ONE), a != b)           \
+BINARY_KERNEL(lt_##S, AVX, T, VT, W, _mm256_loadu_##SFX, _mm256_storeu_##SFX,              \
+              _mm256_and_##SFX(_mm256_cmp_##SFX(a, b, _CMP_LT_OQ), ONE), a < b)             \
+BINARY_KERNEL(le_##S, AVX, T, VT, W, _mm256_loadu_##SFX, _mm256_storeu_##SFX,              \
+              _mm256_and_##SFX(_mm256_cmp_##SFX(a, b, _CMP_LE_OQ), ONE), a <= b)            \
+BINARY_KERNEL(gt_##S, AVX, T, VT, W, _mm256_loadu_##SFX, _mm256_storeu_##SFX,              \
+              _mm256_and_##SFX(_mm256_cmp_##SFX(a, b, _CMP_GT_OQ), ONE), a > b)             \
+BINARY_KERNEL(ge_##S, AVX, T, VT, W, _mm256_loadu_##SFX, _mm256_storeu_##SFX,              \
+              _mm256_and_##SFX(_mm256_cmp_##SFX(a, b, _CMP_GE_OQ), ONE), a >= b)            \
+BINARY_KERNEL(and_##S, AVX, T, VT, W, _mm256_loadu_##SFX, _mm256_storeu_##SFX,             \
+              _mm256_and_##SFX(_mm256_and_##SFX(_mm256_cmp_##SFX(a, ZERO, _CMP_NEQ_UQ),     \
+                                                _mm256_cmp_##SFX(b, ZERO, _CMP_NEQ_UQ)),    \
+                               ONE), a && b)                                                \
+BINARY_KERNEL(or_##S, AVX, T, VT, W, _mm256_loadu_##SFX, _mm256_storeu_##SFX,              \
+              _mm256_and_##SFX(_mm256_or_##SFX(_mm256_cmp_##SFX(a, ZERO, _CMP_NEQ_UQ),      \
+                                               _mm256_cmp_##SFX(b, ZERO, _CMP_NEQ_UQ)),     \
+                               ONE), a || b)                                                \
+BINARY_KERNEL(min_##S, AVX, T, VT, W, _mm256_loadu_##SFX, _mm256_storeu_##SFX,             \
+              _mm256_min_##SFX(a, b), a < b ? a : b)                                        \
+BINARY_KERNEL(max_##S, AVX, T, VT, W, _mm256_loadu_##SFX, _mm256_storeu_##SFX,             \
+              _mm256_max_##SFX(a, b), a > b ? a : b)                                        \
+UNARY_KERNEL(abs_##S, AVX, T, VT, W, _mm256_loadu_##SFX, _mm256_storeu_##SFX,              \
+             _mm256_andnot_##SFX(ABS_MASK, a), fabs##SFN(a))                                \
+UNARY_KERNEL(sqrt_##S, AVX, T, VT, W, _mm256_loadu_##SFX, _mm256_storeu_##SFX,             \
+             _mm256_sqrt_##SFX(a), sqrt##SFN(a))                                            \
+UNARY_KERNEL(floor_##S, AVX, T, VT, W, _mm256_loadu_##SFX, _mm256_storeu_##SFX,            \
+             _mm256_round_##SFX(a, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC), floor##SFN(a))\
+UNARY_KERNEL(ceil_##S, AVX, T, VT, W, _mm256_loadu_##SFX, _mm256_storeu_##SFX,             \
+             _mm256_round_##SFX(a, _MM_FROUND_TO_POS_INF | _MM_FROUND_NO_EXC), ceil##SFN(a)) \
+UNARY_KERNEL(trunc_##S, AVX, T, VT, W, _mm256_loadu_##SFX, _mm256_storeu_##SFX,            \
+             _mm256_round_##SFX(a, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC), trunc##SFN(a))
+
+AVX_KERNELS(avx_f, float, __m256, 8, ps, _mm256_set1_ps(1.f), _mm256_setzero_ps(),
+            _mm256_set1_ps(-0.f), f)
+AVX_KERNELS(avx_d, double, __m256d, 4, pd, _mm256_set1_pd(1.), _mm256_setzero_pd(),
+            _mm256_set1_pd(-0.), )
+
+#define EQ_MASK_256_PS(x) _mm256_movemask_ps(_mm256_cmp_ps(x, _mm256_setzero_ps(), _CMP_EQ_OQ))
+#define NE_MASK_256_PS(x) _mm256_movemask_ps(_mm256_cmp_ps(x, _mm256_setzero_ps(), _CMP_NEQ_UQ))
+#define EQ_MASK_256_PD(x) _mm256_movemask_pd(_mm256_cmp_pd(x, _mm256_setzero_pd(), _CMP_EQ_OQ))
+#define NE_MASK_256_PD(x) _mm256_movemask_pd(_mm256_cmp_pd(x, _mm256_setzero_pd(), _CMP_NEQ_UQ))
+
+REDUCE_KERNELS(avx_f, AVX, float, __m256, 8, _mm256_loadu_ps, _mm256_storeu_ps,
+               _mm256_setzero_ps, _mm256_set1_ps, _mm256_add_ps, _mm256_max_ps,
+               _mm256_min_ps, EQ_MASK_256_PS, NE_MASK_256_PS)
+REDUCE_KERNELS(avx_d, AVX, double, __m256d, 4, _mm256_loadu_pd, _mm256_storeu_pd,
+               _mm256_setzero_pd, _mm256_set1_pd, _mm256_add_pd, _mm256_max_pd,
+               _mm256_min_pd, EQ_MASK_256_PD, NE_MASK_256_PD)
+
+/**** SSE2 and AVX2 float transcendental kernels ****/
+
+/* Polynomial approximations of sinf, cosf, expf and logf following Cephes,
+ * with a four-part Cody-Waite reduction for sin and cos. Lanes whose argument
+ * lies outside the range handled by the approximation (|x| > 8192 for sin and
+ * cos, x outside [-87, 88] for exp, and x that is not a positive normal number
+ * for log) are evaluated with libm, so special values are returned exactly as
+ * libm would. The last partial block is padded rather than finished in scalar
+ * code, so every element goes through the same arithmetic and the SSE2 and
+ * AVX2 kernels return identical results. Compared exhaustively against libm
+ * in double precision, the maximum error is 2.5 ulp for sin and cos and 1 ulp
+ * for exp and log. */
+
+#define AVX2 TARGET("avx2")
+
+#define SSE2_LE(a, b) _mm_cmple_ps(a, b)
+#define SSE2_LT(a, b) _mm_cmplt_ps(a, b)
+#define AVX2_LE(a, b) _mm256_cmp_ps(a, b, _CMP_LE_OQ)
+#define AVX2_LT(a, b) _mm256_cmp_ps(a, b, _CMP_LT_OQ)
+
+/* P is the intrinsic prefix (_mm or _mm256) and SI the integer vector width
+ * used in intrinsic names (128 or 256). */
+#define MATH_KERNELS(S, ATTR, P, SI, VF, VI, W, LE, LT)                             \
+static inline ATTR VF vsincos_##S(VF x, int cosine)                                 \
+{                                                                                   \
+    VF sign = P##_and_ps(x, P##_set1_ps(-0.f)), y, z, y1, y2, poly;                 \
+    VI j;                                                                           \
+    x = P##_andnot_ps(P##_set1_ps(-0.f), x);                                        \
+    /* octant of x, rounded up to an even number */                                 \
+    j = P##_cvttps_epi32(P##_mul_ps(x, P##_set1_ps(1.27323954473516f)));            \
+    j = P##_and_si##SI(P##_add_epi32(j, P##_set1_epi32(1)), P##_set1_epi32(~1));    \
+    y = P##_cvtepi32_ps(j);                                                         \
+    if (cosine) {                                                                   \
+        j = P##_sub_epi32(j, P##_set1_epi32(2));                                    \
+        sign = P##_castsi##SI##_ps(P##_slli_epi32(                                  \
+            P##_andnot_si##SI(j, P##_set1_epi32(4)), 29));                          \
+    }                                                                               \
+    else {                                                                          \
+        sign = P##_xor_ps(sign, P##_castsi##SI##_ps(P##_slli_epi32(                 \
+            P##_and_si##SI(j, P##_set1_epi32(4)), 29)));                            \
+    }                                                                               \
+    poly = P##_castsi##SI##_ps(P##_cmpeq_epi32(                                     \
+        P##_and_si##SI(j, P##_set1_epi32(2)), P##_setzero_si##SI()));               \
+    /* x - y * pi/4, with pi/4 split so that the leading products are exact */      \
+    x = P##_add_ps(x, P##_mul_ps(y, P##_set1_ps(-0.78515625f)));                    \
+    x = P##_add_ps(x, P##_mul_ps(y, P##_set1_ps(-2.4175643920898438e-4f)));         \
+    x = P##_add_ps(x, P##_mul_ps(y, P##_set1_ps(-1.5692785382270813e-7f)));         \
+    x = P##_add_ps(x, P##_mul_ps(y, P##_set1_ps(-3.038550314138355e-11f)));         \
+    z = P##_mul_ps(x, x);                                                           \
+    y1 = P##_set1_ps(2.443315711809948e-5f);                                        \
+    y1 = P##_add_ps(P##_mul_ps(y1, z), P##_set1_ps(-1.388731625493765e-3f));        \
+    y1 = P##_add_ps(P##_mul_ps(y1, z), P##_set1_ps(4.166664568298827e-2f));         \
+    y1 = P##_mul_ps(P##_mul_ps(y1, z), z);                                          \
+    y1 = P##_sub_ps(y1, P##_mul_ps(z, P##_set1_ps(0.5f)));                          \
+    y1 = P##_add_ps(y1, P##_set1_ps(1.f));                                          \
+    y2 = P##_set1_ps(-1.9515295891e-4f);                                            \
+    y2 = P##_add_ps(P##_mul_ps(y2, z), P##_set1_ps(8.3321608736e-3f));              \
+    y2 = P##_add_ps(P##_mul_ps(y2, z), P##_set1_ps(-1.6666654611e-1f));             \
+    y2 = P##_add_ps(P##_mul_ps(P##_mul_ps(y2, z), x), x);                           \
+    y = P##_or_ps(P##_and_ps(poly, y2), P##_andnot_ps(poly, y1));                   \
+    return P##_xor_ps(y, sign);                                                     \
+}                                                                                   \
+static inline ATTR VF vsin_##S(VF x) { return vsincos_##S(x, 0); }                  \
+static inline ATTR VF vcos_##S(VF x) { return vsincos_##S(x, 1); }                  \
+static inline ATTR VF vexp_##S(VF x)                                                \
+{                                                                                   \
+    VF fx, t, y, z;                                                                 \
+    /* n = floor(x * log2(e) + 0.5) */                                              \
+    fx = P##_add_ps(P##_mul_ps(x, P##_set1_ps(1.44269504088896341f)),               \
+                    P##_set1_ps(0.5f));                                             \
+    t = P##_cvtepi32_ps(P##_cvttps_epi32(fx));                                      \
+    fx = P##_sub_ps(t, P##_and_ps(LT(fx, t), P##_set1_ps(1.f)));                    \
+    x = P##_sub_ps(x, P##_mul_ps(fx, P##_set1_ps(0.693359375f)));                   \
+    x = P##_sub_ps(x, P##_mul_ps(fx, P##_set1_ps(-2.12194440e-4f)));                \
+    z = P##_mul_ps(x, x);                                                           \
+    y = P##_set1_ps(1.9875691500e-4f);                                              \
+    y = P##_add_ps(P##_mul_ps(y, x), P##_set1_ps(1.3981999507e-3f));                \
+    y = P##_add_ps(P##_mul_ps(y, x), P##_set1_ps(8.3334519073e-3f));                \
+    y = P##_add_ps(P##_mul_ps(y, x), P##_set1_ps(4.1665795894e-2f));                \
+    y = P##_add_ps(P##_mul_ps(y, x), P##_set1_ps(1.6666665459e-1f));                \
+    y = P##_add_ps(P##_mul_ps(y, x), P##_set1_ps(5.0000001201e-1f));                \
+    y = P##_add_ps(P##_add_ps(P##_mul_ps(y, z), x), P##_set1_ps(1.f));              \
+    /* scale by 2^n */                                                              \
+    return P##_mul_ps(y, P##_castsi##SI##_ps(P##_slli_epi32(                        \
+        P##_add_epi32(P##_cvttps_epi32(fx), P##_set1_epi32(127)), 23)));            \
+}                                                                                   \
+static inline ATTR VF vlog_##S(VF x)                                                \
+{                                                                                   \
+    VI bits = P##_castps_si##SI(x);                                                 \
+    VF e, mask, y, z;                                                               \
+    /* split x into an exponent and a mantissa in [sqrt(0.5), sqrt(2)) */           \
+    e = P##_cvtepi32_ps(P##_sub_epi32(P##_srli_epi32(bits, 23),                     \
+                                      P##_set1_epi32(126)));                        \
+    x = P##_or_ps(P##_castsi##SI##_ps(P##_and_si##SI(bits,                          \
+                                      P##_set1_epi32(0x007FFFFF))),                 \
+                  P##_set1_ps(0.5f));                                               \
+    mask = LT(x, P##_set1_ps(0.707106781186547524f));                               \
+    e = P##_sub_ps(e, P##_and_ps(mask, P##_set1_ps(1.f)));                          \
+    x = P##_add_ps(P##_sub_ps(x, P##_set1_ps(1.f)), P##_and_ps(mask, x));           \
+    z = P##_mul_ps(x, x);                                                           \
+    y = P##_set1_ps(7.0376836292e-2f);                                              \
+    y = P##_add_ps(P##_mul_ps(y, x), P##_set1_ps(-1.1514610310e-1f));               \
+    y = P##_add_ps(P##_mul_ps(y, x), P##_set1_ps(1.1676998740e-1f));                \
+    y = P##_add_ps(P##_mul_ps(y, x), P##_set1_ps(-1.2420140846e-1f));               \
+    y = P##_add_ps(P##_mul_ps(y, x), P##_set1_ps(1.4249322787e-1f));                \
+    y = P##_add_ps(P##_mul_ps(y, x), P##_set1_ps(-1.6668057665e-1f));               \
+    y = P##_add_ps(P##_mul_ps(y, x), P##_set1_ps(2.0000714765e-1f));                \
+    y = P##_add_ps(P##_mul_ps(y, x), P##_set1_ps(-2.4999993993e-1f));               \
+    y = P##_add_ps(P##_mul_ps(y, x), P##_set1_ps(3.3333331174e-1f));                \
+    y = P##_mul_ps(P##_mul_ps(y, x), z);                                            \
+    y = P##_add_ps(y, P##_mul_ps(e, P##_set1_ps(-2.12194440e-4f)));                 \
+    y = P##_sub_ps(y, P##_mul_ps(z, P##_set1_ps(0.5f)));                            \
+    return P##_add_ps(P##_add_ps(x, y), P##_mul_ps(e, P##_set1_ps(0.693359375f)));  \
+}                                                                                   \
+static inline ATTR int sin_mask_##S(VF x)                                           \
+{                                                                                   \
+    x = P##_andnot_ps(P##_set1_ps(-0.f), x);                                        \
+    return P##_movemask_ps(LE(x, P##_set1_ps(8192.f)));                             \
+}                                                                                   \
+static inline ATTR int exp_mask_##S(VF x)                                           \
+{                                                                                   \
+    return P##_movemask_ps(P##_and_ps(LE(P##_set1_ps(-87.f), x),                    \
+                                      LE(x, P##_set1_ps(88.f))));                   \
+}                                                                                   \
+static inline ATTR int log_mask_##S(VF x)                                           \
+{                                                                                   \
+    return P##_movemask_ps(P##_and_ps(LE(P##_set1_ps(FLT_MIN), x),                  \
+                                      LE(x, P##_set1_ps(FLT_MAX))));                \
+}                                                                                   \
+MATH_KERNEL(sin_##S, ATTR, P, W, vsin_##S, sin_mask_##S, sinf)                      \
+MATH_KERNEL(cos_##S, ATTR, P, W, vcos_##S, sin_mask_##S, cosf)                      \
+MATH_KERNEL(exp_##S, ATTR, P, W, vexp_##S, exp_mask_##S, expf)                      \
+MATH_KERNEL(log_##S, ATTR, P, W, vlog_##S, log_mask_##S, logf)
+
+/* Partial blocks are padded with 1, which is in range for every function. */
+#define MATH_KERNEL(NAME, ATTR, P, W, VFN, RANGE_MASK, SFN)                         \
+static ATTR void NAME(void *_dst, const void *_src, int len)                        \
+{                                                                                   \
+    float *dst = _dst, pad[W], out[W];                                              \
+    const float *src = _src;                                                        \
+    int i, j, n, mask;                                                              \
+    for (i = 0; i < len; i += W) {                                                  \
+        const float *s = src + i;                                                   \
+        n = len - i < W ? len - i : W;                                              \
+        if (n < W) {                                                                \
+            for (j = 0; j < W; j++)                                                 \
+                pad[j] = j < n ? s[j] : 1.f;                                        \
+            s = pad;                                                                \
+        }                                                                           \
+        mask = RANGE_MASK(P##_loadu_ps(s));                                         \
+        if (n == W && mask == (1 << W) - 1) {                                       \
+            P##_storeu_ps(dst + i, VFN(P##_loadu_ps(s)));                           \
+            continue;                                                               \
+        }                                                                           \
+        P##_storeu_ps(out, VFN(P##_loadu_ps(s)));                                   \
+        for (j = 0; j < n; j++) {                                                   \
+            if (!(mask & (1 << j)))                                                 \
+                out[j] = SFN(s[j]);                                                 \
+        }                                                                           \
+        memcpy(dst + i, out, n * sizeof(float));                                    \
+    }                                                                               \
+}
+
+MATH_KERNELS(sse_f, SSE2, _mm, 128, __m128, __m128i, 4, SSE2_LE, SSE2_LT)
+MATH_KERNELS(avx2_f, AVX2, _mm256, 256, __m256, __m256i, 8, AVX2_LE, AVX2_LT)
+
+#define SET_FN(OP, TYPE, FN)        fn_tbl[OP][TYPE] = FN;
+#define SET_REDUCE(OP, TYPE, FN)    reduce_tbl[OP][TYPE] = FN;
+
+/* Kernels shared by all three types. */
+#define SET_COMMON_KERNELS(TYPE, S)                 \
+    SET_FN(MPR_VEC_ADD, TYPE, add_##S)              \
+    SET_FN(MPR_VEC_SUB, TYPE, sub_##S)              \
+    SET_FN(MPR_VEC_MUL, TYPE, mul_##S)              \
+    SET_FN(MPR_VEC_EQ, TYPE, eq_##S)                \
+    SET_FN(MPR_VEC_NE, TYPE, ne_##S)                \
+    SET_FN(MPR_VEC_LT, TYPE, lt_##S)                \
+    SET_FN(MPR_VEC_LE, TYPE, le_##S)                \
+    SET_FN(MPR_VEC_GT, TYPE, gt_##S)                \
+    SET_FN(MPR_VEC_GE, TYPE, ge_##S)                \
+    SET_FN(MPR_VEC_AND, TYPE, and_##S)              \
+    SET_FN(MPR_VEC_OR, TYPE, or_##S)                \
+    SET_FN(MPR_VEC_MIN, TYPE, min_##S)              \
+    SET_FN(MPR_VEC_MAX, TYPE, max_##S)              \
+    SET_FN(MPR_VEC_ABS, TYPE, abs_##S)              \
+    SET_REDUCE(MPR_VEC_SUM, TYPE, sum_##S)          \
+    SET_REDUCE(MPR_VEC_VMAX, TYPE, vmax_##S)        \
+    SET_REDUCE(MPR_VEC_VMIN, TYPE, vmin_##S)        \
+    SET_REDUCE(MPR_VEC_ALL, TYPE, all_##S)          \
+    SET_REDUCE(MPR_VEC_ANY, TYPE, any_##S)
+
+#define SET_INT_KERNELS(S)                          \
+    SET_COMMON_KERNELS(0, S)                        \
+    SET_FN(MPR_VEC_BAND, 0, band_##S)               \
+    SET_FN(MPR_VEC_BOR, 0, bor_##S)                 \
+    SET_FN(MPR_VEC_BXOR, 0, bxor_##S)
+
+#define SET_REAL_KERNELS(TYPE, S)                   \
+    SET_COMMON_KERNELS(TYPE, S)                     \
+    SET_FN(MPR_VEC_DIV, TYPE, div_##S)              \
+    SET_FN(MPR_VEC_SQRT, TYPE, sqrt_##S)
+
+#define SET_ROUNDING_KERNELS(TYPE, S)               \
+    SET_FN(MPR_VEC_FLOOR, TYPE, floor_##S)          \
+    SET_FN(MPR_VEC_CEIL, TYPE, ceil_##S)            \
+    SET_FN(MPR_VEC_TRUNC, TYPE, trunc_##S)
+
+#define SET_MATH_KERNELS(S)                         \
+    SET_FN(MPR_VEC_SIN, 1, sin_##S)                 \
+    SET_FN(MPR_VEC_COS, 1, cos_##S)                 \
+    SET_FN(MPR_VEC_EXP, 1, exp_##S)                 \
+    SET_FN(MPR_VEC_LOG, 1, log_##S)
+
+/* Runs once when the library is loaded, before any other thread can read the
+ * tables. */
+__attribute__((constructor)) static void init(void)
+{
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx")) {
+        trace("using AVX vector kernels\n");
+        SET_REAL_KERNELS(1, avx_f)
+        SET_REAL_KERNELS(2, avx_d)
+        SET_ROUNDING_KERNELS(1, avx_f)
+        SET_ROUNDING_KERNELS(2, avx_d)
+    }
+    else if (__builtin_cpu_supports("sse2")) {
+        trace("using SSE2 vector kernels\n");
+        SET_REAL_KERNELS(1, sse_f)
+        SET_REAL_KERNELS(2, sse_d)
+        if (__builtin_cpu_supports("sse4.1")) {
+            SET_ROUNDING_KERNELS(1, sse_f)
+            SET_ROUNDING_KERNELS(2, sse_d)
+        }
+    }
+    /* AVX has no 256-bit integer instructions so int32 kernels use SSE4.1 */
+    if (__builtin_cpu_supports("sse4.1")) {
+        SET_INT_KERNELS(sse_i)
+    }
+    /* the transcendental kernels need 256-bit integer instructions for AVX */
+    if (__builtin_cpu_supports("avx2")) {
+        SET_MATH_KERNELS(avx2_f)
+    }
+    else if (__builtin_cpu_supports("sse2")) {
+        SET_MATH_KERNELS(sse_f)
+    }
+}
+
+#endif /* HAVE_X86_KERNELS */
+
+mpr_vec_fn *mpr_vec_get_fn(mpr_vec_op op, mpr_type type)
+{
+    RETURN_UNLESS(op > MPR_VEC_NONE && op < MPR_VEC_N_FN, 0);
+    RETURN_UNLESS(MPR_INT32 == type || MPR_FLT == type || MPR_DBL == type, 0);
+    return fn_tbl[op][TYPE_IDX(type)];
+}
+
+mpr_vec_reduce_fn *mpr_vec_get_reduce_fn(mpr_vec_reduce_op op, mpr_type type)
+{
+    RETURN_UNLESS(op >= 0 && op < MPR_VEC_N_REDUCE, 0);
+    RETURN_UNLESS(MPR_INT32 == type || MPR_FLT == type || MPR_DBL == type, 0);
+    return reduce_tbl[op][TYPE_IDX(type)];
+}
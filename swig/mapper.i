@@ -259,6 +259,11 @@ typedef struct _map_list {
     mpr_list list;
 } map_list;
 
+typedef struct _query {
+    mpr_qry qry;
+    PyObject *cb;
+} query;
+
 typedef struct {
     void *val;
     int len;
@@ -950,6 +955,7 @@ static named_prop get_obj_prop_by_idx(mpr_obj obj, int idx) {
 %constant int PROP_DATA                 = MPR_PROP_DATA;
 %constant int PROP_VERSION              = MPR_PROP_VERSION;
 %constant int PROP_EXTRA                = MPR_PROP_EXTRA;
+%constant int PROP_JIT                  = MPR_PROP_JIT;
 
 /*! Possible operations for composing graph queries. */
 %constant int OP_NEX                    = MPR_OP_NEX;
@@ -971,6 +977,10 @@ static named_prop get_obj_prop_by_idx(mpr_obj obj, int idx) {
 %constant int PROTO_UNDEFINED           = MPR_PROTO_UNDEFINED;
 %constant int PROTO_UDP                 = MPR_PROTO_UDP;
 %constant int PROTO_TCP                 = MPR_PROTO_TCP;
+%constant int PROTO_UDP_PACKED          = MPR_PROTO_UDP_PACKED;
+%constant int PROTO_TCP_PACKED          = MPR_PROTO_TCP_PACKED;
+%constant int PROTO_UDP_COMPACT         = MPR_PROTO_UDP_COMPACT;
+%constant int PROTO_TCP_COMPACT         = MPR_PROTO_TCP_COMPACT;
 
 /*! The set of possible directions for a signal. */
 %constant int DIR_UNDEFINED             = MPR_DIR_UNDEFINED;
@@ -991,6 +1001,8 @@ static named_prop get_obj_prop_by_idx(mpr_obj obj, int idx) {
 %constant int STEAL_NONE                = MPR_STEAL_NONE;
 %constant int STEAL_OLDEST              = MPR_STEAL_OLDEST;
 %constant int STEAL_NEWEST              = MPR_STEAL_NEWEST;
+%constant int STEAL_STALEST             = MPR_STEAL_STALEST;
+%constant int STEAL_QUIETEST            = MPR_STEAL_QUIETEST;
 
 /*! The set of possible events for a graph record, used to inform callbacks
  *  of what is happening to a record. */
@@ -1732,6 +1744,63 @@ typedef struct _map_list {
     }
 }
 
+typedef struct _query {
+    mpr_qry qry;
+} query;
+
+%extend _query {
+    ~_query() {
+        mpr_qry_free($self->qry);
+        Py_XDECREF($self->cb);
+        free($self);
+    }
+    query *filter(const char *key, propval val=0, mpr_op op=MPR_OP_EQ) {
+        if (key && val) {
+            mpr_qry_add_filter($self->qry, MPR_PROP_UNKNOWN, key, val->len,
+                               val->type, val->val, op);
+        }
+        return $self;
+    }
+    query *filter(int prop, propval val=0, mpr_op op=MPR_OP_EQ) {
+        if (val) {
+            mpr_qry_add_filter($self->qry, prop, NULL, val->len, val->type,
+                               val->val, op);
+        }
+        return $self;
+    }
+    int length() {
+        return mpr_qry_get_size($self->qry);
+    }
+    PyObject *get(int idx) {
+        mpr_obj obj = mpr_qry_get_idx($self->qry, idx);
+        switch (obj ? mpr_obj_get_type(obj) : 0) {
+            case MPR_DEV:
+                return SWIG_NewPointerObj(SWIG_as_voidptr(obj), SWIGTYPE_p__device, 0);
+            case MPR_SIG:
+                return SWIG_NewPointerObj(SWIG_as_voidptr(obj), SWIGTYPE_p__signal, 0);
+            case MPR_MAP:
+                return SWIG_NewPointerObj(SWIG_as_voidptr(obj), SWIGTYPE_p__map, 0);
+            default:
+                Py_INCREF(Py_None);
+                return Py_None;
+        }
+    }
+    %pythoncode {
+        def __len__(self):
+            return self.length()
+        def __getitem__(self, idx):
+            if idx < 0 or idx >= self.length():
+                raise IndexError('query index out of range')
+            return self.get(idx)
+    }
+}
+
+// keep the graph alive for as long as its queries are in use
+%feature("pythonappend") _graph::query %{
+    if val:
+        val.graph = self
+%}
+
 %extend _graph {
     _graph(int flags=0x00) {
         return (graph*)mpr_graph_new(flags);
@@ -1797,6 +1866,21 @@ typedef struct _map_list {
         ret->list = mpr_graph_get_objs((mpr_graph)$self, MPR_MAP);
         return ret;
     }
+    query *query(int type, device *dev=0, int dir=MPR_DIR_ANY,
+                 PyObject *PyFunc=0) {
+        query *ret = malloc(sizeof(struct _query));
+        if (PyFunc == Py_None)
+            PyFunc = 0;
+        ret->qry = mpr_graph_new_qry((mpr_graph)$self, type, (mpr_dev)dev, dir,
+                                     PyFunc ? graph_handler_py : 0, PyFunc);
+        if (!ret->qry) {
+            free(ret);
+            return 0;
+        }
+        ret->cb = PyFunc;
+        Py_XINCREF(PyFunc);
+        return ret;
+    }
     %pythoncode {
         interface = property(get_interface, set_interface)
         address = property(get_address, set_address)
@@ -140,6 +140,13 @@ q1.join(g.signals().filter("name", "*req"))
 for i in q1:
     print("    ", i['name'])
 
+# live query
+print('live query of signals matching \'out*\':')
+q2 = g.query(mpr.SIG)
+q2.filter("name", "out*")
+for i in q2:
+    print("    ", i['name'])
+
 tt1 = mpr.timetag(0.5)
 tt2 = mpr.timetag(2.5)
 tt3 = tt1 + 0.5
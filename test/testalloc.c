@@ -0,0 +1,237 @@
+#include <mapper/mapper.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <signal.h>
+#include <string.h>
+
+/* Count heap allocations made while updating an output signal mapped to an
+ * input of the same device and to inputs of another device over UDP and TCP,
+ * and processing the device outputs. Once every bundle slot has been used the
+ * outgoing messages and bundle buffers are reused, so the steady state should
+ * not allocate. */
+
+#define eprintf(format, ...) do {               \
+    if (verbose)                                \
+        fprintf(stdout, format, ##__VA_ARGS__); \
+} while(0)
+
+int verbose = 1;
+int terminate = 0;
+int done = 0;
+int iterations = 10000;
+
+mpr_dev dev = 0;
+mpr_dev dst = 0;
+mpr_sig sendsig = 0;
+mpr_sig recvsig = 0;
+mpr_sig remotesig = 0;
+mpr_sig tcpsig = 0;
+
+int received = 0;
+int received_remote = 0;
+int received_tcp = 0;
+
+volatile int counting = 0;
+volatile int num_allocs = 0;
+
+#ifdef __GLIBC__
+/* Interpose the allocator so that calls made from libmapper and liblo are
+ * counted too. */
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t num, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+
+void *malloc(size_t size)
+{
+    if (counting)
+        ++num_allocs;
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t num, size_t size)
+{
+    if (counting)
+        ++num_allocs;
+    return __libc_calloc(num, size);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+    if (counting)
+        ++num_allocs;
+    return __libc_realloc(ptr, size);
+}
+#define CAN_COUNT_ALLOCS 1
+#else
+#define CAN_COUNT_ALLOCS 0
+#endif
+
+void handler(mpr_sig sig, mpr_sig_evt event, mpr_id instance, int length,
+             mpr_type type, const void *value, mpr_time t)
+{
+    if (!value)
+        return;
+    if (sig == recvsig)
+        ++received;
+    else if (sig == tcpsig)
+        ++received_tcp;
+    else
+        ++received_remote;
+}
+
+void wait_ready(mpr_map map)
+{
+    while (!done && !mpr_map_get_is_ready(map)) {
+        mpr_dev_poll(dev, 10);
+        mpr_dev_poll(dst, 10);
+    }
+}
+
+int setup()
+{
+    dev = mpr_dev_new("testalloc", 0);
+    dst = mpr_dev_new("testalloc-recv", 0);
+    if (!dev || !dst)
+        return 1;
+    sendsig = mpr_sig_new(dev, MPR_DIR_OUT, "outsig", 1, MPR_FLT, NULL,
+                          NULL, NULL, NULL, NULL, 0);
+    recvsig = mpr_sig_new(dev, MPR_DIR_IN, "insig", 1, MPR_FLT, NULL,
+                          NULL, NULL, NULL, handler, MPR_SIG_UPDATE);
+    remotesig = mpr_sig_new(dst, MPR_DIR_IN, "insig", 1, MPR_FLT, NULL,
+                            NULL, NULL, NULL, handler, MPR_SIG_UPDATE);
+    tcpsig = mpr_sig_new(dst, MPR_DIR_IN, "tcpsig", 1, MPR_FLT, NULL,
+                         NULL, NULL, NULL, handler, MPR_SIG_UPDATE);
+    if (!sendsig || !recvsig || !remotesig || !tcpsig)
+        return 1;
+
+    while (!done && !(mpr_dev_get_is_ready(dev) && mpr_dev_get_is_ready(dst))) {
+        mpr_dev_poll(dev, 25);
+        mpr_dev_poll(dst, 25);
+    }
+    eprintf("Devices are ready.\n");
+
+    mpr_map map = mpr_map_new(1, &sendsig, 1, &recvsig);
+    mpr_obj_push(map);
+    wait_ready(map);
+    map = mpr_map_new(1, &sendsig, 1, &remotesig);
+    mpr_obj_push(map);
+    wait_ready(map);
+    int proto = MPR_PROTO_TCP;
+    map = mpr_map_new(1, &sendsig, 1, &tcpsig);
+    mpr_obj_set_prop((mpr_obj)map, MPR_PROP_PROTOCOL, NULL, 1, MPR_INT32, &proto, 1);
+    mpr_obj_push(map);
+    wait_ready(map);
+    eprintf("Maps are ready.\n");
+    return done;
+}
+
+/*! Update the output signal and send the bundles without polling the source
+ *  device, since receiving admin messages allocates. Only the source side is
+ *  counted. */
+void update(int num, int count)
+{
+    int i;
+    float value;
+    for (i = 0; i < num && !done; i++) {
+        value = (float)i;
+        counting = count;
+        mpr_sig_set_value(sendsig, 0, 1, MPR_FLT, &value);
+        mpr_dev_process_outputs(dev);
+        counting = 0;
+        mpr_dev_poll(dst, 0);
+    }
+}
+
+void ctrlc(int sig)
+{
+    done = 1;
+}
+
+int main(int argc, char **argv)
+{
+    int i, j, result = 0;
+
+    // process flags for -q quiet, -f fast (terminate), -h help
+    for (i = 1; i < argc; i++) {
+        if (argv[i] && argv[i][0] == '-') {
+            int len = strlen(argv[i]);
+            for (j = 1; j < len; j++) {
+                switch (argv[i][j]) {
+                    case 'h':
+                        printf("testalloc.c: possible arguments "
+                               "-q quiet (suppress output), "
+                               "-f fast (execute quickly), "
+                               "-h help, "
+                               "--num_iterations <int> (default %d)\n",
+                               iterations);
+                        return 1;
+                        break;
+                    case 'q':
+                        verbose = 0;
+                        break;
+                    case 'f':
+                        terminate = 1;
+                        break;
+                    case '-':
+                        if (++j < len && strcmp(argv[i]+j, "num_iterations")==0) {
+                            if (++i < argc)
+                                iterations = atoi(argv[i]);
+                        }
+                        j = len;
+                        break;
+                    default:
+                        break;
+                }
+            }
+        }
+    }
+
+    if (terminate && iterations > 1000)
+        iterations = 1000;
+
+    signal(SIGINT, ctrlc);
+
+    if (setup()) {
+        eprintf("Error initializing device.\n");
+        result = 1;
+        goto done;
+    }
+
+    // fill the message pools and bundle buffers for every bundle slot
+    update(100, 0);
+    received = received_remote = received_tcp = 0;
+
+    update(iterations, 1);
+    mpr_dev_poll(dst, 100);
+
+    eprintf("%d updates, %d received locally, %d remotely over UDP, %d over TCP, "
+            "%d allocations\n", iterations, received, received_remote, received_tcp,
+            num_allocs);
+    if (received != iterations) {
+        eprintf("Error: expected %d local updates\n", iterations);
+        result = 1;
+    }
+    if (!received_remote) {
+        eprintf("Error: no remote updates received\n");
+        result = 1;
+    }
+    if (!received_tcp) {
+        eprintf("Error: no remote updates received over TCP\n");
+        result = 1;
+    }
+    if (!CAN_COUNT_ALLOCS)
+        eprintf("Allocation counting is not supported on this platform.\n");
+    else if (num_allocs) {
+        eprintf("Error: steady-state output allocated memory\n");
+        result = 1;
+    }
+
+  done:
+    if (dev)
+        mpr_dev_free(dev);
+    if (dst)
+        mpr_dev_free(dst);
+    printf("..................................................Test %s\x1B[0m.\n",
+           result ? "\x1B[31mFAILED" : "\x1B[32mPASSED");
+    return result;
+}
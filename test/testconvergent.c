@@ -17,12 +17,14 @@ int terminate = 0;
 int autoconnect = 1;
 int done = 0;
 int period = 100;
-int config, num_configs = 3;
+int config, num_configs = 4;
 
 mpr_dev *srcs = 0;
 mpr_dev dst = 0;
 mpr_sig *sendsigs = 0;
+mpr_sig *instsigs = 0;
 mpr_sig recvsig = 0;
+mpr_sig recvinst = 0;
 mpr_map map = 0;
 
 int sent = 0;
@@ -32,10 +34,11 @@ float expected;
 
 int setup_srcs()
 {
-    int i, mni=0, mxi=1;
+    int i, mni=0, mxi=1, num_inst=4;
 
     srcs = (mpr_dev*)calloc(1, num_sources * sizeof(mpr_dev));
     sendsigs = (mpr_sig*)calloc(1, num_sources * sizeof(mpr_sig));
+    instsigs = (mpr_sig*)calloc(1, num_sources * sizeof(mpr_sig));
 
     for (i = 0; i < num_sources; i++) {
         srcs[i] = mpr_dev_new("testconvergent-send", 0);
@@ -45,6 +48,10 @@ int setup_srcs()
                                   MPR_INT32, NULL, &mni, &mxi, NULL, NULL, 0);
         if (!sendsigs[i])
             goto error;
+        instsigs[i] = mpr_sig_new(srcs[i], MPR_DIR_OUT, "instsig", 1, MPR_INT32,
+                                  NULL, &mni, &mxi, &num_inst, NULL, 0);
+        if (!instsigs[i])
+            goto error;
         eprintf("source %d created.\n", i);
     }
     return 0;
@@ -69,6 +76,7 @@ void cleanup_src()
     }
     free(srcs);
     free(sendsigs);
+    free(instsigs);
 }
 
 void handler(mpr_sig sig, mpr_sig_evt evt, mpr_id instance, int length,
@@ -81,6 +89,8 @@ void handler(mpr_sig sig, mpr_sig_evt evt, mpr_id instance, int length,
     }
     else {
         eprintf("handler: Got NULL\n");
+        if (sig == recvinst)
+            mpr_sig_release_inst(sig, instance);
     }
 }
 
@@ -92,8 +102,11 @@ int setup_dst()
     eprintf("destination created.\n");
 
     float mn=0, mx=1;
+    int num_inst=4;
     recvsig = mpr_sig_new(dst, MPR_DIR_IN, "recvsig", 1, MPR_FLT, NULL,
                           &mn, &mx, NULL, handler, MPR_SIG_UPDATE);
+    recvinst = mpr_sig_new(dst, MPR_DIR_IN, "recvinst", 1, MPR_FLT, NULL,
+                           &mn, &mx, &num_inst, handler, MPR_SIG_UPDATE);
 
     eprintf("Input signal 'insig' registered.\n");
     mpr_list l = mpr_dev_get_sigs(dst, MPR_DIR_IN);
@@ -162,6 +175,21 @@ int setup_maps()
             map = mpr_map_new_from_str("%y=%x-_%x+_%x", recvsig, sendsigs[0],
                                        sendsigs[1], sendsigs[2]);
             break;
+        case 3: {
+            /* instanced map where only the first source is ever updated: new
+             * instances trigger a dry-run evaluation with the other source
+             * missing, which must not touch the memoized subexpression */
+            if (!(map = mpr_map_new(2, instsigs, 1, &recvinst))) {
+                eprintf("Failed to create map\n");
+                return 1;
+            }
+            int a = mpr_map_get_sig_idx(map, instsigs[0]);
+            int b = mpr_map_get_sig_idx(map, instsigs[1]);
+            char expr[64];
+            snprintf(expr, 64, "alive=x%d>=0&&(x%d*x%d+x%d*3)>=0;y=x%d+1", a, b, b, b, a);
+            mpr_obj_set_prop(map, MPR_PROP_EXPR, NULL, 1, MPR_STR, expr, 1);
+            break;
+        }
     }
 
     mpr_obj_push(map);
@@ -202,8 +230,18 @@ void loop()
 
     while ((!terminate || i < 50) && !done) {
         for (j = num_sources-1; j >= 0; j--) {
-            eprintf("Updating source %d = %i\n", j, i);
-            mpr_sig_set_value(sendsigs[j], 0, 1, MPR_INT32, &i);
+            if (3 == config) {
+                // only update the first source, using a new instance each time
+                if (0 == j) {
+                    eprintf("Updating source %d instance %d = %i\n", j, i % 4, i);
+                    mpr_sig_set_value(instsigs[j], i % 4, 1, MPR_INT32, &i);
+                    mpr_sig_release_inst(instsigs[j], (i + 2) % 4);
+                }
+            }
+            else {
+                eprintf("Updating source %d = %i\n", j, i);
+                mpr_sig_set_value(sendsigs[j], 0, 1, MPR_INT32, &i);
+            }
             mpr_dev_poll(srcs[j], 0);
         }
         switch (config) {
@@ -216,6 +254,9 @@ void loop()
             case 2:
                 expected = i;
                 break;
+            case 3:
+                expected = i + 1;
+                break;
         }
         sent++;
         mpr_dev_poll(dst, period);
@@ -295,6 +336,8 @@ int main(int argc, char **argv)
     if (autoconnect) {
         for (i = 0; i < num_configs; i++) {
             config = i;
+            if (3 == config && num_sources < 2)
+                break;
             if (setup_maps()) {
                 eprintf("Error setting map (1).\n");
                 result = 1;
@@ -274,6 +274,14 @@ int main(int argc, char ** argv)
             << " inputs)" << std::endl;
     }
 
+    // try a live query
+    out << "live query of devices with name matching 'my*'" << std::endl;
+    Query<Device> live = graph.device_query();
+    live.filter(Property(MPR_PROP_NAME, "my*"), MPR_OP_EQ);
+    for (int j = 0; j < live.size(); j++) {
+        out << "  " << live[j] << std::endl;
+    }
+
     // check graph records
     out << "graph records:" << std::endl;
     for (const Device d : graph.devices()) {
@@ -327,6 +335,16 @@ int main(int argc, char ** argv)
         }
     }
 
+    // update several instances at once
+    std::vector<mpr_id> ids;
+    std::vector<float> vals;
+    for (int i = 5; i < 15; i++) {
+        ids.push_back(i);
+        vals.push_back(i * 1.0f);
+    }
+    multisend.set_values(ids, vals);
+    dev.poll(period);
+
     // test some time manipulation
     Time t1(10, 200);
     Time t2(10, 300);
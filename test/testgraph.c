@@ -1,6 +1,7 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <time.h>
 #include <lo/lo_lowlevel.h>
 #include "../src/mapper_internal.h"
 
@@ -17,6 +18,17 @@ void printobject(mpr_obj obj)
         mpr_obj_print(obj, 0);
 }
 
+// count the changes reported by a live query: added, removed and modified
+void qry_handler(mpr_graph g, mpr_obj obj, const mpr_graph_evt evt, const void *data)
+{
+    int *counts = (int*)data;
+    switch (evt) {
+        case MPR_OBJ_NEW:   ++counts[0];    break;
+        case MPR_OBJ_REM:   ++counts[1];    break;
+        default:            ++counts[2];    break;
+    }
+}
+
 int main(int argc, char **argv)
 {
     int i, j, result = 0;
@@ -577,6 +589,46 @@ int main(int argc, char **argv)
 
     /*********/
 
+    eprintf("\nFind devices with property 'port'<5678 after moving one device:\n");
+
+    // the property index is updated for the modified device only
+    for (i = 0; i < 2; i++) {
+        lom = lo_message_new();
+        if (!lom) {
+            result = 1;
+            goto done;
+        }
+        lo_message_add_string(lom, "@port");
+        lo_message_add_int32(lom, i ? 1234 : 6000);
+        if (!(props = mpr_msg_parse_props(lo_message_get_argc(lom),
+                                          lo_message_get_types(lom),
+                                          lo_message_get_argv(lom)))) {
+            eprintf("Error, parsing failed.\n");
+            result = 1;
+            goto done;
+        }
+        mpr_graph_add_dev(graph, "testgraph.1", props);
+        mpr_msg_free(props);
+        lo_message_free(lom);
+
+        devlist = mpr_graph_get_objs(graph, MPR_DEV);
+        devlist = mpr_list_filter(devlist, MPR_PROP_PORT, NULL, 1, MPR_INT32, &port,
+                                  MPR_OP_LT);
+        count = 0;
+        while (devlist) {
+            ++count;
+            printobject(*devlist);
+            devlist = mpr_list_get_next(devlist);
+        }
+        if (count != (i ? 3 : 2)) {
+            eprintf("Expected %d records, but counted %d.\n", i ? 3 : 2, count);
+            result = 1;
+            goto done;
+        }
+    }
+
+    /*********/
+
     eprintf("\nFind devices with property 'num_outputs'==2:\n");
     int temp = 2;
     devlist = mpr_graph_get_objs(graph, MPR_DEV);
@@ -1049,8 +1101,6 @@ int main(int argc, char **argv)
         goto done;
     }
 
-    goto done;
-
     /*********/
 
     eprintf("\nFind maps for source device 'testgraph__.2', signal 'out1'"
@@ -1245,6 +1295,232 @@ int main(int argc, char **argv)
     }
 
     /*********/
+
+    eprintf("\nLook up objects in a large graph by id and name:\n");
+
+    mpr_graph big = mpr_graph_new(0);
+    int num_devs = 200, num_sigs = 50;
+    char name[64], dst_name[64];
+    const char *src_name = name;
+    clock_t start;
+
+    start = clock();
+    for (i = 0; i < num_devs; i++) {
+        snprintf(name, 64, "scaledev.%d", i + 1);
+        dev = mpr_graph_add_dev(big, name, 0);
+        for (j = 0; j < num_sigs; j++) {
+            snprintf(name, 64, "sig%d", j);
+            sig = mpr_graph_add_sig(big, name, dev->obj.name, 0);
+            sig->obj.id = dev->obj.id | (i * num_sigs + j + 1);
+            mpr_graph_reindex_obj(big, (mpr_obj)sig);
+        }
+    }
+    for (i = 1; i < num_devs; i++) {
+        snprintf(name, 64, "scaledev.%d/sig0", i);
+        snprintf(dst_name, 64, "scaledev.%d/sig1", i + 1);
+        mpr_graph_add_map(big, 1000 + i, 1, &src_name, dst_name);
+    }
+    eprintf("  added %d devices, %d signals and %d maps in %.3f s\n", num_devs,
+            num_devs * num_sigs, num_devs - 1,
+            (double)(clock() - start) / CLOCKS_PER_SEC);
+
+    start = clock();
+    for (i = 0; i < num_devs; i++) {
+        snprintf(name, 64, "scaledev.%d", i + 1);
+        if (!(dev = mpr_graph_get_dev_by_name(big, name))
+            || dev != (mpr_dev)mpr_graph_get_obj(big, MPR_DEV, dev->obj.id)) {
+            eprintf("failed to find device '%s'.\n", name);
+            result = 1;
+            break;
+        }
+        for (j = 0; j < num_sigs; j++) {
+            snprintf(name, 64, "sig%d", j);
+            sig = mpr_dev_get_sig_by_name(dev, name);
+            if (!sig || sig != (mpr_sig)mpr_graph_get_obj(big, MPR_SIG, sig->obj.id)) {
+                eprintf("failed to find signal '%s/%s'.\n", dev->obj.name, name);
+                result = 1;
+                break;
+            }
+        }
+    }
+    for (i = 1; i < num_devs && !result; i++) {
+        mpr_map map;
+        snprintf(name, 64, "scaledev.%d/sig0", i);
+        snprintf(dst_name, 64, "scaledev.%d/sig1", i + 1);
+        map = mpr_graph_get_map_by_names(big, 1, &src_name, dst_name);
+        if (!map || map != (mpr_map)mpr_graph_get_obj(big, MPR_MAP, 1000 + i)) {
+            eprintf("failed to find map '%s' -> '%s'.\n", name, dst_name);
+            result = 1;
+        }
+    }
+    eprintf("  looked up every object by name and id in %.3f s\n",
+            (double)(clock() - start) / CLOCKS_PER_SEC);
+
+    start = clock();
+    for (i = 0; i < num_devs && !result; i++) {
+        // devices in the middle of the chain have one incoming and one outgoing map
+        int num_maps = (i == 0 || i == num_devs - 1) ? 1 : 2;
+        snprintf(name, 64, "scaledev.%d", i + 1);
+        dev = mpr_graph_get_dev_by_name(big, name);
+        siglist = mpr_dev_get_sigs(dev, MPR_DIR_ANY);
+        maplist = mpr_dev_get_maps(dev, MPR_DIR_ANY);
+        devlist = mpr_dev_get_links(dev, MPR_DIR_ANY);
+        if (mpr_list_get_size(siglist) != num_sigs
+            || mpr_list_get_size(maplist) != num_maps
+            || mpr_list_get_size(devlist) != num_maps) {
+            eprintf("wrong number of signals, maps or links for device '%s'.\n", name);
+            result = 1;
+        }
+        mpr_list_free(siglist);
+        mpr_list_free(maplist);
+        mpr_list_free(devlist);
+    }
+    eprintf("  enumerated the signals, maps and links of every device in %.3f s\n",
+            (double)(clock() - start) / CLOCKS_PER_SEC);
+
+    // filters on the whole signal list should agree with a scan of the graph
+    sig = mpr_dev_get_sig_by_name(mpr_graph_get_dev_by_name(big, "scaledev.100"), "sig25");
+    mpr_id mid_id = sig->obj.id;
+    int num_lt = 0;
+    siglist = mpr_graph_get_objs(big, MPR_SIG);
+    while (siglist) {
+        if ((*siglist)->id < mid_id)
+            ++num_lt;
+        siglist = mpr_list_get_next(siglist);
+    }
+    start = clock();
+    for (i = 0; i < 100 && !result; i++) {
+        int size;
+        siglist = mpr_list_filter(mpr_graph_get_objs(big, MPR_SIG), MPR_PROP_NAME,
+                                  NULL, 1, MPR_STR, "sig7", MPR_OP_EQ);
+        if ((size = mpr_list_get_size(siglist)) != num_devs) {
+            eprintf("expected %d signals named 'sig7', found %d.\n", num_devs, size);
+            result = 1;
+        }
+        mpr_list_free(siglist);
+        // sig1 and sig10-sig19
+        siglist = mpr_list_filter(mpr_graph_get_objs(big, MPR_SIG), MPR_PROP_NAME,
+                                  NULL, 1, MPR_STR, "sig1*", MPR_OP_EQ);
+        if ((size = mpr_list_get_size(siglist)) != num_devs * 11) {
+            eprintf("expected %d signals matching 'sig1*', found %d.\n", num_devs * 11, size);
+            result = 1;
+        }
+        mpr_list_free(siglist);
+        siglist = mpr_list_filter(mpr_graph_get_objs(big, MPR_SIG), MPR_PROP_ID,
+                                  NULL, 1, MPR_INT64, &mid_id, MPR_OP_LT);
+        if ((size = mpr_list_get_size(siglist)) != num_lt) {
+            eprintf("expected %d signals with lower id, found %d.\n", num_lt, size);
+            result = 1;
+        }
+        mpr_list_free(siglist);
+    }
+    eprintf("  ran 300 filters on %d signals in %.3f s\n", num_devs * num_sigs,
+            (double)(clock() - start) / CLOCKS_PER_SEC);
+
+    // indexed filters should return signals in the order of the graph list
+    for (i = 0; i < 2 && !result; i++) {
+        mpr_list scan = mpr_graph_get_objs(big, MPR_SIG);
+        if (i)
+            siglist = mpr_list_filter(mpr_graph_get_objs(big, MPR_SIG), MPR_PROP_ID,
+                                      NULL, 1, MPR_INT64, &mid_id, MPR_OP_LT);
+        else
+            siglist = mpr_list_filter(mpr_graph_get_objs(big, MPR_SIG), MPR_PROP_NAME,
+                                      NULL, 1, MPR_STR, "sig1*", MPR_OP_EQ);
+        while (scan && !result) {
+            const char *name = mpr_obj_get_prop_as_str(*scan, MPR_PROP_NAME, NULL);
+            if (i ? (*scan)->id < mid_id : 0 == strncmp(name, "sig1", 4)) {
+                if (!siglist || *siglist != *scan) {
+                    eprintf("filtered signals are not in graph order.\n");
+                    result = 1;
+                }
+                else
+                    siglist = mpr_list_get_next(siglist);
+            }
+            scan = mpr_list_get_next(scan);
+        }
+        if (siglist && !result) {
+            eprintf("filter returned signals that do not match.\n");
+            result = 1;
+        }
+        mpr_list_free(scan);
+        mpr_list_free(siglist);
+    }
+
+    // live queries are filled when created and then only see changes
+    int qry_counts[3] = {0, 0, 0};
+    mpr_qry sig_qry = mpr_graph_new_qry(big, MPR_SIG, NULL, MPR_DIR_ANY, qry_handler,
+                                        qry_counts);
+    mpr_qry_add_filter(sig_qry, MPR_PROP_NAME, NULL, 1, MPR_STR, "sig7", MPR_OP_EQ);
+    mpr_qry map_qry = mpr_graph_new_qry(big, MPR_MAP,
+                                        mpr_graph_get_dev_by_name(big, "scaledev.100"),
+                                        MPR_DIR_IN, NULL, NULL);
+    // results dropped by the new filter are reported as removed
+    if (mpr_qry_get_size(sig_qry) != num_devs || mpr_qry_get_size(map_qry) != 1
+        || qry_counts[0] || qry_counts[1] != num_devs * (num_sigs - 1)) {
+        eprintf("live queries found %d signals and %d maps.\n",
+                mpr_qry_get_size(sig_qry), mpr_qry_get_size(map_qry));
+        result = 1;
+    }
+    qry_counts[1] = 0;
+
+    if (!result) {
+        // renamed and removed objects must leave the indexes
+        dev = mpr_graph_get_dev_by_name(big, "scaledev.1");
+        sig = mpr_dev_get_sig_by_name(dev, "sig0");
+        mpr_id sig_id = sig->obj.id;
+        sig->obj.id = 1;
+        mpr_graph_reindex_obj(big, (mpr_obj)sig);
+        mpr_graph_remove_dev(big, dev, MPR_OBJ_REM, 1);
+        if (mpr_graph_get_dev_by_name(big, "scaledev.1")
+            || mpr_graph_get_obj(big, MPR_SIG, sig_id)
+            || mpr_graph_get_obj(big, MPR_SIG, 1)) {
+            eprintf("found object after it was removed.\n");
+            result = 1;
+        }
+        // the name index must be rebuilt without the removed signals
+        siglist = mpr_list_filter(mpr_graph_get_objs(big, MPR_SIG), MPR_PROP_NAME,
+                                  NULL, 1, MPR_STR, "sig7", MPR_OP_EQ);
+        if (mpr_list_get_size(siglist) != num_devs - 1) {
+            eprintf("filter returned a removed signal.\n");
+            result = 1;
+        }
+        mpr_list_free(siglist);
+    }
+
+    if (!result) {
+        // live queries should have dropped the removed signal and pick up new ones
+        if (mpr_qry_get_size(sig_qry) != num_devs - 1 || qry_counts[1] != 1) {
+            eprintf("live query has %d signals after removing a device.\n",
+                    mpr_qry_get_size(sig_qry));
+            result = 1;
+        }
+        mpr_graph_add_sig(big, "sig7", "scaledev.new", 0);
+        mpr_graph_add_sig(big, "sig8", "scaledev.new", 0);
+        if (mpr_qry_get_size(sig_qry) != num_devs || qry_counts[0] != 1) {
+            eprintf("live query has %d signals after adding a device.\n",
+                    mpr_qry_get_size(sig_qry));
+            result = 1;
+        }
+        for (i = 0; i < mpr_qry_get_size(sig_qry); i++) {
+            sig = (mpr_sig)mpr_qry_get_idx(sig_qry, i);
+            if (strcmp(mpr_obj_get_prop_as_str((mpr_obj)sig, MPR_PROP_NAME, NULL), "sig7")) {
+                eprintf("live query returned signal '%s'.\n", sig->obj.name);
+                result = 1;
+                break;
+            }
+        }
+        if (mpr_qry_get_idx(sig_qry, num_devs)) {
+            eprintf("live query returned an object past its end.\n");
+            result = 1;
+        }
+    }
+    // map_qry is freed along with the graph
+    mpr_qry_free(sig_qry);
+    mpr_graph_free(big);
+    if (result)
+        goto done;
+
+    /*********/
 done:
     mpr_graph_free(graph);
     if (!verbose)
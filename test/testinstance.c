@@ -7,6 +7,7 @@
 #include <unistd.h>
 #include <signal.h>
 #include <string.h>
+#include <sys/time.h>
 
 #define eprintf(format, ...) do {               \
     if (verbose)                                \
@@ -19,6 +20,7 @@ int iterations = 100;
 int autoconnect = 1;
 int period = 100;
 int automate = 1;
+int bench_inst = 128;
 
 mpr_dev src = 0;
 mpr_dev dst = 0;
@@ -404,6 +406,90 @@ void ctrlc(int sig)
     done = 1;
 }
 
+/*! Internal function to get the current time. */
+static double current_time()
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (double) tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+/*! Benchmark instance lookup with a large number of active instances: every
+ *  update is resolved by LID on the source and by GID on the destination. */
+int run_benchmark()
+{
+    int i, j, result = 0;
+    float valf;
+    double then, elapsed;
+
+    eprintf("Benchmark: %d active instances\n", bench_inst);
+    mpr_sig sendsig = mpr_sig_new(src, MPR_DIR_OUT, "benchsend", 1, MPR_FLT, NULL,
+                                  NULL, NULL, &bench_inst, NULL, 0);
+    mpr_sig recvsig = mpr_sig_new(dst, MPR_DIR_IN, "benchrecv", 1, MPR_FLT, NULL,
+                                  NULL, NULL, &bench_inst, NULL, 0);
+    if (!sendsig || !recvsig)
+        return 1;
+
+    mpr_map map = mpr_map_new(1, &sendsig, 1, &recvsig);
+    mpr_obj_push((mpr_obj)map);
+    while (!done && !mpr_map_get_is_ready(map)) {
+        mpr_dev_poll(src, 10);
+        mpr_dev_poll(dst, 10);
+    }
+
+    then = current_time();
+    for (i = 0; i < iterations && !done; i++) {
+        for (j = 0; j < bench_inst; j++) {
+            valf = i + j;
+            mpr_sig_set_value(sendsig, j, 1, MPR_FLT, &valf);
+        }
+        mpr_dev_poll(src, 0);
+        mpr_dev_poll(dst, 0);
+    }
+    elapsed = current_time() - then;
+    mpr_dev_poll(src, period);
+    mpr_dev_poll(dst, period);
+
+    i = mpr_sig_get_num_inst(recvsig, MPR_STATUS_ACTIVE);
+    eprintf("  %d updates in %f seconds (%.2f us/update), %d destination "
+            "instances active\n", iterations * bench_inst, elapsed,
+            elapsed * 1e6 / (iterations * bench_inst), i);
+    if (i != bench_inst) {
+        eprintf("  expected %d active destination instances\n", bench_inst);
+        result = 1;
+    }
+
+    // repeat with all instances updated in a single call
+    mpr_id *ids = malloc(bench_inst * sizeof(mpr_id));
+    float *vals = malloc(bench_inst * sizeof(float));
+    for (j = 0; j < bench_inst; j++)
+        ids[j] = j;
+    then = current_time();
+    for (i = 0; i < iterations && !done; i++) {
+        for (j = 0; j < bench_inst; j++)
+            vals[j] = i + j;
+        mpr_sig_set_values(sendsig, bench_inst, ids, 1, MPR_FLT, vals, 0);
+        mpr_dev_poll(src, 0);
+        mpr_dev_poll(dst, 0);
+    }
+    elapsed = current_time() - then;
+    mpr_dev_poll(src, period);
+    mpr_dev_poll(dst, period);
+    eprintf("  %d batched updates in %f seconds (%.2f us/update)\n",
+            iterations * bench_inst, elapsed,
+            elapsed * 1e6 / (iterations * bench_inst));
+    if (mpr_sig_get_num_inst(recvsig, MPR_STATUS_ACTIVE) != bench_inst) {
+        eprintf("  expected %d active destination instances\n", bench_inst);
+        result = 1;
+    }
+    free(ids);
+    free(vals);
+
+    mpr_sig_free(sendsig);
+    mpr_sig_free(recvsig);
+    return result;
+}
+
 int run_test(test_config *config)
 {
     mpr_sig *src_ptr, *dst_ptr;
@@ -619,7 +705,9 @@ int main(int argc, char **argv)
                                "-f fast (execute quickly), "
                                "-q quiet (suppress output), "
                                "-t terminate automatically, "
-                               "-h help\n");
+                               "-h help, "
+                               "--num_inst <int> instances for benchmark "
+                               "(default and maximum %d)\n", bench_inst);
                         return 1;
                         break;
                     case 'f':
@@ -631,6 +719,13 @@ int main(int argc, char **argv)
                     case 't':
                         terminate = 1;
                         break;
+                    case '-':
+                        if (++j < len && strcmp(argv[i]+j, "num_inst")==0)
+                            if (++i < argc && atoi(argv[i]) > 0
+                                && atoi(argv[i]) < bench_inst)
+                                bench_inst = atoi(argv[i]);
+                        j = len;
+                        break;
                     default:
                         break;
                 }
@@ -667,6 +762,9 @@ int main(int argc, char **argv)
         ++i;
     }
 
+    if (!done && !result && run_benchmark())
+        result = 1;
+
   done:
     cleanup_dst();
     cleanup_src();
@@ -0,0 +1,217 @@
+#include "../src/mapper_internal.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+/* Benchmark comparing evaluation of mapping expressions by the token
+ * interpreter, the compiled instruction stream, and native code generated by
+ * the JIT backend (if libmapper was configured with --enable-jit). All three
+ * must produce identical output. */
+
+#define MAX_LEN 512
+#define MAX_VARS 4
+
+#define eprintf(format, ...) do {               \
+    if (verbose)                                \
+        fprintf(stdout, format, ##__VA_ARGS__); \
+} while(0)
+
+enum { INTERP, COMPILED, JIT, N_MODES };
+const char *mode_names[] = { "interpreter", "compiled", "jit" };
+
+int verbose = 1;
+int iterations = 100000;
+
+typedef struct {
+    const char *str;
+    mpr_type in_type;
+    int in_len;
+    mpr_type out_type;
+    int out_len;
+} bench_t;
+
+bench_t benchmarks[] = {
+    { "y=x*0.5+3",                                  MPR_FLT,   1, MPR_FLT,   1 },
+    { "y=x*10-x/4+1",                               MPR_DBL,   1, MPR_DBL,   1 },
+    { "y=(x+3)*(x-2)",                              MPR_INT32, 1, MPR_INT32, 1 },
+    { "y=sin(x)*cos(x*2)+pow(x,2)",                 MPR_DBL,   1, MPR_DBL,   1 },
+    { "y=x*0.1+y{-1}*0.9",                          MPR_FLT,   2, MPR_FLT,   2 },
+    { "y=(x-x{-1})*0.5+y{-1}",                      MPR_DBL,   3, MPR_DBL,   3 },
+    { "a=x*2;b=a+x{-1};y=[a,b]",                    MPR_FLT,   1, MPR_DBL,   2 },
+    { "y=x+1.5",                                    MPR_INT32, 1, MPR_FLT,   1 },
+    { "y=x*0.5+3",                                  MPR_FLT,   64, MPR_FLT,  64 },
+    { "y=x*0.5+3",                                  MPR_FLT,  512, MPR_FLT, 512 },
+    { "y=(x+3)*(x-2)",                              MPR_INT32, 64, MPR_INT32, 64 },
+    { "y=(x+3)*(x-2)",                              MPR_INT32, 512, MPR_INT32, 512 },
+    { "y=x*0.1+y{-1}*0.9",                          MPR_FLT,   64, MPR_FLT,  64 },
+    { "y=x*0.1+y{-1}*0.9",                          MPR_FLT,  512, MPR_FLT, 512 },
+    { "y=sum(x)*0.5",                               MPR_FLT,  512, MPR_FLT,   1 },
+    { "y=sum(x)+y{-1}*0.5",                         MPR_FLT,   64, MPR_FLT,   1 },
+    { "y=max(x)-min(x)+y{-1}",                      MPR_DBL,   64, MPR_DBL,   1 },
+    { "y=all(x>0)+any(x<0)*2",                      MPR_INT32, 64, MPR_INT32, 1 },
+    { "y=x>y{-1}?x%7:x/3",                          MPR_INT32, 4, MPR_INT32,  4 },
+    { "y=sin(x)*exp(x/100)",                        MPR_FLT,   64, MPR_FLT,  64 },
+};
+
+double src[8] = { 0.1, -2.5, 3.75, 12, -0.003, 100.25, 7, -8 };
+
+mpr_value_t in[N_MODES], out[N_MODES], vars[N_MODES][MAX_VARS];
+
+static double current_time()
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (double) tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+static void set_input(mpr_value v, int iteration)
+{
+    int i;
+    mpr_value_buffer b = &v->inst[0];
+    b->pos = (b->pos + 1) % v->mlen;
+    void *samp = mpr_value_get_samp(v, 0);
+    for (i = 0; i < v->vlen; i++) {
+        double d = src[i % 8] + iteration % 100;
+        switch (v->type) {
+            case MPR_INT32: ((int*)samp)[i] = (int)d;       break;
+            case MPR_FLT:   ((float*)samp)[i] = (float)d;   break;
+            default:        ((double*)samp)[i] = d;         break;
+        }
+    }
+}
+
+static int run_bench(bench_t *b)
+{
+    mpr_expr e[N_MODES] = {0};
+    mpr_value in_p[N_MODES], vars_p[N_MODES];
+    mpr_type types[MAX_LEN];
+    mpr_time t;
+    double elapsed[N_MODES];
+    int i, j, m, n_modes = JIT, result = 0;
+
+    eprintf("Expression '%s' (%c[%d])\n", b->str, b->in_type, b->in_len);
+    for (m = 0; m < N_MODES; m++) {
+        e[m] = mpr_expr_new_from_str(b->str, 1, &b->in_type, &b->in_len,
+                                     b->out_type, b->out_len);
+        if (!e[m]) {
+            eprintf("  parser FAILED\n");
+            result = 1;
+            goto done;
+        }
+        mpr_value_realloc(&in[m], b->in_len, b->in_type,
+                          mpr_expr_get_in_hist_size(e[m], 0), 1, 0);
+        memset(in[m].inst[0].samps, 0,
+               in[m].mlen * in[m].vlen * mpr_type_get_size(in[m].type));
+        mpr_value_realloc(&out[m], b->out_len, b->out_type,
+                          mpr_expr_get_out_hist_size(e[m]), 1, 1);
+        memset(out[m].inst[0].samps, 0,
+               out[m].mlen * out[m].vlen * mpr_type_get_size(out[m].type));
+        for (i = 0; i < mpr_expr_get_num_vars(e[m]); i++) {
+            int vlen = mpr_expr_get_var_vec_len(e[m], i);
+            mpr_value_realloc(&vars[m][i], vlen, MPR_DBL, 1, 1, 0);
+            memset(vars[m][i].inst[0].samps, 0, vlen * sizeof(double));
+        }
+        in_p[m] = &in[m];
+        vars_p[m] = vars[m];
+    }
+    if (mpr_expr_set_jit(e[JIT], 1))
+        n_modes = N_MODES;
+    else {
+#ifdef HAVE_JIT
+        eprintf("  failed to generate native code\n");
+        result = 1;
+#else
+        eprintf("  native code not available, skipping jit\n");
+#endif
+    }
+
+    mpr_time_set(&t, MPR_NOW);
+    for (m = 0; m < n_modes; m++) {
+        double then = current_time();
+        for (i = 0; i < iterations; i++) {
+            set_input(&in[m], i);
+            if (INTERP == m)
+                mpr_expr_eval_interp(e[m], in_p + m, vars_p + m, &out[m], &t, types, 0);
+            else
+                mpr_expr_eval(e[m], in_p + m, vars_p + m, &out[m], &t, types, 0);
+        }
+        elapsed[m] = current_time() - then;
+    }
+
+    for (m = 1; m < n_modes; m++) {
+        if (memcmp(out[INTERP].inst[0].samps, out[m].inst[0].samps,
+                   out[m].mlen * out[m].vlen * mpr_type_get_size(out[m].type))) {
+            eprintf("  %s output does not match interpreter\n", mode_names[m]);
+            result = 1;
+        }
+        for (j = 0; j < mpr_expr_get_num_vars(e[m]); j++) {
+            if (memcmp(vars[INTERP][j].inst[0].samps, vars[m][j].inst[0].samps,
+                       vars[m][j].vlen * sizeof(double))) {
+                eprintf("  %s variable %d does not match interpreter\n",
+                        mode_names[m], j);
+                result = 1;
+            }
+        }
+    }
+    for (m = 0; m < n_modes; m++) {
+        eprintf("  %-12s %8.2f ns/eval", mode_names[m], elapsed[m] * 1e9 / iterations);
+        if (m)
+            eprintf("  (%.2fx)", elapsed[INTERP] / elapsed[m]);
+        eprintf("\n");
+    }
+
+done:
+    for (m = 0; m < N_MODES; m++)
+        FUNC_IF(mpr_expr_free, e[m]);
+    return result;
+}
+
+int main(int argc, char **argv)
+{
+    int i, j, m, result = 0;
+    // process flags for -q quiet, -h help
+    for (i = 1; i < argc; i++) {
+        if (argv[i] && argv[i][0] == '-') {
+            int len = strlen(argv[i]);
+            for (j = 1; j < len; j++) {
+                switch (argv[i][j]) {
+                    case 'h':
+                        printf("testjit.c: possible arguments "
+                               "-q quiet (suppress output), "
+                               "-h help, "
+                               "--num_iterations <int> (default %d)\n",
+                               iterations);
+                        return 1;
+                        break;
+                    case 'q':
+                        verbose = 0;
+                        break;
+                    case '-':
+                        if (++j < len && strcmp(argv[i]+j, "num_iterations")==0)
+                            if (++i < argc)
+                                iterations = atoi(argv[i]);
+                        j = len;
+                        break;
+                    default:
+                        break;
+                }
+            }
+        }
+    }
+
+    for (i = 0; i < sizeof(benchmarks) / sizeof(bench_t); i++)
+        result |= run_bench(&benchmarks[i]);
+
+    for (m = 0; m < N_MODES; m++) {
+        mpr_value_free(&in[m]);
+        mpr_value_free(&out[m]);
+        for (i = 0; i < MAX_VARS; i++)
+            mpr_value_free(&vars[m][i]);
+    }
+
+    printf("..................................................Test %s\x1B[0m.\n",
+           result ? "\x1B[31mFAILED" : "\x1B[32mPASSED");
+    return result;
+}
@@ -27,6 +27,24 @@ mpr_sig sendsig = 0;
 mpr_sig recvsig = 0;
 mpr_map map = 0;
 
+// instanced signals for testing the packed protocols
+#define NUM_INST 4
+mpr_sig multisend = 0;
+mpr_sig multirecv = 0;
+mpr_map multimap = 0;
+
+// enough vector instances to fill more than one packed message
+#define BIG_NUM_INST 128
+#define BIG_LEN 64
+mpr_sig bigsend = 0;
+mpr_sig bigrecv = 0;
+mpr_map bigmap = 0;
+
+// recreate enough maps that destination slot ids no longer fit in a char
+#define NUM_SLOT_MAPS 260
+mpr_sig slotsend = 0;
+mpr_sig slotrecv = 0;
+
 int sent = 0;
 int received = 0;
 int done = 0;
@@ -44,6 +62,14 @@ int setup_src()
 
     sendsig = mpr_sig_new(src, MPR_DIR_OUT, "outsig", 1, MPR_FLT, NULL,
                           &mn, &mx, NULL, NULL, 0);
+    int num_inst = NUM_INST;
+    multisend = mpr_sig_new(src, MPR_DIR_OUT, "multisend", 1, MPR_FLT, NULL,
+                            &mn, &mx, &num_inst, NULL, 0);
+    num_inst = BIG_NUM_INST;
+    bigsend = mpr_sig_new(src, MPR_DIR_OUT, "bigsend", BIG_LEN, MPR_FLT, NULL,
+                          NULL, NULL, &num_inst, NULL, 0);
+    slotsend = mpr_sig_new(src, MPR_DIR_OUT, "slotsend", 1, MPR_FLT, NULL,
+                           &mn, &mx, NULL, NULL, 0);
 
     eprintf("Output signal /outsig registered.\n");
     mpr_list l = mpr_dev_get_sigs(src, MPR_DIR_OUT);
@@ -85,6 +111,14 @@ int setup_dst()
 
     recvsig = mpr_sig_new(dst, MPR_DIR_IN, "insig", 1, MPR_FLT, NULL,
                           &mn, &mx, NULL, handler, MPR_SIG_UPDATE);
+    int num_inst = NUM_INST;
+    multirecv = mpr_sig_new(dst, MPR_DIR_IN, "multirecv", 1, MPR_FLT, NULL,
+                            &mn, &mx, &num_inst, handler, MPR_SIG_UPDATE);
+    num_inst = BIG_NUM_INST;
+    bigrecv = mpr_sig_new(dst, MPR_DIR_IN, "bigrecv", BIG_LEN, MPR_FLT, NULL,
+                          NULL, NULL, &num_inst, handler, MPR_SIG_UPDATE);
+    slotrecv = mpr_sig_new(dst, MPR_DIR_IN, "slotrecv", 1, MPR_FLT, NULL,
+                           &mn, &mx, NULL, handler, MPR_SIG_UPDATE);
 
     eprintf("Input signal /insig registered.\n");
     mpr_list l = mpr_dev_get_sigs(dst, MPR_DIR_IN);
@@ -106,7 +140,7 @@ void cleanup_dst()
     }
 }
 
-void set_map_protocol(mpr_proto proto)
+void set_map_protocol(mpr_map map, mpr_proto proto)
 {
     if (!map)
         return;
@@ -134,9 +168,14 @@ int setup_map()
 {
     map = mpr_map_new(1, &sendsig, 1, &recvsig);
     mpr_obj_push(map);
-
-    // wait until map is established
-    while (!mpr_map_get_is_ready(map)) {
+    multimap = mpr_map_new(1, &multisend, 1, &multirecv);
+    mpr_obj_push(multimap);
+    bigmap = mpr_map_new(1, &bigsend, 1, &bigrecv);
+    mpr_obj_push(bigmap);
+
+    // wait until maps are established
+    while (!mpr_map_get_is_ready(map) || !mpr_map_get_is_ready(multimap)
+           || !mpr_map_get_is_ready(bigmap)) {
         mpr_dev_poll(dst, 10);
         mpr_dev_poll(src, 10);
     }
@@ -171,6 +210,101 @@ void loop()
     }
 }
 
+/*! Update all instances at once so that the updates can be packed. */
+void loop_inst()
+{
+    int i = 0, j;
+    mpr_id ids[NUM_INST];
+    float vals[NUM_INST];
+    for (j = 0; j < NUM_INST; j++)
+        ids[j] = j;
+    while (!done && i < 50) {
+        for (j = 0; j < NUM_INST; j++)
+            vals[j] = (i + j) * 1.0f;
+        eprintf("Updating %d instances of signal multisend\n", NUM_INST);
+        mpr_sig_set_values(multisend, NUM_INST, ids, 1, MPR_FLT, vals, 0);
+        sent += NUM_INST;
+        mpr_dev_poll(src, 0);
+        mpr_dev_poll(dst, period);
+        ++i;
+        if (!verbose) {
+            printf("\r  Sent: %4i, Received: %4i   ", sent, received);
+            fflush(stdout);
+        }
+    }
+}
+
+/*! Update more vector instances than fit in a single packed message. */
+void loop_big()
+{
+    int i = 0, j, k;
+    mpr_id ids[BIG_NUM_INST];
+    float vals[BIG_NUM_INST * BIG_LEN];
+    for (j = 0; j < BIG_NUM_INST; j++)
+        ids[j] = j;
+    while (!done && i < 10) {
+        for (j = 0; j < BIG_NUM_INST; j++) {
+            for (k = 0; k < BIG_LEN; k++)
+                vals[j * BIG_LEN + k] = (i + j + k) * 1.0f;
+        }
+        eprintf("Updating %d instances of signal bigsend\n", BIG_NUM_INST);
+        mpr_sig_set_values(bigsend, BIG_NUM_INST, ids, BIG_LEN, MPR_FLT, vals, 0);
+        sent += BIG_NUM_INST;
+        mpr_dev_poll(src, 0);
+        mpr_dev_poll(dst, period);
+        ++i;
+        if (!verbose) {
+            printf("\r  Sent: %4i, Received: %4i   ", sent, received);
+            fflush(stdout);
+        }
+    }
+}
+
+/*! Repeatedly create and release a compact map processed at the destination
+ *  so that its slot id grows past the range of the unlabelled char form. */
+void loop_slots()
+{
+    int i = 0, loc = MPR_LOC_DST, proto = MPR_PROTO_UDP_COMPACT;
+    while (!done && i < NUM_SLOT_MAPS) {
+        mpr_map m = mpr_map_new(1, &slotsend, 1, &slotrecv);
+        mpr_obj_set_prop((mpr_obj)m, MPR_PROP_PROCESS_LOC, NULL, 1, MPR_INT32, &loc, 1);
+        mpr_obj_set_prop((mpr_obj)m, MPR_PROP_PROTOCOL, NULL, 1, MPR_INT32, &proto, 1);
+        mpr_obj_push(m);
+        while (!done && !mpr_map_get_is_ready(m)) {
+            mpr_dev_poll(dst, 10);
+            mpr_dev_poll(src, 10);
+        }
+
+        float val = i * 1.0f;
+        eprintf("Updating signal slotsend through map %d\n", i);
+        mpr_sig_set_value(slotsend, 0, 1, MPR_FLT, &val);
+        sent++;
+        mpr_dev_poll(src, 0);
+        mpr_dev_poll(dst, period);
+
+        mpr_map_release(m);
+        int num_maps;
+        do {
+            mpr_dev_poll(src, 10);
+            mpr_dev_poll(dst, 10);
+            mpr_list l = mpr_sig_get_maps(slotsend, MPR_DIR_ANY);
+            num_maps = mpr_list_get_size(l);
+            mpr_list_free(l);
+        } while (!done && num_maps);
+        ++i;
+        if (!verbose) {
+            printf("\r  Sent: %4i, Received: %4i   ", sent, received);
+            fflush(stdout);
+        }
+    }
+}
+
+/*! Switch direct serialisation of the data bundles sent over the map's link. */
+void set_direct(mpr_map map, int direct)
+{
+    mpr_obj_set_prop((mpr_obj)map, MPR_PROP_EXTRA, "direct", 1, MPR_BOOL, &direct, 0);
+}
+
 void ctrlc(int sig)
 {
     done = 1;
@@ -232,14 +366,39 @@ int main(int argc, char **argv)
         goto done;
     }
 
+    eprintf("SENDING COMPACT UDP WITH LARGE SLOT IDS\n");
+    loop_slots();
+
     do {
-        set_map_protocol(MPR_PROTO_UDP);
+        set_map_protocol(map, MPR_PROTO_UDP);
         eprintf("SENDING UDP\n");
         loop();
 
-        set_map_protocol(MPR_PROTO_TCP);
+        set_map_protocol(map, MPR_PROTO_TCP);
         eprintf("SENDING TCP\n");
         loop();
+
+        set_direct(map, 0);
+        set_map_protocol(map, MPR_PROTO_UDP);
+        eprintf("SENDING UDP THROUGH LIBLO\n");
+        loop();
+
+        set_map_protocol(map, MPR_PROTO_TCP);
+        eprintf("SENDING TCP THROUGH LIBLO\n");
+        loop();
+        set_direct(map, 1);
+
+        set_map_protocol(multimap, MPR_PROTO_UDP_PACKED);
+        eprintf("SENDING PACKED UDP\n");
+        loop_inst();
+
+        set_map_protocol(multimap, MPR_PROTO_TCP_PACKED);
+        eprintf("SENDING PACKED TCP\n");
+        loop_inst();
+
+        set_map_protocol(bigmap, MPR_PROTO_UDP_PACKED);
+        eprintf("SENDING LARGE PACKED UDP\n");
+        loop_big();
     } while (!terminate && !done);
 
     if (sent != received) {
@@ -8,8 +8,8 @@
 #include <unistd.h>
 #include <assert.h>
 
-#define SRC_ARRAY_LEN 3
-#define DST_ARRAY_LEN 6
+#define SRC_ARRAY_LEN MPR_MAX_VECTOR_LEN
+#define DST_ARRAY_LEN MPR_MAX_VECTOR_LEN
 #define MAX_VARS 3
 
 #define eprintf(format, ...) do {               \
@@ -19,7 +19,7 @@
 
 int verbose = 1;
 char str[256];
-mpr_expr e;
+mpr_expr e, e_ref;
 int iterations = 20000;
 int expression_count = 1;
 int token_count = 0;
@@ -30,12 +30,13 @@ float src_flt[SRC_ARRAY_LEN], dst_flt[DST_ARRAY_LEN], expect_flt[DST_ARRAY_LEN];
 double src_dbl[SRC_ARRAY_LEN], dst_dbl[DST_ARRAY_LEN], expect_dbl[DST_ARRAY_LEN];
 double then, now;
 double total_elapsed_time = 0;
-mpr_type out_types[DST_ARRAY_LEN];
+mpr_type out_types[DST_ARRAY_LEN], out_types_ref[DST_ARRAY_LEN];
 
 mpr_time time_in = {0, 0}, time_out = {0, 0};
 
 // signal_history structures
 mpr_value_t inh[SRC_ARRAY_LEN], outh, user_vars[MAX_VARS], *user_vars_p;
+mpr_value_t outh_ref, user_vars_ref[MAX_VARS], *user_vars_ref_p;
 mpr_value inh_p[SRC_ARRAY_LEN];
 mpr_type src_types[SRC_ARRAY_LEN], dst_type;
 int src_lens[SRC_ARRAY_LEN], n_sources, dst_len;
@@ -52,7 +53,7 @@ typedef struct _var {
     char *name;
     mpr_type datatype;
     mpr_type casttype;
-    uint8_t vec_len;
+    uint16_t vec_len;
     char vec_len_locked;
     char assigned;
     char public;
@@ -65,7 +66,7 @@ struct _mpr_expr
     mpr_var vars;
     uint8_t offset;
     uint8_t len;
-    uint8_t vec_size;
+    uint16_t vec_size;
     uint8_t *in_mem;
     uint8_t out_mem;
     uint8_t n_vars;
@@ -216,6 +217,34 @@ int check_result(mpr_type *types, int len, const void *val, int pos, int check)
     return 0;
 }
 
+/* The vector kernels for transcendental functions are approximations, so
+ * compare the output against libm with a tolerance in ulp instead. */
+int check_ulp(double (*fn)(double), int len, double max_ulp)
+{
+    int i;
+    for (i = 0; i < len; i++) {
+        double expect = fn(src_flt[i]);
+        float expect_f = (float)expect;
+        if (isnan(expect_f) || isinf(expect_f) || 0 == expect_f) {
+            if (memcmp(&dst_flt[i], &expect_f, sizeof(float))
+                && !(isnan(expect_f) && isnan(dst_flt[i]))) {
+                eprintf("... error at index %d (expected %g, got %g)\n", i,
+                        expect_f, dst_flt[i]);
+                return 1;
+            }
+            continue;
+        }
+        double ulp = nextafterf(fabsf(expect_f), INFINITY) - fabsf(expect_f);
+        if (fabs(dst_flt[i] - expect) > max_ulp * ulp) {
+            eprintf("... error at index %d (expected %g, got %g)\n", i,
+                    expect_f, dst_flt[i]);
+            return 1;
+        }
+    }
+    eprintf("Checked %d elements against libm... OK\n", len);
+    return 0;
+}
+
 void setup_test_multisource(int _n_sources, mpr_type *_src_types, int *_src_lens,
                             mpr_type _dst_type, int _dst_len)
 {
@@ -234,6 +263,37 @@ void setup_test(mpr_type in_type, int in_len, mpr_type out_type, int out_len)
     setup_test_multisource(1, &in_type, &in_len, out_type, out_len);
 }
 
+/* Evaluate the compiled expression and also evaluate a separately parsed copy
+ * using the reference interpreter, checking that both produce identical status,
+ * output history, output types, and user variable values. */
+int eval_and_compare(int *status)
+{
+    int i;
+    *status = mpr_expr_eval(e, inh_p, &user_vars_p, &outh, &time_in, out_types, 0);
+    int ref_status = mpr_expr_eval_interp(e_ref, inh_p, &user_vars_ref_p, &outh_ref,
+                                          &time_in, out_types_ref, 0);
+    if (*status != ref_status) {
+        eprintf("... error: status %d does not match interpreter (%d)\n",
+                *status, ref_status);
+        return 1;
+    }
+    if (   outh.inst[0].pos != outh_ref.inst[0].pos
+        || memcmp(outh.inst[0].samps, outh_ref.inst[0].samps,
+                  outh.mlen * outh.vlen * mpr_type_get_size(outh.type))
+        || memcmp(out_types, out_types_ref, outh.vlen)) {
+        eprintf("... error: output does not match interpreter\n");
+        return 1;
+    }
+    for (i = 0; i < e->n_vars; i++) {
+        if (memcmp(user_vars[i].inst[0].samps, user_vars_ref[i].inst[0].samps,
+                   user_vars[i].vlen * mpr_type_get_size(MPR_DBL))) {
+            eprintf("... error: variable %d does not match interpreter\n", i);
+            return 1;
+        }
+    }
+    return 0;
+}
+
 #define EXPECT_SUCCESS 0
 #define EXPECT_FAILURE 1
 
@@ -261,6 +321,12 @@ int parse_and_eval(int expectation, int max_tokens, int check, int exp_updates)
         result = 1;
         goto free;
     }
+    e_ref = mpr_expr_new_from_str(str, n_sources, src_types, src_lens, dst_type, dst_len);
+    if (!e_ref) {
+        eprintf("Parser FAILED on reference copy");
+        result = 1;
+        goto free;
+    }
     int mlen;
     mpr_time_set(&time_in, MPR_NOW);
     for (i = 0; i < n_sources; i++) {
@@ -284,6 +350,7 @@ int parse_and_eval(int expectation, int max_tokens, int check, int exp_updates)
     }
     mlen = mpr_expr_get_out_hist_size(e);
     mpr_value_realloc(&outh, dst_len, dst_type, mlen, 1, 1);
+    mpr_value_realloc(&outh_ref, dst_len, dst_type, mlen, 1, 1);
 
     /* mpr_value_realloc will not initialize memory if history size is unchanged
      * so we will explicitly initialise it here. */
@@ -294,6 +361,7 @@ int parse_and_eval(int expectation, int max_tokens, int check, int exp_updates)
         memset(inh[i].inst[0].samps + samp_size, 0, (inh[i].mlen - 1) * samp_size);
     }
     memset(outh.inst[0].samps, 0, outh.mlen * outh.vlen * mpr_type_get_size(outh.type));
+    memset(outh_ref.inst[0].samps, 0, outh.mlen * outh.vlen * mpr_type_get_size(outh.type));
 
     if (mpr_expr_get_num_vars(e) > MAX_VARS) {
         eprintf("Maximum variables exceeded.\n");
@@ -309,8 +377,12 @@ int parse_and_eval(int expectation, int max_tokens, int check, int exp_updates)
         /* mpr_value_realloc will not initialize memory if history size is
          * unchanged so we will explicitly initialise it here. */
         memset(user_vars[i].inst[0].samps, 0, vlen * mpr_type_get_size(MPR_DBL));
+
+        mpr_value_realloc(&user_vars_ref[i], vlen, MPR_DBL, 1, 1, 0);
+        memset(user_vars_ref[i].inst[0].samps, 0, vlen * mpr_type_get_size(MPR_DBL));
     }
     user_vars_p = user_vars;
+    user_vars_ref_p = user_vars_ref;
 
     eprintf("Parser returned %d tokens...", e->len);
     if (max_tokens && e->len > max_tokens) {
@@ -337,7 +409,10 @@ int parse_and_eval(int expectation, int max_tokens, int check, int exp_updates)
     then = current_time();
 
     eprintf("Try evaluation once... ");
-    status = mpr_expr_eval(e, inh_p, &user_vars_p, &outh, &time_in, out_types, 0);
+    if (eval_and_compare(&status)) {
+        result = 1;
+        goto free;
+    }
     if (!status) {
         eprintf("FAILED.\n");
         result = 1;
@@ -372,8 +447,7 @@ int parse_and_eval(int expectation, int max_tokens, int check, int exp_updates)
             }
             memcpy(mpr_value_get_time(&inh[j], 0), &time_in, sizeof(mpr_time));
         }
-        status = mpr_expr_eval(e, inh_p, &user_vars_p, &outh, &time_in, out_types, 0);
-        if (!status) {
+        if (eval_and_compare(&status) || !status) {
             result = 1;
             break;
         }
@@ -405,6 +479,10 @@ int parse_and_eval(int expectation, int max_tokens, int check, int exp_updates)
 
 free:
     mpr_expr_free(e);
+    if (e_ref) {
+        mpr_expr_free(e_ref);
+        e_ref = 0;
+    }
     return result;
 
 fail:
@@ -991,6 +1069,201 @@ int run_tests()
     if (parse_and_eval(EXPECT_SUCCESS, 0, 0, iterations))
         return 1;
 
+    /* 67) Elementwise operations on long vectors */
+    snprintf(str, 256, "y=max(floor(x*2.5-x/3),abs(x+1))+sqrt(abs(x))*(x>=0);");
+    setup_test(MPR_DBL, 10, MPR_DBL, 10);
+    if (parse_and_eval(EXPECT_SUCCESS, 0, 0, iterations))
+        return 1;
+
+    /* 68) Mixed types with timetag history */
+    snprintf(str, 256, "y=(x-x{-1})/(t_x-t_x{-1})");
+    setup_test(MPR_FLT, 1, MPR_FLT, 1);
+    if (parse_and_eval(EXPECT_SUCCESS, 0, 0, iterations))
+        return 1;
+
+    /* 69) Optimization: common subexpressions */
+    snprintf(str, 256, "y=(x*2+1)*(x*2+1)-(x*2+1)");
+    setup_test(MPR_DBL, 1, MPR_DBL, 1);
+    expect_dbl[0] = (src_dbl[0] * 2 + 1) * (src_dbl[0] * 2 + 1) - (src_dbl[0] * 2 + 1);
+    if (parse_and_eval(EXPECT_SUCCESS, 11, 1, iterations))
+        return 1;
+
+    /* 70) Optimization: conditionals with constant condition */
+    snprintf(str, 256, "y=(1?x:x*2)*(0?x:3.5)");
+    setup_test(MPR_FLT, 1, MPR_FLT, 1);
+    expect_flt[0] = src_flt[0] * 3.5f;
+    if (parse_and_eval(EXPECT_SUCCESS, 4, 1, iterations))
+        return 1;
+
+    /* 71) Optimization: strength reduction */
+    snprintf(str, 256, "y=pow(x,2)+x/4");
+    setup_test(MPR_DBL, 1, MPR_DBL, 1);
+    expect_dbl[0] = src_dbl[0] * src_dbl[0] + src_dbl[0] / 4;
+    if (parse_and_eval(EXPECT_SUCCESS, 8, 1, iterations))
+        return 1;
+
+    /* 72) Optimization: variables that are never read are still published */
+    snprintf(str, 256, "a=x*2;b=a+1;y=x*3");
+    setup_test(MPR_INT32, 1, MPR_INT32, 1);
+    expect_int[0] = src_int[0] * 3;
+    if (parse_and_eval(EXPECT_SUCCESS, 0, 1, iterations))
+        return 1;
+    e = mpr_expr_new_from_str(str, n_sources, src_types, src_lens, dst_type, dst_len);
+    if (!e || mpr_expr_get_num_vars(e) != 2) {
+        eprintf("Error: expected variables 'a' and 'b' to be kept\n");
+        FUNC_IF(mpr_expr_free, e);
+        return 1;
+    }
+    mpr_expr_free(e);
+
+    /* 73) Shared expression cache */
+    if (verbose) {
+        printf("***************** Expression %d *****************\n",
+               expression_count++);
+        printf("Retrieving 'y=x*2' from expression cache... ");
+    }
+    else {
+        printf("\rExpression %d", expression_count++);
+        fflush(stdout);
+    }
+    mpr_expr_cache cache = mpr_expr_cache_new();
+    mpr_type type = MPR_FLT;
+    int len = 1;
+    mpr_expr e1 = mpr_expr_cache_get(cache, "y=x*2", 1, &type, &len, MPR_FLT, 1);
+    mpr_expr e2 = mpr_expr_cache_get(cache, "y=x*2", 1, &type, &len, MPR_FLT, 1);
+    mpr_expr e3 = mpr_expr_cache_get(cache, "y=x*2", 1, &type, &len, MPR_DBL, 1);
+    if (!e1 || !e2 || !e3 || e1 == e2 || mpr_expr_cache_get_size(cache) != 2) {
+        eprintf("FAILED (expected 2 cached expressions, got %d)\n",
+                mpr_expr_cache_get_size(cache));
+        return 1;
+    }
+    mpr_expr_free(e1);
+    mpr_expr_free(e3);
+    if (mpr_expr_cache_get_size(cache) != 1) {
+        eprintf("FAILED (expected 1 cached expression after release, got %d)\n",
+                mpr_expr_cache_get_size(cache));
+        return 1;
+    }
+    mpr_expr_cache_free(cache);
+    mpr_expr_free(e2);
+    eprintf("OK\n");
+
+    /* 74) Incremental evaluation of convergent maps: the results of
+     * subexpressions whose sources have not been updated are reused */
+    snprintf(str, 256, "y=sin(x0)*2+cos(x1)*3+pow(x2,3)+sqrt(abs(x3))");
+    mpr_type flt_types[] = {MPR_FLT, MPR_FLT, MPR_FLT, MPR_FLT};
+    int flt_lens[] = {2, 2, 2, 2};
+    setup_test_multisource(4, flt_types, flt_lens, MPR_FLT, 2);
+    if (parse_and_eval(EXPECT_SUCCESS, 0, 0, iterations))
+        return 1;
+    eprintf("Updating one source at a time... ");
+    e = mpr_expr_new_from_str(str, n_sources, src_types, src_lens, dst_type, dst_len);
+    e_ref = mpr_expr_new_from_str(str, n_sources, src_types, src_lens, dst_type, dst_len);
+    for (int i = 0; i < iterations; i++) {
+        int status;
+        float samp[2] = {random_flt(), i};
+        mpr_value_set_sample(&inh[i % n_sources], 0, samp, time_in);
+        if (eval_and_compare(&status)) {
+            eprintf("FAILED after updating source %d\n", i % n_sources);
+            mpr_expr_free(e);
+            mpr_expr_free(e_ref);
+            e_ref = 0;
+            return 1;
+        }
+    }
+    mpr_expr_free(e);
+    mpr_expr_free(e_ref);
+    e_ref = 0;
+    eprintf("OK\n");
+
+    /* 75) Elementwise float arithmetic and comparisons on long vectors */
+    int long_lens[] = {64, MPR_MAX_VECTOR_LEN};
+    for (int i = 0; i < 2; i++) {
+        int len = long_lens[i];
+        snprintf(str, 256, "y=x*x-x+(x>=0)-(x<x*x)+min(x,-x)");
+        setup_test(MPR_FLT, len, MPR_FLT, len);
+        for (int j = 0; j < len; j++) {
+            float x = src_flt[j];
+            expect_flt[j] = x * x - x + (x >= 0) - (x < x * x) + (x < -x ? x : -x);
+        }
+        if (parse_and_eval(EXPECT_SUCCESS, 0, 1, iterations))
+            return 1;
+    }
+
+    /* 76) Elementwise int32 arithmetic and comparisons on long vectors */
+    for (int i = 0; i < 2; i++) {
+        int len = long_lens[i];
+        snprintf(str, 256, "y=((x&255)+3)*((x&255)-2)+(x>x/2)-(x==0)+max(x%%7,x&7)");
+        setup_test(MPR_INT32, len, MPR_INT32, len);
+        for (int j = 0; j < len; j++) {
+            int x = src_int[j];
+            expect_int[j] = ((x & 255) + 3) * ((x & 255) - 2) + (x > x / 2) - (x == 0)
+                            + (x % 7 > (x & 7) ? x % 7 : x & 7);
+        }
+        if (parse_and_eval(EXPECT_SUCCESS, 0, 1, iterations))
+            return 1;
+    }
+
+    /* 77) Vector reductions on long float vectors */
+    for (int i = 0; i < 2; i++) {
+        int len = long_lens[i];
+        float max = src_flt[0], min = src_flt[0];
+        int all = 1, any = 0;
+        snprintf(str, 256, "y=all(x==x)*1000+any(x>1e30)*100+all(x>0)*10+any(x==0)"
+                 "+(max(x)>=min(x))+max(x)");
+        setup_test(MPR_FLT, len, MPR_FLT, 1);
+        for (int j = 1; j < len; j++) {
+            if (src_flt[j] > max)
+                max = src_flt[j];
+            if (src_flt[j] < min)
+                min = src_flt[j];
+        }
+        for (int j = 0; j < len; j++) {
+            all &= src_flt[j] > 0;
+            any |= src_flt[j] == 0;
+        }
+        expect_flt[0] = 1000.f + (max > 1e30f) * 100 + all * 10 + any + (max >= min) + max;
+        if (parse_and_eval(EXPECT_SUCCESS, 0, 1, iterations))
+            return 1;
+    }
+
+    /* 78) Vector reductions on long int32 vectors */
+    for (int i = 0; i < 2; i++) {
+        int len = long_lens[i];
+        int sum = 0, all = 1, any = 0, max = src_int[0], min = src_int[0];
+        snprintf(str, 256, "y=sum(x>0)+all(x!=0)*1000+any(x<0)*10000+(max(x)>=min(x))*100000"
+                 "+max(x)%%1000-min(x)%%1000");
+        setup_test(MPR_INT32, len, MPR_INT32, 1);
+        for (int j = 0; j < len; j++) {
+            sum += src_int[j] > 0;
+            all &= src_int[j] != 0;
+            any |= src_int[j] < 0;
+            if (src_int[j] > max)
+                max = src_int[j];
+            if (src_int[j] < min)
+                min = src_int[j];
+        }
+        expect_int[0] = sum + all * 1000 + any * 10000 + 100000 + max % 1000 - min % 1000;
+        if (parse_and_eval(EXPECT_SUCCESS, 0, 1, iterations))
+            return 1;
+    }
+
+    /* 79) Transcendental functions on long float vectors */
+    struct {
+        const char *name;
+        double (*fn)(double);
+    } long_fns[] = {{"sin", sin}, {"cos", cos}, {"exp", exp}, {"log", log}};
+    for (int i = 0; i < 2; i++) {
+        for (int j = 0; j < 4; j++) {
+            snprintf(str, 256, "y=%s(x)", long_fns[j].name);
+            setup_test(MPR_FLT, long_lens[i], MPR_FLT, long_lens[i]);
+            if (parse_and_eval(EXPECT_SUCCESS, 0, 0, iterations))
+                return 1;
+            if (check_ulp(long_fns[j].fn, long_lens[i], 3))
+                return 1;
+        }
+    }
+
     return 0;
 }
 
@@ -1029,6 +1302,7 @@ int main(int argc, char **argv)
     for (int i = 0; i < SRC_ARRAY_LEN; i++)
         inh[i].inst = 0;
     outh.inst = 0;
+    outh_ref.inst = 0;
 
     eprintf("**********************************\n");
     seed_srand();
@@ -1063,6 +1337,7 @@ int main(int argc, char **argv)
     for (int i = 0; i < SRC_ARRAY_LEN; i++)
         mpr_value_free(&inh[i]);
     mpr_value_free(&outh);
+    mpr_value_free(&outh_ref);
 
     eprintf("**********************************\n");
     printf("\r..................................................Test %s\x1B[0m.",
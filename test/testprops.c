@@ -1013,6 +1013,68 @@ int main(int argc, char **argv)
     else
         eprintf("OK\n");
 
+    eprintf("Test 38: setting and retrieving many extra properties... ");
+    {
+        char key[32];
+        int num_extra = 500, num_props = mpr_obj_get_num_props(sig, 0);
+        // add keys in reverse order so that the table is not already sorted
+        for (i = num_extra - 1; i >= 0; i--) {
+            snprintf(key, 32, "extra%d", i);
+            mpr_obj_set_prop(sig, MPR_PROP_EXTRA, key, 1, MPR_INT32, &i, 1);
+        }
+        for (i = 0; i < num_extra; i++) {
+            snprintf(key, 32, "extra%d", i);
+            if (mpr_obj_get_prop_as_int32(sig, MPR_PROP_EXTRA, key) != i)
+                break;
+        }
+        if (i < num_extra) {
+            eprintf("ERROR (wrong value for '%s')\n", key);
+            result = 1;
+            goto cleanup;
+        }
+        if (mpr_obj_get_num_props(sig, 0) != num_props + num_extra) {
+            eprintf("ERROR (expected %d properties)\n", num_props + num_extra);
+            result = 1;
+            goto cleanup;
+        }
+        eprintf("OK\n");
+    }
+
+    eprintf("Test 39: looking up static properties by name... ");
+    {
+        mpr_obj objs[] = {dev, sig};
+        const char *key;
+        int len;
+        mpr_type type;
+        const void *val;
+        mpr_prop prop;
+        for (j = 0; j < 2; j++) {
+            int num_props = mpr_obj_get_num_props(objs[j], 0);
+            for (i = 0; i < num_props; i++) {
+                prop = mpr_obj_get_prop_by_idx(objs[j], i, &key, &len, &type, &val, 0);
+                if (prop >= MPR_PROP_EXTRA)
+                    continue;
+                if (prop != mpr_obj_get_prop_by_key(objs[j], key, &len, &type, &val, 0))
+                    break;
+            }
+            if (i < num_props)
+                break;
+        }
+        if (j < 2) {
+            eprintf("ERROR (wrong property for key '%s')\n", key);
+            result = 1;
+            goto cleanup;
+        }
+        fval = 35.0;
+        mpr_obj_set_prop(sig, MPR_PROP_MAX, NULL, 1, MPR_FLT, &fval, 1);
+        if (MPR_PROP_MAX != mpr_obj_get_prop_by_key(sig, "maximum", &len, &type, &val, 0)) {
+            eprintf("ERROR (alias 'maximum' not found)\n");
+            result = 1;
+            goto cleanup;
+        }
+        eprintf("OK\n");
+    }
+
   cleanup:
     if (dev) mpr_dev_free(dev);
     if (!verbose)
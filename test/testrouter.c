@@ -0,0 +1,191 @@
+#include "../src/mapper_internal.h"
+#include <mapper/mapper.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <signal.h>
+#include <sys/time.h>
+
+/* Micro-benchmark for the router: a source device with an increasing number
+ * of mapped output signals updates the signal that was mapped first. The cost
+ * per update should not depend on how many other signals are mapped. */
+
+#define eprintf(format, ...) do {               \
+    if (verbose)                                \
+        fprintf(stdout, format, ##__VA_ARGS__); \
+} while(0)
+
+int verbose = 1;
+int terminate = 0;
+int done = 0;
+int iterations = 20000;
+int max_sigs = 1000;
+
+mpr_dev src = 0;
+mpr_dev dst = 0;
+mpr_sig *sendsigs = 0;
+mpr_sig *recvsigs = 0;
+int num_sigs = 0;
+
+/*! Internal function to get the current time. */
+static double current_time()
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (double) tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+void ctrlc(int sig)
+{
+    done = 1;
+}
+
+void wait_local_devs()
+{
+    while (!done && !(mpr_dev_get_is_ready(src) && mpr_dev_get_is_ready(dst))) {
+        mpr_dev_poll(src, 25);
+        mpr_dev_poll(dst, 25);
+    }
+    eprintf("Devices are ready.\n");
+}
+
+/*! Add signals and maps until there are num mapped signal pairs. */
+int add_sigs(int num)
+{
+    int i, ready = 0;
+    char name[32];
+    mpr_map *maps;
+
+    sendsigs = realloc(sendsigs, num * sizeof(mpr_sig));
+    recvsigs = realloc(recvsigs, num * sizeof(mpr_sig));
+    maps = malloc((num - num_sigs) * sizeof(mpr_map));
+
+    for (i = num_sigs; i < num; i++) {
+        snprintf(name, 32, "outsig%d", i);
+        sendsigs[i] = mpr_sig_new(src, MPR_DIR_OUT, name, 1, MPR_FLT, NULL,
+                                  NULL, NULL, NULL, NULL, 0);
+        snprintf(name, 32, "insig%d", i);
+        recvsigs[i] = mpr_sig_new(dst, MPR_DIR_IN, name, 1, MPR_FLT, NULL,
+                                  NULL, NULL, NULL, NULL, 0);
+        if (!sendsigs[i] || !recvsigs[i]) {
+            free(maps);
+            return 1;
+        }
+        maps[i - num_sigs] = mpr_map_new(1, &sendsigs[i], 1, &recvsigs[i]);
+        mpr_obj_push((mpr_obj)maps[i - num_sigs]);
+    }
+
+    // wait until all maps have been established
+    while (!done && ready < num - num_sigs) {
+        mpr_dev_poll(src, 10);
+        mpr_dev_poll(dst, 10);
+        for (ready = 0, i = 0; i < num - num_sigs; i++)
+            ready += mpr_map_get_is_ready(maps[i]) ? 1 : 0;
+    }
+    free(maps);
+    num_sigs = num;
+    return done;
+}
+
+/*! Time updates of the first mapped signal, which is the last entry in the
+ *  router's list of mapped signals. */
+double run_trial()
+{
+    int i;
+    float value;
+    double then = current_time();
+    for (i = 0; i < iterations && !done; i++) {
+        value = (float)i;
+        mpr_sig_set_value(sendsigs[0], 0, 1, MPR_FLT, &value);
+        if (i % 100 == 99) {
+            mpr_dev_poll(src, 0);
+            mpr_dev_poll(dst, 0);
+        }
+    }
+    return current_time() - then;
+}
+
+int main(int argc, char **argv)
+{
+    int i, j, num, result = 0;
+    double elapsed, base = 0;
+
+    // process flags for -q quiet, -f fast (terminate), -h help
+    for (i = 1; i < argc; i++) {
+        if (argv[i] && argv[i][0] == '-') {
+            int len = strlen(argv[i]);
+            for (j = 1; j < len; j++) {
+                switch (argv[i][j]) {
+                    case 'h':
+                        printf("testrouter.c: possible arguments "
+                               "-q quiet (suppress output), "
+                               "-f fast (execute quickly), "
+                               "-h help, "
+                               "--num_sigs <int> (default %d), "
+                               "--num_iterations <int> (default %d)\n",
+                               max_sigs, iterations);
+                        return 1;
+                        break;
+                    case 'q':
+                        verbose = 0;
+                        break;
+                    case 'f':
+                        terminate = 1;
+                        break;
+                    case '-':
+                        if (++j < len && strcmp(argv[i]+j, "num_sigs")==0) {
+                            if (++i < argc)
+                                max_sigs = atoi(argv[i]);
+                        }
+                        else if (strcmp(argv[i]+j, "num_iterations")==0) {
+                            if (++i < argc)
+                                iterations = atoi(argv[i]);
+                        }
+                        j = len;
+                        break;
+                    default:
+                        break;
+                }
+            }
+        }
+    }
+
+    if (terminate && max_sigs > 100)
+        max_sigs = 100;
+
+    signal(SIGINT, ctrlc);
+
+    src = mpr_dev_new("testrouter-send", 0);
+    dst = mpr_dev_new("testrouter-recv", 0);
+    if (!src || !dst) {
+        eprintf("Error initializing devices.\n");
+        result = 1;
+        goto done;
+    }
+
+    wait_local_devs();
+
+    for (num = 1; num <= max_sigs && !done; num *= 10) {
+        if (add_sigs(num)) {
+            eprintf("Error adding signals.\n");
+            result = 1;
+            goto done;
+        }
+        elapsed = run_trial();
+        if (num == 1)
+            base = elapsed;
+        eprintf("%6d mapped signals: %8.2f ns/update  (%.2fx)\n", num,
+                elapsed * 1e9 / iterations, elapsed / base);
+    }
+
+  done:
+    if (src)
+        mpr_dev_free(src);
+    if (dst)
+        mpr_dev_free(dst);
+    free(sendsigs);
+    free(recvsigs);
+    printf("..................................................Test %s\x1B[0m.\n",
+           result ? "\x1B[31mFAILED" : "\x1B[32mPASSED");
+    return result;
+}
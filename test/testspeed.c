@@ -34,20 +34,32 @@ mpr_dev src = 0;
 mpr_dev dst = 0;
 mpr_sig sendsig = 0;
 mpr_sig recvsig = 0;
+mpr_map map = 0;
 
 int numTrials = 10;
 int trial = 0;
-int numModes = 2;
+int numModes = 4;
 int mode = 0;
 int use_inst = 1;
 int iterations = 100000;
 int counter = 0;
 int received = 0;
 int done = 0;
+mpr_proto pending_proto = MPR_PROTO_UNDEFINED;
 
 double times[100];
 float value;
 
+/* Modes 2 and 3 repeat modes 0 and 1 with the compact encoding, which sends
+ * instance and slot ids without string labels. The transport stays UDP so
+ * that only the encoding differs between the two halves of the test. */
+const char *mode_names[] = {
+    "instanced",
+    "singleton",
+    "instanced, compact encoding",
+    "singleton, compact encoding"
+};
+
 void switch_modes();
 void print_results();
 
@@ -101,6 +113,8 @@ void handler(mpr_sig sig, mpr_sig_evt event, mpr_id inst, int length,
         counter = (counter+1)%10;
         if (++received >= iterations)
             switch_modes();
+        if (done || MPR_PROTO_UNDEFINED != pending_proto)
+            return;
         if (use_inst) {
             mpr_sig_set_value(sendsig, counter, length, type, value);
         }
@@ -160,7 +174,7 @@ void wait_local_devs()
 void map_sigs()
 {
     eprintf("Creating maps... ");
-    mpr_map map = mpr_map_new(1, &sendsig, 1, &recvsig);
+    map = mpr_map_new(1, &sendsig, 1, &recvsig);
     const char *expr = "y=y{-1}+1";
     mpr_obj_set_prop((mpr_obj)map, MPR_PROP_EXPR, NULL, 1, MPR_STR, expr, 1);
     mpr_obj_push((mpr_obj)map);
@@ -177,6 +191,20 @@ void ctrlc(int sig)
     done = 1;
 }
 
+void set_map_protocol(mpr_proto proto)
+{
+    if (mpr_obj_set_prop((mpr_obj)map, MPR_PROP_PROTOCOL, NULL, 1, MPR_INT32, &proto, 1))
+        mpr_obj_push((mpr_obj)map);
+
+    // wait until the modified map has been re-established with the new protocol
+    while (!done && !(mpr_map_get_is_ready(map)
+                      && proto == mpr_obj_get_prop_as_int32((mpr_obj)map,
+                                                            MPR_PROP_PROTOCOL, NULL))) {
+        mpr_dev_poll(src, 10);
+        mpr_dev_poll(dst, 10);
+    }
+}
+
 void switch_modes()
 {
     int i;
@@ -204,6 +232,20 @@ void switch_modes()
                 mpr_sig_release_inst(sendsig, i);
             }
             break;
+        case 2:
+            use_inst = 1;
+            if (0 == trial) {
+                // change the protocol from the main loop before timing resumes
+                pending_proto = MPR_PROTO_UDP_COMPACT;
+                return;
+            }
+            break;
+        case 3:
+            use_inst = 0;
+            for (i=1; i<10; i++) {
+                mpr_sig_release_inst(sendsig, i);
+            }
+            break;
     }
 
     times[mode*numTrials+trial] = current_time();
@@ -225,7 +267,7 @@ void print_results()
     eprintf("\n*****************************************************\n");
     eprintf("\nRESULTS OF SPEED TEST:\n");
     for (i=0; i<numModes; i++) {
-        eprintf("MODE %i\n", i);
+        eprintf("MODE %i (%s)\n", i, mode_names[i]);
         float bestTime = times[i*numTrials];
         for (j=0; j<numTrials; j++) {
             eprintf("trial %i: %i messages processed in %f seconds\n", j,
@@ -291,6 +333,12 @@ int main(int argc, char **argv)
     while (!done) {
         mpr_dev_poll(dst, 0);
         mpr_dev_poll(src, 0);
+        if (MPR_PROTO_UNDEFINED != pending_proto) {
+            set_map_protocol(pending_proto);
+            pending_proto = MPR_PROTO_UNDEFINED;
+            times[mode*numTrials+trial] = current_time();
+            mpr_sig_set_value(sendsig, counter++, 1, MPR_FLT, &value);
+        }
     }
     goto done;
 